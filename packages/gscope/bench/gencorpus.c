@@ -0,0 +1,304 @@
+
+/*
+ * gencorpus - Generate a synthetic C source tree for Gscope benchmarking.
+ *
+ * The generated tree is fully deterministic for a given set of parameters, so
+ * timings taken against two Gscope builds (or two machines) are comparable.
+ *
+ *   <out>/inc/chain_<c>_<d>.h     Include chains: each header includes the next deeper one.
+ *   <out>/src/dir_<n>/file_<n>.c  Source files spread across sub-directories.
+ *
+ * Every source file defines a set of functions, macros, structs and globals and
+ * calls functions defined in other files, so every Gscope query type has
+ * real work to do.  Optional "long lines" emulate generated code (large table
+ * initializers) which stresses the scanner and the result excerpt logic.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+
+//  ======= #defines ========
+
+#define FILES_PER_DIR   100
+#define INCLUDE_CHAINS  16
+#define CALLS_PER_FUNC  4
+
+
+//  ==== Global Variables ====
+
+static struct
+{
+    const char      *out;
+    unsigned long   files;
+    unsigned long   depth;
+    unsigned long   symbols;
+    unsigned long   long_lines;
+    unsigned long   line_length;
+    unsigned long   seed;
+} params = {NULL, 1000, 4, 20, 2, 4096, 1};
+
+static unsigned long long rng_state;
+static unsigned long long bytes_written;
+
+
+
+//===============================================================
+//      Helpers
+//===============================================================
+
+static unsigned long rng(unsigned long limit)
+{
+    /* 64-bit LCG (Knuth MMIX constants) - portable and reproducible */
+    rng_state = rng_state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return ((unsigned long) (rng_state >> 33) % limit);
+}
+
+
+static void call_graph_seed(unsigned long file)
+{
+    /* Each file draws from its own stream so the call graph is stable per file */
+    rng_state = params.seed * 1000003ULL + file;
+}
+
+
+static void make_dir(const char *path)
+{
+    if (mkdir(path, 0755) != 0 && errno != EEXIST)
+    {
+        fprintf(stderr, "gencorpus: Unable to create directory %s: %s\n", path, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+}
+
+
+static FILE *open_output(const char *path)
+{
+    FILE *fp = fopen(path, "w");
+
+    if (!fp)
+    {
+        fprintf(stderr, "gencorpus: Unable to create %s: %s\n", path, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    return(fp);
+}
+
+
+static void close_output(FILE *fp, const char *path)
+{
+    long size = ftell(fp);
+
+    if (size > 0) bytes_written += size;
+
+    if (ferror(fp) || fclose(fp) != 0)
+    {
+        fprintf(stderr, "gencorpus: Write error on %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+}
+
+
+static unsigned long parse_count(const char *option, const char *value)
+{
+    char            *end;
+    unsigned long   result;
+
+    errno = 0;
+    result = strtoul(value, &end, 10);
+    if (errno || end == value || *end != '\0')
+    {
+        fprintf(stderr, "gencorpus: Invalid value for %s: '%s'\n", option, value);
+        exit(EXIT_FAILURE);
+    }
+    return(result);
+}
+
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "Usage: %s --out DIR [--files N] [--include-depth N] [--symbols N]\n"
+            "          [--long-lines N] [--line-length N] [--seed N]\n\n"
+            "  --out DIR           Root of the generated tree (created if needed)\n"
+            "  --files N           Number of .c files                     [1000]\n"
+            "  --include-depth N   Length of each header include chain    [4]\n"
+            "  --symbols N         Functions defined per .c file          [20]\n"
+            "  --long-lines N      Generated 'table' lines per .c file    [2]\n"
+            "  --line-length N     Approximate length of each long line   [4096]\n"
+            "  --seed N            Random seed                            [1]\n",
+            name);
+    exit(EXIT_FAILURE);
+}
+
+
+
+//===============================================================
+//      Generators
+//===============================================================
+
+static void write_header(const char *path, unsigned long chain, unsigned long level)
+{
+    FILE            *fp = open_output(path);
+    unsigned long   i;
+
+    fprintf(fp, "/* Synthetic header: chain %lu, level %lu */\n\n", chain, level);
+    if (level + 1 < params.depth)
+        fprintf(fp, "#include \"chain_%lu_%lu.h\"\n\n", chain, level + 1);
+
+    fprintf(fp, "#define CHAIN_%lu_LEVEL_%lu_LIMIT  %lu\n\n", chain, level, rng(100000));
+    fprintf(fp, "typedef struct chain_%lu_%lu_s\n{\n", chain, level);
+    for (i = 0; i < 4; i++)
+        fprintf(fp, "    unsigned long   field_%lu;\n", i);
+    fprintf(fp, "} chain_%lu_%lu_t;\n\n", chain, level);
+    fprintf(fp, "extern int chain_%lu_%lu_lookup(chain_%lu_%lu_t *entry, int key);\n", chain, level, chain, level);
+
+    close_output(fp, path);
+}
+
+
+static void write_long_line(FILE *fp, unsigned long file, unsigned long n)
+{
+    unsigned long length;
+
+    length = fprintf(fp, "static const unsigned int table_%lu_%lu[] = {", file, n);
+    while (length < params.line_length)
+        length += fprintf(fp, " 0x%08lx,", rng(0xffffffffUL));
+    fprintf(fp, " 0 };\n");
+}
+
+
+static void write_source(const char *path, unsigned long file)
+{
+    FILE            *fp = open_output(path);
+    unsigned long   chain = file % INCLUDE_CHAINS;
+    unsigned long   i, j;
+
+    fprintf(fp, "/* Synthetic source file %lu */\n\n", file);
+    fprintf(fp, "#include <stdio.h>\n");
+    fprintf(fp, "#include <stdlib.h>\n");
+    if (params.depth)
+    {
+        fprintf(fp, "#include \"chain_%lu_0.h\"\n", chain);
+        fprintf(fp, "#include \"chain_%lu_0.h\"\n", (chain + 1) % INCLUDE_CHAINS);
+    }
+    fprintf(fp, "\n#define FILE_%lu_SCALE  %lu\n", file, rng(1000) + 1);
+    fprintf(fp, "#define FILE_%lu_MASK   0x%lxUL\n\n", file, rng(0xffffffUL));
+
+    fprintf(fp, "struct record_%lu\n{\n    int     key;\n    char    name[32];\n    struct record_%lu *next;\n};\n\n", file, file);
+    fprintf(fp, "static struct record_%lu *record_%lu_head;\n", file, file);
+    fprintf(fp, "int global_counter_%lu = FILE_%lu_SCALE;\n\n", file, file);
+
+    /* Prototypes for the functions this file calls in other files */
+    call_graph_seed(file);
+    for (i = 0; i < params.symbols; i++)
+    {
+        for (j = 0; j < CALLS_PER_FUNC; j++)
+        {
+            unsigned long target_file = rng(params.files);
+            unsigned long target_func = rng(params.symbols);
+
+            fprintf(fp, "extern int func_%lu_%lu(int arg);\n", target_file, target_func);
+        }
+    }
+    fprintf(fp, "\n");
+
+    for (i = 0; i < params.long_lines; i++)
+        write_long_line(fp, file, i);
+    if (params.long_lines) fprintf(fp, "\n");
+
+    /* Replay the same stream so the calls match the prototypes above */
+    call_graph_seed(file);
+
+    for (i = 0; i < params.symbols; i++)
+    {
+        fprintf(fp, "int func_%lu_%lu(int arg)\n{\n", file, i);
+        fprintf(fp, "    int result = arg & FILE_%lu_MASK;\n\n", file);
+        fprintf(fp, "    if (result > global_counter_%lu)\n    {\n", file);
+        fprintf(fp, "        printf(\"func_%lu_%lu: overflow %%d\\n\", result);\n", file, i);
+        fprintf(fp, "        return (-1);\n    }\n");
+        for (j = 0; j < CALLS_PER_FUNC; j++)
+        {
+            unsigned long target_file = rng(params.files);
+            unsigned long target_func = rng(params.symbols);
+
+            fprintf(fp, "    result += func_%lu_%lu(result + %lu);\n", target_file, target_func, j);
+        }
+        if (params.depth)
+            fprintf(fp, "    result += chain_%lu_0_lookup(NULL, CHAIN_%lu_LEVEL_0_LIMIT);\n", chain, chain);
+        fprintf(fp, "    global_counter_%lu += result;\n", file);
+        fprintf(fp, "    return (result);\n}\n\n");
+    }
+
+    close_output(fp, path);
+}
+
+
+
+//===============================================================
+//      Main
+//===============================================================
+
+int main(int argc, char *argv[])
+{
+    char            path[4096];
+    unsigned long   i, c;
+
+    for (i = 1; i < (unsigned long) argc; i++)
+    {
+        const char *opt = argv[i];
+
+        if (i + 1 >= (unsigned long) argc) usage(argv[0]);
+
+        if      (strcmp(opt, "--out")           == 0) params.out         = argv[++i];
+        else if (strcmp(opt, "--files")         == 0) params.files       = parse_count(opt, argv[++i]);
+        else if (strcmp(opt, "--include-depth") == 0) params.depth       = parse_count(opt, argv[++i]);
+        else if (strcmp(opt, "--symbols")       == 0) params.symbols     = parse_count(opt, argv[++i]);
+        else if (strcmp(opt, "--long-lines")    == 0) params.long_lines  = parse_count(opt, argv[++i]);
+        else if (strcmp(opt, "--line-length")   == 0) params.line_length = parse_count(opt, argv[++i]);
+        else if (strcmp(opt, "--seed")          == 0) params.seed        = parse_count(opt, argv[++i]);
+        else usage(argv[0]);
+    }
+
+    if (!params.out || params.files == 0 || params.symbols == 0) usage(argv[0]);
+
+    make_dir(params.out);
+    snprintf(path, sizeof(path), "%s/inc", params.out);
+    make_dir(path);
+    snprintf(path, sizeof(path), "%s/src", params.out);
+    make_dir(path);
+
+    rng_state = params.seed;
+    for (c = 0; c < INCLUDE_CHAINS && params.depth; c++)
+    {
+        for (i = 0; i < params.depth; i++)
+        {
+            snprintf(path, sizeof(path), "%s/inc/chain_%lu_%lu.h", params.out, c, i);
+            write_header(path, c, i);
+        }
+    }
+
+    for (i = 0; i < params.files; i++)
+    {
+        if (i % FILES_PER_DIR == 0)
+        {
+            snprintf(path, sizeof(path), "%s/src/dir_%lu", params.out, i / FILES_PER_DIR);
+            make_dir(path);
+        }
+        snprintf(path, sizeof(path), "%s/src/dir_%lu/file_%lu.c", params.out, i / FILES_PER_DIR, i);
+
+        write_source(path, i);
+    }
+
+    /* Summary on stdout (consumed by run_bench.sh) */
+    printf("\"files\": %lu, \"headers\": %lu, \"include_depth\": %lu, \"symbols\": %lu, "
+           "\"long_lines\": %lu, \"line_length\": %lu, \"seed\": %lu, \"bytes\": %llu\n",
+           params.files, params.depth ? INCLUDE_CHAINS * params.depth : 0, params.depth, params.symbols,
+           params.long_lines, params.line_length, params.seed, bytes_written);
+
+    return(EXIT_SUCCESS);
+}
@@ -0,0 +1,260 @@
+#!/bin/sh
+#
+# run_bench.sh - End-to-end Gscope benchmark.
+#
+# Generates a synthetic C tree with gencorpus, then times:
+#   - A full cross-reference build (--refOnly, no existing database)
+#   - An incremental rebuild after touching 1% of the source files
+#   - A batch of queries of each type (-L batch mode, one process per type)
+#
+# It also checks that N partial builds (--shard I/N) combined with --merge
+# give a cross-reference identical to a single build (--shards 0 skips the
+# check), and fails if they do not.
+#
+# Results are written as JSON (one object) so runs can be diffed against a
+# saved baseline.  All Gscope settings come from a private rc file so the
+# user's ~/.gscope/gscoperc does not influence the numbers.
+#
+# Usage: run_bench.sh --gscope PATH --gencorpus PATH [--work DIR] [--output FILE]
+#                     [--repeat N] [--queries N] [--shards N] [gencorpus options...]
+#
+
+set -e
+
+GSCOPE=
+GENCORPUS=
+WORK=
+OUTPUT=bench-results.json
+REPEAT=3
+QUERIES=20
+SHARDS=4
+CORPUS_ARGS=
+
+usage()
+{
+    sed -n '3,20s/^# \{0,1\}//p' "$0" >&2
+    exit 1
+}
+
+while [ $# -gt 0 ]; do
+    case "$1" in
+        --gscope)       GSCOPE="$2";    shift 2 ;;
+        --gencorpus)    GENCORPUS="$2"; shift 2 ;;
+        --work)         WORK="$2";      shift 2 ;;
+        --output)       OUTPUT="$2";    shift 2 ;;
+        --repeat)       REPEAT="$2";    shift 2 ;;
+        --queries)      QUERIES="$2";   shift 2 ;;
+        --shards)       SHARDS="$2";    shift 2 ;;
+        --files|--include-depth|--symbols|--long-lines|--line-length|--seed)
+                        CORPUS_ARGS="$CORPUS_ARGS $1 $2"; shift 2 ;;
+        *)              usage ;;
+    esac
+done
+
+[ -x "$GSCOPE" ] && [ -x "$GENCORPUS" ] || usage
+
+# Absolute paths: gscope runs from inside the corpus
+case "$GSCOPE" in /*) ;; *) GSCOPE="`pwd`/$GSCOPE" ;; esac
+
+if [ -z "$WORK" ]; then
+    WORK=`mktemp -d "${TMPDIR:-/tmp}/gscope-bench.XXXXXX"`
+    trap 'rm -rf "$WORK"' EXIT
+fi
+mkdir -p "$WORK"
+
+CORPUS="$WORK/corpus"
+REF="$WORK/cscope_db.out"
+RC="$WORK/gscoperc"
+
+# Wall-clock seconds (fractional when the platform date(1) supports %N)
+now()
+{
+    t=`date +%s.%N`
+    case "$t" in *N) date +%s ;; *) echo "$t" ;; esac
+}
+
+elapsed()
+{
+    echo "$1 $2" | awk '{ printf "%.3f", $2 - $1 }'
+}
+
+# Median of the arguments
+median()
+{
+    printf '%s\n' "$@" | sort -n | awk '{ v[NR] = $1 } END { printf "%.3f", (NR % 2) ? v[(NR + 1) / 2] : (v[NR / 2] + v[NR / 2 + 1]) / 2 }'
+}
+
+# Build database $1 (default $REF); any further arguments are passed to gscope
+run_gscope()
+{
+    ref="${1:-$REF}"
+    [ $# -gt 0 ] && shift
+    ( cd "$CORPUS" && "$GSCOPE" -b -R -r "$RC" -f "$ref" -I ":$CORPUS/inc:" "$@" ) > "$WORK/gscope.log" 2>&1 || {
+        echo "run_bench.sh: gscope failed, see $WORK/gscope.log" >&2
+        cat "$WORK/gscope.log" >&2
+        exit 1
+    }
+}
+
+# Build the corpus as $SHARDS partial cross-references, merge them, and compare the result
+# with a single build of the corpus (same directory, so the headers match)
+check_shards()
+{
+    echo "Check: $SHARDS shards + --merge against a single build ..." >&2
+    rm -f "$REF" "$REF".*
+    run_gscope
+
+    parts=
+    s=0
+    while [ $s -lt "$SHARDS" ]; do
+        rm -f "$WORK/part$s.out" "$WORK/part$s.out".*
+        run_gscope "$WORK/part$s.out" --shard $s/$SHARDS
+        parts="$parts $WORK/part$s.out"
+        s=$((s + 1))
+    done
+
+    rm -f "$WORK/merged.out"
+    ( cd "$CORPUS" && "$GSCOPE" -f "$WORK/merged.out" --merge $parts ) > "$WORK/gscope.log" 2>&1 || {
+        echo "run_bench.sh: gscope --merge failed, see $WORK/gscope.log" >&2
+        cat "$WORK/gscope.log" >&2
+        exit 1
+    }
+
+    cmp "$REF" "$WORK/merged.out" || {
+        echo "run_bench.sh: the merged cross-reference differs from a single build ($WORK/merged.out)" >&2
+        exit 1
+    }
+    rm -f $parts "$WORK/merged.out"
+}
+
+# Answer the batch of queries in file $1 against the existing database (no rebuild)
+run_queries()
+{
+    ( cd "$CORPUS" && "$GSCOPE" -L -d -R -r "$RC" -f "$REF" -I ":$CORPUS/inc:" < "$1" ) > "$WORK/query.out" 2> "$WORK/gscope.log" || {
+        echo "run_bench.sh: gscope query failed, see $WORK/gscope.log" >&2
+        cat "$WORK/gscope.log" >&2
+        exit 1
+    }
+}
+
+# Write a batch of $QUERIES queries of type $1 to stdout, spread across the corpus.
+# Query type 8 (all functions) takes no pattern and is asked once.
+make_queries()
+{
+    awk -v type="$1" -v n="$QUERIES" -v files="$NSOURCES" 'BEGIN {
+        if (type == 8) { print "8"; exit }
+        for (i = 0; i < n; i++)
+        {
+            f = int(i * files / n)
+            if      (type == 0) print "0global_counter_" f
+            else if (type == 4) print "4func_" f "_0: overflow"
+            else if (type == 5) print "5func_" f "_[0-9]*: overflow"
+            else if (type == 6) print "6file_" f ".c"
+            else if (type == 7) print "7chain_" (i % 16) "_0.h"
+            else                print type "func_" f "_0"
+        }
+    }'
+}
+
+
+echo "Generating corpus in $CORPUS ..." >&2
+rm -rf "$CORPUS"
+CORPUS_JSON=`"$GENCORPUS" --out "$CORPUS" $CORPUS_ARGS`
+
+SOURCES=`find "$CORPUS/src" -name '*.c' | sort`
+NSOURCES=`echo "$SOURCES" | wc -l | tr -d ' '`
+NTOUCH=$(( (NSOURCES + 99) / 100 ))
+
+# Prime the page cache so the first timed run is not an outlier
+cat $SOURCES > /dev/null
+
+full_times=
+incr_times=
+i=0
+while [ $i -lt "$REPEAT" ]; do
+    i=$((i + 1))
+
+    echo "Run $i/$REPEAT: full build ..." >&2
+    rm -f "$REF" "$REF".*
+    start=`now`
+    run_gscope
+    full_times="$full_times `elapsed $start \`now\``"
+
+    # Build staleness is judged on whole-second mtimes
+    sleep 1
+    echo "$SOURCES" | awk -v n="$NTOUCH" -v step=100 '(NR - 1) % step == 0 && n-- > 0' | xargs touch
+
+    echo "Run $i/$REPEAT: incremental build ($NTOUCH files touched) ..." >&2
+    start=`now`
+    run_gscope
+    incr_times="$incr_times `elapsed $start \`now\``"
+done
+
+if [ "$SHARDS" -gt 0 ]; then
+    check_shards
+fi
+
+# Query timings: the empty batch measures process start-up and database load alone
+QUERY_TYPES="symbol definition called_by calling string regexp file including all_functions"
+: > "$WORK/queries.none"
+load_times=
+for type in 0 1 2 3 4 5 6 7 8; do
+    make_queries $type > "$WORK/queries.$type"
+    eval "query_times_$type="
+done
+i=0
+while [ $i -lt "$REPEAT" ]; do
+    i=$((i + 1))
+    echo "Run $i/$REPEAT: queries ..." >&2
+
+    start=`now`
+    run_queries "$WORK/queries.none"
+    load_times="$load_times `elapsed $start \`now\``"
+
+    for type in 0 1 2 3 4 5 6 7 8; do
+        start=`now`
+        run_queries "$WORK/queries.$type"
+        eval "query_times_$type=\"\$query_times_$type `elapsed $start \`now\``\""
+        eval "query_lines_$type=`grep -v '^gscope: ' "$WORK/query.out" | wc -l | tr -d ' '`"
+    done
+done
+
+DB_BYTES=`wc -c < "$REF" | tr -d ' '`
+VERSION=`"$GSCOPE" -v 2>/dev/null | awk '{ print $NF }'`
+
+json_list()
+{
+    echo "$@" | sed 's/^ *//; s/ *$//; s/  */, /g'
+}
+
+# One "<name>": { ... } member per query type; each batch time includes db_load_sec
+query_json()
+{
+    type=0
+    for name in $QUERY_TYPES; do
+        eval "times=\$query_times_$type; lines=\$query_lines_$type"
+        if [ $type -lt 8 ]; then queries=$QUERIES; sep=,; else queries=1; sep=; fi
+        echo "        \"$name\": { \"queries\": $queries, \"result_lines\": $lines, \"median\": `median $times`, \"runs\": [ `json_list $times` ] }$sep"
+        type=$((type + 1))
+    done
+}
+
+cat > "$OUTPUT" <<EOF
+{
+    "gscope_version": "$VERSION",
+    "host": "`uname -n`",
+    "timestamp": "`date -u +%Y-%m-%dT%H:%M:%SZ`",
+    "repeat": $REPEAT,
+    "corpus": { $CORPUS_JSON },
+    "db_bytes": $DB_BYTES,
+    "shard_merge_check": { "shards": $SHARDS, "identical": `[ "$SHARDS" -gt 0 ] && echo true || echo null` },
+    "full_build_sec": { "median": `median $full_times`, "runs": [ `json_list $full_times` ] },
+    "incremental_build_sec": { "median": `median $incr_times`, "touched_files": $NTOUCH, "runs": [ `json_list $incr_times` ] },
+    "db_load_sec": { "median": `median $load_times`, "runs": [ `json_list $load_times` ] },
+    "query_batch_sec": {
+`query_json`
+    }
+}
+EOF
+
+cat "$OUTPUT"
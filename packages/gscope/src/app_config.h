@@ -27,6 +27,8 @@
 #define menuIconsDef       TRUE
 #define singleClickDef     FALSE
 #define showIncludesDef    FALSE
+#define transitiveIncludesDef FALSE
+#define includersSrcOnlyDef   FALSE
 #define refFileDef         "cscope_db.out"
 #define nameFileDef        ""
 #define includeDirDef      ""
@@ -79,6 +81,8 @@ typedef struct
       gboolean   menuIcons;
       gboolean   singleClick;
       gboolean   showIncludes;
+      gboolean   transitiveIncludes;
+      gboolean   includersSrcOnly;
       gboolean   autoGenEnable;
       // Command agrument [string] settings
       gchar     refFile[MAX_STRING_ARG_SIZE];
@@ -121,6 +125,16 @@ typedef struct
 } sticky_t;
 
 
+/* Configuration file events reported by APP_CONFIG_init() for the front-end to present */
+typedef struct
+{
+    gboolean    create_failed;      /* The default config file could not be created */
+    gboolean    version_changed;    /* First run of a newer Gscope version */
+    gchar       old_version[20];
+    gchar       new_version[20];
+} app_config_status_t;
+
+
 //===============================================================
 // Global Variables
 //===============================================================
@@ -134,8 +148,9 @@ extern sticky_t   sticky_settings;
 // Public Functions
 //===============================================================
 
-void        APP_CONFIG_init        (GtkWidget *gscope_splash);
+void        APP_CONFIG_init        (app_config_status_t *status);
 void        APP_CONFIG_set_boolean (const gchar *key, gboolean value);
 void        APP_CONFIG_set_integer (const gchar *key, gint value);
 void        APP_CONFIG_set_string  (const gchar *key, const gchar *value);
 gboolean    APP_CONFIG_valid_list  (const char *list_name, char *list_ptr, char *delim_char);
+gboolean    APP_CONFIG_create_template(const char *filename, const gchar *template);
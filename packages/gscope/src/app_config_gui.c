@@ -0,0 +1,793 @@
+/*
+ * app_config_gui.c - GUI-only configuration processing
+ *
+ * The application settings [gscoperc] are managed by app_config.c, which is part of the
+ * headless core library.  This module adds the GTK specific pieces: the button theme file
+ * (gtkrc or gscope.css) and the dialogs that report configuration events to the user.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtk/gtk.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <errno.h>
+
+#include "app_config.h"
+#include "app_config_gui.h"
+#include "version.h"
+#include "utils.h"
+
+
+//===============================================================
+// Defines
+//===============================================================
+#define     MAX_UPDATE_MSG  1000
+
+/*** Version Checking Defines ***/
+#define     VCHECK_SIZE     30
+
+#ifdef GTK3_BUILD   // GTK3 (gscope.css)
+#define     CURRENT_CONFIG_VERSION   "001"
+#define     CONFIG_VERSION_TAG       "/*Version="
+
+#else               // GTK2 (gtkrc)
+#define     CURRENT_CONFIG_VERSION   "003"
+#define     CONFIG_VERSION_TAG       "#!Version="
+#endif
+
+
+
+//===============================================================
+// Private Function Prototypes
+//===============================================================
+static gboolean  gtk_config_version_check(char *filename, char *version);
+static void      pixmap_path_fixup       (char *filename, char *path, GtkWidget *parent);
+static void      gtk_config_parse        (char *gtk_config_file);
+
+static gboolean  create_gtk_config_file  (const char *filename);  /* GTK V2/V3 specific config file */
+
+
+
+//===============================================================
+// Public Functions
+//===============================================================
+
+void APP_CONFIG_init_gui(GtkWidget *gscope_splash)
+{
+    static GtkWidget *MsgDialog;
+    app_config_status_t status;
+
+    gchar       gtk_config_file[256] = {0};
+    char        *home;
+
+    APP_CONFIG_init(&status);
+
+    if (status.create_failed)
+    {
+        MsgDialog = gtk_message_dialog_new_with_markup (
+                GTK_WINDOW (gscope_splash),
+                GTK_DIALOG_DESTROY_WITH_PARENT,
+                GTK_MESSAGE_WARNING, 
+                GTK_BUTTONS_CLOSE,
+                "Unable to create default G-Scope configuration file:\n"
+                "%s.\n\n"
+                "Starting program using factory defaults.\n"
+                "G-Scope will not retain configuration changes.", settings.rcFile);
+
+        gtk_dialog_run (GTK_DIALOG (MsgDialog));
+        gtk_widget_destroy (GTK_WIDGET (MsgDialog));
+    }
+
+    home = getenv("HOME");
+    if (home == NULL)       // APP_CONFIG_init() has already reported the problem
+        return;
+
+    strncpy(gtk_config_file, home, 215);
+    #ifdef GTK3_BUILD
+        strncat(gtk_config_file, "/.gscope/gscope.css", 30);
+    #else   // GTK2
+        strncat(gtk_config_file, "/.gscope/gtkrc", 30);
+    #endif
+
+
+    /*** GTK Configuration File Processing ***/
+    /*****************************************/
+
+    // if the application gtkrc config file exists
+    if ( (g_file_test(gtk_config_file, G_FILE_TEST_EXISTS)) && (gtk_config_version_check(gtk_config_file, CURRENT_CONFIG_VERSION)) )
+    {
+        // We found a pre-existing application gtkrc (or gscope.css)
+        // file.  Make sure the 'pixmap_path' is correct for this 
+        // gscope instance.
+        // ==============================================
+        pixmap_path_fixup(gtk_config_file, PACKAGE_DATA_DIR "/" PACKAGE "/pixmaps", gscope_splash);
+        
+        // process the config file
+        //=======================
+        gtk_config_parse(gtk_config_file);
+    }
+    else
+    {
+        // No application gtkrc file found
+        // create a default gtkrc file
+        //================================
+
+        if ( !create_gtk_config_file(gtk_config_file) )
+        {
+            MsgDialog = gtk_message_dialog_new_with_markup (
+                    GTK_WINDOW (gscope_splash),
+                    GTK_DIALOG_DESTROY_WITH_PARENT,
+                    GTK_MESSAGE_WARNING, 
+                    GTK_BUTTONS_CLOSE,
+                    "Unable to create default G-Scope button theme\ntemplate file: %s.\n\n"
+                    "It may not be pretty, but\nG-Scope will still work.", 
+                    gtk_config_file);
+
+            gtk_dialog_run (GTK_DIALOG (MsgDialog));
+            gtk_widget_destroy (GTK_WIDGET (MsgDialog));
+        }
+        else
+        {
+            MsgDialog = gtk_message_dialog_new_with_markup (
+                    GTK_WINDOW (gscope_splash),
+                    GTK_DIALOG_DESTROY_WITH_PARENT,
+                    GTK_MESSAGE_INFO, 
+                    GTK_BUTTONS_CLOSE,
+                    "<span weight=\"bold\" size=\"large\">Updating obsolete (or missing)\n"
+                    "G-Scope button theme.</span>\n\n"
+                    "File: <span weight=\"bold\">%s</span>",
+                    gtk_config_file);
+
+            gtk_dialog_run (GTK_DIALOG (MsgDialog));
+            gtk_widget_destroy (GTK_WIDGET (MsgDialog));
+
+            // process the newly created config file
+            //=====================================
+            gtk_config_parse(gtk_config_file);
+        }
+    }
+
+    if (status.version_changed)
+    {
+        GtkWidget *update_dialog;
+        GtkWidget *update_dialog_hbox;
+        GtkWidget *update_dialog_image;
+        GtkWidget *update_dialog_notification_label;
+        GtkWidget *release_notes_button;
+
+        #ifdef GTK3_BUILD
+        GtkWidget *update_dialog_content_area;
+        #else
+        GtkWidget *update_dialog_vbox;
+        GtkWidget *update_dialog_action_area;
+        #endif
+
+        gchar     update_msg[MAX_UPDATE_MSG];
+
+        snprintf(update_msg, MAX_UPDATE_MSG, "<span weight=\"bold\" size=\"large\">\nYour installation of Gscope has been updated.</span>\n\n"
+                             "Old Version:   %s\n"
+                             "New Version:  %s\n\n"
+                             "%s"
+                             "Follow the link below to view the latest release notes.",
+                             status.old_version,
+                             status.new_version,
+                             VERSION_ANNOUNCE);
+
+        update_dialog_notification_label = gtk_label_new(NULL);
+        gtk_label_set_markup (GTK_LABEL(update_dialog_notification_label), update_msg);
+        gtk_widget_set_name (update_dialog_notification_label, "update_dialog_notification_label");
+        gtk_widget_show (update_dialog_notification_label);
+
+        update_dialog_image = gtk_image_new_from_icon_name ("gtk-dialog-info", GTK_ICON_SIZE_DIALOG);
+        gtk_widget_set_name (update_dialog_image, "update_dialog_image");
+        gtk_widget_show (update_dialog_image);
+
+
+        update_dialog = gtk_dialog_new ();
+        gtk_widget_set_name (update_dialog, "update_dialog");
+        gtk_window_set_title(GTK_WINDOW (update_dialog), "");
+        gtk_window_set_transient_for(GTK_WINDOW (update_dialog), GTK_WINDOW(gscope_splash));
+        gtk_window_set_position (GTK_WINDOW (update_dialog), GTK_WIN_POS_CENTER_ON_PARENT);
+        gtk_window_set_modal (GTK_WINDOW (update_dialog), TRUE);
+        gtk_window_set_resizable (GTK_WINDOW (update_dialog), FALSE);
+        gtk_window_set_destroy_with_parent (GTK_WINDOW (update_dialog), TRUE);
+
+
+        #ifdef GTK3_BUILD
+
+        update_dialog_content_area = gtk_dialog_get_content_area( GTK_DIALOG(update_dialog) );
+
+        update_dialog_hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
+        gtk_widget_set_name (update_dialog_hbox, "update_dialog_hbox");
+        gtk_container_add(GTK_CONTAINER(update_dialog_content_area), update_dialog_hbox);
+
+        gtk_box_pack_start (GTK_BOX (update_dialog_hbox), update_dialog_image, FALSE, FALSE, 0);
+        gtk_box_pack_start (GTK_BOX (update_dialog_hbox), update_dialog_notification_label, TRUE, TRUE, 0);
+
+
+        release_notes_button = gtk_link_button_new_with_label("https://github.com/tefletch/gscope/wiki/Gscope-Release-Notes",
+                                                              "Gscope Release Notes");
+        gtk_widget_set_name (release_notes_button, "release_notes_button");
+
+        gtk_dialog_add_action_widget(GTK_DIALOG(update_dialog), release_notes_button, 0);
+
+        gtk_widget_show_all(update_dialog);
+
+        #else
+
+        gtk_window_set_type_hint (GTK_WINDOW (update_dialog), GDK_WINDOW_TYPE_HINT_DIALOG);
+        gtk_dialog_set_has_separator (GTK_DIALOG (update_dialog), FALSE);
+
+        update_dialog_vbox = GTK_DIALOG (update_dialog)->vbox;
+        gtk_widget_set_name (update_dialog_vbox, "update_dialog_vbox");
+        gtk_widget_show (update_dialog_vbox);
+
+        update_dialog_hbox = gtk_hbox_new (FALSE, 0);
+        gtk_widget_set_name (update_dialog_hbox, "update_dialog_hbox");
+        gtk_widget_show (update_dialog_hbox);
+        gtk_box_pack_start (GTK_BOX (update_dialog_vbox), update_dialog_hbox, TRUE, TRUE, 0);
+
+        gtk_box_pack_start (GTK_BOX (update_dialog_hbox), update_dialog_image, FALSE, FALSE, 0);
+        gtk_box_pack_start (GTK_BOX (update_dialog_hbox), update_dialog_notification_label, TRUE, TRUE, 0);
+
+        update_dialog_action_area = GTK_DIALOG (update_dialog)->action_area;
+        gtk_widget_set_name (update_dialog_action_area, "update_dialog_action_area");
+        gtk_widget_show (update_dialog_action_area);
+        gtk_button_box_set_layout (GTK_BUTTON_BOX (update_dialog_action_area), GTK_BUTTONBOX_SPREAD);
+
+        release_notes_button = gtk_link_button_new_with_label("https://github.com/tefletch/gscope/wiki/Gscope-Release-Notes",
+                                                              "Gscope Release Notes");
+
+        gtk_widget_set_name (release_notes_button, "release_notes_button");
+        gtk_dialog_add_action_widget (GTK_DIALOG (update_dialog), release_notes_button, GTK_RESPONSE_APPLY);
+        GTK_WIDGET_SET_FLAGS (release_notes_button, GTK_CAN_DEFAULT);
+
+        gtk_widget_show_all(update_dialog);
+
+        #endif
+
+        gtk_dialog_run (GTK_DIALOG (update_dialog));
+        gtk_widget_destroy (GTK_WIDGET (update_dialog));
+    }
+    return;
+}
+
+
+
+//=================================== 
+// Private Functions
+//===================================
+
+
+static void gtk_config_parse(char *gtk_config_file)
+{
+    #ifdef GTK3_BUILD
+    {
+        GtkCssProvider  *provider;
+        GdkDisplay      *display;
+        GdkScreen       *screen;
+
+        provider = gtk_css_provider_new();
+
+        #if 1 // applies to all widgets on the screen
+
+        display  = gdk_display_get_default();
+        screen   = gdk_display_get_default_screen(display);
+        gtk_style_context_add_provider_for_screen(screen, GTK_STYLE_PROVIDER(provider), GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
+
+        gtk_css_provider_load_from_path(provider, gtk_config_file, NULL);
+        g_object_unref(provider);
+
+        #else  // affect only specific widgets  g_object_get_data(G_OBJECT(widget), name)
+        GtkStyleContext *context;
+
+        context = gtk_widget_get_style_context(GTK_WIDGET(gtk_builder_get_object(builder, "find_c_identifier_button")));
+        gtk_css_provider_load_from_path(provider, "gscope.css", NULL);
+
+        gtk_style_context_add_provider(context, GTK_STYLE_PROVIDER(provider), GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
+        g_object_unref(provider);
+
+        #endif
+    }
+    #else       // GTK2
+        gtk_rc_parse(gtk_config_file);
+    #endif
+}
+
+
+
+
+
+
+static gboolean gtk_config_version_check(char *filename, char *version)
+{
+
+    FILE *rc_file;
+    char file_buf[VCHECK_SIZE];
+    gboolean retval = FALSE;
+
+
+    /* Check the version tag */
+    rc_file = fopen(filename, "r");
+
+    if (rc_file)
+    {
+        // grab the first VCHECK_SIZE bytes from the file
+        if (fread(file_buf, 1, VCHECK_SIZE, rc_file) < VCHECK_SIZE)
+        {
+            fclose(rc_file);
+            return(retval);
+        }
+
+        if (strncmp(file_buf, CONFIG_VERSION_TAG, 10) == 0)   // if we find the tag: #!Version=
+        {
+            /* Check the version number */
+            if (strncmp(file_buf + 10, version, 3) >= 0)   // If version string in file is >= version string param.
+            {
+                retval = TRUE;
+            }
+        }
+
+        fclose(rc_file);
+    }
+
+    return(retval);
+}
+
+
+
+
+static void pixmap_path_fixup(char *filename, char *path, GtkWidget *parent)
+{
+    FILE    *config_file;
+    char    *config_file_buf = NULL;
+    char    *sub_string;
+    struct  stat statstruct;
+    gboolean path_ok = FALSE;
+    GtkWidget *MsgDialog;
+
+    // open gtk config file and locate pixmap path string
+    if ( stat(filename, &statstruct) == 0 )                                                     // if we can stat() the file
+    {
+        if ( (config_file = fopen(filename, "rwb")) )                                           // and we can open the file
+        {
+            if ( (config_file_buf = g_malloc(statstruct.st_size)) )                             // and we can alloc a buffer
+            {
+                if ( fread(config_file_buf, 1, statstruct.st_size, config_file) == statstruct.st_size ) // and we can read the file into the buffer
+                {
+                    sub_string = strstr(config_file_buf, path);
+                    if (sub_string)      // Might be a good path, check delimiters
+                    {
+                        #ifdef GTK3_BUILD
+                        if ( *(sub_string - 1) == '\'')
+                            if ( *(sub_string + strlen(path)) == '/' )
+                                path_ok = TRUE;
+                        #else       // GTK2
+                            if ( *(sub_string - 1) == '"' || *(sub_string - 1) == ':' )
+                                if ( *(sub_string + strlen(path)) == '"' || *(sub_string + strlen(path)) == ':' )
+                                    path_ok = TRUE;
+                        #endif
+                    }
+
+                    // compare in-file pixmap_path with "path" parameter
+                    if ( !path_ok )
+                    {
+                        char *new_filename; 
+
+                        // Preserve possible end-user customization
+                        my_asprintf(&new_filename, "%s.sav", filename);
+                        if ( rename(filename, new_filename) < 0 )
+                            fprintf(stderr,"Warning: Unable to rename original GTK config file:\n%s\n", strerror(errno));
+
+                        create_gtk_config_file(filename);
+
+                        MsgDialog = gtk_message_dialog_new_with_markup (
+                                GTK_WINDOW (parent),
+                                GTK_DIALOG_DESTROY_WITH_PARENT,
+                                GTK_MESSAGE_INFO, 
+                                GTK_BUTTONS_CLOSE,
+                                "<span weight=\"bold\" size=\"large\">Fixed bad pixmap_path in G-Scope button theme.</span>\n\n"
+                                "If you had customizations in <span weight=\"bold\">%s</span> you will need to merge them back"
+                                "from your old config file"
+                                "(now named %s)",
+                                filename,
+                                new_filename);
+
+                        gtk_dialog_run (GTK_DIALOG (MsgDialog));
+                        gtk_widget_destroy (GTK_WIDGET (MsgDialog));
+                        g_free(new_filename);
+                    }
+                }
+                g_free(config_file_buf);
+            }
+            fclose(config_file);
+        }
+    }
+}
+
+
+
+
+#ifdef GTK3_BUILD
+static gboolean create_gtk_config_file(const char *filename)
+{
+
+gchar *template =
+{
+"/*Version=001 */"
+"\n"
+"\n/*"
+"\nDocumentation for styling GTK+ using CSS is kind of scattered.  The following"
+"\nlinks have been useful:"
+"\n"
+"\nhttps://thegnomejournal.wordpress.com/2011/03/15/styling-gtk-with-css/   (Styling GTK+ with CSS)"
+"\n"
+"\nhttp://www.gtkforums.com/viewtopic.php?f=3&t=988&p=72088=GTK3+with+CSS#p72088  (GTK forums 'GTK3 with CSS')-Lots of examples"
+"\n"
+"\nhttps://developer.gnome.org/gtk3/3.14/GtkCssProvider.html   (GTK 3.14 Reference - Gtk CssProvider)"
+"\n"
+"\nhttps://developer.gnome.org/gtk3/3.0/ch25s02.html#gtk-migrating-GtkStyleContext (Porting GTK2 to 3 in general, Migrating themes info)"
+"\n"
+"\nhttps://developer.gnome.org/gtk3/stable/GtkStyleContext.html  (GtkStyleContext - Rendering UI elements)"
+"\n*/"
+"\n"
+"\n"
+"\n/*--------- Blue Buttons------------*/"
+"\n"
+"\n#find_c_identifier_button,"
+"\n#find_definition_of_button"
+"\n{"
+"\n    padding: 5px;"
+"\n    /* border-radius: 15px; */"
+"\n    /* border-style: solid; */"
+"\n    /* border-width: 1px; */"
+"\n    /* transition: 500ms linear; */"
+"\n    /* font: Sans 16; */"
+"\n    /* background-color: blue; */"
+"\n    /* border-width: 3px 3px 3px 3px; */"
+"\n    background-image: url('" PACKAGE_DATA_DIR "/" PACKAGE "/pixmaps/blue-button-normal-wide.png');"
+"\n    background-position: center;"
+"\n    color: white;"
+"\n}"
+"\n"
+"\n#find_c_identifier_button:prelight,"
+"\n#find_definition_of_button:prelight"
+"\n{"
+"\n    background-image: url('" PACKAGE_DATA_DIR "/" PACKAGE "/pixmaps/blue-button-prelight.png');"
+"\n    color: cadetblue1;"
+"\n}"
+"\n"
+"\n#find_c_identifier_button:active,"
+"\n#find_definition_of_button:active"
+"\n{"
+"\n    background-image: url('" PACKAGE_DATA_DIR "/" PACKAGE "/pixmaps/blue-button-pressed.png');"
+"\n    color: yellow;"
+"\n}"
+"\n"
+"\n"
+"\n/*--------- Red Buttons ------------*/"
+"\n"
+"\n#find_functions_called_by_button,"
+"\n#find_functions_calling_button"
+"\n{"
+"\n    padding: 5px;"
+"\n    background-image: url('" PACKAGE_DATA_DIR "/" PACKAGE "/pixmaps/red-button-normal-wide.png');"
+"\n    background-position: center;"
+"\n    color: white;"
+"\n}"
+"\n"
+"\n#find_functions_called_by_button:prelight,"
+"\n#find_functions_calling_button:prelight"
+"\n{"
+"\n    background-image: url('" PACKAGE_DATA_DIR "/" PACKAGE "/pixmaps/red-button-prelight.png');"
+"\n    color: lavenderblush;"
+"\n}"
+"\n"
+"\n#find_functions_called_by_button:active,"
+"\n#find_functions_calling_button:active"
+"\n{"
+"\n    background-image: url('" PACKAGE_DATA_DIR "/" PACKAGE "/pixmaps/red-button-pressed.png');"
+"\n    color: yellow;"
+"\n}"
+"\n"
+"\n"
+"\n/*--------- Green Buttons ------------*/"
+"\n"
+"\n#find_text_string_button,"
+"\n#find_egrep_pattern_button"
+"\n{"
+"\n    padding: 5px;"
+"\n    background-image: url('" PACKAGE_DATA_DIR "/" PACKAGE "/pixmaps/green-button-normal-wide.png');"
+"\n    background-position: center;"
+"\n    color: white;"
+"\n}"
+"\n"
+"\n#find_text_string_button:prelight,"
+"\n#find_egrep_pattern_button:prelight"
+"\n{"
+"\n    background-image: url('" PACKAGE_DATA_DIR "/" PACKAGE "/pixmaps/green-button-prelight.png');"
+"\n    color: darkseagreen1;"
+"\n}"
+"\n"
+"\n#find_text_string_button:active,"
+"\n#find_egrep_pattern_button:active"
+"\n{"
+"\n    background-image: url('" PACKAGE_DATA_DIR "/" PACKAGE "/pixmaps/green-button-pressed.png');"
+"\n    color: yellow;"
+"\n}"
+"\n"
+"\n"
+"\n/*--------- Orange Buttons------------*/"
+"\n"
+"\n#find_files_button,"
+"\n#find_files_including_button"
+"\n{"
+"\n    padding: 5px;"
+"\n    background-image: url('" PACKAGE_DATA_DIR "/" PACKAGE "/pixmaps/orange-button-normal-wide.png');"
+"\n    background-position: center;"
+"\n    color: white;"
+"\n}"
+"\n"
+"\n#find_files_button:prelight,"
+"\n#find_files_including_button:prelight"
+"\n{"
+"\n    background-image: url('" PACKAGE_DATA_DIR "/" PACKAGE "/pixmaps/orange-button-prelight.png');"
+"\n    color: lightgoldenrod;"
+"\n}"
+"\n"
+"\n#find_files_button:active,"
+"\n#find_files_including_button:active"
+"\n{"
+"\n    background-image: url('" PACKAGE_DATA_DIR "/" PACKAGE "/pixmaps/orange-button-pressed.png');"
+"\n    color: yellow;"
+"\n}"
+"\n"
+"\n/*---------------------------------*/"
+"\n"
+"\n#clear_query_button"
+"\n{"
+"\n    padding: 0px;"
+"\n}"
+"\n"
+"\n"
+"\nGtkNotebook"
+"\n{"
+"\n    padding: 5px;"
+"\n}"
+"\n"
+"\n/*"
+"\nGtkTreeView row:nth-child(even)"
+"\n{"
+"\n    background-color: shade(steelblue, 2.0);"
+"\n}"
+"\n"
+"\nGtkTreeView row:nth-child(odd)"
+"\n{"
+"\n    background-color: shade(@base_color, 1.0);"
+"\n}"
+"\n*/"
+"\n"
+"\nGtkTreeView row:selected"
+"\n{"
+"\nbackground-color:steelblue;"
+"\ncolor:#fff;"
+"\n}"
+"\n"
+"\nGtkTreeView row:selected:focused"
+"\n{"
+"\nbackground-color:steelblue;"
+"\ncolor:#fff;"
+"\n}"
+"\n"
+};
+
+    return( APP_CONFIG_create_template(filename, template) );
+}
+
+#else
+
+static gboolean create_gtk_config_file(const char *filename)
+{
+
+gchar *template =
+{
+"#!Version=003"
+"\n# This is ""the initial gtkrc template file created automatically by Gscope."
+"\n# Edit this file to make your own GTK customizations. If you would like" 
+"\n# gscope to create a fresh template just delete/rename this file and run gscope."
+"\n"
+"\n"
+"\n# If you want to override some, or all, of the stock gscope button pixmaps, "
+"\n# add the path to your pixmaps in front of the stock path.  For example"
+"\n# pixmap_path \"/home/username/.gscope:/usr/local/share/gscope/pixmaps\""
+"\n"
+"\npixmap_path \"" PACKAGE_DATA_DIR "/" PACKAGE "/pixmaps\""
+"\n"
+"\n"
+"\nstyle \"blue-button\""
+"\n{"
+"\n"
+"\n  engine \"pixmap\""
+"\n  {"
+"\n    image"
+"\n    {"
+"\n      function          = BOX"
+"\n      state             = PRELIGHT"
+"\n      recolorable       = TRUE"
+"\n      file              = \"blue-button-prelight.png\""
+"\n      border            = { 3, 3, 3, 3}"
+"\n      stretch           = TRUE"
+"\n    }"
+"\n    image"
+"\n    {"
+"\n      function          = BOX"
+"\n      state             = ACTIVE"
+"\n      file              = \"blue-button-pressed.png\""
+"\n      border            = { 3, 3, 3, 3 }"
+"\n      stretch           = TRUE"
+"\n    }"
+"\n    image "
+"\n    {"
+"\n      function          = BOX"
+"\n      state             = NORMAL"
+"\n      file              = \"blue-button-normal.png\""
+"\n      border            = { 3, 3, 3, 3 }"
+"\n      stretch           = TRUE"
+"\n    }"
+"\n  }"
+"\n"
+"\n  fg[ACTIVE]      = \"yellow\""
+"\n  fg[SELECTED]    = \"white\""
+"\n  fg[NORMAL]      = \"white\""
+"\n  fg[PRELIGHT]    = \"cadetblue1\""
+"\n  fg[INSENSITIVE] = \"white\""
+"\n"
+"\n}"
+"\n"
+"\n"
+"\n"
+"\nstyle \"red-button\""
+"\n{"
+"\n"
+"\n  engine \"pixmap\""
+"\n  {"
+"\n    image"
+"\n    {"
+"\n      function          = BOX"
+"\n      state             = PRELIGHT"
+"\n      recolorable       = TRUE"
+"\n      file              = \"red-button-prelight.png\""
+"\n      border            = { 3, 3, 3, 3}"
+"\n      stretch           = TRUE"
+"\n    }"
+"\n    image"
+"\n    {"
+"\n      function          = BOX"
+"\n      state             = ACTIVE"
+"\n      file              = \"red-button-pressed.png\""
+"\n      border            = { 3, 3, 3, 3 }"
+"\n      stretch           = TRUE"
+"\n    }"
+"\n    image "
+"\n    {"
+"\n      function          = BOX"
+"\n      state             = NORMAL"
+"\n      file              = \"red-button-normal.png\""
+"\n      border            = { 3, 3, 3, 3 }"
+"\n      stretch           = TRUE"
+"\n    }"
+"\n  }"
+"\n"
+"\n  fg[ACTIVE]      = \"yellow\""
+"\n  fg[SELECTED]    = \"white\""
+"\n  fg[NORMAL]      = \"white\""
+"\n  fg[PRELIGHT]    = \"lavenderblush\""
+"\n  fg[INSENSITIVE] = \"white\""
+"\n"
+"\n}"
+"\n"
+"\n"
+"\n"
+"\nstyle \"green-button\""
+"\n{"
+"\n"
+"\n  engine \"pixmap\""
+"\n  {"
+"\n    image"
+"\n    {"
+"\n      function          = BOX"
+"\n      state             = PRELIGHT"
+"\n      recolorable       = TRUE"
+"\n      file              = \"green-button-prelight.png\""
+"\n      border            = { 3, 3, 3, 3}"
+"\n      stretch           = TRUE"
+"\n    }"
+"\n    image"
+"\n    {"
+"\n      function          = BOX"
+"\n      state             = ACTIVE"
+"\n      file              = \"green-button-pressed.png\""
+"\n      border            = { 3, 3, 3, 3 }"
+"\n      stretch           = TRUE"
+"\n    }"
+"\n    image "
+"\n    {"
+"\n      function          = BOX"
+"\n      state             = NORMAL"
+"\n      file              = \"green-button-normal.png\""
+"\n      border            = { 3, 3, 3, 3 }"
+"\n      stretch           = TRUE"
+"\n    }"
+"\n  }"
+"\n"
+"\n  fg[ACTIVE]      = \"yellow\""
+"\n  fg[SELECTED]    = \"white\""
+"\n  fg[NORMAL]      = \"white\""
+"\n  fg[PRELIGHT]    = \"darkseagreen1\""
+"\n  fg[INSENSITIVE] = \"white\""
+"\n"
+"\n}"
+"\n"
+"\n"
+"\n"
+"\nstyle \"orange-button\""
+"\n{"
+"\n"
+"\n  engine \"pixmap\""
+"\n  {"
+"\n    image"
+"\n    {"
+"\n      function          = BOX"
+"\n      state             = PRELIGHT"
+"\n      recolorable       = TRUE"
+"\n      file              = \"orange-button-prelight.png\""
+"\n      border            = { 3, 3, 3, 3}"
+"\n      stretch           = TRUE"
+"\n    }"
+"\n    image"
+"\n    {"
+"\n      function          = BOX"
+"\n      state             = ACTIVE"
+"\n      file              = \"orange-button-pressed.png\""
+"\n      border            = { 3, 3, 3, 3 }"
+"\n      stretch           = TRUE"
+"\n    }   "
+"\n    image "
+"\n    {"
+"\n      function          = BOX"
+"\n      state             = NORMAL"
+"\n      file              = \"orange-button-normal.png\""
+"\n      border            = { 3, 3, 3, 3 }"
+"\n      stretch           = TRUE"
+"\n    }"
+"\n  }"
+"\n"
+"\n  fg[ACTIVE]      = \"yellow\""
+"\n  fg[SELECTED]    = \"white\""
+"\n  fg[NORMAL]      = \"white\""
+"\n  fg[PRELIGHT]    = \"lightgoldenrod\""
+"\n  fg[INSENSITIVE] = \"white\""
+"\n"
+"\n}"
+"\n"
+"\n"
+"\nwidget  \"*find_c_identifier_button*\"        style \"blue-button\""
+"\nwidget  \"*find_definition_of_button*\"       style \"blue-button\""
+"\n"
+"\nwidget  \"*find_functions_called_by_button*\" style \"red-button\""
+"\nwidget  \"*find_functions_calling_button*\"   style \"red-button\""
+"\n"
+"\nwidget  \"*find_text_string_button*\"         style \"green-button\""
+"\nwidget  \"*find_egrep_pattern_button*\"       style \"green-button\""
+"\n"
+"\nwidget  \"*find_files_button*\"               style \"orange-button\""
+"\nwidget  \"*find_files_including_button*\"     style \"orange-button\""
+};
+
+    return( APP_CONFIG_create_template(filename, template) );
+}
+#endif
@@ -0,0 +1,6 @@
+
+//===============================================================
+// Public Functions
+//===============================================================
+
+void        APP_CONFIG_init_gui    (GtkWidget *gscope_splash);
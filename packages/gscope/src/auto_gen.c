@@ -9,7 +9,6 @@
 #include <stdlib.h>
 #include <ftw.h>
 #include <glib.h>
-#include <gtk/gtk.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <time.h>
@@ -22,7 +21,8 @@
 #include "utils.h"
 #include "auto_gen.h"
 #include "search.h"
-#include "display.h"
+#include "core.h"
+#include "trace.h"
 #include "app_config.h"
 
 //===============================================================
@@ -302,6 +302,7 @@ void AUTOGEN_run(char *data_dir)
     char    compiledBuf  [PATHLEN + sizeof(GSCOPE_GEN_DIR) + PATHLEN + PATHLEN + 10]; //Path to the compiled .pb-c.c file
 
     gettimeofday(&autogen_time_start, NULL);
+    TRACE_BEGIN("autogen", NULL);
 
     no_compile_flag = FALSE;    
     src_file_index = 0;
@@ -350,10 +351,13 @@ void AUTOGEN_run(char *data_dir)
         // If the proto file is newer than the cross reference
         if (difftime(statstruct.st_mtime, compile_time) > 0 || no_compile_flag || settings.updateAll)
         {
+             TRACE_BEGIN("autogen job", file_path_buf);
              _protobuf_csrc(file_path_buf, data_dir);
+             TRACE_END("autogen job");
         }       
         src_file_index++;
     }
+    TRACE_END("autogen");
     gettimeofday(&autogen_time_stop, NULL);
    
     /* Timing calculations: calculate milliseconds */
@@ -847,7 +851,7 @@ static void _do_garbage_collection()
                          "If you are seeing this message on a regular basis, you may want to increase the CACHE "
                          "GARBAGE COLLECTION THRESHOLD preference value.  See:\n\n(Options-->Preferences-->Cross Reference)";                      
         if ( !settings.refOnly )
-            DISPLAY_msg(GTK_MESSAGE_INFO, message);
+            CORE_msg(CORE_MSG_INFO, message);
         else
             fprintf(stderr,"%s\n", message);
     }
@@ -0,0 +1,758 @@
+/*
+ *  gscope block-compressed cross-reference files (LZ4)
+ *
+ *  Blocks are independent.  A whole file is compressed (and, for the build, decompressed)
+ *  by a small pool of threads that take the next unclaimed block from a shared counter.
+ *  A search scan decompresses block n into slot n % BLOCKS_PREFETCH on a thread pool, so the
+ *  blocks ahead of the scan are ready when it gets to them and only BLOCKS_PREFETCH blocks are
+ *  decompressed at any time.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#include <lz4hc.h>
+#endif
+
+#include "scanner.h"
+#include "blocks.h"
+
+
+//===============================================================
+//      Defines
+//===============================================================
+
+/* The layout of a block-compressed file */
+typedef struct
+{
+    const gchar *src;           /* Compressed file contents */
+    guint64     *src_offsets;   /* File offset of every block */
+    guint32     *src_sizes;     /* Compressed size of every block */
+    guint64     *offsets;       /* Data offset of every block, and the data size */
+    guint32     nblocks;
+} block_table_t;
+
+
+/* A decompressed block */
+typedef struct
+{
+    gchar       *data;          /* Block data, followed by an end-of-symbols mark */
+    gsize       capacity;
+    gint64      block;          /* Block held, -1 if none */
+    gboolean    ready;          /* (Scan slots) decompressed */
+    gboolean    failed;
+} block_buf_t;
+
+
+struct blocks_cref
+{
+    gchar           *map;       /* The mapped file */
+    gsize           map_size;
+    gboolean        compressed;
+    block_table_t   table;      /* (Block-compressed file) */
+    block_buf_t     at;         /* The block BLOCKS_at() points into */
+};
+
+
+struct blocks_scan
+{
+    BLOCKS_cref_t   *cref;
+    guint32         block;      /* Block being scanned */
+    char            *data;      /* Its data */
+    GThreadPool     *pool;      /* Decompresses the blocks ahead of the scan */
+    GMutex          lock;
+    GCond           decoded;
+    block_buf_t     slots[BLOCKS_PREFETCH];
+};
+
+
+typedef struct
+{
+    block_table_t   *table;
+    gchar           *dst;       /* Cross-reference data */
+    gint            next;       /* Next unclaimed block (atomic) */
+    gint            failed;
+} decode_job_t;
+
+
+typedef struct
+{
+    const gchar *src;           /* Cross-reference data */
+    guint64     *offsets;       /* Data offset of every block, and the data size */
+    guint32     nblocks;
+    gchar       **blocks;       /* Compressed blocks */
+    guint32     *sizes;
+    gint        next;           /* Next unclaimed block (atomic) */
+    gint        failed;
+} encode_job_t;
+
+
+
+//===============================================================
+//      Private Function Prototypes
+//===============================================================
+
+static gboolean select_compress (const gchar *option_name, const gchar *value, gpointer data, GError **error);
+static gboolean lz4_available   (void);
+static void     run_threads     (GThreadFunc func, gpointer job, guint32 nblocks);
+static gboolean parse_value     (const gchar **read_ptr, const gchar *end, guint64 *value);
+static gboolean parse_header    (const gchar *file_data, gsize file_size, block_table_t *table);
+static void     free_table      (block_table_t *table);
+static gboolean decode_file     (block_table_t *table, gchar *dst);
+static gboolean decode_block    (const block_table_t *table, guint32 block, block_buf_t *buf);
+static void     damaged         (void);
+static void     prefetch        (BLOCKS_scan_t *scan, guint32 block);
+static void     decode_ahead    (gpointer data, gpointer user_data);
+static char     *wait_for_block (BLOCKS_scan_t *scan, guint32 block);
+static guint32  split_blocks    (const gchar *data, gsize data_size, guint64 **offsets);
+#ifdef HAVE_LZ4
+static gpointer decode_blocks   (gpointer data);
+static gpointer encode_blocks   (gpointer data);
+#endif
+
+
+
+//===============================================================
+//      Private Globals
+//===============================================================
+
+static gboolean compress_requested = FALSE;
+
+static const char end_mark[]     = { '\t', NEWFILE, '\n' };     /* End of symbols */
+static const char section_mark[] = { '\n', '\t', NEWFILE };     /* Start of a file section */
+
+
+
+//===============================================================
+//      Public Globals
+//===============================================================
+
+GOptionEntry BLOCKS_options[] = {
+    {
+        "block-compress", 0, G_OPTION_FLAG_NO_ARG, G_OPTION_ARG_CALLBACK, select_compress,
+        "Write the cross-reference file in LZ4-compressed blocks (smaller on disk and in memory, decompressed while searching).", NULL
+    },
+    { NULL }
+};
+
+
+
+//===============================================================
+//      Private Functions
+//===============================================================
+
+static gboolean select_compress(const gchar *option_name, const gchar *value, gpointer data, GError **error)
+{
+    #ifdef HAVE_LZ4
+    compress_requested = TRUE;
+    return(TRUE);
+    #else
+    g_set_error(error, G_OPTION_ERROR, G_OPTION_ERROR_FAILED, "%s: gscope was built without LZ4 support", option_name);
+    return(FALSE);
+    #endif
+}
+
+
+
+static gboolean lz4_available()
+{
+    #ifdef HAVE_LZ4
+    return(TRUE);
+    #else
+    fprintf(stderr, "Error: gscope was built without LZ4 support: cannot read a block-compressed cross-reference\n");
+    return(FALSE);
+    #endif
+}
+
+
+
+/* Run 'func' on up to BLOCKS_MAX_THREADS threads (including this one) */
+static void run_threads(GThreadFunc func, gpointer job, guint32 nblocks)
+{
+    GThread *threads[BLOCKS_MAX_THREADS];
+    long    nthreads;
+    long    i;
+
+    nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+    nthreads = CLAMP(nthreads, 1, MIN(BLOCKS_MAX_THREADS, MAX(nblocks, 1)));
+
+    for (i = 1; i < nthreads; i++)
+        threads[i] = g_thread_new("cref-blocks", func, job);
+
+    func(job);
+
+    for (i = 1; i < nthreads; i++)
+        g_thread_join(threads[i]);
+}
+
+
+
+/* Read one decimal header field (and its delimiter) */
+static gboolean parse_value(const gchar **read_ptr, const gchar *end, guint64 *value)
+{
+    gchar   *next;
+
+    if (*read_ptr >= end || !g_ascii_isdigit(**read_ptr))
+        return(FALSE);
+
+    *value    = g_ascii_strtoull(*read_ptr, &next, 10);
+    *read_ptr = next + 1;
+    return(TRUE);
+}
+
+
+
+/* Parse the header and block table into 'table' (free_table() it, valid or not) */
+static gboolean parse_header(const gchar *file_data, gsize file_size, block_table_t *table)
+{
+    const gchar *end = file_data + file_size;
+    const gchar *read_ptr;
+    guint64     values[3];
+    guint64     length;
+    guint64     size;
+    guint64     offset;
+    guint32     i;
+
+    memset(table, 0, sizeof(block_table_t));
+    table->src = file_data;
+    read_ptr   = file_data + strlen(BLOCKS_MAGIC " ");
+
+    for (i = 0; i < 3; i++)
+    {
+        if ( !parse_value(&read_ptr, end, &values[i]) )
+            return(FALSE);
+    }
+
+    /* Every block has a table line: the count can't exceed the file size */
+    if (values[0] != BLOCKS_VERSION || values[2] == 0 || values[2] > file_size)
+        return(FALSE);
+
+    table->nblocks     = values[2];
+    table->offsets     = g_new0(guint64, table->nblocks + 1);
+    table->src_offsets = g_new0(guint64, table->nblocks);
+    table->src_sizes   = g_new0(guint32, table->nblocks);
+
+    for (i = 0; i < table->nblocks; i++)
+    {
+        if ( !parse_value(&read_ptr, end, &length) || !parse_value(&read_ptr, end, &size) ||
+             length == 0 || length > G_MAXINT || size > G_MAXINT )
+            return(FALSE);
+
+        table->offsets[i + 1] = table->offsets[i] + length;
+        table->src_sizes[i]   = size;
+    }
+
+    /* The blocks follow the table */
+    offset = read_ptr - file_data;
+    for (i = 0; i < table->nblocks; i++)
+    {
+        table->src_offsets[i] = offset;
+        offset += table->src_sizes[i];
+    }
+
+    return(offset <= file_size && table->offsets[table->nblocks] == values[1]);
+}
+
+
+
+static void free_table(block_table_t *table)
+{
+    g_free(table->offsets);
+    g_free(table->src_offsets);
+    g_free(table->src_sizes);
+    memset(table, 0, sizeof(block_table_t));
+}
+
+
+
+/* Decompress every block of a file into 'dst' */
+static gboolean decode_file(block_table_t *table, gchar *dst)
+{
+    #ifdef HAVE_LZ4
+    decode_job_t    job;
+
+    memset(&job, 0, sizeof(job));
+    job.table = table;
+    job.dst   = dst;
+    run_threads(decode_blocks, &job, table->nblocks);
+    return(!job.failed);
+    #else
+    return(FALSE);
+    #endif
+}
+
+
+
+/* Decompress 'block' into 'buf', followed by an end-of-symbols mark.  Returns FALSE if the block is damaged. */
+static gboolean decode_block(const block_table_t *table, guint32 block, block_buf_t *buf)
+{
+    gsize   length = table->offsets[block + 1] - table->offsets[block];
+
+    if (buf->capacity < length + sizeof(end_mark))
+    {
+        g_free(buf->data);
+        buf->capacity = length + sizeof(end_mark);
+        buf->data     = g_malloc(buf->capacity);
+    }
+    memcpy(buf->data + length, end_mark, sizeof(end_mark));
+
+    #ifdef HAVE_LZ4
+    return( LZ4_decompress_safe(table->src + table->src_offsets[block], buf->data,
+                                table->src_sizes[block], length) == (int) length );
+    #else
+    return(FALSE);
+    #endif
+}
+
+
+
+/* A block failed to decompress: the file was readable when it was opened, so it has been damaged since */
+static void damaged()
+{
+    fprintf(stderr, "Fatal Error: Damaged block-compressed cross-reference file\n");
+    exit(EXIT_FAILURE);
+}
+
+
+
+/* Start decompressing 'block' into its slot (which the scan no longer uses) */
+static void prefetch(BLOCKS_scan_t *scan, guint32 block)
+{
+    block_buf_t *slot = &(scan->slots[block % BLOCKS_PREFETCH]);
+
+    slot->block = block;
+    slot->ready = FALSE;
+    g_thread_pool_push(scan->pool, slot, NULL);
+}
+
+
+
+/* Thread pool function: decompress a scan slot's block */
+static void decode_ahead(gpointer data, gpointer user_data)
+{
+    block_buf_t     *slot = data;
+    BLOCKS_scan_t   *scan = user_data;
+    gboolean        decoded;
+
+    decoded = decode_block(&(scan->cref->table), slot->block, slot);
+
+    g_mutex_lock(&scan->lock);
+    slot->failed = !decoded;
+    slot->ready  = TRUE;
+    g_cond_broadcast(&scan->decoded);
+    g_mutex_unlock(&scan->lock);
+}
+
+
+
+/* Make 'block' (prefetched) the one scanned, returns its data */
+static char *wait_for_block(BLOCKS_scan_t *scan, guint32 block)
+{
+    block_buf_t *slot = &(scan->slots[block % BLOCKS_PREFETCH]);
+
+    g_mutex_lock(&scan->lock);
+    while (!slot->ready)
+        g_cond_wait(&scan->decoded, &scan->lock);
+    g_mutex_unlock(&scan->lock);
+
+    if (slot->failed)
+        damaged();
+
+    scan->block = block;
+    return(slot->data);
+}
+
+
+
+/* Choose the block boundaries (returns the number of blocks).  Blocks hold BLOCKS_SIZE bytes
+   or more: each one ends at the first file section past that size, so every block but the
+   first starts at a NEWFILE mark's tab.  The last block holds the end-of-symbols mark and the
+   trailer.  'offsets' (g_free() it) gets the data offset of every block, and the data size. */
+static guint32 split_blocks(const gchar *data, gsize data_size, guint64 **offsets)
+{
+    GArray      *starts;
+    const gchar *first;
+    const gchar *mark;
+    guint64     start = 0;
+    guint64     from;
+    guint32     nblocks;
+
+    starts = g_array_new(FALSE, FALSE, sizeof(guint64));
+    g_array_append_val(starts, start);
+
+    /* The first block holds the header and the first section (after the header's tab) */
+    first = memchr(data, '\t', data_size);
+    from  = first ? (first - data) + 2 : data_size;
+
+    for (;;)
+    {
+        from = MAX(from, start + BLOCKS_SIZE);
+        if (from >= data_size)
+            break;
+
+        mark = memmem(data + from - 1, data_size - from + 1, section_mark, sizeof(section_mark));
+        if ( mark == NULL || mark + sizeof(section_mark) >= data + data_size ||
+             mark[sizeof(section_mark)] == '\n' )
+            break;      /* The rest (from the end-of-symbols mark on) is the last block */
+
+        start = (mark + 1) - data;
+        g_array_append_val(starts, start);
+    }
+
+    nblocks = starts->len;
+    start   = data_size;
+    g_array_append_val(starts, start);
+
+    *offsets = (guint64 *) g_array_free(starts, FALSE);
+    return(nblocks);
+}
+
+
+
+#ifdef HAVE_LZ4
+
+static gpointer decode_blocks(gpointer data)
+{
+    decode_job_t    *job = data;
+    block_table_t   *table = job->table;
+    guint64         length;
+    gint            i;
+
+    while ( (i = g_atomic_int_add(&job->next, 1)) < (gint) table->nblocks )
+    {
+        length = table->offsets[i + 1] - table->offsets[i];
+
+        if ( LZ4_decompress_safe(table->src + table->src_offsets[i], job->dst + table->offsets[i],
+                                 table->src_sizes[i], length) != (int) length )
+            g_atomic_int_set(&job->failed, 1);
+    }
+    return(NULL);
+}
+
+
+
+static gpointer encode_blocks(gpointer data)
+{
+    encode_job_t    *job = data;
+    int             length;
+    int             bound;
+    gint            i;
+
+    while ( (i = g_atomic_int_add(&job->next, 1)) < (gint) job->nblocks )
+    {
+        length = job->offsets[i + 1] - job->offsets[i];
+        bound  = LZ4_compressBound(length);
+
+        job->blocks[i] = g_malloc(bound);
+        job->sizes[i]  = LZ4_compress_HC(job->src + job->offsets[i], job->blocks[i], length, bound, LZ4HC_CLEVEL_DEFAULT);
+
+        if (job->sizes[i] == 0)
+            g_atomic_int_set(&job->failed, 1);
+    }
+    return(NULL);
+}
+
+#endif  /* HAVE_LZ4 */
+
+
+
+//===============================================================
+//      Public Interface Functions
+//===============================================================
+
+gboolean BLOCKS_requested()
+{
+    return(compress_requested);
+}
+
+
+
+/* Is this (cross-reference) file block-compressed? */
+gboolean BLOCKS_is_compressed(int fd)
+{
+    char    magic[sizeof(BLOCKS_MAGIC)];
+
+    return( pread(fd, magic, sizeof(magic), 0) == sizeof(magic) &&
+            memcmp(magic, BLOCKS_MAGIC " ", sizeof(magic)) == 0 );
+}
+
+
+
+/* Map a cross-reference file of either format for searching (see SEARCH_load_cref).  The
+   mapping is shared, compressed or not.  cref_stat->st_size becomes the size of the data.
+   Returns NULL if the file can't be mapped or is damaged. */
+BLOCKS_cref_t *BLOCKS_open(int fd, struct stat *cref_stat)
+{
+    BLOCKS_cref_t   *cref;
+
+    cref = g_malloc0(sizeof(BLOCKS_cref_t));
+    cref->map_size = cref_stat->st_size;
+    cref->at.block = -1;
+
+    cref->map = mmap(NULL, cref->map_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (cref->map == MAP_FAILED)
+    {
+        g_free(cref);
+        return(NULL);
+    }
+
+    if ( BLOCKS_is_compressed(fd) )
+    {
+        cref->compressed = TRUE;
+
+        if ( !lz4_available() || !parse_header(cref->map, cref->map_size, &cref->table) )
+        {
+            BLOCKS_close(cref);
+            return(NULL);
+        }
+        cref_stat->st_size = cref->table.offsets[cref->table.nblocks];
+    }
+
+    return(cref);
+}
+
+
+
+gboolean BLOCKS_compressed(const BLOCKS_cref_t *cref)
+{
+    return(cref->compressed);
+}
+
+
+
+/* The cross-reference data at 'offset'.  A file section is read from the start of the section
+   up to its block's end-of-symbols mark.  Valid until the next BLOCKS_at() on 'cref'. */
+char *BLOCKS_at(BLOCKS_cref_t *cref, guint64 offset)
+{
+    guint32 low  = 0;
+    guint32 high;
+    guint32 mid;
+
+    if (!cref->compressed)
+        return(cref->map + offset);
+
+    /* The last block that starts at or before 'offset' */
+    high = cref->table.nblocks - 1;
+    while (low < high)
+    {
+        mid = (low + high + 1) / 2;
+        if (cref->table.offsets[mid] <= offset)
+            low = mid;
+        else
+            high = mid - 1;
+    }
+
+    if (cref->at.block != low)
+    {
+        cref->at.block = -1;
+        if ( !decode_block(&cref->table, low, &cref->at) )
+            damaged();
+        cref->at.block = low;
+    }
+
+    return(cref->at.data + (offset - cref->table.offsets[low]));
+}
+
+
+
+void BLOCKS_close(BLOCKS_cref_t *cref)
+{
+    munmap(cref->map, cref->map_size);
+    free_table(&cref->table);
+    g_free(cref->at.data);
+    g_free(cref);
+}
+
+
+
+/* Start a scan of the cross-reference data: 'data' gets the first block */
+BLOCKS_scan_t *BLOCKS_scan_start(BLOCKS_cref_t *cref, char **data)
+{
+    BLOCKS_scan_t   *scan;
+    long            nthreads;
+    guint32         i;
+
+    scan = g_malloc0(sizeof(BLOCKS_scan_t));
+    scan->cref = cref;
+
+    if (!cref->compressed)
+    {
+        *data = scan->data = cref->map;
+        return(scan);
+    }
+
+    g_mutex_init(&scan->lock);
+    g_cond_init(&scan->decoded);
+
+    nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+    nthreads = CLAMP(nthreads, 1, BLOCKS_PREFETCH);
+    scan->pool = g_thread_pool_new(decode_ahead, scan, nthreads, FALSE, NULL);
+
+    for (i = 0; i < BLOCKS_PREFETCH && i < cref->table.nblocks; i++)
+        prefetch(scan, i);
+
+    *data = scan->data = wait_for_block(scan, 0);
+    return(scan);
+}
+
+
+
+/* At an end-of-symbols mark: move on to the next block ('data' gets it, starting at its first
+   NEWFILE mark's tab).  The previous block's data is released.  Returns FALSE at the end. */
+gboolean BLOCKS_scan_next(BLOCKS_scan_t *scan, char **data)
+{
+    if (!scan->cref->compressed || scan->block + 1 >= scan->cref->table.nblocks)
+        return(FALSE);
+
+    /* The slot of the block just scanned decompresses the block BLOCKS_PREFETCH ahead */
+    if (scan->block + BLOCKS_PREFETCH < scan->cref->table.nblocks)
+        prefetch(scan, scan->block + BLOCKS_PREFETCH);
+
+    *data = scan->data = wait_for_block(scan, scan->block + 1);
+    return(TRUE);
+}
+
+
+
+/* The data offset of 'ptr', in the block being scanned */
+guint64 BLOCKS_scan_offset(const BLOCKS_scan_t *scan, const char *ptr)
+{
+    if (!scan->cref->compressed)
+        return(ptr - scan->data);
+
+    return(scan->cref->table.offsets[scan->block] + (ptr - scan->data));
+}
+
+
+
+void BLOCKS_scan_stop(BLOCKS_scan_t *scan)
+{
+    guint   i;
+
+    if (scan->pool)
+    {
+        g_thread_pool_free(scan->pool, TRUE, TRUE);     /* Drop the blocks not started, wait for the others */
+
+        for (i = 0; i < BLOCKS_PREFETCH; i++)
+            g_free(scan->slots[i].data);
+        g_mutex_clear(&scan->lock);
+        g_cond_clear(&scan->decoded);
+    }
+    g_free(scan);
+}
+
+
+
+/* Read a cross-reference file of either format into memory (g_free() it).  The data is
+   '\0' terminated.  Returns NULL if the file can't be read. */
+gchar *BLOCKS_read_file(const gchar *file, gsize *size)
+{
+    struct stat     file_stat;
+    gchar           *file_data;
+    gchar           *data = NULL;
+    block_table_t   table;
+    int             fd;
+
+    if ( (fd = open(file, O_RDONLY)) < 0 )
+        return(NULL);
+
+    if ( !BLOCKS_is_compressed(fd) )
+    {
+        close(fd);
+        return( g_file_get_contents(file, &data, size, NULL) ? data : NULL );
+    }
+
+    if ( lz4_available() && fstat(fd, &file_stat) == 0 &&
+         (file_data = mmap(NULL, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0)) != MAP_FAILED )
+    {
+        if ( parse_header(file_data, file_stat.st_size, &table) )
+        {
+            *size = table.offsets[table.nblocks];
+            data  = g_malloc(*size + 1);
+            data[*size] = '\0';
+
+            if ( !decode_file(&table, data) )
+            {
+                g_free(data);
+                data = NULL;
+            }
+        }
+        free_table(&table);
+        munmap(file_data, file_stat.st_size);
+    }
+
+    close(fd);
+    return(data);
+}
+
+
+
+/* Rewrite a (newly built, plain) cross-reference file in block-compressed format.  The
+   file is left as it is if it can't be compressed. */
+void BLOCKS_compress_file(const gchar *file)
+{
+    #ifdef HAVE_LZ4
+    encode_job_t    job;
+    gchar           *data;
+    gsize           data_size;
+    gchar           *temp_name;
+    FILE            *output;
+    gboolean        written;
+    guint32         i;
+
+    if ( !g_file_get_contents(file, &data, &data_size, NULL) )
+        return;
+
+    memset(&job, 0, sizeof(job));
+    job.src     = data;
+    job.nblocks = split_blocks(data, data_size, &job.offsets);
+    job.blocks  = g_new0(gchar *, job.nblocks + 1);
+    job.sizes   = g_new0(guint32, job.nblocks + 1);
+
+    run_threads(encode_blocks, &job, job.nblocks);
+
+    temp_name = g_strconcat(file, ".blk", NULL);
+    written   = FALSE;
+
+    if ( !job.failed && (output = fopen(temp_name, "w")) != NULL )
+    {
+        written = fprintf(output, "%s %d %" G_GSIZE_FORMAT " %u\n", BLOCKS_MAGIC, BLOCKS_VERSION,
+                          data_size, job.nblocks) > 0;
+
+        for (i = 0; written && i < job.nblocks; i++)
+            written = fprintf(output, "%" G_GUINT64_FORMAT " %u\n", job.offsets[i + 1] - job.offsets[i], job.sizes[i]) > 0;
+
+        for (i = 0; written && i < job.nblocks; i++)
+            written = fwrite(job.blocks[i], 1, job.sizes[i], output) == job.sizes[i];
+
+        written = (fclose(output) == 0) && written && (rename(temp_name, file) == 0);
+    }
+
+    if (!written)
+    {
+        fprintf(stderr, "Warning: Unable to block-compress %s, it is left uncompressed\n", file);
+        (void) unlink(temp_name);
+    }
+
+    for (i = 0; i < job.nblocks; i++)
+        g_free(job.blocks[i]);
+    g_free(job.blocks);
+    g_free(job.sizes);
+    g_free(job.offsets);
+    g_free(temp_name);
+    g_free(data);
+    #endif
+}
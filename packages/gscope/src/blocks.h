@@ -0,0 +1,61 @@
+
+/* Block-compressed cross-reference files:
+ *
+ *   gscope --block-compress ...
+ *
+ * Stores the cross-reference in independently LZ4-compressed blocks of about BLOCKS_SIZE
+ * bytes (requires the system liblz4 at configure time, see configure.ac).  The file is
+ * several times smaller on disk and in the page cache.  Every block but the first starts at
+ * a file section, so a block can be searched on its own.  The compressed file is mapped (shared, like a plain file) and never
+ * decompressed as a whole: a scan decompresses the blocks ahead of it on a few threads.
+ *
+ * Every reader of the cross-reference file accepts either format.  The file is written
+ * plain and compressed just before it replaces the old one.  Partial (--shard) files are
+ * always plain.
+ *
+ *   gscope-blocks <version> <data size> <number of blocks>
+ *   <data size of block 0> <compressed size of block 0>
+ *   ...
+ *   <compressed blocks>
+ *
+ * Reading a mapped cross-reference (of either format):
+ *
+ *   cref = BLOCKS_open(fd, &cref_stat);         st_size becomes the size of the data
+ *   scan = BLOCKS_scan_start(cref, &read_ptr);
+ *   [scan to the end-of-symbols mark]
+ *   while ( BLOCKS_scan_next(scan, &read_ptr) ) [scan on, from the next block's NEWFILE tab]
+ *   BLOCKS_scan_stop(scan);
+ *
+ * Each block's data is followed by an end-of-symbols mark, and is valid until the next
+ * BLOCKS_scan_next().  A plain file is one block.  BLOCKS_at() is random access to the file
+ * section at a data offset (valid until the next BLOCKS_at() on the same file).
+ */
+
+#define BLOCKS_MAGIC        "gscope-blocks"
+#define BLOCKS_VERSION      2
+#define BLOCKS_SIZE         (1024 * 1024)   /* Uncompressed block size (a block ends at a file section) */
+#define BLOCKS_MAX_THREADS  16              /* (De)compression threads */
+#define BLOCKS_PREFETCH     8               /* Blocks decompressed ahead of a scan */
+
+extern GOptionEntry BLOCKS_options[];       /* Command line options: --block-compress */
+
+typedef struct blocks_cref BLOCKS_cref_t;
+typedef struct blocks_scan BLOCKS_scan_t;
+
+
+//===============================================================
+//      Public Interface Functions
+//===============================================================
+
+gboolean        BLOCKS_requested    (void);
+gboolean        BLOCKS_is_compressed(int fd);
+BLOCKS_cref_t * BLOCKS_open         (int fd, struct stat *cref_stat);
+gboolean        BLOCKS_compressed   (const BLOCKS_cref_t *cref);
+char *          BLOCKS_at           (BLOCKS_cref_t *cref, guint64 offset);
+void            BLOCKS_close        (BLOCKS_cref_t *cref);
+BLOCKS_scan_t * BLOCKS_scan_start   (BLOCKS_cref_t *cref, char **data);
+gboolean        BLOCKS_scan_next    (BLOCKS_scan_t *scan, char **data);
+guint64         BLOCKS_scan_offset  (const BLOCKS_scan_t *scan, const char *ptr);
+void            BLOCKS_scan_stop    (BLOCKS_scan_t *scan);
+gchar *         BLOCKS_read_file    (const gchar *file, gsize *size);
+void            BLOCKS_compress_file(const gchar *file);
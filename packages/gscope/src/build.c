@@ -18,10 +18,11 @@ Symbol database (cscope_db.out file) format
     first file symbol data
     ...
     last file symbol data
+    trailer (section table)
 
 The header is a single line
 
-    cscope <format version> <current dir> [-T] <trailer offset>    Note: offset is obsolete.
+    cscope <format version> <current dir> <options> [<dictionary>] <trailer offset>
 
 The format version is the first number in the cscope version that wrote
 the database, e.g. the format version is 9 for cscope version 9.14.
@@ -29,8 +30,8 @@ When the format version number in the cscope program is greater than that
 in the database, the entire database will be rebuilt when any part of it is
 out-of-date.  The current directory is either a full path or prefixed by
 $HOME, allowing the user's login to be moved to a different file system
-without rebuilding the database.  The (obsolete) trailer offset is the fseek(3)
-offset of the trailer.
+without rebuilding the database.  The trailer offset is the fseek(3)
+offset of the section table.
 
 The header is followed by the symbol data for each file in alphabetical
 order.  This allows fast updating of the database when only a few files
@@ -42,7 +43,9 @@ and so on.
 Two data compression techniques are used on the symbol data: (1) keywords
 and trailing syntax are converted to control characters, and (2) common
 digraphs (character pairs) are compressed to meta-characters (characters
-with the eight bit set).
+with the eight bit set).  With --train-dictionary the meta-characters stand
+for substrings trained on the project's source files instead, and the header
+carries the dictionary (option D1, see textdict.h).
 
 The symbol data for each file starts with
 
@@ -64,6 +67,20 @@ ends with
 
     <file mark>
     
+The section table follows the last file mark.  It holds the symbol counts
+of every file section, so session statistics never require a scan of the
+symbol data:
+
+    sections <number of file sections>
+    <file mark offset> <definitions> <identifiers> <function calls> <functions> <classes> <#includes>
+    ...
+
+The counts are accumulated while crossref() writes a section and while
+copydata() re-uses one, so an incremental build never re-counts an unchanged
+file.  Readers that stop at the final file mark never see the table, and a
+database without one (the trailer offset then points at the first file mark)
+is simply counted the old way.
+
 A mark is a tab followed by one of these characters:
 
     Char    Meaning
@@ -94,7 +111,7 @@ the database file.
  
  
 ============================= begin obsolete section ============================= 
-Note:  The trailer is now obsolete (2/10/13 TF) 
+Note:  The trailer is now obsolete (2/10/13 TF)  [Replaced by the section table, above]
  
 The trailer contains lists of source directories, include directories, and
 source files; its format is
@@ -130,7 +147,6 @@ line of the header to the trailer.
 #include "config.h"
 #endif
 
-#include <gtk/gtk.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/types.h>
@@ -149,7 +165,17 @@ line of the header to the trailer.
 #include "build.h"
 #include "lookup.h"
 #include "scanner.h"
-#include "display.h"
+#include "core.h"
+#include "trace.h"
+#include "report.h"
+#include "fileindex.h"
+#include "watch.h"
+#include "stale.h"
+#include "share.h"
+#include "shard.h"
+#include "sectcache.h"
+#include "blocks.h"
+#include "textdict.h"
 #include "app_config.h"
 #include "auto_gen.h"
 
@@ -160,6 +186,7 @@ line of the header to the trailer.
 //===============================================================
 #define         FILEVERSION         14  /* symbol database file format version */
 #define         OPTIONS_LEN         40
+#define         MERGE_BUF_SIZE      (256 * 1024)    /* BUILD_merge() copy buffer */
 
 
 //===============================================================
@@ -174,6 +201,36 @@ typedef struct
 } old_buf_decriptor_t;
 
 
+/* The result of a build, loaded and indexed by the build thread (load_cross_reference) */
+typedef struct
+{
+    search_cref_t   *cref;
+    DIR_src_list_t  *src_list;      /* Compact source file list */
+    fileindex_t     *file_index;
+} loaded_cref_t;
+
+
+typedef struct
+{
+    FILE            *file;
+    char            *name;
+    char            *header;    /* Header line (with any text dictionary) */
+    uint32_t        index;      /* Shard I of N */
+    uint32_t        count;
+} partial_cref_t;
+
+
+typedef struct
+{
+    char            *file;      /* Source file name */
+    uint32_t        pass;       /* Build pass that parsed the file */
+    partial_cref_t  *partial;
+    uint32_t        offset;     /* File section in the partial cross-reference */
+    uint32_t        size;
+    stats_struct_t  counts;
+} partial_section_t;
+
+
 
 
 //===============================================================
@@ -182,15 +239,29 @@ typedef struct
 static gboolean old_crossref_is_compatible(char *file_buf);
 static void     initialize_using_old_cref(void);
 static void     initialize_for_new_cref(void);
+static void     initialize_for_update(void);
+static void     begin_build(void);
+static void     make_database(void);
+static void     load_cross_reference(loaded_cref_t *loaded);
+static void     finish_build(loaded_cref_t *loaded);
+static gpointer build_thread_main(gpointer data);
+static gboolean install_new_cref(gpointer data);
 static void     build_new_cref(void);
 static void     make_new_cref(old_buf_decriptor_t *old_descriptor);
+static gboolean crossref_section(char *new_file, uint32_t section_start);
 static void     initcompress(void);
+static void     train_dictionary(void);
 static void     putheader(char *dir);
 static char     *get_old_file(char *dest_ptr, char *src_ptr);
 static void     copydata(char *src_ptr);
+static void     putsection(uint32_t offset);
+static void     puttrailer(char *new_cref_file);
 static void     movefile(char *new, char *old);
 static void     get_decompressed_string(char *dest, char *src);
 static int      compare();   /* for qsort */
+static void     read_partial(partial_cref_t *partial, char *options, GPtrArray *sections);
+static void     partial_error(partial_cref_t *partial, const char *problem);
+static int      compare_sections(const void *s1, const void *s2);
 
 
 //===============================================================
@@ -205,15 +276,19 @@ int     fileversion;        /* cross-reference file version */
 //===============================================================
 
 
-/* Note: these digraph character frequencies were calculated from possible 
-   printable digraphs in the cross-reference for the C compiler */
-char        dichar1[] = " teisaprnl(of)=c"; /* 16 most frequent first chars */
-char        dichar2[] = " tnerpla";         /* 8 most frequent second chars using the above as first chars */
-char        dicode1[256];           /* digraph first character code */
-char        dicode2[256];           /* digraph second character code */
+textdict_t  build_dict;         /* text compression dictionary of the new cross-reference */
 
 FILE        *newrefs;           /* new cross-reference */
 
+static section_stats_t  *section_table = NULL;  /* section table for the new cross-reference */
+static uint32_t         nsections;              /* number of section table entries */
+static uint32_t         msections;              /* maximum number of section table entries */
+static uint32_t         trailer_field;          /* offset of the header's trailer offset field */
+static uint32_t         *section_pass = NULL;   /* build pass of every section (partial cross-references) */
+static uint32_t         build_pass;             /* 1: original source files, 2..: #include files */
+static uint32_t         cached_sections;        /* sections copied from the section cache */
+static char             section_format[64];     /* section cache key: cross-reference format and options */
+
 
 struct timeval overall_time_start,  overall_time_stop;
 struct timeval src_list_time_start, src_list_time_stop;
@@ -221,6 +296,16 @@ struct timeval cref_time_start,     cref_time_stop;
 
 static char build_stats_msg[1024];
 
+static GHashTable   *update_files = NULL;           /* Changed source files (BUILD_start_background) */
+static gboolean     build_in_progress = FALSE;
+
+/* Background build (BUILD_start_background) */
+static GThread      *build_thread = NULL;
+static BUILD_done_func  build_done = NULL;
+static gpointer     build_done_data;
+static loaded_cref_t    next_cref;                  /* The new cross-reference, loaded by the build thread */
+static gboolean     load_published = FALSE;         /* Load another instance's cross-reference (BUILD_load_background) */
+
 //====================================================================
 //
 // Open up the cross reference database.  This database will be
@@ -251,26 +336,125 @@ static char build_stats_msg[1024];
 //       This is the default behavior if a previous, compatible, 
 //       cross-reference is detected.  (Assuming 'forced' and
 //       'nobuild' are not specified)
+//
+//    4) Update:  Like Incremental, but for a known set of changed
+//       files (see BUILD_start_background).  The source file list is
+//       taken from the old cross-reference and only the changed
+//       files are stat'd and parsed.
 // 
 //====================================================================
 
 void BUILD_initDatabase()
 {
-    suseconds_t elapsed_usec;
-    char working_buf[500];
+    loaded_cref_t   loaded;
+
+    begin_build();
+    make_database();
+    load_cross_reference(&loaded);
+    SHARE_unlock();
+    finish_build(&loaded);
+}
+
+
+
+//====================================================================
+// Rebuild (or, given a set of changed files, update) the cross-
+// reference on a worker thread.  The build writes the ".new" file
+// and loads the result while lookups keep searching the current
+// cross-reference.  The new one is installed from the main loop,
+// between lookups, and then 'done' is called.  The build takes
+// ownership of 'changed_files'.
+//
+// Returns FALSE (and does nothing) if a build is already running.
+//====================================================================
+
+gboolean BUILD_start_background(GHashTable *changed_files, BUILD_done_func done, gpointer data)
+{
+    if (build_in_progress)
+    {
+        if (changed_files)
+            g_hash_table_destroy(changed_files);
+        return(FALSE);
+    }
+
+    begin_build();
+
+    update_files    = changed_files;
+    build_done      = done;
+    build_done_data = data;
+
+    build_thread = g_thread_new("cref-build", build_thread_main, NULL);
+    return(TRUE);
+}
+
+
+
+//====================================================================
+// Load the cross-reference another gscope instance has published
+// (see share.c) in the background, as BUILD_start_background() does.
+//====================================================================
+
+gboolean BUILD_load_background(BUILD_done_func done, gpointer data)
+{
+    if (build_in_progress)
+        return(FALSE);
+
+    load_published = TRUE;
+    return( BUILD_start_background(NULL, done, data) );
+}
+
+
 
+gboolean BUILD_in_progress()
+{
+    return(build_in_progress);
+}
+
+
+
+//===============================================================
+//      Build phases
+//===============================================================
+
+static void begin_build()
+{
+    build_in_progress = TRUE;
+    STALE_cancel();             /* A staleness check result would not describe the new cross-reference */
     build_stats_msg[0] = '\0';   /* Initialize build stats to null string */
+    REPORT_reset();
 
     gettimeofday(&overall_time_start, NULL);
 
+    /* The paths and #include search path the build uses, set before the build thread starts */
+    DIR_init_paths();
+
     /* if the database path is relative and it can't be created */
     if (settings.refFile[0] != '/' && access(".", W_OK) != 0)
     {
         (void) fprintf(stderr, "Cannot create Cross Reference file, no write permission for [%s] in CWD\n", settings.refFile);
         exit(EXIT_FAILURE);
     }
+}
+
+
 
-    if (settings.noBuild)
+/* Build the new cross-reference file (may run on the build thread).  Takes the shared build
+   lock (see share.c), which is released once the result has been loaded. */
+static void make_database()
+{
+    if ( SHARE_lock() || load_published )
+    {
+        /* Another gscope instance has just built it: use its cross-reference as-is */
+        initialize_using_old_cref();
+        return;
+    }
+
+    if (update_files)
+    {
+        /* Splice a known set of changed files into the existing cross-reference */
+        initialize_for_update();
+    }
+    else if (settings.noBuild)
     {
         /* We want to re-use an existing cross-reference */
         printf("\nWARNING: The '--no_build' option is active.\n"); 
@@ -286,9 +470,17 @@ void BUILD_initDatabase()
         initialize_for_new_cref();
     }
 
-    // Now that we have a valid cross-reference database,
-    // Initialize the "search" sub-system
-    SEARCH_init(); 
+    if ( update_files || !settings.noBuild )
+        SHARE_publish();
+}
+
+
+
+/* Load the new cross-reference and derive everything searches use (may run on the build
+   thread): the search indexes, the compact source file list and the file name index */
+static void load_cross_reference(loaded_cref_t *loaded)
+{
+    loaded->cref = SEARCH_load_cref();
 
     /* Free the source_name hash table (no longer needed) */
     DIR_free_src_names_hash();
@@ -296,6 +488,26 @@ void BUILD_initDatabase()
     /* Free the offset_hash table (no longer needed) */
     DIR_free_offset_hash();
 
+    /* Searches use the compact copy of the source file list from here on */
+    loaded->src_list   = DIR_compact_src_files();
+    loaded->file_index = FILEINDEX_make(loaded->src_list);
+}
+
+
+
+/* Install the new cross-reference for searching and report the build (main thread) */
+static void finish_build(loaded_cref_t *loaded)
+{
+    suseconds_t elapsed_usec;
+    char working_buf[500];
+
+    // Now that we have a valid cross-reference database,
+    // Initialize the "search" sub-system: only swaps in what load_cross_reference() built
+    SEARCH_install_cref(loaded->cref);
+    DIR_publish_src_list(loaded->src_list);
+    FILEINDEX_install(loaded->file_index);
+    memset(loaded, 0, sizeof(*loaded));
+
     gettimeofday(&overall_time_stop, NULL);
 
     /* Show (optional) autogen stats */
@@ -359,13 +571,64 @@ void BUILD_initDatabase()
            elapsed_usec );
     strcat(build_stats_msg, working_buf);
 
+    REPORT_write(build_stats_msg, sizeof(build_stats_msg));
+
+    if ( WATCH_active() )
+        WATCH_sync();       /* Watch any new source directories */
+
     if ( !settings.refOnly )
     {
-        DISPLAY_update_stats_tooltip(build_stats_msg);
-        DISPLAY_set_cref_current(TRUE);
+        CORE_stats_tooltip(build_stats_msg);
+        CORE_cref_current(TRUE);
     }
     else
         printf("\n%s\n", build_stats_msg);
+
+    build_in_progress = FALSE;
+}
+
+
+
+static gpointer build_thread_main(gpointer data)
+{
+    make_database();
+
+    CORE_build_phase("Loading Cross Reference");
+    load_cross_reference(&next_cref);
+    SHARE_unlock();
+
+    g_idle_add(install_new_cref, NULL);
+    return(NULL);
+}
+
+
+
+/* Main loop: swap in the cross-reference built by the build thread */
+static gboolean install_new_cref(gpointer data)
+{
+    if ( SEARCH_busy() )
+    {
+        /* A lookup is servicing the main loop: wait for it to finish with the current cross-reference */
+        g_timeout_add(BUILD_INSTALL_RETRY_MS, install_new_cref, NULL);
+        return(FALSE);
+    }
+
+    g_thread_join(build_thread);
+    build_thread = NULL;
+
+    if (update_files)
+    {
+        g_hash_table_destroy(update_files);
+        update_files = NULL;
+    }
+
+    finish_build(&next_cref);
+    load_published = FALSE;
+
+    if (build_done)
+        build_done(build_done_data);
+
+    return(FALSE);
 }
 
 
@@ -378,40 +641,24 @@ void BUILD_init_cli_file_list(int argc, char *argv[])
 
 static void initialize_using_old_cref()
 {
-    FILE      *old_file;           /* old cross-reference file */
     char      *format_string;
     char      options[OPTIONS_LEN + 1];
     char      *options_ptr = options;
     char      *old_file_buf = NULL;     /* Buffer that holds the entire old crossref file contents */
+    gsize     old_file_size;
     char      *oldbuf_ptr;
-    struct    stat statstruct;          /* file status */
     char      src_file[PATHLEN +1];
     int       file_count;
 
     gettimeofday(&src_list_time_start, NULL);
 
-    /* If there is no pre-existing cross-reference */
-    if ( (stat(settings.refFile, &statstruct) != 0 ) || ((old_file = fopen(settings.refFile, "rb")) == NULL) )
+    /* If there is no pre-existing cross-reference (plain or block-compressed) */
+    if ( (old_file_buf = BLOCKS_read_file(settings.refFile, &old_file_size)) == NULL )
     {
         fprintf(stderr, "Fatal Error: No pre-existing cross-reference file [%s] available\n", settings.refFile);
         exit(EXIT_FAILURE);
     }
 
-    old_file_buf = g_malloc(statstruct.st_size);    /* malloc a buffer to hold the entire old-file */
-    if (old_file_buf == NULL)
-    {
-        fprintf(stderr, "Fatal Error: Unable to allocate memory for old cross-reference file\n");
-        exit(EXIT_FAILURE);
-    }
-
-
-    if ( fread(old_file_buf, 1, statstruct.st_size, old_file) != statstruct.st_size )
-    {
-        fprintf(stderr, "Fatal Error: Unable to to read old cross-reference file\n");
-        exit(EXIT_FAILURE);
-    }
-    fclose(old_file);
-
 
     /* Construct a format_string that protects us from buffer overflows */
     my_asprintf(&format_string, "cscope %%d %%*s %%%ds", OPTIONS_LEN);
@@ -441,7 +688,8 @@ static void initialize_using_old_cref()
             break;
 
             default:
-                /* Unrecognized option, ignore */
+                /* Unrecognized option (D: trained text dictionary, see textdict.h), ignore */
+                options_ptr += options_ptr[1] ? 2 : 1;
             break;
         }
     }
@@ -481,6 +729,98 @@ static void initialize_using_old_cref()
 }
 
 
+static void initialize_for_update()
+{
+    gchar       *old_file_buf;
+    gsize       old_file_size;
+    char        *oldbuf_ptr;
+    char        src_file[PATHLEN + 1];
+    char        path[PATHLEN + 1];
+    GHashTable  *additions;
+    GHashTableIter  iter;
+    gpointer    name;
+    struct stat statstruct;
+    gboolean    autogen_enable;
+    guint       modified = 0;
+    guint       deleted = 0;
+    guint       added = 0;
+    char        *working_buf;
+
+    gettimeofday(&src_list_time_start, NULL);
+
+    if ( (old_file_buf = BLOCKS_read_file(settings.refFile, &old_file_size)) == NULL )
+    {
+        /* No usable old cross-reference: fall back to a normal (incremental or full) build */
+        initialize_for_new_cref();
+        return;
+    }
+
+    DIR_init(OLD_CREF);
+
+    /* Changed files not found in the old cross-reference are new files */
+    additions = g_hash_table_new(g_str_hash, g_str_equal);
+    g_hash_table_iter_init(&iter, update_files);
+    while ( g_hash_table_iter_next(&iter, &name, NULL) )
+        g_hash_table_insert(additions, name, name);
+
+    /* The old list already holds any auto-generated files */
+    autogen_enable = settings.autoGenEnable;
+    settings.autoGenEnable = FALSE;
+
+    oldbuf_ptr = get_old_file(src_file, old_file_buf);
+    while (*src_file != '\0')
+    {
+        if ( g_hash_table_lookup(update_files, src_file) )
+        {
+            g_hash_table_remove(additions, src_file);
+            if (stat(DIR_src_path(src_file, path), &statstruct) != 0)
+                deleted++;
+            else
+            {
+                DIR_addsrcfile(src_file);
+                modified++;
+            }
+        }
+        else
+            DIR_addsrcfile(src_file);
+
+        oldbuf_ptr = get_old_file(src_file, oldbuf_ptr);
+    }
+
+    g_hash_table_iter_init(&iter, additions);
+    while ( g_hash_table_iter_next(&iter, &name, NULL) )
+    {
+        if ( stat(DIR_src_path(name, path), &statstruct) == 0 && S_ISREG(statstruct.st_mode) )
+        {
+            DIR_addsrcfile(name);
+            added++;
+        }
+    }
+
+    settings.autoGenEnable = autogen_enable;
+    g_hash_table_destroy(additions);
+    g_free(old_file_buf);
+
+    my_asprintf(&working_buf, "Updated changed files: %d modified, %d added, %d deleted\n",
+                modified, added, deleted);
+    strcat(build_stats_msg, working_buf);
+    g_free(working_buf);
+
+    initsymtab();
+    initcompress();
+
+    gettimeofday(&src_list_time_stop, NULL);
+    gettimeofday(&cref_time_start, NULL);
+
+    TRACE_BEGIN("update cross-reference", settings.refFile);
+    build_new_cref();
+    TRACE_END("update cross-reference");
+
+    gettimeofday(&cref_time_stop, NULL);
+}
+
+
+
 static void initialize_for_new_cref()
 {
     gettimeofday(&src_list_time_start, NULL);
@@ -488,7 +828,8 @@ static void initialize_for_new_cref()
     if ( !settings.refOnly )  // Only update if we are in GUI mode.
     {
         /* Bring up the splash screen prior to searching for source files (the search can take a while) */
-        DISPLAY_update_build_progress(0, 100);   /* Show (essentially) no progress */
+        CORE_build_progress(0, 100);   /* Show (essentially) no progress */
+        CORE_build_phase("Searching for source files");
     }
    
     /* Create a fresh Source-File list. 
@@ -497,13 +838,16 @@ static void initialize_for_new_cref()
     DIR_init(NEW_CREF);
 
     if (settings.autoGenEnable)
+    {
+        CORE_build_phase("Generating meta-source files");
         AUTOGEN_run( DIR_get_path(DIR_DATA));
+    }
 
 
     if (nsrcfiles == 0)    
     {
         if ( !settings.refOnly )
-            DISPLAY_msg(GTK_MESSAGE_ERROR, "<span weight=\"bold\"> No source files found</span>\nGscope will exit.");
+            CORE_msg(CORE_MSG_ERROR, "<span weight=\"bold\"> No source files found</span>\nGscope will exit.");
         else
             fprintf(stderr,"No source files found. Gscope will exit.\n");
 
@@ -527,7 +871,9 @@ static void initialize_for_new_cref()
     // We are now ready parse the source files and build the cross-reference database
     gettimeofday(&cref_time_start, NULL);
 
+    TRACE_BEGIN("build cross-reference", settings.refFile);
     build_new_cref();
+    TRACE_END("build cross-reference");
 
     gettimeofday(&cref_time_stop, NULL);
 }
@@ -535,23 +881,34 @@ static void initialize_for_new_cref()
 
 
 
-/* set up the digraph character tables for text compression */
+/* set up the (default, digraph) dictionary for text compression */
 
 static void initcompress()
 {
-    int    i;
+    TEXTDICT_init(&build_dict, !settings.compressDisable);
+}
 
-    if (settings.compressDisable == FALSE)
-    {
-        for (i = 0; i < 16; ++i)
-        {
-            dicode1[(unsigned) (dichar1[i])] = i * 8 + 1;
-        }
-        for (i = 0; i < 8; ++i)
-        {
-            dicode2[(unsigned) (dichar2[i])] = i + 1;
-        }
-    }
+
+
+/* train the text compression dictionary on the original source files (see textdict.h) */
+
+static void train_dictionary()
+{
+    char    working_buf[200];
+    guint   codes;
+
+    if ( !settings.refOnly )
+        CORE_build_phase("Training the text dictionary");
+
+    TRACE_BEGIN("train dictionary", NULL);
+    codes = TEXTDICT_train(&build_dict, DIR_src_files, nsrcfiles);
+    TRACE_END("train dictionary");
+
+    if (codes)
+        sprintf(working_buf, "Trained a %u-entry text dictionary\n", codes);
+    else
+        sprintf(working_buf, "Too little source text to train a text dictionary: using the default\n");
+    strcat(build_stats_msg, working_buf);
 }
 
 
@@ -560,8 +917,8 @@ static void initcompress()
 
 void build_new_cref()
 {
-    FILE    *old_file;              
     char    *old_file_buf = NULL;   /* Buffer that holds the entire old crossref file contents */
+    gsize   old_file_size;          /* Its size (decompressed, for a block-compressed file) */
     struct  stat statstruct;        /* file status */
     
     gboolean force_rebuild;
@@ -591,46 +948,25 @@ void build_new_cref()
     }
     else    /* There is a pre-existing cross-reference present AND we are _NOT_ ignoring it */
     {
-        if ( (old_file = fopen(settings.refFile, "rb")) == NULL)
+        if ( (old_file_buf = BLOCKS_read_file(settings.refFile, &old_file_size)) == NULL )
         {
-            fprintf(stderr, "Error opening old cross-reference file.  Assuming old file is out-of-date.\n");
+            fprintf(stderr, "Error reading old cross-reference file.  Assuming old file is out-of-date.\n");
             force_rebuild = TRUE;
         }
-        else    /* The old cross-reference file has been successfully opened */
+        else if ( !old_crossref_is_compatible(old_file_buf) )
         {
-            old_file_buf = g_malloc(statstruct.st_size);  /* malloc a buffer to hold the entire old-file */
-            if ( old_file_buf == NULL )
-            {
-                fprintf(stderr, "Error allocating memory to read old cross-reference file.  Assuming old file is out-of-date.\n");
-                force_rebuild = TRUE;
-            }
-            else
-            {
-                if ( fread(old_file_buf, 1, statstruct.st_size, old_file) != statstruct.st_size )
-                {
-                    fprintf(stderr, "Error reading old cross-reference file.  Assuming old file is out-of-date.\n");
-                    force_rebuild = TRUE;
-                }
-                else
-                {
-                    if ( !old_crossref_is_compatible(old_file_buf) )
-                    {
-                        printf("Pre-existing cross-reference file is incompatible.  Building New database...\n");
-                        force_rebuild = TRUE;
-                    }
-                    else
-                    {
-                        /* Looks like a useable "old" cross-reference, initialize the descriptor */
-                        /*************************************************************************/
+            printf("Pre-existing cross-reference file is incompatible.  Building New database...\n");
+            force_rebuild = TRUE;
+        }
+        else
+        {
+            /* Looks like a useable "old" cross-reference, initialize the descriptor */
+            /*************************************************************************/
 
-                        /* Get the modification time of the old cross-reference file */
-                        old_buf_descriptor.reftime = statstruct.st_mtime;
-                        old_buf_descriptor.start   = old_file_buf;
-                        old_buf_descriptor.end     = old_file_buf + statstruct.st_size - 1;
-                    }
-                }
-            }
-            fclose(old_file);
+            /* Get the modification time of the old cross-reference file */
+            old_buf_descriptor.reftime = statstruct.st_mtime;
+            old_buf_descriptor.start   = old_file_buf;
+            old_buf_descriptor.end     = old_file_buf + old_file_size - 1;
         }
     }
 
@@ -660,6 +996,7 @@ static gboolean old_crossref_is_compatible(char *file_buf)
 
     char    *cref_header;
     guint   header_size;
+    textdict_t old_dict;
 
     data_dir = DIR_get_path(DIR_DATA);
 
@@ -698,11 +1035,22 @@ static gboolean old_crossref_is_compatible(char *file_buf)
                         if (settings.truncateSymbols != option_val) retval = FALSE;
                     break;
 
+                    case 'D':   /* trained text dictionary (checked below: older cross-references lack the option) */
+                        options_ptr += 2;
+                    break;
+
                     default:
                         /* Unrecognized option, ignore */
+                        options_ptr += options_ptr[1] ? 2 : 1;
                     break;
                 }
             }
+
+            /* An incremental build keeps a trained dictionary (unless asked to retrain it).  Without
+               one, --train-dictionary needs a full build. */
+            option_val = (strstr(options, "D1") != NULL);
+            if ( option_val ? TEXTDICT_retrain_requested() : (TEXTDICT_requested() && !settings.compressDisable) ) retval = FALSE;
+            if ( option_val && !TEXTDICT_load(&old_dict, file_buf) ) retval = FALSE;
         }
         else
         {
@@ -732,14 +1080,19 @@ static void make_new_cref(old_buf_decriptor_t *old_descriptor)
     int         skipped = 0;        /* number of invalid "source" files skipped */
     int         copied = 0;         /* copied crossref for these files */
     struct      stat statstruct;    /* file status */
+    char        path[PATHLEN + 1];  /* file path (see DIR_src_path) */
 
     time_t      starttime;
     time_t      now;
 
     char        *old_offset_ptr;
     char        *new_cref_file;
+    uint32_t    section_start;      /* offset of the current file section */
     gboolean    full_update;
+    gboolean    parsed;             /* crossref() result */
     char        working_buf[200];
+    gchar       *dictionary;
+    gchar       *checksum;
 
 
     if (old_descriptor == NULL)
@@ -747,6 +1100,16 @@ static void make_new_cref(old_buf_decriptor_t *old_descriptor)
     else
         full_update = FALSE;
 
+    /* A full build may train a new text dictionary, an incremental build keeps the old one */
+    if (full_update)
+    {
+        TEXTDICT_init(&build_dict, !settings.compressDisable);
+        if ( TEXTDICT_requested() && !settings.compressDisable )
+            train_dictionary();
+    }
+    else
+        (void) TEXTDICT_load(&build_dict, old_descriptor->start);
+
 
     /* open the new cross-reference file */
     new_cref_file = DIR_get_path(FILE_NEW_CREF);
@@ -758,6 +1121,9 @@ static void make_new_cref(old_buf_decriptor_t *old_descriptor)
 
     putheader( DIR_get_path(DIR_DATA) );
 
+    /* start a new section table */
+    nsections = 0;
+
     /* output the leading tab expected by crossref() */
     dbputc('\t');
 
@@ -771,6 +1137,27 @@ static void make_new_cref(old_buf_decriptor_t *old_descriptor)
     firstfile = 0;
     lastfile = nsrcfiles;
     num_original = nsrcfiles;
+    build_pass = 1;
+
+    cached_sections = 0;
+    sprintf(section_format, "%d-c%dT%d", FILEVERSION, settings.compressDisable ? 1 : 0, settings.truncateSymbols ? 1 : 0);
+    if (build_dict.trained)
+    {
+        /* Cached sections are only valid with the dictionary that compressed them */
+        dictionary = TEXTDICT_format(&build_dict);
+        checksum   = g_compute_checksum_for_string(G_CHECKSUM_SHA1, dictionary, -1);
+        sprintf(section_format + strlen(section_format), "D%s", checksum);
+        g_free(checksum);
+        g_free(dictionary);
+    }
+
+    /* A shard parses only its share of the original source files (and the files they #include) */
+    SHARD_range(num_original, &firstfile, &lastfile);
+    if (lastfile - firstfile != num_original)
+    {
+        sprintf(working_buf, "Shard: %u of %u source files\n", lastfile - firstfile, num_original);
+        strcat(build_stats_msg, working_buf);
+    }
 
     starttime = time((time_t *) NULL);  // Initialize the progress bar timer
 
@@ -781,6 +1168,8 @@ static void make_new_cref(old_buf_decriptor_t *old_descriptor)
         /************************************************************************************************/
         for (;;)
         {
+            TRACE_BEGIN("build pass", firstfile == 0 ? "source files" : "#include files");
+
             /* get the next source file name from the NEW source file list*/
             for (fileindex = firstfile; fileindex < lastfile; fileindex++)
             {
@@ -790,30 +1179,36 @@ static void make_new_cref(old_buf_decriptor_t *old_descriptor)
                     if ( (now  - starttime) >= 1 )
                     {
                         starttime = now;
-                        DISPLAY_update_build_progress(fileindex, nsrcfiles);
+                        CORE_build_progress(fileindex, nsrcfiles);
                     }
                 }
                 
-                /* if srcDir is not NULL, temporarily cd to srcDir */
-                if ( strcmp(settings.srcDir, "") != 0) my_chdir(settings.srcDir);
-
                 new_file = DIR_src_files[fileindex];
+                section_start = dboffset;
 
-                if ( crossref(new_file) )
+                parsed = crossref_section(new_file, section_start);
+
+                if ( parsed )
+                {
+                    putsection(section_start);
                     built++;
+                }
                 else
                     skipped++;
 
-                /* if srcDir is not NULL, pop back to the original CWD */
-                if ( strcmp(settings.srcDir, "") != 0) my_chdir( DIR_get_path(DIR_CURRENT_WORKING) );
-                
             }  /* for (fileindex = firstfile; fileindex < lastfile; ++fileindex) */
 
+            TRACE_END("build pass");
+
+            /* The rest of the original source files belong to other shards */
+            if (lastfile < num_original)
+                lastfile = num_original;
+
             /* Process all include files detected during parsing */
             if (lastfile == nsrcfiles)
             {
                 sprintf(working_buf, "Cross-referenced %d files\n(Source parsing found %d additional include files)\n", 
-                        nsrcfiles - skipped, nsrcfiles - skipped - num_original);
+                        built, nsrcfiles - skipped - num_original);
                 strcat(build_stats_msg, working_buf);
 
                 if (skipped > 0)
@@ -827,6 +1222,7 @@ static void make_new_cref(old_buf_decriptor_t *old_descriptor)
 
             firstfile = lastfile;
             lastfile = nsrcfiles;
+            build_pass++;
 
             /* sort the included file names */
             qsort( (char *) &DIR_src_files[firstfile],
@@ -849,6 +1245,8 @@ static void make_new_cref(old_buf_decriptor_t *old_descriptor)
 
         for (;;)
         {
+            TRACE_BEGIN("build pass", firstfile == 0 ? "source files" : "#include files");
+
             /* get the next source file name from the NEW source file list*/
             for (fileindex = firstfile; fileindex < lastfile; ++fileindex)
             {
@@ -858,24 +1256,28 @@ static void make_new_cref(old_buf_decriptor_t *old_descriptor)
                     if ( (now  - starttime) >= 1 )
                     {
                         starttime = now;
-                        DISPLAY_update_build_progress(fileindex, nsrcfiles);
+                        CORE_build_progress(fileindex, nsrcfiles);
                     }
                 }
 
-                /* if srcDir is not NULL, temporarily cd to srcDir */
-                if ( strcmp(settings.srcDir, "") != 0) my_chdir(settings.srcDir);
-
                 new_file = DIR_src_files[fileindex];
 
                 old_offset_ptr = DIR_get_old_offset(new_file);
+                section_start = dboffset;
 
                 if (old_offset_ptr)     /* Old file match */
                 {
-                    /* If the file has been modified since it was last parsed. */
-                    if (stat(new_file, &statstruct) == 0 && statstruct.st_mtime > old_descriptor->reftime)
+                    /* If the file has been modified since it was last parsed (only changed files are checked in an update) */
+                    if ( update_files ? (g_hash_table_lookup(update_files, new_file) != NULL)
+                                      : (stat(DIR_src_path(new_file, path), &statstruct) == 0 && statstruct.st_mtime > old_descriptor->reftime) )
                     {
-                        if ( crossref(new_file) )
+                        parsed = crossref_section(new_file, section_start);
+
+                        if ( parsed )
+                        {
+                            putsection(section_start);
                             ++built;
+                        }
                         else
                             skipped++;
                     }
@@ -886,28 +1288,40 @@ static void make_new_cref(old_buf_decriptor_t *old_descriptor)
                         // Yes, we re-use the old data if we can't stat the file in question.  It's just
                         // too obscure of a corner case to justify more complexity -- 2/8/13 TF
 
+                        TRACE_BEGIN("copydata", new_file);
                         copydata(old_offset_ptr + 1);  // skip the leading '\t' character
+                        TRACE_END("copydata");
+                        REPORT_reused();
+                        putsection(section_start);
                         ++copied;
                     }
                 }
                 else            // File not found in old CREF, this must be a new file
                 {
-                    if ( crossref(new_file) ) 
+                    parsed = crossref_section(new_file, section_start);
+
+                    if ( parsed )
+                    {
+                        putsection(section_start);
                         ++built;
+                    }
                     else
                         skipped++;
                 }
 
-                /* if srcDir is not NULL, pop back to the original CWD */
-                if ( strcmp(settings.srcDir, "") != 0) my_chdir( DIR_get_path(DIR_CURRENT_WORKING) );
-
             } /* for (fileindex = firstfile; fileindex < lastfile; ++fileindex) */
 
+            TRACE_END("build pass");
+
+            /* The rest of the original source files belong to other shards */
+            if (lastfile < num_original)
+                lastfile = num_original;
+
             /* Process all include files detected during parsing */
             if (lastfile == nsrcfiles)
             {
                 sprintf(working_buf, "Cross-referenced %d files (%d New, %d Re-used)\nSource parsing found %d additional include files\n", 
-                        nsrcfiles - skipped, built, copied, nsrcfiles - skipped - num_original);
+                        built + copied, built, copied, nsrcfiles - skipped - num_original);
                 strcat(build_stats_msg, working_buf);
 
                 if (skipped > 0)
@@ -920,6 +1334,7 @@ static void make_new_cref(old_buf_decriptor_t *old_descriptor)
             }
             firstfile = lastfile;
             lastfile = nsrcfiles;
+            build_pass++;
 
             /* sort the included file names */
             qsort( (char *) &DIR_src_files[firstfile],
@@ -931,10 +1346,19 @@ static void make_new_cref(old_buf_decriptor_t *old_descriptor)
         } /* for(;;) */
     }  /*** End Incremental Update ***/
 
+    if (cached_sections > 0)
+    {
+        sprintf(working_buf, "Re-used %u cached #include file sections\n", cached_sections);
+        strcat(build_stats_msg, working_buf);
+    }
+
     /* add a null file name to the trailing tab */
     dbputc(NEWFILE);
     dbputc('\n');
 
+    /* append the section table and point the header at it */
+    puttrailer(new_cref_file);
+
     if (fflush(newrefs) == EOF)
     {
         /* fflush() failed - some sort of fatal file write error has occurred */
@@ -948,6 +1372,10 @@ static void make_new_cref(old_buf_decriptor_t *old_descriptor)
  
     (void) fclose(newrefs);
 
+    /* Partial (--shard) cross-references stay plain: the merge reads their sections directly */
+    if ( BLOCKS_requested() && !SHARD_build_requested() )
+        BLOCKS_compress_file(new_cref_file);
+
     /* replace the old database file with the new database file */
     movefile(new_cref_file, settings.refFile);
 //    printf("Cross-Reference build complete.\n\n");
@@ -955,6 +1383,299 @@ static void make_new_cref(old_buf_decriptor_t *old_descriptor)
 
 
 
+/* Write the cross-reference section of one source file: parse it, or copy its section from
+   the section cache (see sectcache.h).  Returns FALSE if the file was skipped. */
+static gboolean crossref_section(char *new_file, uint32_t section_start)
+{
+    gboolean    parsed;
+    gboolean    cache;
+    gchar       *entry;
+    gchar       *section;
+    char        path[PATHLEN + 1];
+
+    cache = SECTCACHE_enabled(new_file);
+
+    if ( cache && (entry = SECTCACHE_lookup(new_file, section_format, &section)) != NULL )
+    {
+        TRACE_BEGIN("copydata", new_file);
+        copydata(section);
+        TRACE_END("copydata");
+        g_free(entry);
+
+        REPORT_reused();
+        cached_sections++;
+        return(TRUE);
+    }
+
+    TRACE_BEGIN("crossref", new_file);
+    parsed = crossref(new_file, DIR_src_path(new_file, path));
+    TRACE_END("crossref");
+
+    if ( parsed )
+    {
+        REPORT_add(new_file, &crossref_cost);
+
+        if ( cache && fflush(newrefs) == 0 )
+            SECTCACHE_store(new_file, section_format, fileno(newrefs), section_start, dboffset - section_start);
+    }
+
+    return(parsed);
+}
+
+
+
+//====================================================================
+// Combine the partial cross-references written by a sharded build
+// (see shard.h) into settings.refFile.  File sections are ordered by
+// build pass, then by file name, as make_new_cref() orders them.  An
+// #include file that several shards parsed is written once, from its
+// earliest pass.  Section data is copied as-is, never re-parsed.
+//====================================================================
+
+void BUILD_merge(int nfiles, char **files)
+{
+    partial_cref_t      *partials;
+    partial_section_t   *section;
+    GPtrArray   *sections;
+    GHashTable  *written;
+    gboolean    *seen;
+    char        options[OPTIONS_LEN + 1];
+    char        first_options[OPTIONS_LEN + 1];
+    textdict_t  dict;
+    gchar       *dictionary;
+    gchar       *first_dictionary = NULL;
+    char        *new_cref_file;
+    char        *copy_buf;
+    uint32_t    remaining;
+    uint32_t    chunk;
+    guint       i;
+
+    partials = g_new0(partial_cref_t, nfiles);
+    sections = g_ptr_array_new();
+
+    for (i = 0; i < nfiles; i++)
+    {
+        partials[i].name = files[i];
+        read_partial(&partials[i], (i == 0) ? first_options : options, sections);
+
+        if ( i > 0 && strcmp(options, first_options) != 0 )
+            partial_error(&partials[i], "built with different options (-c, -T, --train-dictionary)");
+
+        /* Every shard trains the same dictionary (see textdict.c), unless the source files changed */
+        if ( !TEXTDICT_load(&dict, partials[i].header) )
+            partial_error(&partials[i], "damaged text dictionary");
+        dictionary = TEXTDICT_format(&dict);
+        if (i == 0)
+        {
+            build_dict       = dict;
+            first_dictionary = dictionary;
+        }
+        else
+        {
+            if ( strcmp(dictionary, first_dictionary) != 0 )
+                partial_error(&partials[i], "trained a different text dictionary (were the source files changed?)");
+            g_free(dictionary);
+        }
+        if ( partials[i].count != partials[0].count )
+            partial_error(&partials[i], "not from the same set of shards");
+    }
+
+    /* Every shard, exactly once */
+    if (partials[0].count != nfiles)
+    {
+        fprintf(stderr, "Fatal Error: The cross-reference was built in %u shards, %d given\n", partials[0].count, nfiles);
+        exit(EXIT_FAILURE);
+    }
+    seen = g_new0(gboolean, nfiles);
+    for (i = 0; i < nfiles; i++)
+    {
+        if ( seen[partials[i].index] )
+            partial_error(&partials[i], "shard given twice");
+        seen[partials[i].index] = TRUE;
+    }
+    g_free(seen);
+
+    /* The merged header carries the options the shards were built with */
+    settings.compressDisable = (strstr(first_options, "c1") != NULL);
+    settings.truncateSymbols = (strstr(first_options, "T1") != NULL);
+
+    g_ptr_array_sort(sections, compare_sections);
+
+    (void) SHARE_lock();    /* Don't replace the cross-reference under a gscope instance's build */
+
+    new_cref_file = DIR_get_path(FILE_NEW_CREF);
+    if ((newrefs = fopen(new_cref_file, "w")) == NULL)
+    {
+        my_cannotopen(new_cref_file);
+        exit(EXIT_FAILURE);
+    }
+
+    putheader( DIR_get_path(DIR_DATA) );
+    nsections = 0;
+    dbputc('\t');
+
+    written  = g_hash_table_new(g_str_hash, g_str_equal);
+    copy_buf = g_malloc(MERGE_BUF_SIZE);
+
+    for (i = 0; i < sections->len; i++)
+    {
+        section = g_ptr_array_index(sections, i);
+
+        if ( g_hash_table_lookup_extended(written, section->file, NULL, NULL) )
+            continue;       /* An #include file already written from an earlier pass */
+        g_hash_table_insert(written, section->file, NULL);
+
+        section_stats = section->counts;
+        putsection(dboffset);
+
+        if ( fseek(section->partial->file, section->offset, SEEK_SET) != 0 )
+            partial_error(section->partial, strerror(errno));
+
+        for (remaining = section->size; remaining > 0; remaining -= chunk)
+        {
+            chunk = MIN(remaining, MERGE_BUF_SIZE);
+            if ( fread(copy_buf, 1, chunk, section->partial->file) != chunk )
+                partial_error(section->partial, "truncated file section");
+            (void) fwrite(copy_buf, 1, chunk, newrefs);
+            dboffset += chunk;
+        }
+    }
+
+    /* add a null file name to the trailing tab */
+    dbputc(NEWFILE);
+    dbputc('\n');
+
+    puttrailer(new_cref_file);
+
+    if (fflush(newrefs) == EOF || ferror(newrefs))
+    {
+        fprintf(stderr, "%s\n", strerror(errno));
+        (void) unlink(new_cref_file);
+        fprintf(stderr, "Removed file %s because write failed\n", new_cref_file);
+        exit(EXIT_FAILURE);
+    }
+    (void) fclose(newrefs);
+
+    if ( BLOCKS_requested() )
+        BLOCKS_compress_file(new_cref_file);
+
+    movefile(new_cref_file, settings.refFile);
+    SHARE_publish();
+    SHARE_unlock();
+
+    printf("Merged %d partial cross-references: %u files\n", nfiles, nsections);
+
+    g_hash_table_destroy(written);
+    g_free(copy_buf);
+    for (i = 0; i < sections->len; i++)
+    {
+        section = g_ptr_array_index(sections, i);
+        g_free(section->file);
+        g_free(section);
+    }
+    g_ptr_array_free(sections, TRUE);
+    for (i = 0; i < nfiles; i++)
+    {
+        fclose(partials[i].file);
+        free(partials[i].header);
+    }
+    g_free(partials);
+    g_free(first_dictionary);
+}
+
+
+
+/* Read a partial cross-reference's header options, section table and pass table.  Each
+   file section is added to 'sections' (the partial stays open for BUILD_merge to copy from). */
+static void read_partial(partial_cref_t *partial, char *options, GPtrArray *sections)
+{
+    partial_section_t   *section;
+    stats_struct_t      *cptr;
+    char        line[PATHLEN + OPTIONS_LEN + 64];
+    char        *format_string;
+    size_t      header_size = 0;
+    ssize_t     header_length;
+    uint32_t    trailer_offset;
+    uint32_t    count;
+    uint32_t    end;
+    uint32_t    first = sections->len;
+    uint32_t    i;
+    gboolean    valid;
+
+    if ( (partial->file = fopen(partial->name, "rb")) == NULL )
+    {
+        my_cannotopen(partial->name);
+        exit(EXIT_FAILURE);
+    }
+
+    /* Construct a format_string that protects us from buffer overflows */
+    /* The trailer offset is the last field of the header (a text dictionary may precede it) */
+    my_asprintf(&format_string, "cscope %%d %%*s %%%ds", OPTIONS_LEN);
+    valid = ( (header_length = getline(&partial->header, &header_size, partial->file)) > 11 &&
+              sscanf(partial->header, format_string, &fileversion, options) == 2 &&
+              sscanf(partial->header + header_length - 11, "%u", &trailer_offset) == 1 &&
+              fileversion == FILEVERSION );
+    g_free(format_string);
+    if ( !valid )
+        partial_error(partial, "not a cross-reference of this gscope version");
+
+    /* The trailer follows the final (null) file mark */
+    if ( trailer_offset < 2 || fseek(partial->file, trailer_offset - 2, SEEK_SET) != 0 ||
+         getc(partial->file) != NEWFILE || getc(partial->file) != '\n' ||
+         fscanf(partial->file, SECTION_TABLE_TAG " %u", &count) != 1 )
+        partial_error(partial, "no section table");
+
+    for (i = 0; i < count; i++)
+    {
+        section = g_new0(partial_section_t, 1);
+        section->partial = partial;
+        cptr = &section->counts;
+        g_ptr_array_add(sections, section);
+
+        if ( fscanf(partial->file, "%u %u %u %u %u %u %u", &section->offset,
+                    &cptr->define_cnt, &cptr->identifier_cnt, &cptr->fn_calls_cnt,
+                    &cptr->fn_cnt, &cptr->class_cnt, &cptr->include_cnt) != 7 )
+            partial_error(partial, "damaged section table");
+    }
+
+    if ( fscanf(partial->file, " " SHARD_TABLE_TAG " %u %u", &partial->index, &partial->count) != 2 ||
+         partial->index >= partial->count )
+        partial_error(partial, "not a partial cross-reference (see --shard)");
+
+    for (i = 0; i < count; i++)
+    {
+        section = g_ptr_array_index(sections, first + i);
+        if ( fscanf(partial->file, "%u", &section->pass) != 1 )
+            partial_error(partial, "damaged shard table");
+    }
+
+    /* A section runs up to the next file mark; get its file name */
+    for (i = 0; i < count; i++)
+    {
+        section = g_ptr_array_index(sections, first + i);
+        end = (i + 1 < count) ? ((partial_section_t *) g_ptr_array_index(sections, first + i + 1))->offset
+                              : trailer_offset - 2;
+
+        if ( end <= section->offset || fseek(partial->file, section->offset, SEEK_SET) != 0 ||
+             fgets(line, sizeof(line), partial->file) == NULL || line[0] != NEWFILE )
+            partial_error(partial, "damaged section table");
+
+        line[strcspn(line, "\n")] = '\0';
+        section->file = g_strdup(line + 1);
+        section->size = end - section->offset;
+    }
+}
+
+
+
+static void partial_error(partial_cref_t *partial, const char *problem)
+{
+    fprintf(stderr, "Fatal Error: Cannot merge [%s]: %s\n", partial->name, problem);
+    exit(EXIT_FAILURE);
+}
+
+
+
 
 /* string comparison function for qsort */
 
@@ -965,6 +1686,24 @@ static int compare(char **s1, char **s2)
 
 
 
+/* merge order: build pass, file name (as compare()), then shard */
+static int compare_sections(const void *s1, const void *s2)
+{
+    const partial_section_t *a = *(partial_section_t * const *) s1;
+    const partial_section_t *b = *(partial_section_t * const *) s2;
+    int     result;
+
+    if (a->pass != b->pass)
+        return( (a->pass < b->pass) ? -1 : 1 );
+
+    if ( (result = strcmp(a->file, b->file)) != 0 )
+        return(result);
+
+    return( (a->partial->index < b->partial->index) ? -1 : (a->partial->index > b->partial->index) );
+}
+
+
+
 static char *get_old_file(char *dest_ptr, char *src_ptr)
 {
     uint32_t count = 0;
@@ -1010,6 +1749,8 @@ static char *get_old_file(char *dest_ptr, char *src_ptr)
 
 static void putheader(char *dir)
 {
+    gchar   *dictionary;
+
     dboffset = fprintf(newrefs, "cscope %d %s ", FILEVERSION, dir);
 
     /* When re-using a saved database, the application settings must track the settings used to create the original */
@@ -1018,7 +1759,16 @@ static void putheader(char *dir)
 
     dboffset += fprintf(newrefs, "%s", settings.truncateSymbols ? "T1" : "T0");
 
-    /* Terminate the options field and add a dummy offset value (traileroffset value is no longer used) */
+    /* A trained text dictionary follows the options (see textdict.h) */
+    if (build_dict.trained)
+    {
+        dictionary = TEXTDICT_format(&build_dict);
+        dboffset  += fprintf(newrefs, "D1 %s", dictionary);
+        g_free(dictionary);
+    }
+
+    /* Terminate the options field and add a placeholder trailer offset (puttrailer() fills in the real value) */
+    trailer_field = dboffset + 1;
     dboffset += fprintf(newrefs, " %.10d\n", dboffset);
 }
 
@@ -1029,6 +1779,8 @@ static void copydata(char *src_ptr)
 {
     char   symbol[PATHLEN + 1];
 
+    memset(&section_stats, 0, sizeof(stats_struct_t));
+
     for (;;)
     {
         /* copy up to the next 'tab' */
@@ -1047,6 +1799,8 @@ static void copydata(char *src_ptr)
 
         src_ptr++;      /* Now update the read pointer */
 
+        SEARCH_count_mark(&section_stats, *src_ptr);
+
         /* look for an #included file */
         if (*src_ptr == INCLUDE)
         {
@@ -1062,6 +1816,63 @@ static void copydata(char *src_ptr)
 
 
 
+/* add the just-written file section (and its symbol counts) to the section table */
+static void putsection(uint32_t offset)
+{
+    if (section_table == NULL || nsections == msections)
+    {
+        msections = (msections == 0) ? 1024 : msections * 2;
+        section_table = g_realloc(section_table, msections * sizeof(section_stats_t));
+        section_pass  = g_realloc(section_pass, msections * sizeof(uint32_t));
+    }
+    section_table[nsections].offset = offset;
+    section_table[nsections].counts = section_stats;
+    section_pass[nsections]         = build_pass;
+    nsections++;
+}
+
+
+
+/* output the section table and back-patch its offset into the header */
+static void puttrailer(char *new_cref_file)
+{
+    uint32_t    trailer_offset = dboffset;
+    uint32_t    i;
+    uint32_t    shard_index;
+    uint32_t    shard_count;
+    stats_struct_t  *cptr;
+
+    dboffset += fprintf(newrefs, "%s %u\n", SECTION_TABLE_TAG, nsections);
+    for (i = 0; i < nsections; i++)
+    {
+        cptr = &(section_table[i].counts);
+        dboffset += fprintf(newrefs, "%u %u %u %u %u %u %u\n",
+                            (uint32_t) section_table[i].offset,
+                            cptr->define_cnt, cptr->identifier_cnt, cptr->fn_calls_cnt,
+                            cptr->fn_cnt, cptr->class_cnt, cptr->include_cnt);
+    }
+
+    /* A partial cross-reference (see shard.h) also records the build pass of every section */
+    if ( SHARD_get(&shard_index, &shard_count) )
+    {
+        dboffset += fprintf(newrefs, "%s %u %u\n", SHARD_TABLE_TAG, shard_index, shard_count);
+        for (i = 0; i < nsections; i++)
+            dboffset += fprintf(newrefs, "%u\n", section_pass[i]);
+    }
+
+    if ( fseek(newrefs, trailer_field, SEEK_SET) != 0 ||
+         fprintf(newrefs, "%.10u", trailer_offset) != 10 ||
+         fseek(newrefs, 0, SEEK_END) != 0 )
+    {
+        fprintf(stderr, "%s\n", strerror(errno));
+        (void) unlink(new_cref_file);
+        fprintf(stderr, "Removed file %s because write failed\n", new_cref_file);
+        exit(EXIT_FAILURE);
+    }
+}
+
+
+
 /* replace the old file with the new file */
 
 static void movefile(char *new, char *old)
@@ -1091,9 +1902,8 @@ static void get_decompressed_string(char *dest, char *src)
     {
         if (byte > 0x7f)
         {
-            byte   &= 0x7f;
-            *dest++ = dichar1[byte / 8];
-            *dest++ = dichar2[byte & 7];
+            memcpy(dest, TEXTDICT_TEXT(&build_dict, byte), TEXTDICT_LENGTH(&build_dict, byte));
+            dest += TEXTDICT_LENGTH(&build_dict, byte);
         }
         else
         {
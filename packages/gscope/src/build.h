@@ -1,15 +1,18 @@
 extern  FILE    *newrefs;       /* new cross-reference */
-extern char     dicode2[];      /* digraph second character code */
 
 int             fileversion;    /* cross-reference file version */
-extern char     dichar1[];      /* 16 most frequent first chars */
-extern char     dichar2[];      /* 8 most frequent second chars using the above as first chars */
-extern char     dicode1[];      /* digraph first character code */
-extern char     dicode2[];      /* digraph second character code */
 
 extern time_t       autogen_elapsed_sec;
 extern suseconds_t  autogen_elapsed_usec;
 
+#define BUILD_INSTALL_RETRY_MS  100     /* Background build: wait for a running lookup before installing the result */
+
+typedef void (*BUILD_done_func)(gpointer data);
+
 void  BUILD_initDatabase(void);
+gboolean BUILD_start_background(GHashTable *changed_files, BUILD_done_func done, gpointer data);
+gboolean BUILD_load_background(BUILD_done_func done, gpointer data);
+gboolean BUILD_in_progress(void);
 void  BUILD_init_cli_file_list(int argc, char *argv[]);
+void  BUILD_merge(int nfiles, char **files);
 
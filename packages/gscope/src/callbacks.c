@@ -19,6 +19,8 @@
 #include "fileview.h"
 #include "dir.h"
 #include "build.h"
+#include "stale.h"
+#include "share.h"
 #include "app_config.h"
 
 
@@ -52,6 +54,10 @@ static void process_query(search_t query_type);
 static gboolean exit_confirmed(void);
 static void shutdown(void);
 static SrcFile_stats *create_stats_list(SrcFile_stats **si_stats);
+static void rebuild_database(GHashTable *changed_files);
+static void start_build(GHashTable *changed_files);
+static void rebuild_done(gpointer data);
+static void load_published_cref(void);
 
 
 //---------------- Private Globals ----------------------------------
@@ -81,6 +87,9 @@ static gboolean  cache_threshold_changed = FALSE;
 static gboolean  terminal_app_entry_changed = FALSE;
 static gboolean  file_manager_app_entry_changed = FALSE;
 
+static search_t  queued_query = FIND_NULL;  /* Query made before the first cross-reference was ready */
+static gchar     *queued_pattern = NULL;
+
 
 static unsigned int active_dir_entry;
 static unsigned int active_input_entry;
@@ -209,6 +218,15 @@ static void process_query(search_t query_type)
         return;
     }
 
+    if ( !SEARCH_ready() )      // The first cross-reference is still being built: run the query when it is ready
+    {
+        g_free(queued_pattern);
+        queued_query   = query_type;
+        queued_pattern = g_strdup(gtk_entry_get_text(GTK_ENTRY(query_entry)));
+        DISPLAY_status("<span foreground=\"blue\">Query queued: waiting for the Cross Reference build to finish</span>");
+        return;
+    }
+
     if (query_type <= FIND_INCLUDING) // if this is not a "virtual button" query
     {
         // Make the most recent query the default
@@ -384,39 +402,99 @@ void
 on_rebuild_database1_activate          (GtkMenuItem     *menuitem,
                                         gpointer         user_data)
 {
-    static gboolean in_progress_lockout = FALSE;
+    rebuild_database(NULL);
+}
+
+
+
+/* Startup: build the cross-reference (as configured) while the main window is already usable */
+void CALLBACKS_build_database()
+{
+    start_build(NULL);
+
+    /* Pick up cross-references built by other gscope sessions on this project */
+    SHARE_monitor(load_published_cref);
+}
+
+
+
+/* Another gscope session has published a new cross-reference: load it (in the background) */
+static void load_published_cref()
+{
+    gtk_widget_show(lookup_widget(gscope_main, "rebuild_progressbar"));
+
+    if ( !BUILD_load_background(rebuild_done, (gpointer) "Cross Reference updated by another gscope session") )
+        gtk_widget_hide(lookup_widget(gscope_main, "rebuild_progressbar"));
+}
 
-    if ( !in_progress_lockout )
+
+
+/* Rebuild the cross-reference: all (out-of-date) files, or only 'changed_files' when known (the
+   set is freed).  The build runs in the background; queries search the current cross-reference
+   until the new one is ready. */
+static void rebuild_database(GHashTable *changed_files)
+{
+    if ( BUILD_in_progress() )
     {
-        in_progress_lockout = TRUE;
+        if (changed_files)
+            g_hash_table_destroy(changed_files);
+        return;
+    }
 
-        gtk_widget_show(lookup_widget(gscope_main, "rebuild_progressbar"));
-        gtk_widget_hide(lookup_widget(gscope_main, "status_label"));
+    /* Rebuild the cross-reference */
+    settings.noBuild = FALSE;           /* Override the noBuild setting (for this session only - leave preferences file as-is) */
+    start_build(changed_files);
+}
 
-        // This widget will not actually appear until the first progress bar update.
 
-        /* Rebuild the cross-reference */
-        settings.noBuild = FALSE;           /* Override the noBuild setting (for this session only - leave preferences file as-is) */
-        BUILD_initDatabase();               /* Rebuild the cross-reference */
 
-        /* Close results of previous searches */
-        if (refsfound != NULL)
-        {
-            fclose(refsfound);
-            refsfound = NULL;
-        }
+static void start_build(GHashTable *changed_files)
+{
+    // The status line stays visible: queries can be made while the build runs.
+    gtk_widget_show(lookup_widget(gscope_main, "rebuild_progressbar"));
 
-        /*
-         * Reset the record of the last query so that the next query will not
-         * be reported as current.
-         */
-         process_query(FIND_NULL);
+    BUILD_start_background(changed_files, rebuild_done, NULL);
+}
 
-         gtk_widget_hide(lookup_widget(gscope_main, "rebuild_progressbar"));
-         gtk_widget_show(lookup_widget(gscope_main, "status_label"));
 
-         DISPLAY_status("<span foreground=\"seagreen\" weight=\"bold\">Cross Reference rebuild complete</span>");
-         in_progress_lockout = FALSE;
+
+/* The rebuilt cross-reference has been installed (between queries).  'data': status message, or NULL */
+static void rebuild_done(gpointer data)
+{
+    gchar       *msg;
+    search_t    query_type;
+
+    /* Close results of previous searches */
+    if (refsfound != NULL)
+    {
+        fclose(refsfound);
+        refsfound = NULL;
+    }
+
+    /*
+     * Reset the record of the last query so that the next query will not
+     * be reported as current.
+     */
+     process_query(FIND_NULL);
+
+     gtk_widget_hide(lookup_widget(gscope_main, "rebuild_progressbar"));
+
+     my_asprintf(&msg, "<span foreground=\"seagreen\" weight=\"bold\">%s</span>",
+                 data ? (const gchar *) data : "Cross Reference rebuild complete");
+     DISPLAY_status(msg);
+     g_free(msg);
+
+    /* Run the query made while the first cross-reference was being built */
+    if (queued_query != FIND_NULL)
+    {
+        query_type   = queued_query;
+        queued_query = FIND_NULL;
+
+        gtk_entry_set_text(GTK_ENTRY(lookup_widget(gscope_main, "query_entry")), queued_pattern);
+        g_free(queued_pattern);
+        queued_pattern = NULL;
+
+        process_query(query_type);
     }
 }
 
@@ -2342,7 +2420,8 @@ static SrcFile_stats *create_stats_list(SrcFile_stats **si_stats)
     gchar *wptr;
     gchar delimiter;
     gchar working[80];       // Working buffer for constructing each individual suffix string.
-    int f;
+    gchar *src_file;
+    DIR_src_iter_t iter;
     guint noSuffixCnt = 0;
     guint si_noSuffixCnt = 0;
 
@@ -2399,17 +2478,18 @@ static SrcFile_stats *create_stats_list(SrcFile_stats **si_stats)
         counter = 0;
 
         // Now that the list is created, collect the per-suffix statistics
-        for ( f = 0; f < nsrcfiles; f++ )
+        DIR_src_iter_init(&iter, 0);
+        while ( (src_file = (gchar *) DIR_src_iter_next(&iter)) != NULL )
         {
 
-           if ( (include_file_path_exists) && (DIR_file_on_include_search_path(DIR_src_files[f])) )
+           if ( (include_file_path_exists) && (DIR_file_on_include_search_path(src_file)) )
            {
                /* Count this file in the system include source stats */
                if (settings.showIncludes)
-                   printf("%d) %s\n", ++counter, DIR_src_files[f]);
+                   printf("%d) %s\n", ++counter, src_file);
 
                // if the file has a suffix
-               if ( ( wptr = strrchr(DIR_src_files[f], '.') ) != NULL)
+               if ( ( wptr = strrchr(src_file, '.') ) != NULL)
                {
                    si_entry = si_ListBegin;
                    // increment the suffix counter corresponding to wptr
@@ -2433,7 +2513,7 @@ static SrcFile_stats *create_stats_list(SrcFile_stats **si_stats)
                 /* Count this file in the user program source stats */
            {
                // if the file has a suffix
-               if ( ( wptr = strrchr(DIR_src_files[f], '.') ) != NULL)
+               if ( ( wptr = strrchr(src_file, '.') ) != NULL)
                {
                    entry = ListBegin;
                    // increment the suffix counter corresponding to wptr
@@ -2441,7 +2521,7 @@ static SrcFile_stats *create_stats_list(SrcFile_stats **si_stats)
                    {
                        if ( strcmp(entry->suffix, wptr) == 0)
                        {
-                           //if ( strcmp(wptr, DELSOL_ISINK_FID_INIT) == 0) printf("%s\n", DIR_src_files[f]);
+                           //if ( strcmp(wptr, DELSOL_ISINK_FID_INIT) == 0) printf("%s\n", src_file);
                            entry->fcount++;
                            break;
                        }
@@ -2476,7 +2556,7 @@ static SrcFile_stats *create_stats_list(SrcFile_stats **si_stats)
     entry = g_malloc(sizeof(SrcFile_stats));
     entry->next = ListBegin;
     ListBegin = entry;
-    entry->fcount = nsrcfiles;
+    entry->fcount = DIR_src_count();
     entry->suffix = strdup("Total");
 
     // Now reverse the entries in the linked list so that the
@@ -2521,6 +2601,7 @@ on_session_statistics_activate         (GtkMenuItem     *menuitem,
     static SrcFile_stats  *sft_list = NULL;
     static SrcFile_stats  *si_sft_list = NULL;
     static stats_struct_t symbol_stats;
+    static GtkWidget      *dir_stats_label = NULL;     // Created on first use, below the lexical analysis table
 
     gchar tmp_str[MAX_STAT_STRING + 1];
     GtkWidget *header_hbox;
@@ -2537,6 +2618,11 @@ on_session_statistics_activate         (GtkMenuItem     *menuitem,
     gchar working[MAX_STATS_PATH + 1];
     gchar *offset_ptr;
     char  *cwd_ptr;
+    GArray      *dir_stats;
+    dir_stats_t *dir_entry;
+    GString     *dir_text;
+    gchar       *row;
+    guint       i;
 
 
     if ( !stats_visible )
@@ -2749,6 +2835,42 @@ on_session_statistics_activate         (GtkMenuItem     *menuitem,
         sprintf(tmp_str, "<span size=\"large\" color=\"blue\">%d</span>", symbol_stats.include_cnt);
         gtk_label_set_label(GTK_LABEL (lookup_widget(GTK_WIDGET (stats_dialog) ,"include_file_count_label")), tmp_str);
 
+
+        /* The same counts per top-level directory (from the cross-reference's section table) */
+        if (dir_stats_label == NULL)
+        {
+            dir_stats_label = gtk_label_new(NULL);
+            gtk_widget_set_name(dir_stats_label, "dir_stats_label");
+            #ifdef GTK3_BUILD
+            gtk_widget_set_halign(dir_stats_label, GTK_ALIGN_START);
+            #else
+            gtk_misc_set_alignment(GTK_MISC(dir_stats_label), 0, 0);
+            gtk_misc_set_padding(GTK_MISC(dir_stats_label), 10, 0);
+            #endif
+            gtk_box_pack_start(GTK_BOX(lookup_widget(GTK_WIDGET(stats_dialog), "vbox16")), dir_stats_label, FALSE, FALSE, 5);
+        }
+
+        dir_text = g_string_new("<span size=\"large\" weight=\"bold\">Source File Lexical Analysis Statistics by Directory</span>\n\n<tt>");
+        g_string_append_printf(dir_text, "<b>%-30s %8s %11s %11s %9s %7s %9s %8s</b>\n",
+                               "Directory", "Files", "Definitions", "Identifiers", "Functions", "Classes", "Calls", "Includes");
+
+        dir_stats = SEARCH_stats_by_dir();
+        for (i = 0; i < dir_stats->len; i++)
+        {
+            dir_entry = &g_array_index(dir_stats, dir_stats_t, i);
+            row = g_markup_printf_escaped("%-30s %8u %11u %11u %9u %7u %9u %8u\n", dir_entry->dir, dir_entry->files,
+                                          dir_entry->counts.define_cnt, dir_entry->counts.identifier_cnt,
+                                          dir_entry->counts.fn_cnt, dir_entry->counts.class_cnt,
+                                          dir_entry->counts.fn_calls_cnt, dir_entry->counts.include_cnt);
+            g_string_append(dir_text, row);
+            g_free(row);
+        }
+        SEARCH_free_dir_stats(dir_stats);
+
+        g_string_append(dir_text, "</tt>");
+        gtk_label_set_markup(GTK_LABEL(dir_stats_label), dir_text->str);
+        g_string_free(dir_text, TRUE);
+
         gtk_window_set_transient_for(GTK_WINDOW(stats_dialog), GTK_WINDOW(gscope_main));
 
         gtk_widget_show_all(stats_dialog);
@@ -3091,10 +3213,16 @@ void
 on_cref_update_button_clicked          (GtkButton       *button,
                                         gpointer         user_data)
 {
+    GHashTable  *changed_files;
+
     if ( SEARCH_get_cref_status() )   // If the cref is marked up-to-date, check for changes
         SEARCH_check_cref();
     else
-        on_rebuild_database1_activate(NULL, NULL);  // Otherwise, rebuild the cross reference.
+    {
+        // Otherwise, update the cross reference: just the changed files if the last check found them.
+        changed_files = STALE_take_changes();
+        rebuild_database(changed_files);
+    }
 }
 
 
@@ -1,6 +1,7 @@
 #include <gtk/gtk.h>
 
 void CALLBACKS_init(GtkWidget *main);
+void CALLBACKS_build_database(void);
 
 
 void
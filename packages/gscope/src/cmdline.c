@@ -0,0 +1,211 @@
+/*
+ *  gscope command line handling
+ *
+ *  The option table and the headless modes, shared by the GTK front-end (main.c) and the
+ *  GLib-only command-line front-end (gscope_cli.c), so both accept the same options and a
+ *  headless tool gives the same results as the GUI binary.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "app_config.h"
+#include "build.h"
+#include "search.h"
+#include "crossref.h"
+#include "query.h"
+#include "serve.h"
+#include "report.h"
+#include "watch.h"
+#include "shard.h"
+#include "federate.h"
+#include "sectcache.h"
+#include "blocks.h"
+#include "textdict.h"
+#include "cmdline.h"
+
+
+//===============================================================
+//      Private Function Prototypes
+//===============================================================
+
+static void copy_argument(gchar *setting, gchar *argument);
+
+
+
+//===============================================================
+//      Private Globals
+//===============================================================
+
+static gboolean option_error = FALSE;
+static gchar    *refFile = NULL;
+static gchar    *nameFile = NULL;
+static gchar    *includeDir = NULL;
+static gchar    *rcFile = NULL;
+static gchar    *srcDir = NULL;
+
+#define G_OPTION_FLAG_NONE 0
+
+static GOptionEntry options[] = {
+    {
+        "refOnly", 'b', G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE, &settings.refOnly,
+        "Build the cross-reference only.  (No GUI)", NULL
+    },
+    {
+        "compressOff", 'c', G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE, &settings.compressDisable,
+        "Use only ASCII characters in the cross-reference file (don't compress).", NULL
+    },
+    {
+        "noBuild", 'd', G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE, &settings.noBuild,
+        "Do not update the cross-reference file.", NULL
+    },
+    {
+        "refFile", 'f', G_OPTION_FLAG_NONE, G_OPTION_ARG_FILENAME, &refFile,
+        "Use the filename specified as the cross reference [output] file name instead of 'cscope_db.out`", "FILE"
+    },
+    {
+        "nameFile", 'i', G_OPTION_FLAG_NONE, G_OPTION_ARG_FILENAME, &nameFile,
+        "Use the filename specified as the list of source files to cross-reference", "FILE"
+    },
+    {
+        "includeDir", 'I', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, &includeDir,
+        "Use the specified directory search path to find #include files. (:dir1:dir2:dirN:)", "PATH"
+    },
+    {
+        "rcFile", 'r', G_OPTION_FLAG_NONE, G_OPTION_ARG_FILENAME, &rcFile,
+        "Start Gscope using the preferences info from FILE.", "FILE"
+    },
+    {
+        "recurseDir", 'R', G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE, &settings.recurseDir,
+        "Recursively search all subdirecties [Default = search below <current-dir>] for source files.", NULL
+    },
+    {
+        "srcDir", 'S', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, &srcDir,
+        "Search the specified directory for source files. When used with -R, set search-root = DIRECTORY.", "DIRECTORY"
+    },
+    {
+        "truncSymbols", 'T', G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE, &settings.truncateSymbols,
+        "Use only the first eight characters to match against C symbols.", NULL
+    },
+    {
+        "updateAll", 'u', G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE, &option_error,
+        "***DEPRICATED option do not use*** Unconditionally [re]build the cross-reference file.", NULL
+    },
+    {
+        /* Debugging tool, not for end-user consumption */
+        "UpdateAll", 'U', G_OPTION_FLAG_HIDDEN, G_OPTION_ARG_NONE, &settings.updateAll,
+        "Unconditionally [re]build the cross-reference file.", NULL
+    },
+    {
+        "version", 'v', G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE, &settings.version,
+        "Show version information", NULL
+    },
+    { NULL }
+};
+
+
+
+//===============================================================
+//      Private Functions
+//===============================================================
+
+/* Buffer overflow protection:  Any [argument] string that exceeds the maximum allowed size is truncated */
+static void copy_argument(gchar *setting, gchar *argument)
+{
+    if (argument)
+    {
+        strncpy(setting, argument, MAX_STRING_ARG_SIZE);
+        setting[MAX_STRING_ARG_SIZE - 1] = 0;
+        g_free(argument);
+    }
+}
+
+
+
+//===============================================================
+//      Public Interface Functions
+//===============================================================
+
+/* An option context with the options of every core module (g_option_context_free() it) */
+GOptionContext *CMDLINE_context(void)
+{
+    GOptionContext  *context;
+
+    context = g_option_context_new("[source files]");
+    g_option_context_add_main_entries(context, options, NULL);
+    g_option_context_add_main_entries(context, QUERY_options, NULL);
+    g_option_context_add_main_entries(context, SERVE_options, NULL);
+    g_option_context_add_main_entries(context, REPORT_options, NULL);
+    g_option_context_add_main_entries(context, WATCH_options, NULL);
+    g_option_context_add_main_entries(context, SHARD_options, NULL);
+    g_option_context_add_main_entries(context, FEDERATE_options, NULL);
+    g_option_context_add_main_entries(context, SECTCACHE_options, NULL);
+    g_option_context_add_main_entries(context, BLOCKS_options, NULL);
+    g_option_context_add_main_entries(context, TEXTDICT_options, NULL);
+
+    return(context);
+}
+
+
+
+/* Copy the parsed [argument] strings to the settings structure (and free them).  Handles -v. */
+void CMDLINE_apply_options(void)
+{
+    if (option_error) fprintf(stderr, "Warning:  Ignoring depricated option '-u'.\n");
+
+    if (settings.updateAll) fprintf(stderr, "Warning: Unless you are debugging Gscope, you should probably not be using the '-U' option.\n");
+
+    copy_argument(settings.refFile,    refFile);
+    copy_argument(settings.nameFile,   nameFile);
+    copy_argument(settings.includeDir, includeDir);
+    copy_argument(settings.rcFile,     rcFile);
+    copy_argument(settings.srcDir,     srcDir);
+    refFile = nameFile = includeDir = rcFile = srcDir = NULL;
+
+    if (settings.version)
+    {
+        printf("GSCOPE version %s\n", VERSION);
+        exit(EXIT_SUCCESS);
+    }
+}
+
+
+
+/* Run the modes that need no display.  'argc' and 'argv' are what is left after option
+   parsing (the source file arguments).  Returns the exit status, or CMDLINE_NEEDS_GUI. */
+int CMDLINE_run_headless(int argc, char *argv[])
+{
+    /* save the filename arguments */
+    BUILD_init_cli_file_list(argc, argv);
+
+    /* Start loading any additional cross-references searched with ours (--search-also) */
+    FEDERATE_start();
+
+    if (QUERY_requested())      /* Line-oriented query mode: no GUI */
+        return(QUERY_main());
+
+    if (SERVE_requested())      /* Query daemon: no GUI */
+        return(SERVE_main());
+
+    if (SHARD_merge_requested())    /* Combine partial cross-references: no GUI */
+        return(SHARD_merge_main(argc - 1, argv + 1));
+
+    if (SHARD_build_requested())    /* A partial cross-reference is only built, never browsed */
+        settings.refOnly = TRUE;
+
+    if (settings.refOnly)
+    {
+        APP_CONFIG_init(NULL);
+        BUILD_initDatabase();
+        return(EXIT_SUCCESS);
+    }
+
+    return(CMDLINE_NEEDS_GUI);
+}
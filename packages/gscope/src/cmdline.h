@@ -0,0 +1,24 @@
+
+/* Command line handling shared by the GUI (gscope) and the headless front-end (gscope-cli):
+ *
+ *   context = CMDLINE_context();               The options of every core module
+ *   [add the GUI's option group]
+ *   g_option_context_parse(context, ...);
+ *   CMDLINE_apply_options();                   Copy the arguments to the settings, handle -v
+ *   status = CMDLINE_run_headless(argc, argv);
+ *
+ * CMDLINE_run_headless() does the modes that need no display: -L (line queries), --serve,
+ * --merge and -b/--refOnly (and --shard, which implies -b).  It returns their exit status,
+ * or CMDLINE_NEEDS_GUI if the command line asks for the GUI.
+ */
+
+#define CMDLINE_NEEDS_GUI   (-1)
+
+
+//===============================================================
+//      Public Interface Functions
+//===============================================================
+
+GOptionContext *    CMDLINE_context         (void);
+void                CMDLINE_apply_options   (void);
+int                 CMDLINE_run_headless    (int argc, char *argv[]);
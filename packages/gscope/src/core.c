@@ -0,0 +1,291 @@
+/*
+ *  gscope core library front-end hooks
+ *
+ *  The cross-reference build and search modules [libgscope-core] report progress and status
+ *  through this module rather than calling the GTK display module directly, so they can be
+ *  linked into headless tools (command-line queries, benchmarks) that have no X server.
+ *  The GUI installs its display functions with CORE_set_callbacks() at startup.
+ *
+ *  Hooks always run on the thread that installed them.  Reports made on another thread (a
+ *  background cross-reference build) are queued to the main loop with g_idle_add(); build
+ *  progress reports are coalesced so that only the latest is delivered.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "core.h"
+
+
+//===============================================================
+//      Private Globals
+//===============================================================
+
+static core_callbacks_t hooks;      /* All NULL: headless defaults */
+static GThread          *hooks_thread = NULL;   /* Front-end (GTK) thread */
+
+/* A report made off the front-end thread */
+typedef struct
+{
+    void        (*text_hook)(const gchar *msg);
+    void        (*flag_hook)(gboolean flag);
+    gboolean    is_msg;             /* hooks.msg(type, text) */
+    core_msg_e  type;
+    gchar       *text;
+    gboolean    flag;
+} deferred_t;
+
+G_LOCK_DEFINE_STATIC(progress);
+static gboolean         progress_pending = FALSE;
+static guint            progress_count;
+static guint            progress_max;
+
+
+
+//===============================================================
+//      Private Functions
+//===============================================================
+
+/* Write a message to stderr with its Pango markup removed */
+static void print_plain_text(FILE *stream, const gchar *message)
+{
+    static const struct
+    {
+        const char  *entity;
+        char        c;
+    } entities[] = { {"&lt;", '<'}, {"&gt;", '>'}, {"&amp;", '&'}, {"&quot;", '"'}, {"&apos;", '\''} };
+
+    const gchar *p;
+    guint       i;
+
+    for (p = message; *p; p++)
+    {
+        if (*p == '<')      // skip a markup tag
+        {
+            const gchar *end = strchr(p, '>');
+
+            if (end)
+            {
+                p = end;
+                continue;
+            }
+        }
+        else if (*p == '&')
+        {
+            for (i = 0; i < G_N_ELEMENTS(entities); i++)
+            {
+                if (strncmp(p, entities[i].entity, strlen(entities[i].entity)) == 0)
+                    break;
+            }
+            if (i < G_N_ELEMENTS(entities))
+            {
+                putc(entities[i].c, stream);
+                p += strlen(entities[i].entity) - 1;
+                continue;
+            }
+        }
+        putc(*p, stream);
+    }
+    putc('\n', stream);
+}
+
+
+
+/* Is this report being made off the front-end thread? */
+static gboolean deferring()
+{
+    return( hooks_thread != NULL && g_thread_self() != hooks_thread );
+}
+
+
+
+static gboolean run_deferred(gpointer data)
+{
+    deferred_t  *call = data;
+
+    if (call->is_msg)
+        hooks.msg(call->type, call->text);
+    else if (call->text_hook)
+        call->text_hook(call->text);
+    else
+        call->flag_hook(call->flag);
+
+    g_free(call->text);
+    g_free(call);
+    return(FALSE);
+}
+
+
+
+static void defer_text(void (*hook)(const gchar *msg), const gchar *text)
+{
+    deferred_t  *call = g_new0(deferred_t, 1);
+
+    call->text_hook = hook;
+    call->text      = g_strdup(text);
+    g_idle_add(run_deferred, call);
+}
+
+
+
+static gboolean run_build_progress(gpointer data)
+{
+    guint   count;
+    guint   max;
+
+    G_LOCK(progress);
+    count = progress_count;
+    max   = progress_max;
+    progress_pending = FALSE;
+    G_UNLOCK(progress);
+
+    hooks.build_progress(count, max);
+    return(FALSE);
+}
+
+
+
+//===============================================================
+//      Public Interface Functions
+//===============================================================
+
+void CORE_set_callbacks(const core_callbacks_t *callbacks)
+{
+    if (callbacks)
+    {
+        hooks = *callbacks;
+        hooks_thread = g_thread_self();
+    }
+    else
+    {
+        memset(&hooks, 0, sizeof(hooks));
+        hooks_thread = NULL;
+    }
+}
+
+
+/* Is a front-end installed?  Only a front-end runs a main loop to deliver background reports. */
+gboolean CORE_front_end(void)
+{
+    return( hooks_thread != NULL );
+}
+
+
+void CORE_status(const gchar *msg)
+{
+    if (hooks.status && deferring())
+        defer_text(hooks.status, msg);
+    else if (hooks.status) hooks.status(msg);
+}
+
+
+void CORE_search_progress(guint count, guint max)
+{
+    if (hooks.search_progress) hooks.search_progress(count, max);
+}
+
+
+void CORE_build_progress(guint count, guint max)
+{
+    if (hooks.build_progress && deferring())
+    {
+        G_LOCK(progress);
+        progress_count = count;
+        progress_max   = max;
+        if ( !progress_pending )
+        {
+            progress_pending = TRUE;
+            g_idle_add(run_build_progress, NULL);
+        }
+        G_UNLOCK(progress);
+    }
+    else if (hooks.build_progress) hooks.build_progress(count, max);
+}
+
+
+void CORE_path_label(const gchar *path)
+{
+    if (hooks.path_label && deferring())
+        defer_text(hooks.path_label, path);
+    else if (hooks.path_label) hooks.path_label(path);
+}
+
+
+void CORE_stats_tooltip(const gchar *msg)
+{
+    if (hooks.stats_tooltip && deferring())
+        defer_text(hooks.stats_tooltip, msg);
+    else if (hooks.stats_tooltip) hooks.stats_tooltip(msg);
+}
+
+
+void CORE_msg(core_msg_e type, const gchar *message)
+{
+    deferred_t  *call;
+
+    if (hooks.msg && deferring())
+    {
+        call = g_new0(deferred_t, 1);
+        call->is_msg = TRUE;
+        call->type   = type;
+        call->text   = g_strdup(message);
+        g_idle_add(run_deferred, call);
+        return;
+    }
+
+    if (hooks.msg)
+    {
+        hooks.msg(type, message);
+        return;
+    }
+
+    switch (type)
+    {
+        case CORE_MSG_ERROR:    fprintf(stderr, "Error: ");     break;
+        case CORE_MSG_WARNING:  fprintf(stderr, "Warning: ");   break;
+        default:                                                break;
+    }
+    print_plain_text(stderr, message);
+}
+
+
+void CORE_cref_current(gboolean up_to_date)
+{
+    deferred_t  *call;
+
+    if (hooks.cref_current && deferring())
+    {
+        call = g_new0(deferred_t, 1);
+        call->flag_hook = hooks.cref_current;
+        call->flag      = up_to_date;
+        g_idle_add(run_deferred, call);
+    }
+    else if (hooks.cref_current) hooks.cref_current(up_to_date);
+}
+
+
+void CORE_yield(void)
+{
+    if (hooks.yield && !deferring()) hooks.yield();     /* A worker thread has no front-end to service */
+}
+
+
+void CORE_cref_changes(const gchar *summary)
+{
+    if (hooks.cref_changes && deferring())
+        defer_text(hooks.cref_changes, summary);
+    else if (hooks.cref_changes) hooks.cref_changes(summary);
+}
+
+
+void CORE_build_phase(const gchar *phase)
+{
+    if (hooks.build_phase && deferring())
+        defer_text(hooks.build_phase, phase);
+    else if (hooks.build_phase) hooks.build_phase(phase);
+}
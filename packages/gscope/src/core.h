@@ -0,0 +1,47 @@
+
+/* Message severity for CORE_msg() */
+typedef enum
+{
+    CORE_MSG_INFO,
+    CORE_MSG_WARNING,
+    CORE_MSG_ERROR,
+} core_msg_e;
+
+
+/* Front-end hooks for the core library [build, search, dir] progress and status reporting.
+ * Any hook may be NULL.  Without a front-end, messages are written to stderr and all other
+ * reports are discarded.  Hooks run on the thread that installed them (reports from other threads
+ * are delivered through the GLib main loop).
+ */
+typedef struct
+{
+    void    (*status)           (const gchar *msg);                     /* Query status line */
+    void    (*search_progress)  (guint count, guint max);               /* Query progress */
+    void    (*build_progress)   (guint count, guint max);               /* Cross-reference build progress */
+    void    (*path_label)       (const gchar *path);                    /* Source directory changed */
+    void    (*stats_tooltip)    (const gchar *msg);                     /* Session statistics */
+    void    (*msg)              (core_msg_e type, const gchar *message);/* User-visible message (Pango markup) */
+    void    (*cref_current)     (gboolean up_to_date);                  /* Cross-reference status changed */
+    void    (*yield)            (void);                                 /* Long operation: service the front-end */
+    void    (*cref_changes)     (const gchar *summary);                 /* Out-of-date cross-reference: changed files */
+    void    (*build_phase)      (const gchar *phase);                   /* Cross-reference build phase started */
+} core_callbacks_t;
+
+
+//===============================================================
+//      Public Interface Functions
+//===============================================================
+
+void    CORE_set_callbacks      (const core_callbacks_t *callbacks);
+gboolean CORE_front_end         (void);
+
+void    CORE_status             (const gchar *msg);
+void    CORE_search_progress    (guint count, guint max);
+void    CORE_build_progress     (guint count, guint max);
+void    CORE_path_label         (const gchar *path);
+void    CORE_stats_tooltip      (const gchar *msg);
+void    CORE_msg                (core_msg_e type, const gchar *message);
+void    CORE_cref_current       (gboolean up_to_date);
+void    CORE_yield              (void);
+void    CORE_cref_changes       (const gchar *summary);
+void    CORE_build_phase        (const gchar *phase);
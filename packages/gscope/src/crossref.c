@@ -7,7 +7,7 @@
 #include "config.h"
 #endif
 
-#include <gtk/gtk.h>
+#include <glib.h>
 #include <stdlib.h>
 #include <sys/stat.h>
 #include <string.h>
@@ -18,10 +18,12 @@
 
 #include "crossref.h"
 #include "scanner.h"
+#include "search.h"
 #include "build.h"
 #include "lookup.h"
 #include "utils.h"
 #include "app_config.h"
+#include "textdict.h"
 
 
 /* convert long to a string */
@@ -45,6 +47,8 @@ uint32_t    lineoffset;     /* source line database offset */
 int         nsrcoffset;     /* number of file name database offsets */
 uint32_t    *srcoffset;     /* source file name database offsets */
 int         symbols;        /* number of symbols */
+stats_struct_t section_stats;   /* symbol counts for the file section being written */
+crossref_cost_t crossref_cost;  /* cost of the last file cross-referenced */
 
 static  char    *filename;  /* file name for warning messages */
 //static  uint32_t    fcnoffset;  /* function name database offset */
@@ -68,15 +72,17 @@ static  void     writestring(char *s);
 static  void     putfilename(char *srcfile);
 static  gboolean file_is_ascii_text(FILE *filename);
 
-gboolean crossref(char *srcfile)
+/* Cross-reference source file 'srcfile' (the name written to the cross-reference), read from 'path' */
+gboolean crossref(char *srcfile, const char *path)
 {
     int i;
     int length;     /* symbol length */
     int entry_no;       /* function level of the symbol */
     int token;          /* current token */
     struct stat st;
+    gint64 start_time = g_get_monotonic_time();
 
-    if (! ((stat(srcfile, &st) == 0)
+    if (! ((stat(path, &st) == 0)
            && S_ISREG(st.st_mode)))
     {
         my_cannotopen(srcfile);
@@ -86,7 +92,7 @@ gboolean crossref(char *srcfile)
 
     entry_no = 0;
     /* open the source file */
-    if ((yyin = fopen(srcfile, "r")) == NULL)
+    if ((yyin = fopen(path, "r")) == NULL)
     {
         my_cannotopen(srcfile);
         errorsfound = TRUE;
@@ -99,6 +105,8 @@ gboolean crossref(char *srcfile)
         putfilename(srcfile);   /* output the file name */
         dbputc('\n');
         dbputc('\n');
+        memset(&section_stats, 0, sizeof(stats_struct_t));
+        crossref_cost.symbols = 0;      /* counted by putcrossref() */
 
         /* read the source file */
         initscanner(srcfile);
@@ -176,6 +184,10 @@ gboolean crossref(char *srcfile)
 
                     /* output the leading tab expected by the next call */
                     dbputc('\t');
+
+                    crossref_cost.bytes   = st.st_size;
+                    crossref_cost.lines   = myylineno - 1;   /* newline-terminated lines, as wc -l */
+                    crossref_cost.usec    = g_get_monotonic_time() - start_time;
                     return(TRUE);
             }
         }
@@ -298,6 +310,9 @@ static void putcrossref(void)
     gboolean    blank;      /* blank indicator */
     int symput = 0; /* symbols output */
     int type;
+    int code;       /* text dictionary code */
+    guint length;   /* text compressed by 'code' */
+    guint limit;
 
     /* output the source line */
     lineoffset = dboffset;
@@ -335,6 +350,7 @@ static void putcrossref(void)
             {
                 dbputc('\t');
                 dbputc(type);
+                SEARCH_count_mark(&section_stats, type);
             }
             else
             {
@@ -373,26 +389,27 @@ static void putcrossref(void)
                 continue;
             }
 
-            /* check for compressed blanks */
+            /* check for compressed blanks (the text compressed with a blank stops at the next symbol) */
             if (blank == TRUE)
             {
-                if (dicode2[c])
+                limit = (symput < symbols ? symbol[symput].first : my_yyleng) - i;
+                if ((code = TEXTDICT_encode_blank(&build_dict, my_yytext + i, limit, &length)) != 0)
                 {
-                    c = DICODE_COMPRESS(' ', c);
+                    c = code;
+                    i += length - 1;
                 }
                 else
                 {
                     dbputc(' ');
                 }
             }
-            /* compress digraphs */
-            else if (IS_A_DICODE(c, my_yytext[i + 1])
-                     && symput < symbols
-                     && i + 1 != symbol[symput].first
+            /* compress digraphs and dictionary substrings (up to the next symbol) */
+            else if (symput < symbols
+                     && (code = TEXTDICT_encode(&build_dict, my_yytext + i, symbol[symput].first - i, &length)) != 0
                     )
             {
-                c = DICODE_COMPRESS(c, my_yytext[i + 1]);
-                ++i;
+                c = code;
+                i += length - 1;
             }
             dbputc((int) c);
             blank = FALSE;
@@ -448,6 +465,7 @@ static void putcrossref(void)
         dbputc('\n');   /* mark beginning of next source line */
         //macrooffset = 0;
     }
+    crossref_cost.symbols += symput;
     symbols = 0;
 }
 
@@ -459,6 +477,8 @@ static void writestring(char *s)
 {
     unsigned char c;
     int i;
+    int code;       /* text dictionary code */
+    guint length;   /* text compressed by 'code' */
 
     if (settings.compressDisable == TRUE)
     {
@@ -466,15 +486,13 @@ static void writestring(char *s)
         dbfputs(s);
         return;
     }
-    /* compress digraphs */
+    /* compress digraphs and dictionary substrings */
     for (i = 0; (c = s[i]) != '\0'; ++i)
     {
-        if (/* dicode1[c] && dicode2[(unsigned char) s[i + 1]] */
-            IS_A_DICODE(c, s[i + 1]))
+        if ((code = TEXTDICT_encode(&build_dict, s + i, G_MAXUINT, &length)) != 0)
         {
-            /* c = (0200 - 2) + dicode1[c] + dicode2[(unsigned char) s[i + 1]]; */
-            c = DICODE_COMPRESS(c, s[i + 1]);
-            ++i;
+            c = code;
+            i += length - 1;
         }
         dbputc(c);  
     }
@@ -6,24 +6,21 @@ extern uint32_t     lineoffset;     /* source line database offset */
 extern int          symbols;        /* number of symbols */
 
 
-//===============================================================
-// Defines
-//===============================================================
-
-/* Check if a given pair of chars is compressable as a dicode: */
-#define IS_A_DICODE(inchar1, inchar2)                      \
-  (dicode1[(unsigned char)(inchar1)] && dicode2[(unsigned char)(inchar2)])
-
-/* Combine the pair into a dicode */
-#define DICODE_COMPRESS(inchar1, inchar2)       \
-  ((0200 - 2) + dicode1[(unsigned char)(inchar1)]   \
-   + dicode2[(unsigned char)(inchar2)])
+/* Cost of the last successful crossref() call (see the --build-report option) */
+typedef struct
+{
+    guint64     bytes;          /* Source file size */
+    guint       lines;          /* Source lines scanned */
+    guint       symbols;        /* Symbols written to the cross-reference */
+    guint64     usec;           /* Wall time */
+} crossref_cost_t;
 
+extern crossref_cost_t crossref_cost;
 
 
 //===============================================================
 // Public Functions
 //===============================================================
 
-gboolean crossref(char *srcfile);
+gboolean crossref(char *srcfile, const char *path);
 void warning(char *text);
@@ -7,7 +7,7 @@
 #include "config.h"
 #endif
 
-#include <gtk/gtk.h>
+#include <glib.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
@@ -26,7 +26,8 @@
 #include "build.h"
 #include "scanner.h"
 #include "search.h"
-#include "display.h"
+#include "core.h"
+#include "trace.h"
 #include "auto_gen.h"
 
 
@@ -35,7 +36,6 @@
 //===============================================================
 
 #define     ANALYZE_HASH    2      /* set to 1 to enable hash analysis */
-#define     OLD_HASH        1
 #define     MAX_SUFFIX      60     /* Support up to a 60 character file suffix */
 #define     SVN_META_DIR    ".svn"
 #define     GIT_META_DIR    ".git"
@@ -44,20 +44,15 @@
 //#define   DIRSEPS " ,:"   /* directory list separators */
 #define DIRINC  40          /* directory list size increment */
 
-/* As of Jan-2016:  Largest known database had 85000 files                             */
-/* For a data set of this size, and composition (med-to-long pathname strings), a hash */
-/* table size of 2^14 is a sweet spot for the Bob Jenkins lookup3 hash functions.      */
+/* File name lookups use open-addressing (linear probe) tables of 32-bit IDs, hashed with the */
+/* Bob Jenkins lookup3 function.  Tables double when 3/4 full, so probe sequences stay short */
+/* from a few files to several hundred thousand.                                             */
 
-#define HASH_SIZE_EXPONENT  14                                      /* Hash table size (power of 2) size = 2^n */
-#if (OLD_HASH == 1)
-#define HASH_SIZE     2003
-#else
-#define HASH_SIZE           ( (uint32_t) 1 << (HASH_SIZE_EXPONENT)) /* New hash function -- best if a power of 2 */
-#endif
-#define HASH_MASK           ( (HASH_SIZE) - 1)
+#define ID_TABLE_MIN_SIZE   4096                                    /* Initial table size (power of 2) */
+#define ARENA_BLOCK_SIZE    (256 * 1024)                            /* File name arena allocation unit */
 #define SRC_GROW_INCREMENT  10000                                   /* source file list size increment */
-
-//#define HASHMOD   2003        /* (old hash function -- mod prime) must be a prime number - original cscope value */
+#define HASH_INIT           0x8421                                  /* Any arbitrary 4-byte value */
+#define SRC_TABLE_BLOCK     16                                      /* Compact source list: entries per front-coded block */
 
 
 /*
@@ -200,6 +195,9 @@ static int      max_include_dirs;           /* maximum number of #include direct
 static char     *master_ignored_list = NULL;
 static char     master_ignored_delim;
 
+static char     src_root[PATHLEN + 1];      /* Absolute source directory (see DIR_src_path) */
+static size_t   walk_root_len;              /* Length of the tree walk's root directory prefix */
+
 static int      fileargc;          /* file argument count */
 static char     **fileargv;        /* file argument values */
 
@@ -210,23 +208,72 @@ FILE    *rlogfile;
 
 
 #if (ANALYZE_HASH == 1)
-static  int hash_collisions;
+static  int hash_probes;
 #endif
 
 
-static  struct  listitem
-{  /* source file names */
-    char    *text;
-    struct  listitem *next;
-} *src_names_hash_tbl[HASH_SIZE];
+/* Source file name strings are interned in an arena: one copy per name, packed into large
+   blocks.  The blocks are kept for the life of the process and re-used (reset) by each new
+   source file list, so freeing a list is O(1). */
+typedef struct arena_block
+{
+    struct arena_block  *next;
+    gsize               used;
+    gsize               size;
+    char                data[];
+} arena_block_t;
+
+static arena_block_t    *arena_head = NULL;         /* First block */
+static arena_block_t    *arena_current = NULL;      /* Block being filled */
 
 
-static  struct  offset_listitem
+/* Open-addressing hash table of 32-bit IDs.  A slot holds ID + 1 (0 is an empty slot). */
+typedef struct
 {
-    char    *text;          /* source file name */
-    char    *offset;        /* Offset into Cross-Reference for "source file's" data */
-    struct  offset_listitem *next;
-} *offset_hash_tbl[HASH_SIZE];
+    guint32     *slots;
+    guint32     size;           /* Power of 2, 0 when empty */
+    guint32     count;
+} id_table_t;
+
+
+/* Source file names: ID = index into src_names (insertion order -- DIR_src_files is re-sorted by the builder) */
+static char         **src_names = NULL;
+static guint32      *src_name_hashes = NULL;
+static guint32      nsrc_names = 0;
+static guint32      msrc_names = 0;
+static id_table_t   src_names_table;
+
+
+/* Old cross-reference file sections (incremental build re-use): ID = index into old_sections */
+typedef struct
+{
+    const char  *name;          /* File name in the old cross-reference buffer ('\n' terminated) */
+    char        *offset;        /* Offset into Cross-Reference for "source file's" data */
+    guint32     length;         /* File name length */
+} old_section_t;
+
+/* Compact source file list, built once the cross-reference is complete.  The paths are
+   front-coded in their list order: each entry is <shared prefix length><suffix length><suffix>
+   (lengths are varints), relative to the previous path.  Every SRC_TABLE_BLOCK'th entry starts
+   a block with no shared prefix, so any entry can be reached by decoding at most one block.
+   Lists are reference counted so that background threads can keep reading a list after a
+   rebuild has published the next one. */
+struct src_table
+{
+    gint        refs;
+    guint8      *data;
+    guint32     *blocks;        /* Offset of each block in data */
+    guint32     count;
+};
+
+static DIR_src_list_t   *src_table = NULL;      /* The published list */
+
+
+static old_section_t    *old_sections = NULL;
+static guint32          *old_section_hashes = NULL;
+static guint32          nold_sections = 0;
+static guint32          mold_sections = 0;
+static id_table_t       old_sections_table;
 
 
 //=====================================================================================
@@ -235,6 +282,7 @@ static  struct  offset_listitem
 
 static void       find_srcfiles_in_tree(gchar *src_dir);
 static gboolean   infilelist(const char *file);
+static char *     lookup_src_name(const char *file);
 static int        list(const char *name, const struct stat *status, int type);
 static gboolean   issrcfile(const char *file);
 static gboolean   path_check_ok(const char *file);
@@ -245,24 +293,25 @@ static void       _alloc_src_file_list(void);
 static gboolean   is_protobuf_file(const char *filename);
 static void       add_src_primitive(char *name);
 static gboolean   is_regular_file(const char *path);
-
-#if ( OLD_HASH == 1 )
-static int  hash(const char *ss);
-#else
+static char *     arena_strdup(const char *string);
+static void       arena_reset(void);
+static void       arena_release(void);
+static void       id_table_insert(id_table_t *table, guint32 id, const guint32 *hashes);
+static void       id_table_free(id_table_t *table);
 static uint32_t   hashlittle( const void *key, size_t length, uint32_t initval);
 static uint32_t   hash(const char *hash_string);
-#endif
 
 
 
 void DIR_init(dir_init_e init_type)
 {
+    /* The key paths and the #include search path are set by DIR_init_paths() */
     if (init_type == NEW_CREF)
     {
-        DIR_get_path(DIR_INITIALIZE);
         _alloc_src_file_list();
+        TRACE_BEGIN("directory walk", DIR_get_path(DIR_SOURCE));
         _make_src_file_list();
-        _init_include_dir_list();
+        TRACE_END("directory walk");
     }
     else
     {
@@ -271,6 +320,31 @@ void DIR_init(dir_init_e init_type)
 }
 
 
+
+/* Derive the key paths (see DIR_get_path) and the #include search path from the settings.
+   Called on the main thread before a build starts: the build thread only reads them, so
+   they stay valid for the main thread while the build runs. */
+void DIR_init_paths()
+{
+    DIR_get_path(DIR_INITIALIZE);
+    _init_include_dir_list();   /* Also needed to resolve #include names (see DIR_resolve_incfile) */
+}
+
+
+
+/* The path to open source file 'file' by: relative names are relative to the source
+   directory.  The build never changes the working directory (other threads open files
+   too), so this is an absolute path.  'path_buf' holds at least PATHLEN + 1 characters. */
+const char *DIR_src_path(const char *file, char *path_buf)
+{
+    if (*file == '/')
+        return(file);
+
+    snprintf(path_buf, PATHLEN + 1, "%s/%s", src_root, file);
+    return(path_buf);
+}
+
+
 void     DIR_init_cli_file_list(int argc, char *argv[])
 {
     /* skip program name */
@@ -315,13 +389,15 @@ char *DIR_get_path(get_method_e method)
 
             /*** Set CWD ***/
             /***************/
-            if (cwd) free(cwd);  /* avoid memory leak if we DIR_INITIALIZE more than once */
-
-            cwd = getcwd(NULL,0);  /* Get a dynamically allocated CWD string */
+            /* gscope never changes its working directory: get it once, and keep it (callers hold the pointer) */
             if (!cwd)
             {
-                fprintf(stderr, "Error: cannot get current working directory name.\n");
-                exit(EXIT_FAILURE);
+                cwd = getcwd(NULL,0);  /* Get a dynamically allocated CWD string */
+                if (!cwd)
+                {
+                    fprintf(stderr, "Error: cannot get current working directory name.\n");
+                    exit(EXIT_FAILURE);
+                }
             }
 
 
@@ -369,6 +445,12 @@ char *DIR_get_path(get_method_e method)
                 src_dir = src_dir_buf;
             }
 
+            /* The absolute source directory, for opening source files (see DIR_src_path) */
+            if (*src_dir == '/')
+                g_strlcpy(src_root, src_dir, sizeof(src_root));
+            else
+                snprintf(src_root, sizeof(src_root), "%s/%s", cwd, src_dir);
+
 
             /*** Set the autogen_cache Directory ***/
             /***************************************/
@@ -376,7 +458,7 @@ char *DIR_get_path(get_method_e method)
 
 
             if ( !settings.refOnly )    // Only update when in GUI mode.
-                DISPLAY_update_path_label(src_dir);     /* Update the "path label" on the main window */
+                CORE_path_label(src_dir);     /* Update the "path label" on the main window */
         break;
 
 
@@ -482,10 +564,8 @@ static void _init_include_dir_list()
    for the named file's data section.  This is used by the incremental cref builder for data re-use. */
 void DIR_create_offset_hash(char *buf_ptr)
 {
-    struct      offset_listitem *list_ptr;
-    uint32_t    i;
+    old_section_t   *section;
     uint32_t    name_len;  
-    char        *file_name;
     char        *offset_ptr;
 
     DIR_free_offset_hash(); /* (re)initialize the offset hash table */
@@ -507,90 +587,228 @@ void DIR_create_offset_hash(char *buf_ptr)
 
         offset_ptr = buf_ptr - 2;   /* Get the offset for this cref section */
 
-        name_len = 0;
-        while ( *buf_ptr++ != '\n')
+        name_len = strchr(buf_ptr, '\n') - buf_ptr;
+
+        if (nold_sections == mold_sections)
         {
-            name_len++;
+            mold_sections = (mold_sections == 0) ? SRC_GROW_INCREMENT : mold_sections * 2;
+            old_sections = g_realloc(old_sections, mold_sections * sizeof(old_section_t));
+            old_section_hashes = g_realloc(old_section_hashes, mold_sections * sizeof(guint32));
         }
 
-        buf_ptr -= (name_len + 1);  /* reset the pointer to the beginning of the file name string */
+        /* The name is referenced in place: the old cross-reference buffer outlives the table */
+        section = &old_sections[nold_sections];
+        section->name   = buf_ptr;
+        section->length = name_len;
+        section->offset = offset_ptr;
+        old_section_hashes[nold_sections] = hashlittle(buf_ptr, name_len, HASH_INIT);
+
+        id_table_insert(&old_sections_table, nold_sections++, old_section_hashes);
+
+        buf_ptr += name_len + 1;
+    }
+}
+
+
+
+void DIR_free_offset_hash()
+{
+    id_table_free(&old_sections_table);
+
+    g_free(old_sections);
+    g_free(old_section_hashes);
+    old_sections = NULL;
+    old_section_hashes = NULL;
+    nold_sections = mold_sections = 0;
+}
+
 
-        /* Malloc a string buffer */
-        file_name = g_malloc(name_len + 1);
 
-        /* Malloc a list item */
-        list_ptr = (struct offset_listitem *) g_malloc(sizeof(struct offset_listitem));
+void DIR_free_src_names_hash()
+{
+    /* Do not free the file-name strings, they are part of the master source file
+       list which is utilized by search functions (they live in the arena). */
+    id_table_free(&src_names_table);
+
+    g_free(src_names);
+    g_free(src_name_hashes);
+    src_names = NULL;
+    src_name_hashes = NULL;
+    nsrc_names = msrc_names = 0;
+}
+
 
-        list_ptr->text = file_name;
+/* Make a compact copy of DIR_src_files (the build thread makes the next list while lookups
+   use the published one).  The build-time list and its arena are released. */
+DIR_src_list_t *DIR_compact_src_files()
+{
+    DIR_src_list_t  *list;
+    GByteArray  *data;
+    const char  *previous = "";
+    const char  *path;
+    guint32     shared;
+    guint32     length;
+    guint32     i;
+
+    data = g_byte_array_new();
+
+    list = g_malloc(sizeof(DIR_src_list_t));
+    list->refs   = 1;
+    list->count  = nsrcfiles;
+    list->blocks = g_malloc( ((nsrcfiles + SRC_TABLE_BLOCK - 1) / SRC_TABLE_BLOCK + 1) * sizeof(guint32) );
+
+    for (i = 0; i < nsrcfiles; i++)
+    {
+        path   = DIR_src_files[i];
+        shared = 0;
 
-        /* Copy the filename string into the list item->text field */
-        while ( *buf_ptr != '\n')
+        if (i % SRC_TABLE_BLOCK == 0)
+            list->blocks[i / SRC_TABLE_BLOCK] = data->len;
+        else
         {
-            *file_name++ = *buf_ptr++;
+            while (path[shared] && path[shared] == previous[shared])
+                shared++;
         }
-        *file_name = '\0';  /* Null terminate the string */
-
 
-        /* Set the offset value */
-        list_ptr->offset = offset_ptr;
+        length = strlen(path + shared);     /* shared + length <= DIR_SRC_PATH_MAX (see add_src_primitive) */
 
-        /* Insert the newly created listitem into the hash table. */
-        i = hash(list_ptr->text);
+        my_put_varint(data, shared);
+        my_put_varint(data, length);
+        g_byte_array_append(data, (const guint8 *) path + shared, length);
 
-        list_ptr->next = offset_hash_tbl[i];
-        offset_hash_tbl[i] = list_ptr;
+        previous = path;
     }
+
+    list->data = g_byte_array_free(data, FALSE);
+
+    /* The full-length strings are no longer needed */
+    g_free(DIR_src_files);
+    DIR_src_files = NULL;
+    arena_release();
+
+    return(list);
 }
 
 
 
-void DIR_free_offset_hash()
+/* Replace the published (searchable) source file list (main thread, between lookups) */
+void DIR_publish_src_list(DIR_src_list_t *list)
 {
-    struct offset_listitem *p, *nextp;
-    int i;
+    if (src_table)
+        DIR_src_list_unref(src_table);
+    src_table = list;
+}
+
+
+
+guint32 DIR_src_count()
+{
+    return( src_table ? src_table->count : 0 );
+}
+
+
 
-    for (i = 0; i < HASH_SIZE; ++i)
+/* Take a reference to the published list (for use outside the main thread) */
+DIR_src_list_t *DIR_src_list_ref()
+{
+    if (src_table)
+        g_atomic_int_inc(&src_table->refs);
+    return(src_table);
+}
+
+
+
+void DIR_src_list_unref(DIR_src_list_t *list)
+{
+    if ( list && g_atomic_int_dec_and_test(&list->refs) )
     {
-        for (p = offset_hash_tbl[i]; p != NULL; p = nextp)
-        {
-            nextp = p->next;
-            g_free(p->text);
-            g_free(p);
-        }
-        offset_hash_tbl[i] = NULL;
+        g_free(list->data);
+        g_free(list->blocks);
+        g_free(list);
     }
 }
 
 
 
-void DIR_free_src_names_hash()
+/* Position an iterator at file 'index' of the published source file list */
+void DIR_src_iter_init(DIR_src_iter_t *iter, guint32 index)
+{
+    DIR_src_list_iter_init(iter, src_table, index);
+}
+
+
+
+/* Position an iterator at file 'index' of a (referenced) source file list */
+void DIR_src_list_iter_init(DIR_src_iter_t *iter, const DIR_src_list_t *list, guint32 index)
 {
-    struct listitem *p, *nextp;
-    int    i;
+    guint32 block_start;
+
+    iter->count   = list ? list->count : 0;
+    iter->path[0] = '\0';
 
-    for (i = 0; i < HASH_SIZE; ++i)
+    if (index >= iter->count)
     {
-        for (p = src_names_hash_tbl[i]; p != NULL; p = nextp)
-        {
-            nextp = p->next;
-            /* free(p->text);       Do not free() the file-name strings, they are part of the
-                                    master source file list which is utilized by search functions. */
-            g_free((char *) p);
-        }
-        src_names_hash_tbl[i] = NULL;
+        iter->index    = iter->count;
+        iter->read_ptr = NULL;
+        return;
     }
+
+    block_start    = index - (index % SRC_TABLE_BLOCK);
+    iter->index    = block_start;
+    iter->read_ptr = list->data + list->blocks[block_start / SRC_TABLE_BLOCK];
+
+    while (iter->index < index)
+        DIR_src_iter_next(iter);
+}
+
+
+
+/* Return the next path, or NULL at the end of the list */
+const char *DIR_src_iter_next(DIR_src_iter_t *iter)
+{
+    guint32 shared;
+    guint32 length;
+
+    if (iter->index >= iter->count)
+        return(NULL);
+
+    shared = my_get_varint(&iter->read_ptr);
+    length = my_get_varint(&iter->read_ptr);
+
+    memcpy(iter->path + shared, iter->read_ptr, length);
+    iter->path[shared + length] = '\0';
+
+    iter->read_ptr += length;
+    iter->index++;
+
+    return(iter->path);
 }
 
 
+
 char *DIR_get_old_offset(char *filename)
 {
-    struct      offset_listitem *item_ptr;
+    old_section_t   *section;
+    guint32     length;
+    guint32     hash_val;
+    guint32     mask;
+    guint32     i;
+    guint32     id;
+
+    if (old_sections_table.size == 0)
+        return(NULL);
 
-    for (item_ptr = offset_hash_tbl[hash(filename)]; item_ptr != NULL; item_ptr = item_ptr->next)
+    length   = strlen(filename);
+    hash_val = hashlittle(filename, length, HASH_INIT);
+    mask     = old_sections_table.size - 1;
+
+    for (i = hash_val & mask; (id = old_sections_table.slots[i]) != 0; i = (i + 1) & mask)
     {
-        if ( STREQUAL(filename, item_ptr->text) )
+        section = &old_sections[--id];
+        if ( old_section_hashes[id] == hash_val && section->length == length &&
+             memcmp(filename, section->name, length) == 0 )
         {
-            return(item_ptr->offset);
+            return(section->offset);
         }
     }
     return(NULL);
@@ -689,11 +907,8 @@ static void _alloc_src_file_list()
 {
     if (DIR_src_files != NULL)      /* If the source file list is NOT empty*/
     {
-        /* Free the existing source file list */
-        while (nsrcfiles > 0)
-        {
-            g_free(DIR_src_files[--nsrcfiles]);
-        }
+        /* Free the existing source file names (all of them at once) */
+        arena_reset();
 
         /* Re-initialize the source file list */
         memset(DIR_src_files, 0, sizeof(*DIR_src_files) * DIR_max_src_files);
@@ -743,10 +958,7 @@ static void _make_src_file_list()
     char    *src_dir;
 
     #if (ANALYZE_HASH == 1)
-    struct listitem *item_ptr;
-    int depth;
-
-    hash_collisions = 0;
+    hash_probes = 0;
     #endif
 
 
@@ -861,31 +1073,46 @@ static void _make_src_file_list()
 
 
     #if (ANALYZE_HASH == 1)
-    printf("\n");
-    for ( i = 0; i < HASH_SIZE; i++ )
-    {
-        depth = 0;
+    printf("File Count: %d  Table Size: %u  Insert Probes: %d\n", nsrcfiles, src_names_table.size, hash_probes);
+    #endif
+}
 
-        if (src_names_hash_tbl[i])
-        {
-            depth++;
 
-            item_ptr = src_names_hash_tbl[i];
-            while (item_ptr)
-            {
-                item_ptr = item_ptr->next;
-                depth++;
-            }
-        }
-        printf("%d,", depth);
-    }
 
-    printf("File Count: %d  Hash Collisions: %d\n", nsrcfiles, hash_collisions);
-    #endif
+
+
+/* Does the file name match the source suffix (or typeless file) list? */
+gboolean DIR_is_src_file(const char *file)
+{
+    return( issrcfile(file) );
 }
 
 
 
+/* Which directories the source file list was found by searching (new source files appear there):
+   Returns FALSE if the list came from the command line or a name file.  Otherwise *flat_prefix
+   is NULL for a recursive search (every directory below the source directory -- every relative
+   path -- was searched), or the one directory prefix ("dir/") of a flat search (g_free it). */
+gboolean DIR_src_search_scope(gchar **flat_prefix)
+{
+    gchar   *path;
+
+    *flat_prefix = NULL;
+
+    if ( fileargc > 0 || ((settings.nameFile[0] != 0) && (!settings.recurseDir)) )
+        return(FALSE);
+
+    if ( !settings.recurseDir )
+    {
+        /* Same construction as the flat search in _make_src_file_list() */
+        my_asprintf(&path, "%s/x", DIR_get_path(DIR_SOURCE));
+        compress_path(path);
+        path[strlen(path) - 1] = '\0';
+        *flat_prefix = path;
+    }
+    return(TRUE);
+}
+
 
 
 /* see if this is a source file */
@@ -960,38 +1187,39 @@ static gboolean issrcfile(const char *file)
 
 static void find_srcfiles_in_tree(gchar *src_dir)
 {
-    /* Temporarily set the CWD for this process to match the user-specified source "root" directory */
-    /* It seems a little silly to do this, but things stay much simpler if we only use the "." form */
-    /* of the ftw() function call */
-    if (chdir(src_dir) == -1)
-    fprintf(stderr,"Unexpected chdir() error in dir.c:  Dir = %s\n", src_dir); /* Should never happen */
+    gchar   *root;
+
+    /* Walk the source "root" directory itself (the build runs on a thread: never chdir()).  list()
+       strips the root prefix, so the names are the "./dir/file" form of a walk of "." */
+    root = g_strdup(src_dir);
+    walk_root_len = strlen(root);
+    while (walk_root_len > 0 && root[walk_root_len - 1] == '/')
+        root[--walk_root_len] = '\0';
 
     /* walk the tree & build source file list */
-    if ( ftw(".", list, 1) < 0 )
+    if ( ftw(walk_root_len > 0 ? root : "/", list, 1) < 0 )
     {
         char *message;
 
         my_asprintf(&message,"\nG-Scope Error: Recursive File Tree Walk Error: %s", strerror(errno));
 
         if ( !settings.refOnly )  // If we are in GUI mode
-            DISPLAY_msg(GTK_MESSAGE_ERROR, message);
+            CORE_msg(CORE_MSG_ERROR, message);
         else
             fprintf(stderr, "%s\n", message);
 
         g_free(message);
     }
 
-    /* Pop back to the original CWD */
-    if (chdir(DIR_get_path(DIR_CURRENT_WORKING)) == -1)
-    fprintf(stderr,"Unexpected chdir() error in dir.c:  Dir = %s\n", DIR_get_path(DIR_CURRENT_WORKING)); /* Should never happen */
-
+    g_free(root);
     return;
 }
 
 
-static int list(const char *name, const struct stat *status, int type) 
+static int list(const char *walk_name, const struct stat *status, int type) 
 {
     char *base_name;
+    char name[PATHLEN + 1];
 
     if(type == FTW_NS)     /* non stat-able file */
     {
@@ -1002,6 +1230,9 @@ static int list(const char *name, const struct stat *status, int type)
 
     if(type == FTW_F || type == FTW_SL)  /* if we have a file, or symlink */
     {
+        /* <root>/dir/file -> ./dir/file */
+        snprintf(name, sizeof(name), ".%s", walk_name + walk_root_len);
+
         if  ( path_check_ok( name ) )   /* if path is not on the exclusion list */
         {
             base_name = my_basename( (char *) name );
@@ -1144,20 +1375,88 @@ void DIR_incfile(char *file)
     free(clean_name);
 }
 
+/* Resolve an #include name to the source file list entry that DIR_incfile() would have
+   selected for it.  "Quoted" #include names are first resolved relative to the directory
+   of the #including file (C preprocessor semantics).  No file system access is performed,
+   only names already in the source file list can be resolved.
+
+   Returns a pointer to the source file list name string, or NULL if not resolved. */
+
+char *DIR_resolve_incfile(const char *includer, const char *file, gboolean local)
+{
+    char    path[PATHLEN + 1];
+    char    dir[PATHLEN + 1];
+    char    *name;
+    int     i;
+
+    if ( local && *file != '/' )
+    {
+        strncpy(dir, includer, PATHLEN);
+        dir[PATHLEN] = '\0';
+        my_dirname(dir);
+
+        if (*dir != '\0')
+        {
+            snprintf(path, sizeof(path), "%s/%s", dir, file);
+            if ( (name = lookup_src_name(compress_path(path))) != NULL )
+                return(name);
+        }
+    }
+
+    /* An absolute path, or a path relative to src_dir */
+    strncpy(path, file, PATHLEN);
+    path[PATHLEN] = '\0';
+    if ( (name = lookup_src_name(compress_path(path))) != NULL )
+        return(name);
+
+    if ( *file != '/' )
+    {
+        /* Check the "include" search path */
+        for (i = 0; i < num_include_dirs; ++i)
+        {
+            snprintf(path, sizeof(path), "%s/%s", include_dirs[i], file);
+            if ( (name = lookup_src_name(compress_path(path))) != NULL )
+                return(name);
+        }
+    }
+
+    return(NULL);
+}
+
+
+
 /* see if the file is already in the list */
 
 static gboolean infilelist(const char *file)
 {
-    struct  listitem *p;
+    return( lookup_src_name(file) != NULL );
+}
+
+
+
+/* find the source file list name string for 'file' */
+
+static char *lookup_src_name(const char *file)
+{
+    guint32     hash_val;
+    guint32     mask;
+    guint32     i;
+    guint32     id;
+
+    if (src_names_table.size == 0)
+        return(NULL);
 
-    for (p = src_names_hash_tbl[hash(file)]; p != NULL; p = p->next)
+    hash_val = hash(file);
+    mask     = src_names_table.size - 1;
+
+    for (i = hash_val & mask; (id = src_names_table.slots[i]) != 0; i = (i + 1) & mask)
     {
-        if ( STREQUAL(file, p->text) )
+        if ( src_name_hashes[--id] == hash_val && STREQUAL(file, src_names[id]) )
         {
-            return(TRUE);
+            return(src_names[id]);
         }
     }
-    return(FALSE);
+    return(NULL);
 }
 
 
@@ -1233,14 +1532,14 @@ void DIR_addsrcfile(char *name)
         if (stat(full_path, &statstruct) != 0)
         {
             // add .c file
-            add_src_primitive( strdup(synthetic_name) );
+            add_src_primitive(synthetic_name);
 
             // add .h file
             work_ptr = strrchr(synthetic_name,'.');
             if (work_ptr)
             {
                 *(++work_ptr) = 'h'; 
-                add_src_primitive( strdup(synthetic_name) );
+                add_src_primitive(synthetic_name);
             }
         }
 
@@ -1248,6 +1547,8 @@ void DIR_addsrcfile(char *name)
         g_free(full_path);
         g_free(tmp_name);
     }
+
+    free(clean_name);
 }
 
 
@@ -1262,8 +1563,15 @@ void DIR_addsrcfile(char *name)
 //********************************************************************
 static void add_src_primitive(char *name)
 {
-    struct  listitem *p;
-    int i;
+    char    *interned;
+
+    /* The compact list (and its iterators) hold paths of up to DIR_SRC_PATH_MAX characters */
+    if (strlen(name) > DIR_SRC_PATH_MAX)
+    {
+        (void) fprintf(stderr, "Warning:  Source file path is longer than %d characters, skipping file: %.64s...\n",
+                       DIR_SRC_PATH_MAX, name);
+        return;
+    }
 
     /* make sure there is room for the file */
     if (nsrcfiles == DIR_max_src_files)
@@ -1272,24 +1580,143 @@ static void add_src_primitive(char *name)
         DIR_src_files = (char **) g_realloc((char *) DIR_src_files, DIR_max_src_files * sizeof(char *));
     }
 
-    p = (struct listitem *) g_malloc(sizeof(struct listitem));
+    if (nsrc_names == msrc_names)
+    {
+        msrc_names += SRC_GROW_INCREMENT;
+        src_names = g_realloc(src_names, msrc_names * sizeof(char *));
+        src_name_hashes = g_realloc(src_name_hashes, msrc_names * sizeof(guint32));
+    }
 
+    interned = arena_strdup(name);
 
-    DIR_src_files[nsrcfiles++] = name;
+    DIR_src_files[nsrcfiles++] = interned;
 
+    /* insert the name into the hash table. */
+    src_names[nsrc_names] = interned;
+    src_name_hashes[nsrc_names] = hash(interned);
+    id_table_insert(&src_names_table, nsrc_names++, src_name_hashes);
+}
 
-    p->text = name;
 
-    i = hash(p->text);
 
-    #if (HASH_ANALASYS == 1)
-    if (src_names_hash_tbl[i] != NULL) 
-        hash_collisions++;
-    #endif
+/* Copy a string into the file name arena */
+static char *arena_strdup(const char *string)
+{
+    arena_block_t   *block;
+    gsize           length = strlen(string) + 1;
+    char            *copy;
+
+    if (arena_current == NULL || arena_current->used + length > arena_current->size)
+    {
+        if (arena_current && arena_current->next && length <= arena_current->next->size)
+        {
+            /* Re-use the next block kept from a previous source file list */
+            arena_current = arena_current->next;
+            arena_current->used = 0;
+        }
+        else
+        {
+            block = g_malloc(sizeof(arena_block_t) + MAX(length, ARENA_BLOCK_SIZE));
+            block->size = MAX(length, ARENA_BLOCK_SIZE);
+            block->used = 0;
 
-    /* insert the newly created listitem into the hash table. */
-    p->next = src_names_hash_tbl[i];
-    src_names_hash_tbl[i] = p;
+            if (arena_current)
+            {
+                block->next = arena_current->next;
+                arena_current->next = block;
+            }
+            else
+            {
+                block->next = arena_head;
+                arena_head = block;
+            }
+            arena_current = block;
+        }
+    }
+
+    copy = arena_current->data + arena_current->used;
+    memcpy(copy, string, length);
+    arena_current->used += length;
+
+    return(copy);
+}
+
+
+
+/* Release every string in the arena (the blocks are kept for re-use) */
+static void arena_reset(void)
+{
+    arena_current = arena_head;
+    if (arena_current)
+        arena_current->used = 0;
+}
+
+
+
+/* Free the arena blocks (the source file list has been compacted) */
+static void arena_release(void)
+{
+    arena_block_t   *block;
+
+    while ( (block = arena_head) != NULL )
+    {
+        arena_head = block->next;
+        g_free(block);
+    }
+    arena_current = NULL;
+}
+
+
+
+/* Insert 'id' (hash value hashes[id]) into an ID table, doubling the table when it is 3/4 full */
+static void id_table_insert(id_table_t *table, guint32 id, const guint32 *hashes)
+{
+    guint32     *old_slots;
+    guint32     old_size;
+    guint32     mask;
+    guint32     i;
+    guint32     j;
+
+    if ( (table->count + 1) * 4 > table->size * 3 )
+    {
+        old_slots = table->slots;
+        old_size  = table->size;
+
+        table->size  = (old_size == 0) ? ID_TABLE_MIN_SIZE : old_size * 2;
+        table->slots = g_malloc0(table->size * sizeof(guint32));
+        mask = table->size - 1;
+
+        for (j = 0; j < old_size; j++)
+        {
+            if (old_slots[j])
+            {
+                for (i = hashes[old_slots[j] - 1] & mask; table->slots[i]; i = (i + 1) & mask)
+                    ;
+                table->slots[i] = old_slots[j];
+            }
+        }
+        g_free(old_slots);
+    }
+
+    mask = table->size - 1;
+    for (i = hashes[id] & mask; table->slots[i]; i = (i + 1) & mask)
+    {
+        #if (ANALYZE_HASH == 1)
+        hash_probes++;
+        #endif
+    }
+    table->slots[i] = id + 1;
+    table->count++;
+}
+
+
+
+static void id_table_free(id_table_t *table)
+{
+    g_free(table->slots);
+    table->slots = NULL;
+    table->size  = 0;
+    table->count = 0;
 }
 
 
@@ -1489,31 +1916,11 @@ static char * compress_path(char *pathname)
 
 
 
-#if (OLD_HASH == 1)
-static int  hash(const char *ss)
-{
-    int i;
-    unsigned char   *s = (unsigned char *)ss;
-    
-    for (i = 0; *s != '\0'; )
-        i += *s++;  /* += is faster than <<= for cscope */
-    return(i % HASH_SIZE);
-}
-
-#else
-
-#define HASH_INIT   0x8421      /* Any arbitrary 4-byte value */
 static uint32_t hash(const char *key)
 {
-    uint32_t hash_val;
-
-    hash_val = hashlittle( (const void *) key, strlen(key), HASH_INIT);
-
-    return(hash_val & HASH_MASK);
+    return( hashlittle( (const void *) key, strlen(key), HASH_INIT) );
 }
 
-#endif
-
 
 
 /*
@@ -1579,8 +1986,6 @@ acceptable.  Do NOT use for cryptographic purposes.
 -------------------------------------------------------------------------------
 */
 
-#if ( OLD_HASH != 1 )
-
 static uint32_t hashlittle( const void *key, size_t length, uint32_t initval)
 {
   uint32_t a,b,c;                                          /* internal state */
@@ -1749,6 +2154,3 @@ static uint32_t hashlittle( const void *key, size_t length, uint32_t initval)
   final(a,b,c);
   return c;
 }
-
-#endif
-
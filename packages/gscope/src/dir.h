@@ -23,21 +23,60 @@ typedef enum
 } dir_list_e;
 
 
-extern char     **DIR_src_files;    /* source file list*/
+extern char     **DIR_src_files;    /* source file list (valid only while the cross-reference is being built) */
 extern int      DIR_max_src_files;  /* maximum number of source files */
 extern uint32_t nsrcfiles;          /* number of source files */
 
 
+/* Once the cross-reference is built, the source file list is kept in a compact (front-coded)
+   table and read with an iterator:
+
+        DIR_src_iter_t  iter;
+
+        DIR_src_iter_init(&iter, 0);
+        while ( (file = DIR_src_iter_next(&iter)) != NULL )
+            ...
+
+   The returned path is valid until the next DIR_src_iter_next() call on the same iterator.
+   The published list is replaced by each build; other threads iterate over a list they
+   have referenced with DIR_src_list_ref() (DIR_src_list_iter_init). */
+
+#define DIR_SRC_PATH_MAX    4096
+
+typedef struct src_table DIR_src_list_t;    /* A (reference counted) compact source file list */
+
+typedef struct
+{
+    const guint8    *read_ptr;
+    guint32         index;      /* Index of the next file */
+    guint32         count;
+    char            path[DIR_SRC_PATH_MAX + 1];
+} DIR_src_iter_t;
+
+
 void     DIR_addincdir(char *path);
 void     DIR_init(dir_init_e init_type);
+void     DIR_init_paths(void);
+const char *DIR_src_path(const char *file, char *path_buf);
 void     DIR_incfile(char *file);
+char *   DIR_resolve_incfile(const char *includer, const char *file, gboolean local);
 gboolean DIR_file_on_include_search_path(gchar *srcfile);
 char *   DIR_get_path(get_method_e method);
 void     DIR_addsrcfile(char *name);
+gboolean DIR_is_src_file(const char *file);
+gboolean DIR_src_search_scope(gchar **flat_prefix);
 void     DIR_create_offset_hash(char *buf_ptr);
 void     DIR_free_offset_hash(void);
 void     DIR_free_src_names_hash(void);
 char     *DIR_get_old_offset(char *filename);
+DIR_src_list_t *DIR_compact_src_files(void);
+void     DIR_publish_src_list(DIR_src_list_t *list);
+guint32  DIR_src_count(void);
+void     DIR_src_iter_init(DIR_src_iter_t *iter, guint32 index);
+DIR_src_list_t *DIR_src_list_ref(void);
+void     DIR_src_list_unref(DIR_src_list_t *list);
+void     DIR_src_list_iter_init(DIR_src_iter_t *iter, const DIR_src_list_t *list, guint32 index);
+const char *DIR_src_iter_next(DIR_src_iter_t *iter);
 void     DIR_list_join(char *usr_list, dir_list_e dir_list);
 void     DIR_init_cli_file_list(int argc, char *argv[]);
 
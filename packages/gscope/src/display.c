@@ -20,28 +20,21 @@
 #include "support.h"
 
 #include "search.h"
+#include "results.h"
 #include "display.h"
 #include "dir.h"
 #include "utils.h"
+#include "blocks.h"
+#include "symdict.h"
 #include "app_config.h"
+#include "core.h"
 
 // ==== defines ====
-#define MAX_FUNCTION_SIZE       100     /* Max size of function name */
-#define MAX_DISPLAY_SOURCE      511     /* Max number of character to display for source text */
-#define MAX_CRAZY_BIG_SIZE      15000   /* Max nubmer of source text chars before warnings are generated */
-#define MAX_EXCERPT_SIZE        100
+#define MAX_COMPLETIONS         100     /* Max number of symbol completions offered by the query entry */
+#define MIN_COMPLETION_PREFIX   2       /* Min number of query entry chars before completions are offered */
 
 // ==== typedefs ====
 
-enum
-{
-    FILENAME = 0,
-    FUNCTION,
-    LINE,
-    TEXT,
-    COLUMNS
-};
-
 enum
 {
     HISTORY = 0,
@@ -56,7 +49,7 @@ typedef struct
 // ==== globals ====
 
 GtkWidget *treeview;
-GtkListStore *store;
+ResultsModel *store;
 GtkTreeIter iter;
 
 GtkWidget *h_treeview;
@@ -76,6 +69,7 @@ gboolean line_number_info_avail = FALSE;   // Indicates if the most recent query
 //  ==== Private Global Variables ====
 static GtkWidget   *gscope_main = NULL;
 static GtkWidget   *active_progress_bar = NULL;
+static GtkListStore *completion_store = NULL;
 
 /*** Local Function Prototypes ***/
 
@@ -84,8 +78,28 @@ static void on_function_col_clicked(GtkTreeViewColumn *column, gpointer user_dat
 static void on_line_col_clicked(GtkTreeViewColumn *column, gpointer user_data);
 static void on_text_col_clicked(GtkTreeViewColumn *column, gpointer user_data);
 static void configure_columns(gchar new_mask);
-static void update_list_store(search_results_t *results);
 static gboolean search_equal_func(GtkTreeModel *model, gint column, const gchar *key, GtkTreeIter *iter, gpointer search_data);
+static void on_query_entry_changed(GtkEditable *editable, gpointer user_data);
+static void add_completion(const gchar *symbol, gpointer user_data);
+static gboolean completion_match_func(GtkEntryCompletion *completion, const gchar *key, GtkTreeIter *iter, gpointer user_data);
+static void core_msg(core_msg_e type, const gchar *message);
+static void core_yield(void);
+
+
+/* Route the core library progress and status reports to the main window */
+static const core_callbacks_t core_callbacks =
+{
+    DISPLAY_status,
+    DISPLAY_update_progress_bar,
+    DISPLAY_update_build_progress,
+    DISPLAY_update_path_label,
+    DISPLAY_update_stats_tooltip,
+    core_msg,
+    DISPLAY_set_cref_current,
+    core_yield,
+    DISPLAY_set_cref_changes,
+    DISPLAY_update_build_phase,
+};
 
 
 void DISPLAY_init(GtkWidget *main)
@@ -94,6 +108,8 @@ void DISPLAY_init(GtkWidget *main)
     GtkCellRenderer *renderer;
     GtkWidget *image1;
     GtkWidget *sms_button;
+    GtkWidget *query_entry;
+    GtkEntryCompletion *completion;
 
     gscope_main = main;     // Save a convenience pointer to the main window
 
@@ -111,6 +127,7 @@ void DISPLAY_init(GtkWidget *main)
     gtk_tree_view_column_set_sizing   (display_col[FILENAME], GTK_TREE_VIEW_COLUMN_AUTOSIZE);
     gtk_tree_view_append_column(GTK_TREE_VIEW(treeview), display_col[FILENAME]);
     gtk_tree_view_column_set_clickable(display_col[FILENAME], TRUE);
+    gtk_tree_view_column_set_sort_column_id(display_col[FILENAME], FILENAME);
     g_signal_connect((GtkTreeViewColumn *)display_col[FILENAME], "clicked", G_CALLBACK (on_filename_col_clicked), NULL);
 
     renderer = gtk_cell_renderer_text_new();
@@ -118,6 +135,7 @@ void DISPLAY_init(GtkWidget *main)
     gtk_tree_view_column_set_sizing   (display_col[FUNCTION], GTK_TREE_VIEW_COLUMN_AUTOSIZE);
     gtk_tree_view_append_column(GTK_TREE_VIEW(treeview), display_col[FUNCTION]);
     gtk_tree_view_column_set_clickable(display_col[FUNCTION], TRUE);
+    gtk_tree_view_column_set_sort_column_id(display_col[FUNCTION], FUNCTION);
     g_signal_connect((GtkTreeViewColumn *)display_col[FUNCTION], "clicked", G_CALLBACK (on_function_col_clicked), NULL);
 
     renderer = gtk_cell_renderer_text_new();
@@ -125,6 +143,7 @@ void DISPLAY_init(GtkWidget *main)
     gtk_tree_view_column_set_sizing   (display_col[LINE],     GTK_TREE_VIEW_COLUMN_AUTOSIZE);
     gtk_tree_view_append_column(GTK_TREE_VIEW(treeview), display_col[LINE]);
     gtk_tree_view_column_set_clickable(display_col[LINE], TRUE);
+    gtk_tree_view_column_set_sort_column_id(display_col[LINE], LINE);
     g_signal_connect((GtkTreeViewColumn *)display_col[LINE], "clicked", G_CALLBACK (on_line_col_clicked), NULL);
 
     renderer = gtk_cell_renderer_text_new();
@@ -132,15 +151,13 @@ void DISPLAY_init(GtkWidget *main)
     gtk_tree_view_column_set_sizing   (display_col[TEXT],     GTK_TREE_VIEW_COLUMN_AUTOSIZE);
     gtk_tree_view_append_column(GTK_TREE_VIEW(treeview), display_col[TEXT]);
     gtk_tree_view_column_set_clickable(display_col[TEXT], TRUE);
+    gtk_tree_view_column_set_sort_column_id(display_col[TEXT], TEXT);
     g_signal_connect((GtkTreeViewColumn *)display_col[TEXT], "clicked", G_CALLBACK (on_text_col_clicked), NULL);
 
-    /* Create a new tree model with 4 columns [string, string, string, string] */
-    store = gtk_list_store_new(COLUMNS, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING);
-
-    /* Add the tree model to the tree view and unreference it so that the model will be
-     * destroyed along with the tree view. */
+    /* Create the results tree model [string, string, uint, string], indexed directly over the search results.
+     * The display module keeps its reference: the model is detached from the view while new results are loaded. */
+    store = RESULTS_model_new();
     gtk_tree_view_set_model(GTK_TREE_VIEW(treeview), GTK_TREE_MODEL(store));
-    g_object_unref(store);
 
     /* Configure a custom function for interactive searches */
     gtk_tree_view_set_search_equal_func (GTK_TREE_VIEW(treeview), search_equal_func, NULL, NULL);
@@ -163,6 +180,24 @@ void DISPLAY_init(GtkWidget *main)
     gtk_tree_view_set_model(GTK_TREE_VIEW(h_treeview), GTK_TREE_MODEL(h_store));
     g_object_unref(h_store);
 
+    // ======== Set up the query entry symbol completion ========
+    // Completions come from the symbol dictionary (already prefix-filtered), so the
+    // completion model is refilled on every entry change and the match function accepts all rows.
+    query_entry = lookup_widget(GTK_WIDGET (gscope_main), "query_entry");
+
+    completion_store = gtk_list_store_new(1, G_TYPE_STRING);
+    completion = gtk_entry_completion_new();
+    gtk_entry_completion_set_model(completion, GTK_TREE_MODEL(completion_store));
+    g_object_unref(completion_store);
+    gtk_entry_completion_set_text_column(completion, 0);
+    gtk_entry_completion_set_minimum_key_length(completion, MIN_COMPLETION_PREFIX);
+    gtk_entry_completion_set_match_func(completion, completion_match_func, NULL, NULL);
+
+    /* Connect before attaching the completion: our handler must refill the model before the completion filters it */
+    g_signal_connect(query_entry, "changed", G_CALLBACK (on_query_entry_changed), NULL);
+    gtk_entry_set_completion(GTK_ENTRY(query_entry), completion);
+    g_object_unref(completion);
+
     // ======== Initialize the static status info ========
 
     sms_button = lookup_widget(GTK_WIDGET(gscope_main), "src_mode_status_button");
@@ -188,10 +223,13 @@ void DISPLAY_init(GtkWidget *main)
     // ======== Initialize ImageMenuItem Icon Display Behavior ========
     DISPLAY_always_show_image(settings.menuIcons);
     #endif
+
+    // ======== Take over the core library status reporting ========
+    CORE_set_callbacks(&core_callbacks);
 }
 
 
-void DISPLAY_update_stats_tooltip(gchar *msg)
+void DISPLAY_update_stats_tooltip(const gchar *msg)
 {
     GtkWidget   *info_button;
 
@@ -202,7 +240,7 @@ void DISPLAY_update_stats_tooltip(gchar *msg)
 }
 
 
-void DISPLAY_update_path_label(gchar *path)
+void DISPLAY_update_path_label(const gchar *path)
 {
     #define MAX_DISPLAY_PATH    70
     #define PANGO_OVERHEAD      70
@@ -211,7 +249,7 @@ void DISPLAY_update_path_label(gchar *path)
     gchar *cwd_buf;
     gchar *working;
 
-    gchar *offset_ptr;
+    const gchar *offset_ptr;
     unsigned int length;
 
     // if the path is longer than MAX_DISPLAY_PATH characters, truncate it
@@ -249,7 +287,7 @@ void DISPLAY_update_path_label(gchar *path)
 
 
 /* Place a message in the query status label widget */
-void DISPLAY_status(gchar *msg)
+void DISPLAY_status(const gchar *msg)
 {
     static GtkWidget *status_label = NULL;
 
@@ -270,7 +308,10 @@ void DISPLAY_search_results(search_t button, search_results_t *results)
     
     if (results->match_count < 1) return;   /* This should never happen, but just in case... */
 
-    gtk_list_store_clear(store);
+    /* Load the new rows with the model detached, so the view does not process a signal per row */
+    gtk_tree_view_set_model(GTK_TREE_VIEW(treeview), NULL);
+    RESULTS_model_set(store, results);
+    gtk_tree_view_set_model(GTK_TREE_VIEW(treeview), GTK_TREE_MODEL(store));
 
     #if 0 // failed attempt to have combination manual resize and auto resize columns
     gtk_tree_view_column_set_resizable(display_col[FILENAME], FALSE);
@@ -289,23 +330,25 @@ void DISPLAY_search_results(search_t button, search_results_t *results)
         case FIND_CALLEDBY:
         case FIND_CALLING:
             configure_columns(FILE_FN_LN_TXT_COL_MASK);
-            update_list_store(results);
+            line_number_info_avail = TRUE;
+        break;
+
+        case FIND_INCLUDING:
+            // Transitive results report the #include depth in the function column
+            configure_columns(settings.transitiveIncludes ? FILE_FN_LN_TXT_COL_MASK : FILE_LN_TXT_COL_MASK);
             line_number_info_avail = TRUE;
         break;
 
         case FIND_DEF:
         case FIND_STRING:
         case FIND_REGEXP:
-        case FIND_INCLUDING:
         case FIND_ALL_FUNCTIONS:
             configure_columns(FILE_LN_TXT_COL_MASK);
-            update_list_store(results);
             line_number_info_avail = TRUE;
         break;
 
         case FIND_FILE:
             configure_columns(FILE_COL_MASK);
-            update_list_store(results);
             line_number_info_avail = FALSE;
         break;
     }
@@ -535,12 +578,18 @@ gboolean DISPLAY_get_clicked_entry(gint widget_x, gint widget_y, gchar **entry_p
 gboolean DISPLAY_get_filename_and_lineinfo(GtkTreePath *path, gchar **filename, gchar **line_num)
 {
     static gchar zero_line[] = "0";
+    static gchar line_buf[MAX_LINENUM_SIZE + 1];
+    const gchar *file;
+    guint       line;
 
-    if ( gtk_tree_model_get_iter( GTK_TREE_MODEL(store), &iter, path ) )
+    if ( RESULTS_model_get_row(store, path, &file, &line) )
     {
-        gtk_tree_model_get(GTK_TREE_MODEL(store), &iter, FILENAME, filename, -1);
+        *filename = (gchar *) file;
         if (line_number_info_avail)
-            gtk_tree_model_get(GTK_TREE_MODEL(store), &iter, LINE, line_num, -1);
+        {
+            snprintf(line_buf, sizeof(line_buf), "%u", line);
+            *line_num = line_buf;
+        }
         else
           *line_num = zero_line;
 
@@ -587,6 +636,21 @@ void DISPLAY_update_build_progress(guint count, guint max)
 
 
 
+/* Name the current build phase on the build progress bar (parsing shows a percentage instead) */
+void DISPLAY_update_build_phase(const gchar *phase)
+{
+    gchar *message;
+
+    message = g_strdup_printf("%s ...", phase);
+
+    gtk_progress_bar_pulse(GTK_PROGRESS_BAR(active_progress_bar));
+    gtk_progress_bar_set_text(GTK_PROGRESS_BAR(active_progress_bar), message);
+
+    g_free(message);
+}
+
+
+
 #define GCC_VERSION (__GNUC__ * 10000 \
                      + __GNUC_MINOR__ * 100 \
                      + __GNUC_PATCHLEVEL__)
@@ -665,6 +729,18 @@ void DISPLAY_set_cref_current(gboolean up_to_date)
 }
 
 
+
+/* Name the changed source files in the (out-of-date) cross-reference status tooltip */
+void DISPLAY_set_cref_changes(const gchar *summary)
+{
+    gchar   *tooltip;
+
+    my_asprintf(&tooltip, "Cross Reference Status: [Out-of-Date]\n%s\nClick to update.", summary);
+    gtk_widget_set_tooltip_text(lookup_widget(GTK_WIDGET(gscope_main), "cref_update_button"), tooltip);
+    g_free(tooltip);
+}
+
+
 //---------------------------------------------------------------------------
 //
 // Display a message dialog of the specified type.
@@ -685,6 +761,27 @@ void DISPLAY_msg(GtkMessageType type, const gchar *message)
 
 
 
+/* Core library message hook */
+static void core_msg(core_msg_e type, const gchar *message)
+{
+    switch (type)
+    {
+        case CORE_MSG_ERROR:    DISPLAY_msg(GTK_MESSAGE_ERROR,   message);  break;
+        case CORE_MSG_WARNING:  DISPLAY_msg(GTK_MESSAGE_WARNING, message);  break;
+        default:                DISPLAY_msg(GTK_MESSAGE_INFO,    message);  break;
+    }
+}
+
+
+/* Core library long-operation hook: keep the GUI responsive */
+static void core_yield(void)
+{
+    while (gtk_events_pending() )
+        gtk_main_iteration();
+}
+
+
+
 void DISPLAY_message_dialog(GtkMessageType type, const gchar *message, gboolean modal)
 {
     static GtkWidget *MsgDialog;
@@ -842,205 +939,55 @@ static void configure_columns(gchar new_mask)
 
 
 
-static void update_list_store(search_results_t *results)
+static gboolean search_equal_func(GtkTreeModel *model, gint column, const gchar *key, GtkTreeIter *iter, gpointer search_data)
 {
-    gchar  file       [PATHLEN + 1],
-           function   [MAX_FUNCTION_SIZE + 1],
-           linenum    [MAX_LINENUM_SIZE + 1],
-           source_text[MAX_DISPLAY_SOURCE + 1];
-
-    gchar    field_terminator;
-    uint32_t count;
-    uint32_t over_count;
-    gchar    *work_ptr = results->start_ptr;
-    gchar    *start_ptr;
-    uint32_t lines = results->match_count;
-    int      width;
-
+    gchar *cell_data = NULL;
+    guint line;
+    gboolean found;
 
-    while (lines-- > 0)
+    if (column == LINE)
     {
-        // Each line of the search results has the following fields [although some fields may have dummy values]:
-        //   File Name
-        //   Function Name
-        //   Line Number
-        //   Source Line Text
-        //
-        // The line format uses '|' and space ' ' characters for field delimiters as follows:
-        //   <file name>|<function name> <line number> <source text>\n
-        //
-        //   Note: <source text can contain any number of space ' ' characters.
-
-
-        /*** extract File Name ***/
-        count = 0;
-        start_ptr = work_ptr;
-        field_terminator = '|';
-        while ( (*work_ptr != field_terminator) && (count < sizeof(file)) )
-        {
-            file[count++] = *work_ptr;
-            work_ptr++;
-        }
-
-        if ( *work_ptr != field_terminator)  // We have an overflow condition
-        {
-            over_count = count;
-            count--;                // Bring the index back to the last char in the array.
-            file[count - 1] = '.';  // Ellipsize the overflow string
-            file[count - 2] = '.';
-            file[count - 3] = '.';
-
-            while (*work_ptr++ != field_terminator) // Skip over the overflow data
-                over_count++;
-            work_ptr--;     // Move pointer back to field terminator
-
-            fprintf(stderr, "Warning: Field width overflow: [File Path Name] will be truncated.\n");
-            fprintf(stderr, "    Max File Path Name length allowed: %d, Actual Path Name length: %d\n", PATHLEN, over_count);
-            width = PATHLEN / 4;
-            if (width > MAX_EXCERPT_SIZE) width = MAX_EXCERPT_SIZE;
-            fprintf(stderr, "    Excerpt [Head]: %.*s\n", width, start_ptr);
-            fprintf(stderr, "    Excerpt [Tail]: %.*s\n\n", width, start_ptr + over_count - width);
-        }
-        file[count] = '\0';         // Null terminate the string
-        work_ptr++;                 // skip the field terminator
-
-
-        /*** extract Function Name ***/
-        count = 0;
-        start_ptr = work_ptr;
-        field_terminator = ' ';
-        while ( (*work_ptr != field_terminator) && (count < sizeof(function)) )
-        {
-            function[count++] = *work_ptr;
-            work_ptr++;
-        }
-
-        if ( *work_ptr != field_terminator)  // We have an overflow condition
-        {
-            over_count = count;
-            count--;                    // Bring the index back to the last char in the array.
-            function[count - 1] = '.';  // Ellipsize the overflow string
-            function[count - 2] = '.';
-            function[count - 3] = '.';
-
-            while (*work_ptr++ != field_terminator) // Skip over the overflow data
-                over_count++;
-            work_ptr--;     // Move pointer back to field terminator
-
-            fprintf(stderr, "Warning: Field width overflow: [Function] will be truncated.\n");
-            fprintf(stderr, "    Max File Function length allowed: %d, Actual Function length: %d\n", MAX_FUNCTION_SIZE, over_count);
-            fprintf(stderr, "    File: %s\n", file);
-            width = MAX_FUNCTION_SIZE / 4;
-
-            /* coverity[dead_error_line] this check becomes valid if MAX_FUNCTION_SIZE is changed to a larger value. */
-            if (width > MAX_EXCERPT_SIZE) width = MAX_EXCERPT_SIZE;
-            fprintf(stderr, "    Excerpt [Head]: %.*s\n", width, start_ptr);
-            fprintf(stderr, "    Excerpt [Tail]: %.*s\n\n", width, start_ptr + over_count - width);
-        }
-        function[count] = '\0';     // Null terminate the string
-        work_ptr++;                 // skip the field terminator
-
-
-        /*** extract Line Number ***/
-        count = 0;
-        start_ptr = work_ptr;
-        field_terminator = ' ';
-        while ( (*work_ptr != field_terminator) && (count < sizeof(linenum)) )
-        {
-            linenum[count++] = *work_ptr;
-            work_ptr++;
-        }
-
-        if ( *work_ptr != field_terminator)  // We have an overflow condition
-        {
-            over_count = count;
-            count--;                   // Bring the index back to the last char in the array.
-            linenum[count - 1] = 'E';  // Ellipsize the overflow string
-
-            while (*work_ptr++ != field_terminator) // Skip over the overflow data
-                over_count++;
-            work_ptr--;     // Move pointer back to field terminator
-
-            fprintf(stderr, "Warning: Field width overflow: [Line Number] will be truncated.\n");
-            fprintf(stderr, "    Max Line Number length allowed: %d, Actual Line Number length: %d\n", MAX_LINENUM_SIZE, over_count);
-            fprintf(stderr, "    Full Line Number: %.*s\n\n", over_count, start_ptr);
-            fprintf(stderr, "    File: %s\n", file);
-        }
-        linenum[count] = '\0';     // Null terminate the string
-        work_ptr++;                 // skip the field terminator
-
-
-
-        /*** extract Source Line Text ***/
-        count = 0;
-        start_ptr = work_ptr;
-        field_terminator = '\n';
-        while ( (*work_ptr != field_terminator) && (count < sizeof(source_text)) )
-        {
-            source_text[count++] = *work_ptr;
-            work_ptr++;
-        }
-
-        if ( *work_ptr != field_terminator)  // We have an overflow condition
-        {
-            over_count = count;
-            count--;                    // Bring the index back to the last char in the array.
-            source_text[count - 1] = '.';  // Ellipsize the overflow string
-            source_text[count - 2] = '.';
-            source_text[count - 3] = '.';
-
-            while (*work_ptr++ != field_terminator) // Skip over the overflow data
-                over_count++;
-            work_ptr--;     // Move pointer back to field terminator
-
-            if ( strcmp(linenum, "1") == 0)
-            {
-                fprintf(stderr, "*** Warning: File %s is not using Linux newline format\n", file);
-            }
-
-            if (over_count > MAX_CRAZY_BIG_SIZE)  // We have so many "big" source lines, we need to filter it down to the "worst".
-            {
-                fprintf(stderr, "Warning: Field width overflow: [Source Text] will be truncated.\n"); 
-                fprintf(stderr, "    Max Source Text length allowed: %d, Actual Source Text length: %d\n", MAX_DISPLAY_SOURCE, over_count);
-                fprintf(stderr, "    File: %s\n    Line: %s\n", file, linenum);
-                width = MAX_DISPLAY_SOURCE / 4;
-                if (width > MAX_EXCERPT_SIZE) width = MAX_EXCERPT_SIZE;
-                fprintf(stderr, "    Excerpt [Head]: %.*s\n", width, start_ptr); 
-                fprintf(stderr, "    Excerpt [Tail]: %.*s\n\n", width, start_ptr + over_count - width);
-            }
-        }
-        source_text[count] = '\0';     // Null terminate the string
-        work_ptr++;                 // skip the field terminator
+        gtk_tree_model_get(model, iter, LINE, &line, -1);
+        cell_data = g_strdup_printf("%u", line);
+    }
+    else
+        gtk_tree_model_get(model, iter, column, &cell_data, -1);
 
+    if (!cell_data)
+        return !FALSE;  /* Return inverted logic result */
 
+    found = ( strstr(cell_data, key) != NULL );
+    g_free(cell_data);
 
-        gtk_list_store_append(store, &iter);
-        gtk_list_store_set(store, &iter, FILENAME, file, FUNCTION, function, 
-                           LINE, linenum, TEXT, source_text, -1);
-    }
-    return;
+    return( !found );   /* GtkTreeView search logic is inverted */
 }
 
 
 
-static gboolean search_equal_func(GtkTreeModel *model, gint column, const gchar *key, GtkTreeIter *iter, gpointer search_data)
+static void on_query_entry_changed(GtkEditable *editable, gpointer user_data)
 {
-    gchar *cell_data = NULL;
-    gboolean found;
-
-    gtk_tree_model_get(model, iter, column, &cell_data, -1);
-
-    if (!cell_data)
-        return !FALSE;  /* Return inverted logic result */
+    const gchar *prefix;
 
-    found = ( strstr(cell_data, key) != NULL );
+    gtk_list_store_clear(completion_store);
 
-    return( !found );   /* GtkTreeView search logic is inverted */
+    prefix = gtk_entry_get_text(GTK_ENTRY(editable));
+    if ( strlen(prefix) >= MIN_COMPLETION_PREFIX )
+        SYMDICT_complete(prefix, MAX_COMPLETIONS, add_completion, NULL);
 }
 
 
 
+static void add_completion(const gchar *symbol, gpointer user_data)
+{
+    GtkTreeIter c_iter;
 
+    gtk_list_store_append(completion_store, &c_iter);
+    gtk_list_store_set(completion_store, &c_iter, 0, symbol, -1);
+}
 
 
 
+static gboolean completion_match_func(GtkEntryCompletion *completion, const gchar *key, GtkTreeIter *iter, gpointer user_data)
+{
+    return(TRUE);   /* The completion model only holds matching symbols */
+}
@@ -3,7 +3,7 @@
 
 
 /* Place a message in the query status label widget */
-void DISPLAY_status(gchar *msg);
+void DISPLAY_status(const gchar *msg);
 
 /* Display the results of the query */
 void DISPLAY_search_results(search_t button, search_results_t *results);
@@ -29,14 +29,17 @@ void DISPLAY_update_progress_bar(guint count, guint max);
 /* Update the splash progress bar */
 void DISPLAY_update_build_progress(guint count, guint max);
 
+/* Show the cross-reference build phase */
+void DISPLAY_update_build_phase(const gchar *phase);
+
 /* Update the path label contents */
-void DISPLAY_update_path_label(gchar *path);
+void DISPLAY_update_path_label(const gchar *path);
 
 /* Set the menu-icon display behavior */
 void DISPLAY_always_show_image(gboolean always_show);
 
 /* Set the session info button tooltip */
-void DISPLAY_update_stats_tooltip(gchar *msg);
+void DISPLAY_update_stats_tooltip(const gchar *msg);
 
 /* Convenience function to display a (modal=TRUE) message dialog */
 void DISPLAY_msg(GtkMessageType type, const gchar *message);
@@ -47,6 +50,9 @@ void DISPLAY_message_dialog(GtkMessageType type, const gchar *message, gboolean
 /* Update the cross-reference status indicator */
 void DISPLAY_set_cref_current(gboolean up_to_date);
 
+/* Show the changed files of an out-of-date cross-reference in the status indicator tooltip */
+void DISPLAY_set_cref_changes(const gchar *summary);
+
 /* Set/change the parent for message dialogs */
 void DISPLAY_message_set_transient_parent(GtkWidget *parent);
 
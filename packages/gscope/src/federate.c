@@ -0,0 +1,347 @@
+/*
+ *  gscope federated queries (additional read-only cross-references)
+ *
+ *  One helper process per additional cross-reference.  FEDERATE_send() writes the search
+ *  options and the request line to every helper; FEDERATE_collect() reads the answers back in cross-reference order
+ *  and appends them to the lookup's results file, in the results file format.  A helper that
+ *  exits, answers out of protocol or does not answer within FEDERATE_TIMEOUT_MS is dropped
+ *  (with a warning) and not searched again.  While waiting, the front-end is serviced.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+
+#include "search.h"
+#include "app_config.h"
+#include "core.h"
+#include "utils.h"
+#include "query.h"
+#include "federate.h"
+
+
+//===============================================================
+//      Defines
+//===============================================================
+
+#define READ_CHUNK      4096
+
+
+typedef struct
+{
+    gchar       *ref_file;      /* Absolute cross-reference file name */
+    gchar       *dir;           /* Its directory: the helper's CWD, and the base of relative file names */
+    FILE        *to;            /* Helper stdin (requests) */
+    int         from;           /* Helper stdout (answers), -1 once dropped */
+    GString     *input;         /* Answer text read but not yet used */
+    gboolean    pending;        /* A request has been sent, its answer not yet read */
+} helper_t;
+
+
+
+//===============================================================
+//      Private Function Prototypes
+//===============================================================
+
+static gboolean start_helper    (helper_t *helper);
+static void     drop_helper     (helper_t *helper, const gchar *problem);
+static gboolean read_line       (helper_t *helper, GString *line, gint64 deadline);
+static void     drop_unanswered (helper_t *helper, gint64 deadline);
+static guint    read_answer     (helper_t *helper, FILE *output, gint64 deadline);
+
+
+
+//===============================================================
+//      Private Globals
+//===============================================================
+
+static gchar    **ref_files = NULL;     /* --search-also */
+static helper_t *helpers = NULL;
+static guint    nhelpers = 0;
+
+
+
+//===============================================================
+//      Public Globals
+//===============================================================
+
+GOptionEntry FEDERATE_options[] = {
+    {
+        "search-also", 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &ref_files,
+        "Also search this (read-only) cross-reference file.  May be repeated: results are listed in the order given.", "FILE"
+    },
+    { NULL }
+};
+
+
+
+//===============================================================
+//      Private Functions
+//===============================================================
+
+static gboolean start_helper(helper_t *helper)
+{
+    gchar       *argv[6];
+    gchar       **envp;
+    gchar       *base_name;
+    gint        to_fd;
+    gint        from_fd;
+    GError      *error = NULL;
+    gboolean    started;
+
+    base_name = g_path_get_basename(helper->ref_file);
+
+    argv[0] = access(FEDERATE_PROGRAM, X_OK) == 0 ? FEDERATE_PROGRAM : PACKAGE;
+    argv[1] = "--lineMode";
+    argv[2] = "--noBuild";
+    argv[3] = "--refFile";
+    argv[4] = base_name;
+    argv[5] = NULL;
+
+    /* A helper must not write its trace events over ours (see trace.h) */
+    envp = g_environ_unsetenv(g_get_environ(), "GSCOPE_TRACE_FILE");
+
+    started = g_spawn_async_with_pipes(helper->dir, argv, envp, G_SPAWN_SEARCH_PATH, NULL, NULL, NULL,
+                                       &to_fd, &from_fd, NULL, &error);
+    g_strfreev(envp);
+    g_free(base_name);
+
+    if (!started)
+    {
+        drop_helper(helper, error->message);
+        g_error_free(error);
+        return(FALSE);
+    }
+
+    helper->to    = fdopen(to_fd, "w");
+    helper->from  = from_fd;
+    helper->input = g_string_new(NULL);
+    return(TRUE);
+}
+
+
+
+static void drop_helper(helper_t *helper, const gchar *problem)
+{
+    gchar   *msg;
+
+    my_asprintf(&msg, "<span weight=\"bold\">Not searching %s</span>\n%s", helper->ref_file, problem);
+    CORE_msg(CORE_MSG_WARNING, msg);
+    g_free(msg);
+
+    if (helper->to)   fclose(helper->to);       /* EOF on its input: the helper exits */
+    if (helper->from >= 0) close(helper->from);
+    if (helper->input) g_string_free(helper->input, TRUE);
+    helper->to      = NULL;
+    helper->from    = -1;
+    helper->input   = NULL;
+    helper->pending = FALSE;
+}
+
+
+
+/* Read one answer line (without its newline) into 'line', waiting until 'deadline' (monotonic
+   time) at most.  The front-end is serviced while the helper searches.  Returns FALSE if the
+   helper has exited or the deadline has passed. */
+static gboolean read_line(helper_t *helper, GString *line, gint64 deadline)
+{
+    struct pollfd   poll_fd;
+    char            buf[READ_CHUNK];
+    char            *eol;
+    ssize_t         length;
+    gint64          now;
+    int             ready;
+
+    for (;;)
+    {
+        if ( (eol = memchr(helper->input->str, '\n', helper->input->len)) != NULL )
+        {
+            g_string_truncate(line, 0);
+            g_string_append_len(line, helper->input->str, eol - helper->input->str);
+            g_string_erase(helper->input, 0, eol - helper->input->str + 1);
+            return(TRUE);
+        }
+
+        if ( (now = g_get_monotonic_time()) >= deadline )
+            return(FALSE);
+
+        poll_fd.fd     = helper->from;
+        poll_fd.events = POLLIN;
+        ready = poll(&poll_fd, 1, MIN(FEDERATE_POLL_MS, (deadline - now) / 1000 + 1));
+
+        if (ready < 0 && errno != EINTR)
+            return(FALSE);
+
+        if (ready <= 0)
+        {
+            CORE_yield();       /* Keep the front-end responsive while the helper searches */
+            continue;
+        }
+
+        if ( (length = read(helper->from, buf, sizeof(buf))) <= 0 )
+        {
+            if (length < 0 && errno == EINTR)
+                continue;
+            return(FALSE);      /* The helper has exited */
+        }
+        g_string_append_len(helper->input, buf, length);
+    }
+}
+
+
+
+/* Drop a helper that did not deliver its whole answer by 'deadline' */
+static void drop_unanswered(helper_t *helper, gint64 deadline)
+{
+    if (g_get_monotonic_time() >= deadline)
+        drop_helper(helper, "The query helper did not answer in time.");
+    else
+        drop_helper(helper, "The query helper stopped answering.");
+}
+
+
+
+/* Copy one answer ("gscope: <count> lines" + results) to the results file, returns the line count */
+static guint read_answer(helper_t *helper, FILE *output, gint64 deadline)
+{
+    GString *line;
+    guint   count;
+    guint   i;
+    char    *sep;
+
+    helper->pending = FALSE;
+    line = g_string_new(NULL);
+
+    if ( !read_line(helper, line, deadline) || sscanf(line->str, "gscope: %u lines", &count) != 1 )
+    {
+        g_string_free(line, TRUE);
+        drop_unanswered(helper, deadline);
+        return(0);
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        if ( !read_line(helper, line, deadline) || (sep = strchr(line->str, ' ')) == NULL )
+        {
+            g_string_free(line, TRUE);
+            drop_unanswered(helper, deadline);
+            return(i);
+        }
+
+        /* "<file> <function> ..." back to the results file's "<file>|<function> ..." */
+        *sep = '\0';
+        if (line->str[0] == '/')
+            fprintf(output, "%s|%s\n", line->str, sep + 1);
+        else
+            fprintf(output, "%s/%s|%s\n", helper->dir, line->str, sep + 1);
+    }
+
+    g_string_free(line, TRUE);
+    return(count);
+}
+
+
+
+//===============================================================
+//      Public Interface Functions
+//===============================================================
+
+/* Start a helper for every --search-also cross-reference (they load while ours is built) */
+void FEDERATE_start()
+{
+    gchar   *cwd;
+    guint   i;
+
+    if (ref_files == NULL || helpers != NULL)
+        return;
+
+    nhelpers = g_strv_length(ref_files);
+    helpers  = g_new0(helper_t, nhelpers);
+    cwd      = g_get_current_dir();
+
+    signal(SIGPIPE, SIG_IGN);       /* A helper that exits must not take us with it */
+
+    for (i = 0; i < nhelpers; i++)
+    {
+        if ( g_path_is_absolute(ref_files[i]) )
+            helpers[i].ref_file = g_strdup(ref_files[i]);
+        else
+            helpers[i].ref_file = g_build_filename(cwd, ref_files[i], NULL);
+        helpers[i].dir  = g_path_get_dirname(helpers[i].ref_file);
+        helpers[i].from = -1;
+
+        if ( access(helpers[i].ref_file, R_OK) != 0 )
+        {
+            fprintf(stderr, "Error: Cannot read cross-reference file [%s]\n", helpers[i].ref_file);
+            exit(EXIT_FAILURE);
+        }
+
+        (void) start_helper(&helpers[i]);
+    }
+
+    g_free(cwd);
+}
+
+
+
+/* Are any additional cross-references searched?  (Their helpers serve one lookup at a time) */
+gboolean FEDERATE_active()
+{
+    return(nhelpers > 0);
+}
+
+
+
+/* Send a query to every helper (answers are read by FEDERATE_collect) */
+void FEDERATE_send(search_t type, const gchar *pattern)
+{
+    guint   i;
+
+    for (i = 0; i < nhelpers; i++)
+    {
+        if (helpers[i].to == NULL)
+            continue;
+
+        /* The helper searches with our options, not its own rc file's (they may change between queries).
+           A newline would end the request early: the rest would be answered as another query */
+        if ( fprintf(helpers[i].to, "%c%s%s%s\n%d%.*s\n", QUERY_OPTIONS_MARK,
+                     settings.ignoreCase         ? "i" : "",
+                     settings.transitiveIncludes ? "t" : "",
+                     settings.includersSrcOnly   ? "s" : "",
+                     type, (int) strcspn(pattern, "\r\n"), pattern) < 0 ||
+             fflush(helpers[i].to) == EOF )
+            drop_helper(&helpers[i], g_strerror(errno));
+        else
+            helpers[i].pending = TRUE;
+    }
+}
+
+
+
+/* Append the helpers' answers to the results, in --search-also order.  Returns the number of lines.
+   The helpers search at the same time, so they share one FEDERATE_TIMEOUT_MS deadline. */
+guint FEDERATE_collect(FILE *output)
+{
+    gint64  deadline;
+    guint   count = 0;
+    guint   i;
+
+    deadline = g_get_monotonic_time() + (gint64) FEDERATE_TIMEOUT_MS * 1000;
+
+    for (i = 0; i < nhelpers; i++)
+    {
+        if (helpers[i].pending)
+            count += read_answer(&helpers[i], output, deadline);
+    }
+
+    return(count);
+}
@@ -0,0 +1,34 @@
+
+/* Federated queries:
+ *
+ *   gscope --search-also /sdk/cscope_db.out --search-also /vendor/cscope_db.out ...
+ *
+ * Every lookup also searches these additional cross-references, in the order given, and
+ * their results follow the project's own.  They are used as-is (never rebuilt), so a large
+ * shared SDK cross-reference is built once and searched from every project.
+ *
+ * The search module is not re-entrant, so each additional cross-reference is searched by
+ * a helper "gscope -L -d" process (the batch query protocol, see query.h) started in the
+ * cross-reference's directory, with the front-end's search options (ignore case, transitive
+ * and source-only includers).  A query is sent to every helper before the project's own
+ * cross-reference is searched, so all of them are searched at the same time.  Relative file
+ * names in a helper's results are made absolute, so each result names its origin.  A helper
+ * that has not answered within FEDERATE_TIMEOUT_MS is dropped.  Helpers reload their
+ * cross-reference when it is replaced (rebuilt).
+ */
+
+#define FEDERATE_PROGRAM    "/proc/self/exe"    /* Helper executable (PACKAGE, from $PATH, if unavailable) */
+#define FEDERATE_TIMEOUT_MS 30000               /* A helper that takes longer to answer a query is dropped */
+#define FEDERATE_POLL_MS    100                 /* Front-end service interval while waiting for answers */
+
+extern GOptionEntry FEDERATE_options[];     /* Command line options: --search-also */
+
+
+//===============================================================
+//      Public Interface Functions
+//===============================================================
+
+void        FEDERATE_start      (void);
+gboolean    FEDERATE_active     (void);
+void        FEDERATE_send       (search_t type, const gchar *pattern);
+guint       FEDERATE_collect    (FILE *output);
@@ -0,0 +1,509 @@
+/*
+ *  gscope file name trigram index
+ *
+ *  Every (ASCII lower-cased) three-character substring of every source path maps to the
+ *  list of files whose path contains it.  Files are identified by their index in the
+ *  compact source file list, and since files in the same directory are adjacent in the
+ *  list, each posting list is stored as runs of consecutive indexes:
+ *
+ *      <gap from the end of the previous run><run length - 1>     (varints)
+ *
+ *  Directory trigrams shared by thousands of files then take a few bytes.  A query
+ *  intersects the run lists of the trigrams in the pattern's mandatory literal text,
+ *  shortest list first.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "dir.h"
+#include "utils.h"
+#include "trace.h"
+#include "fileindex.h"
+
+
+//===============================================================
+//       Local Type Definitions
+//===============================================================
+
+struct fileindex
+{
+    guint32     count;          /* Number of distinct trigrams */
+    guint32     *keys;          /* Sorted trigram keys */
+    guint32     *offsets;       /* Start of each key's run list in data (count + 1 entries) */
+    guint8      *data;
+};
+
+
+typedef struct
+{
+    GByteArray  *data;
+    guint32     run_start;
+    guint32     run_end;        /* One past the last index of the open run */
+    guint32     last_end;       /* End of the last run written */
+} posting_builder_t;
+
+
+typedef struct
+{
+    guint32     key;
+    guint32     size;           /* Run list size in bytes (selectivity estimate) */
+} query_key_t;
+
+
+//===============================================================
+//       Private Function Prototypes
+//===============================================================
+
+static guint32  trigram_key     (const gchar *text);
+static void     add_path        (GHashTable *builders, const gchar *path, guint32 index);
+static void     flush_run       (posting_builder_t *builder);
+static int      compare_keys    (const void *a, const void *b);
+static int      compare_size    (const void *a, const void *b);
+static gboolean add_literal     (GArray *keys, const gchar *run, guint length);
+static gboolean pattern_keys    (const gchar *pattern, GArray *keys);
+static gint     find_key        (guint32 key);
+static void     decode_runs     (guint32 slot, GArray *ranges);
+static void     intersect       (GArray *ranges, GArray *other, GArray *result);
+
+
+//===============================================================
+//       Private Global Variables
+//===============================================================
+
+static fileindex_t  findex;         /* The installed index (searched) */
+
+
+
+//===============================================================
+//       Private Functions
+//===============================================================
+
+static guint32 trigram_key(const gchar *text)
+{
+    return( ((guint32) (guint8) g_ascii_tolower(text[0]) << 16) |
+            ((guint32) (guint8) g_ascii_tolower(text[1]) << 8)  |
+             (guint32) (guint8) g_ascii_tolower(text[2]) );
+}
+
+
+
+static void add_path(GHashTable *builders, const gchar *path, guint32 index)
+{
+    posting_builder_t   *builder;
+    guint32             key;
+
+    for (; path[0] && path[1] && path[2]; path++)
+    {
+        key = trigram_key(path);
+
+        if ( (builder = g_hash_table_lookup(builders, GUINT_TO_POINTER(key))) == NULL )
+        {
+            builder = g_malloc0(sizeof(posting_builder_t));
+            builder->data = g_byte_array_new();
+            builder->run_start = builder->run_end = index;
+            g_hash_table_insert(builders, GUINT_TO_POINTER(key), builder);
+        }
+
+        if (index < builder->run_end)       /* Repeated trigram in this path */
+            continue;
+
+        if (index != builder->run_end)
+        {
+            flush_run(builder);
+            builder->run_start = index;
+        }
+        builder->run_end = index + 1;
+    }
+}
+
+
+
+static void flush_run(posting_builder_t *builder)
+{
+    my_put_varint(builder->data, builder->run_start - builder->last_end);
+    my_put_varint(builder->data, builder->run_end - builder->run_start - 1);
+    builder->last_end = builder->run_end;
+}
+
+
+
+static int compare_keys(const void *a, const void *b)
+{
+    guint32 ka = *(const guint32 *) a;
+    guint32 kb = *(const guint32 *) b;
+
+    return( (ka > kb) - (ka < kb) );
+}
+
+
+
+static int compare_size(const void *a, const void *b)
+{
+    guint32 sa = ((const query_key_t *) a)->size;
+    guint32 sb = ((const query_key_t *) b)->size;
+
+    return( (sa > sb) - (sa < sb) );
+}
+
+
+
+/* Add the trigrams of one literal run of the pattern.  Returns TRUE if there were any. */
+static gboolean add_literal(GArray *keys, const gchar *run, guint length)
+{
+    query_key_t entry;
+    guint       i;
+
+    if (length < 3)
+        return(FALSE);
+
+    for (i = 0; i + 2 < length; i++)
+    {
+        entry.key  = trigram_key(run + i);
+        entry.size = 0;
+        g_array_append_val(keys, entry);
+    }
+    return(TRUE);
+}
+
+
+
+/* Collect the trigrams of the text that any match of the (extended) regular expression must
+   contain.  Anything that is not certainly literal -- bracket expressions, groups, escapes
+   of letters or digits, and characters made optional by '?', '*' or '{' -- ends the current
+   literal run.  Returns FALSE if the pattern has no usable literal run. */
+static gboolean pattern_keys(const gchar *pattern, GArray *keys)
+{
+    gchar       *run;
+    guint       length = 0;
+    guint       depth = 0;
+    gboolean    found = FALSE;
+    const gchar *p;
+
+    run = g_malloc(strlen(pattern) + 1);
+
+    for (p = pattern; *p; p++)
+    {
+        switch (*p)
+        {
+            case '|':
+                if (depth == 0)         /* Top-level alternation: no text is mandatory */
+                {
+                    g_free(run);
+                    return(FALSE);
+                }
+            break;
+
+            case '(':
+                depth++;
+                found |= add_literal(keys, run, length);
+                length = 0;
+            break;
+
+            case ')':
+                if (depth > 0)
+                    depth--;
+                found |= add_literal(keys, run, length);
+                length = 0;
+            break;
+
+            case '[':
+                found |= add_literal(keys, run, length);
+                length = 0;
+
+                /* Skip the bracket expression: [^]...], [[:class:]], [[.x.]], [[=x=]] */
+                p++;
+                if (*p == '^')
+                    p++;
+                if (*p == ']')
+                    p++;
+                while (*p && *p != ']')
+                {
+                    if ( *p == '[' && (p[1] == ':' || p[1] == '.' || p[1] == '=') )
+                    {
+                        gchar delimiter = p[1];
+
+                        for (p += 2; *p && !(p[0] == delimiter && p[1] == ']'); p++)
+                            ;
+                        if (*p)
+                            p++;
+                    }
+                    if (*p)
+                        p++;
+                }
+                if (*p == '\0')
+                    p--;
+            break;
+
+            case '?':
+            case '*':
+            case '{':
+                if (length > 0)         /* The previous character is optional */
+                    length--;
+                found |= add_literal(keys, run, length);
+                length = 0;
+
+                if (*p == '{')
+                {
+                    while (p[1] && *p != '}')
+                        p++;
+                }
+            break;
+
+            case '+':
+            case '.':
+            case '^':
+            case '$':
+                found |= add_literal(keys, run, length);
+                length = 0;
+            break;
+
+            case '\\':
+                if ( p[1] == '\0' || g_ascii_isalnum(p[1]) )
+                {
+                    /* GNU operators (\w, \b, \<, ...) and back references are not literal */
+                    found |= add_literal(keys, run, length);
+                    length = 0;
+                    if (p[1])
+                        p++;
+                }
+                else if (depth == 0)
+                    run[length++] = *++p;
+                else
+                    p++;
+            break;
+
+            default:
+                if (depth == 0)
+                    run[length++] = *p;
+            break;
+        }
+    }
+    found |= add_literal(keys, run, length);
+
+    g_free(run);
+    return(found);
+}
+
+
+
+/* Binary search for a trigram.  Returns its slot or -1 */
+static gint find_key(guint32 key)
+{
+    guint32 low = 0;
+    guint32 high = findex.count;
+    guint32 mid;
+
+    while (low < high)
+    {
+        mid = low + (high - low) / 2;
+
+        if (findex.keys[mid] < key)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    return( (low < findex.count && findex.keys[low] == key) ? (gint) low : -1 );
+}
+
+
+
+static void decode_runs(guint32 slot, GArray *ranges)
+{
+    const guint8        *read_ptr = findex.data + findex.offsets[slot];
+    const guint8        *end_ptr  = findex.data + findex.offsets[slot + 1];
+    fileindex_range_t   range;
+    guint32             last_end = 0;
+
+    g_array_set_size(ranges, 0);
+
+    while (read_ptr < end_ptr)
+    {
+        range.start = last_end + my_get_varint(&read_ptr);
+        range.end   = range.start + my_get_varint(&read_ptr) + 1;
+        last_end    = range.end;
+        g_array_append_val(ranges, range);
+    }
+}
+
+
+
+static void intersect(GArray *ranges, GArray *other, GArray *result)
+{
+    fileindex_range_t   *a = (fileindex_range_t *) ranges->data;
+    fileindex_range_t   *b = (fileindex_range_t *) other->data;
+    fileindex_range_t   range;
+    guint               i = 0;
+    guint               j = 0;
+
+    g_array_set_size(result, 0);
+
+    while (i < ranges->len && j < other->len)
+    {
+        range.start = MAX(a[i].start, b[j].start);
+        range.end   = MIN(a[i].end, b[j].end);
+
+        if (range.start < range.end)
+            g_array_append_val(result, range);
+
+        if (a[i].end < b[j].end)
+            i++;
+        else
+            j++;
+    }
+}
+
+
+
+//===============================================================
+//       Public Interface Functions
+//===============================================================
+
+/* Build the index of a compact source file list.  Touches no search state (a build thread
+   builds the next index while lookups use the installed one) */
+fileindex_t *FILEINDEX_make(const DIR_src_list_t *list)
+{
+    fileindex_t         *fx;
+    GHashTable          *builders;
+    GHashTableIter      hash_iter;
+    gpointer            key;
+    posting_builder_t   *builder;
+    DIR_src_iter_t      iter;
+    const gchar         *path;
+    GByteArray          *data;
+    guint32             index;
+    guint32             i;
+
+    TRACE_BEGIN("file index", NULL);
+
+    fx = g_malloc0(sizeof(fileindex_t));
+
+    builders = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+    DIR_src_list_iter_init(&iter, list, 0);
+    for (index = 0; (path = DIR_src_iter_next(&iter)) != NULL; index++)
+        add_path(builders, path, index);
+
+    fx->count = g_hash_table_size(builders);
+    fx->keys  = g_malloc( (fx->count + 1) * sizeof(guint32) );
+    fx->offsets = g_malloc( (fx->count + 1) * sizeof(guint32) );
+
+    i = 0;
+    g_hash_table_iter_init(&hash_iter, builders);
+    while ( g_hash_table_iter_next(&hash_iter, &key, NULL) )
+        fx->keys[i++] = GPOINTER_TO_UINT(key);
+
+    qsort(fx->keys, fx->count, sizeof(guint32), compare_keys);
+
+    data = g_byte_array_new();
+    for (i = 0; i < fx->count; i++)
+    {
+        builder = g_hash_table_lookup(builders, GUINT_TO_POINTER(fx->keys[i]));
+        flush_run(builder);
+
+        fx->offsets[i] = data->len;
+        g_byte_array_append(data, builder->data->data, builder->data->len);
+
+        g_byte_array_free(builder->data, TRUE);
+        g_free(builder);
+    }
+    fx->offsets[fx->count] = data->len;
+    fx->data = g_byte_array_free(data, FALSE);
+
+    g_hash_table_destroy(builders);
+
+    TRACE_END("file index");
+    return(fx);
+}
+
+
+
+/* Make a built index the one searched, freeing the previous one (main thread, between lookups) */
+void FILEINDEX_install(fileindex_t *fx)
+{
+    FILEINDEX_free();
+    findex = *fx;
+    g_free(fx);
+}
+
+
+
+void FILEINDEX_free()
+{
+    g_free(findex.keys);
+    g_free(findex.offsets);
+    g_free(findex.data);
+    memset(&findex, 0, sizeof(findex));
+}
+
+
+
+/* Fill 'ranges' with the (ascending) source list index ranges that may match 'pattern'.
+   Returns FALSE if the index cannot narrow the search. */
+gboolean FILEINDEX_candidates(const gchar *pattern, GArray *ranges)
+{
+    GArray      *keys;
+    GArray      *other;
+    GArray      *result;
+    query_key_t *entry;
+    gint        slot;
+    guint       i;
+
+    if (findex.keys == NULL)
+        return(FALSE);
+
+    keys = g_array_new(FALSE, FALSE, sizeof(query_key_t));
+
+    if ( !pattern_keys(pattern, keys) )
+    {
+        g_array_free(keys, TRUE);
+        return(FALSE);
+    }
+
+    g_array_set_size(ranges, 0);
+
+    /* Look up every trigram -- a missing one means no file can match */
+    for (i = 0; i < keys->len; i++)
+    {
+        entry = &g_array_index(keys, query_key_t, i);
+
+        if ( (slot = find_key(entry->key)) < 0 )
+        {
+            g_array_free(keys, TRUE);
+            return(TRUE);
+        }
+        entry->key  = slot;
+        entry->size = findex.offsets[slot + 1] - findex.offsets[slot];
+    }
+
+    /* Most selective (shortest) run list first */
+    qsort(keys->data, keys->len, sizeof(query_key_t), compare_size);
+
+    other  = g_array_new(FALSE, FALSE, sizeof(fileindex_range_t));
+    result = g_array_new(FALSE, FALSE, sizeof(fileindex_range_t));
+
+    decode_runs(g_array_index(keys, query_key_t, 0).key, ranges);
+
+    for (i = 1; i < keys->len && ranges->len > 0; i++)
+    {
+        decode_runs(g_array_index(keys, query_key_t, i).key, other);
+        intersect(ranges, other, result);
+
+        g_array_set_size(ranges, result->len);
+        memcpy(ranges->data, result->data, result->len * sizeof(fileindex_range_t));
+    }
+
+    g_array_free(other, TRUE);
+    g_array_free(result, TRUE);
+    g_array_free(keys, TRUE);
+
+    return(TRUE);
+}
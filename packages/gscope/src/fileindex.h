@@ -0,0 +1,28 @@
+
+/* File name trigram index (FIND_FILE).
+ *
+ * Built from the compact source file list once the cross-reference is complete.  For a
+ * file-name pattern, FILEINDEX_candidates() returns the ranges of source list indexes whose
+ * paths contain every trigram of the pattern's mandatory literal text.  Only those files
+ * need to be matched with regexec().  Patterns with no usable literal text (or with a
+ * top-level alternation) cannot be narrowed and must be matched against every file.
+ */
+
+typedef struct fileindex fileindex_t;    /* A file name index */
+
+
+typedef struct
+{
+    guint32     start;          /* First source list index */
+    guint32     end;            /* One past the last index */
+} fileindex_range_t;
+
+
+//===============================================================
+//      Public Interface Functions
+//===============================================================
+
+fileindex_t *FILEINDEX_make     (const DIR_src_list_t *list);
+void        FILEINDEX_install   (fileindex_t *fx);
+void        FILEINDEX_free      (void);
+gboolean    FILEINDEX_candidates(const gchar *pattern, GArray *ranges);
@@ -5,6 +5,7 @@
 #include <gtk/gtk.h>
 #include <glib.h>
 #include <string.h>
+#include <sys/stat.h>
 
 #include "support.h"
 #include "callbacks.h"
@@ -12,20 +13,37 @@
 #include "app_config.h"
 
 // ---- Defines ----
+#define BUFFER_CACHE_MAX    8       /* Max number of cached buffers that are not displayed by any window */
 
 // ---- Typedefs ----
 
+// Source buffers are shared by every window that displays the same file, and are kept
+// (up to BUFFER_CACHE_MAX) after the last window closes, so re-opening a file is free.
+// A cached buffer is reloaded when the file's mtime or size changes.
+typedef struct _bufferEntry
+{
+    gchar           *filename;
+    GtkSourceBuffer *buffer;
+    time_t          mtime;
+    off_t           size;
+    guint           views;          /* Number of windows displaying this buffer */
+} BufferEntry;
+
 // ---- local function prototypes ----
 static gboolean open_file (GtkSourceBuffer *sBuf, const gchar *filename);
 void ModifyTextPopUp(GtkTextView *textview, GtkMenu *menu, gpointer user_data);
 static void createFileViewer(ViewWindow *windowPtr);
 static gboolean is_mf_or_makefile(const char *filename);
+static BufferEntry *acquire_buffer(const gchar *filename);
+static void release_buffer(BufferEntry *entry);
 
 
 
 // ---- File Globals ----
 static ViewWindow *viewListBegin = NULL;
 static ViewWindow *viewListEnd   = NULL;
+static GHashTable *bufferCache   = NULL;    // filename -> BufferEntry
+static GQueue     *idleBuffers   = NULL;    // Cached buffers not displayed by any window, most recently used first
 
 
 void on_fileview_destroy(GtkWidget *object, gpointer user_data)
@@ -66,6 +84,7 @@ void on_fileview_destroy(GtkWidget *object, gpointer user_data)
         else
             viewListBegin = windowPtr->next;  // This is not the last list entry, move the "Begin" pointer forward
 
+        release_buffer(windowPtr->bufEntry);
         g_free(windowPtr->filename);
         g_free(windowPtr);
     }
@@ -74,6 +93,7 @@ void on_fileview_destroy(GtkWidget *object, gpointer user_data)
         prevPtr->next = windowPtr->next;
         if (windowPtr == viewListEnd)    // If the window is on the end of the list, push back "End" pointer.
             viewListEnd = prevPtr;
+        release_buffer(windowPtr->bufEntry);
         g_free(windowPtr->filename);
         g_free(windowPtr);
     }
@@ -109,6 +129,7 @@ void FILEVIEW_create(gchar *file_name, gint line)
     GtkTextIter iter;
     GtkTextBuffer *s_buffer;
     ViewWindow *windowPtr;
+    BufferEntry *entry;
     gboolean   sameName;
 
     // Search the view window list looking for file_name
@@ -124,7 +145,11 @@ void FILEVIEW_create(gchar *file_name, gint line)
 
     if (sameName)    // --- A view window is already open for this file ---
     {
-        s_buffer =gtk_text_view_get_buffer(GTK_TEXT_VIEW(windowPtr->srcViewWidget));
+        // Re-acquire the buffer: it is reloaded if the file changed since it was loaded
+        entry = acquire_buffer(file_name);
+        release_buffer(windowPtr->bufEntry);
+        windowPtr->bufEntry = entry;
+        s_buffer = GTK_TEXT_BUFFER(windowPtr->bufEntry->buffer);
     }
     else
     {   // --- No view already open for this file ---
@@ -137,12 +162,12 @@ void FILEVIEW_create(gchar *file_name, gint line)
             gtk_window_set_title (GTK_WINDOW (windowPtr->topWidget), windowPtr->filename);
             gtk_widget_set_name(GTK_WIDGET(windowPtr->topWidget), windowPtr->filename); 
 
-            // Clear the current buffer text
-            s_buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(windowPtr->srcViewWidget));
-            gtk_source_buffer_begin_not_undoable_action (GTK_SOURCE_BUFFER (s_buffer) );
-            gtk_text_buffer_set_text (GTK_TEXT_BUFFER (s_buffer), "", 0);
-            gtk_source_buffer_end_not_undoable_action (GTK_SOURCE_BUFFER (s_buffer) );
-            gtk_text_buffer_set_modified (GTK_TEXT_BUFFER (s_buffer), FALSE);
+            // Switch the window over to the (shared) buffer for the new file
+            entry = acquire_buffer(file_name);
+            release_buffer(windowPtr->bufEntry);
+            windowPtr->bufEntry = entry;
+            s_buffer = GTK_TEXT_BUFFER(windowPtr->bufEntry->buffer);
+            gtk_text_view_set_buffer(GTK_TEXT_VIEW(windowPtr->srcViewWidget), s_buffer);
 
             #ifdef GTK3_BUILD
             g_idle_add (&scroll_view_cb, windowPtr->srcViewWidget);
@@ -157,13 +182,11 @@ void FILEVIEW_create(gchar *file_name, gint line)
             windowPtr = (ViewWindow *) g_malloc(sizeof(ViewWindow));
             windowPtr->filename = strdup(file_name);
     
-            // create a new GtkSourceView window
+            // create a new GtkSourceView window and attach the (shared) buffer for this file
             createFileViewer(windowPtr);
-            s_buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(windowPtr->srcViewWidget));
-
-            // Create a marker to indicate the matched line
-            gtk_text_buffer_get_iter_at_line (GTK_TEXT_BUFFER (s_buffer), &iter, line - 1);
-            gtk_source_buffer_create_source_mark (GTK_SOURCE_BUFFER (s_buffer), "LineMarker", "LMtype", &iter);
+            windowPtr->bufEntry = acquire_buffer(file_name);
+            s_buffer = GTK_TEXT_BUFFER(windowPtr->bufEntry->buffer);
+            gtk_text_view_set_buffer(GTK_TEXT_VIEW(windowPtr->srcViewWidget), s_buffer);
     
             if (viewListBegin == NULL)
             {
@@ -179,9 +202,6 @@ void FILEVIEW_create(gchar *file_name, gint line)
                 viewListEnd = windowPtr;
             }
         }
-
-        // Now load the file
-        open_file ( GTK_SOURCE_BUFFER (s_buffer), file_name);
     }
     // Store the current line number (for future reference)
     windowPtr->line = line;
@@ -197,7 +217,8 @@ void FILEVIEW_create(gchar *file_name, gint line)
 
     // Get the mark that represents the curent cursor position
     mark = gtk_text_buffer_get_insert(GTK_TEXT_BUFFER (s_buffer));
-    // Scroll to the specified line number
+    // Scroll to the specified line number.  Scrolling to a mark (rather than an iter) is deferred
+    // until the lines around the mark are validated, so a large file is never laid out in full.
     gtk_text_view_scroll_to_mark(GTK_TEXT_VIEW(windowPtr->srcViewWidget), mark, 0, TRUE, 0, 0.5);
 
     /* Move the search marker to the specified line */
@@ -212,17 +233,11 @@ static void createFileViewer(ViewWindow *windowPtr)
     GtkWidget *window;
     GtkWidget *pScrollWin;
     GtkWidget *sView;
-    GtkSourceBuffer *sBuf;
-    GtkSourceLanguageManager *lm;
     GdkPixbuf *fileview_icon_pixbuf;
     PangoFontDescription *font_desc;
-    const gchar * const *lang_dirs;
     static guint x = 400;
     static guint y = 400;
 
-    // Data required to support non-standard gtksourceview install directory
-    lang_dirs = gtk_source_language_manager_get_search_path (gtk_source_language_manager_get_default ());
-
     // Create a Window
     window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
     gtk_container_set_border_width (GTK_CONTAINER (window), 10);
@@ -247,24 +262,8 @@ static void createFileViewer(ViewWindow *windowPtr)
     gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (pScrollWin),
                                     GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
 
-    /* Now create a GtkSourceLanguagesManager */
-
-    // "lang_files_dir" HACK: instead of simply calling gtk_source_languages_manager_new(), we
-    // create the language manager with the "lang_files_dir" property set to $PACKAGE_DATA_DIR/gtksourceview/language-specs.
-    // This enables gtksourceview to find the language spec files when it is not installed at its "normal" path.
-    
-    lm = gtk_source_language_manager_new();
-    gtk_source_language_manager_set_search_path(lm, (gchar **) lang_dirs);
-
-    /* and a GtkSourceBuffer to hold text (similar to GtkTextBuffer) */
-    sBuf = GTK_SOURCE_BUFFER (gtk_source_buffer_new (NULL));
-
-    g_object_ref (lm);
-    g_object_set_data_full ( G_OBJECT (sBuf), "languages-manager",
-                             lm, (GDestroyNotify) g_object_unref);
-
-    /* Create the GtkSourceView and associate it with the buffer */
-    sView = gtk_source_view_new_with_buffer(sBuf);
+    /* Create the GtkSourceView.  The (shared) buffer is attached by the caller */
+    sView = gtk_source_view_new();
     windowPtr->srcViewWidget = GTK_SOURCE_VIEW(sView);
 
     gtk_text_view_set_editable(GTK_TEXT_VIEW(sView), FALSE);
@@ -312,10 +311,10 @@ static gboolean open_file (GtkSourceBuffer *sBuf, const gchar *filename)
     GtkSourceLanguageManager *lm;
     GtkSourceLanguage *language = NULL;
     GError *err = NULL;
-    gboolean reading;
-    GtkTextIter iter;
-    GIOChannel *io;
-    gchar *buffer;
+    GMappedFile *mapped;
+    gchar *contents;
+    gchar *converted;
+    gsize length;
 
     g_return_val_if_fail (sBuf != NULL, FALSE);
     g_return_val_if_fail (filename != NULL, FALSE);
@@ -345,74 +344,145 @@ static gboolean open_file (GtkSourceBuffer *sBuf, const gchar *filename)
         gtk_source_buffer_set_language (GTK_SOURCE_BUFFER(sBuf), language);
     }
 
-    /* Now load the file from Disk */
-    io = g_io_channel_new_file (filename, "r", &err);
-    if (!io)
+    /* Now load the file from Disk: map it and insert the whole file with a single call */
+    mapped = g_mapped_file_new (filename, FALSE, &err);
+    if (!mapped)
     {
         g_print("error: %s %s\n", (err)->message, filename);
+        g_error_free (err);
+        gtk_text_buffer_set_text (GTK_TEXT_BUFFER (sBuf), "", 0);
         return FALSE;
     }
 
-    if (g_io_channel_set_encoding (io, "utf-8", &err) != G_IO_STATUS_NORMAL)
+    contents = g_mapped_file_get_contents (mapped);
+    length   = g_mapped_file_get_length (mapped);
+    if (contents == NULL) length = 0;
+
+    // Files that are not valid UTF-8 are displayed as Latin-1 (rather than not at all)
+    converted = NULL;
+    if ( length > 0 && !g_utf8_validate (contents, length, NULL) )
     {
-        g_print("err: Failed to set encoding:\n%s\n%s", filename, (err)->message);
-        return FALSE;
+        converted = g_convert (contents, length, "UTF-8", "ISO-8859-1", NULL, &length, &err);
+        if (!converted)
+        {
+            g_print("err (%s): %s", filename, (err)->message);
+            g_error_free (err);
+            length = 0;
+        }
+        contents = converted;
     }
 
     gtk_source_buffer_begin_not_undoable_action (sBuf);
+    gtk_text_buffer_set_text (GTK_TEXT_BUFFER (sBuf), (length > 0) ? contents : "", length);
+    gtk_source_buffer_end_not_undoable_action (sBuf);
 
-    //gtk_text_buffer_set_text (GTK_TEXT_BUFFER (sBuf), "", 0);
-    buffer = g_malloc (4096);
-    reading = TRUE;
-    while (reading)
-    {
-        gsize bytes_read;
-        GIOStatus status;
+    g_free (converted);
+    #if GLIB_CHECK_VERSION(2,22,0)
+    g_mapped_file_unref (mapped);
+    #else
+    g_mapped_file_free (mapped);
+    #endif
 
-        status = g_io_channel_read_chars (io, buffer, 4096, &bytes_read, &err);
-        switch (status)
-        {
-            case G_IO_STATUS_EOF: reading = FALSE;
+    gtk_text_buffer_set_modified (GTK_TEXT_BUFFER (sBuf), FALSE);
 
-            case G_IO_STATUS_NORMAL:
-                if (bytes_read == 0) continue;
-                gtk_text_buffer_get_end_iter ( GTK_TEXT_BUFFER (sBuf), &iter);
-                gtk_text_buffer_insert (GTK_TEXT_BUFFER(sBuf),&iter,buffer,bytes_read);
-                break;
+    g_object_set_data_full (G_OBJECT (sBuf),"filename", g_strdup (filename),
+                            (GDestroyNotify) g_free);
 
-            case G_IO_STATUS_AGAIN: continue;
+    return TRUE;
+}
 
-            case G_IO_STATUS_ERROR:
 
-            default:
-                g_print("err (%s): %s", filename, (err)->message);
-                /* because of error in input we clear already loaded text */
-                gtk_text_buffer_set_text (GTK_TEXT_BUFFER (sBuf), "", 0);
+/* Return the shared buffer for 'filename', creating or reloading it as needed.
+   Each call must be balanced by a release_buffer() call. */
+static BufferEntry *acquire_buffer(const gchar *filename)
+{
+    BufferEntry *entry;
+    struct stat statstruct;
+    gboolean    have_stat;
+    GtkTextIter iter;
+    GtkSourceLanguageManager *lm;
+    const gchar * const *lang_dirs;
 
-                reading = FALSE;
-                break;
-        }
+    if (bufferCache == NULL)
+    {
+        bufferCache = g_hash_table_new(g_str_hash, g_str_equal);
+        idleBuffers = g_queue_new();
     }
-    g_free (buffer);
 
-    gtk_source_buffer_end_not_undoable_action (sBuf);
-    g_io_channel_unref (io);
+    have_stat = (stat(filename, &statstruct) == 0);
 
-    if (err)
+    entry = g_hash_table_lookup(bufferCache, filename);
+    if (entry == NULL)
     {
-        g_error_free (err);
-        return FALSE;
+        entry = g_malloc(sizeof(BufferEntry));
+        entry->filename = g_strdup(filename);
+        entry->views    = 0;
+
+        // "lang_files_dir" HACK: instead of simply calling gtk_source_languages_manager_new(), we
+        // create the language manager with the "lang_files_dir" property set to $PACKAGE_DATA_DIR/gtksourceview/language-specs.
+        // This enables gtksourceview to find the language spec files when it is not installed at its "normal" path.
+        lang_dirs = gtk_source_language_manager_get_search_path (gtk_source_language_manager_get_default ());
+        lm = gtk_source_language_manager_new();
+        gtk_source_language_manager_set_search_path(lm, (gchar **) lang_dirs);
+
+        /* and a GtkSourceBuffer to hold text (similar to GtkTextBuffer) */
+        entry->buffer = GTK_SOURCE_BUFFER (gtk_source_buffer_new (NULL));
+        g_object_set_data_full ( G_OBJECT (entry->buffer), "languages-manager",
+                                 lm, (GDestroyNotify) g_object_unref);
+
+        // Create a marker to indicate the matched line
+        gtk_text_buffer_get_start_iter (GTK_TEXT_BUFFER (entry->buffer), &iter);
+        gtk_source_buffer_create_source_mark (entry->buffer, "LineMarker", "LMtype", &iter);
+
+        g_hash_table_insert(bufferCache, entry->filename, entry);
+    }
+    else if ( have_stat && entry->mtime == statstruct.st_mtime && entry->size == statstruct.st_size )
+    {
+        // Cached buffer is current
+        if (entry->views++ == 0)
+            g_queue_remove(idleBuffers, entry);
+        return(entry);
     }
 
-    gtk_text_buffer_set_modified (GTK_TEXT_BUFFER (sBuf), FALSE);
+    // (Re)load the file.  A failed load is retried the next time the file is viewed.
+    if ( open_file(entry->buffer, filename) && have_stat )
+    {
+        entry->mtime = statstruct.st_mtime;
+        entry->size  = statstruct.st_size;
+    }
+    else
+    {
+        entry->mtime = 0;
+        entry->size  = -1;
+    }
 
-    g_object_set_data_full (G_OBJECT (sBuf),"filename", g_strdup (filename),
-                            (GDestroyNotify) g_free);
+    if (entry->views++ == 0)
+        g_queue_remove(idleBuffers, entry);     // No-op for a new entry
+    return(entry);
+}
 
-    return TRUE;
+
+
+/* Drop a window's use of a shared buffer.  Unused buffers stay cached (most recently used first) */
+static void release_buffer(BufferEntry *entry)
+{
+    if (entry == NULL || --entry->views > 0)
+        return;
+
+    g_queue_push_head(idleBuffers, entry);
+
+    while (g_queue_get_length(idleBuffers) > BUFFER_CACHE_MAX)
+    {
+        entry = g_queue_pop_tail(idleBuffers);
+        g_hash_table_remove(bufferCache, entry->filename);
+        g_object_unref(entry->buffer);
+        g_free(entry->filename);
+        g_free(entry);
+    }
 }
 
 
+
 void ModifyTextPopUp(GtkTextView *textview, GtkMenu *menu, gpointer user_data)
 {
     GList *list;
@@ -18,6 +18,7 @@ typedef struct _viewWindow
     GtkSourceView *srcViewWidget;
     gchar         *filename;
     gint          line;
+    struct        _bufferEntry *bufEntry;   /* Shared (cached) source buffer displayed by this window */
     struct        _viewWindow *next;
 } ViewWindow;
 
@@ -0,0 +1,51 @@
+/*
+ *  gscope-cli: the headless gscope front-end
+ *
+ *  Links only libgscope-core and GLib, so cross-references can be built, merged and queried
+ *  (and benchmarked) on a system without GTK or an X server.  Accepts the same options as
+ *  gscope; a command line that would open the GUI is an error.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cmdline.h"
+
+
+int main(int argc, char *argv[])
+{
+    GOptionContext  *context;
+    GError          *error = NULL;
+    int             status;
+
+    context = CMDLINE_context();
+
+    if (!g_option_context_parse(context, &argc, &argv, &error))
+    {
+        fprintf(stderr, "\nError: %s\n", error->message);
+
+        if ((error->code == G_OPTION_ERROR_UNKNOWN_OPTION) && (error->domain == G_OPTION_ERROR))
+        {
+            fprintf(stderr, "Type '%s --help' for a list of valid options\n\n", argv[0]);
+        }
+
+        exit(EXIT_FAILURE);
+    }
+    g_option_context_free(context);
+
+    CMDLINE_apply_options();
+
+    status = CMDLINE_run_headless(argc, argv);
+    if (status == CMDLINE_NEEDS_GUI)
+    {
+        fprintf(stderr, "Error: %s has no GUI.  Use -b (--refOnly), -L (--lineMode), --serve or --merge.\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    return(status);
+}
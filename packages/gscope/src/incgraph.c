@@ -0,0 +1,618 @@
+/*
+ *  gscope #include graph index
+ *
+ *  A reverse-indexed view of the #include relationships recorded in the
+ *  cross-reference (INCLUDE '~' marks).  The index is derived from the
+ *  memory-resident cross-reference when the search sub-system is initialized
+ *  and is persisted alongside the cross-reference (<refFile>.inc) so that
+ *  later sessions with an unchanged cross-reference can skip the derivation.
+ *
+ *  Index file format:
+ *
+ *      gscope-incgraph <version> <cref size> <cref mtime> <cref inode>
+ *      <node count> <name count> <edge count>
+ *      <source file name>                      (one line per node, cross-reference order)
+ *      <#include name>                         (one line per unique #include name)
+ *      <from> <to> <name> <offset>             (one line per #include, cross-reference order)
+ *
+ *  <from> and <to> are node indices, <to> is -1 when the #include does not
+ *  resolve to a file in the cross-reference.  <offset> is the cross-reference
+ *  offset of the #include name (used to display the #include source line).
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <regex.h>
+#include <sys/stat.h>
+
+#include "app_config.h"
+#include "build.h"
+#include "scanner.h"
+#include "dir.h"
+#include "utils.h"
+#include "textdict.h"
+#include "blocks.h"
+#include "incgraph.h"
+
+
+//===============================================================
+//       Defines
+//===============================================================
+#define     INCGRAPH_VERSION    1
+#define     UNRESOLVED          G_MAXUINT32
+#define     SEED_TARGET         G_MAXUINT       /* depth marker: a header matched by the query pattern */
+
+/* Edge 'e' #includes a header matched by the query: by name, or resolved to a matched file */
+#define     INCLUDES_TARGET(e)  ( matched[graph.edges[e].name] || \
+                                  (graph.edges[e].to != UNRESOLVED && target[graph.edges[e].to]) )
+
+
+//===============================================================
+//       Local Type Definitions
+//===============================================================
+
+typedef struct
+{
+    guint32     from;       /* node index of the #including file */
+    guint32     to;         /* node index of the #included file (or UNRESOLVED) */
+    guint32     name;       /* index into the #include name table */
+    guint64     offset;     /* cross-reference offset of the #include name */
+} inc_edge_t;
+
+
+struct inc_graph
+{
+    guint       node_count;
+    gchar       **nodes;        /* source file names */
+    guint       name_count;
+    gchar       **names;        /* unique #include names, as written in the source */
+    guint       edge_count;
+    inc_edge_t  *edges;
+    guint       *rev_start;     /* Edges that #include node 'n' are:              */
+    guint       *rev_edges;     /*   rev_edges[ rev_start[n] .. rev_start[n+1]-1 ] */
+};
+
+
+//===============================================================
+//       Private Global Variables
+//===============================================================
+
+static inc_graph_t  graph;          /* The installed graph (searched) */
+static textdict_t   text_dict;      /* Text compression dictionary of the cross-reference */
+
+
+//===============================================================
+//       Local Functions
+//===============================================================
+
+static void     build_from_cref     (inc_graph_t *g, BLOCKS_cref_t *cref_file);
+static void     build_reverse_index (inc_graph_t *g);
+static gboolean load_index          (inc_graph_t *g, const char *filename, struct stat *cref_stat);
+static void     save_index          (const inc_graph_t *g, const char *filename, struct stat *cref_stat);
+static void     free_graph          (inc_graph_t *g);
+static char     *get_name           (char *dest, char *src);
+static gboolean is_header_file      (const char *filename);
+static gboolean read_line           (char *dest, FILE *fp);
+
+
+
+/* Derive the graph from the mapped cross-reference */
+static void build_from_cref(inc_graph_t *g, BLOCKS_cref_t *cref_file)
+{
+    BLOCKS_scan_t   *scan;
+    GHashTable  *node_hash;     /* file name     -> node index + 1 */
+    GHashTable  *name_hash;     /* #include name -> name index + 1 */
+    GPtrArray   *nodes;
+    GPtrArray   *names;
+    GArray      *edges;
+    GByteArray  *local;         /* TRUE for "quoted" #includes, FALSE for <bracketed> */
+    char        name[PATHLEN + 1];
+    char        *read_ptr;
+    char        *resolved;
+    gpointer    value;
+    inc_edge_t  edge;
+    inc_edge_t  *edge_ptr;
+    guint8      is_local;
+    guint       i;
+    guint32     current = UNRESOLVED;
+    gboolean    done = FALSE;
+
+    node_hash = g_hash_table_new(g_str_hash, g_str_equal);
+    name_hash = g_hash_table_new(g_str_hash, g_str_equal);
+    nodes     = g_ptr_array_new();
+    names     = g_ptr_array_new();
+    edges     = g_array_new(FALSE, FALSE, sizeof(inc_edge_t));
+    local     = g_byte_array_new();
+
+    scan = BLOCKS_scan_start(cref_file, &read_ptr);
+    (void) TEXTDICT_load(&text_dict, read_ptr);
+
+    while (*read_ptr++ != '\t');    /* Skip the header, Scan past the first tab char */
+
+    while (!done)
+    {
+        switch (*read_ptr)
+        {
+            case NEWFILE:
+                read_ptr = get_name(name, read_ptr + 1);
+
+                /* Check for end of symbols (the next block starts with a file mark's tab) */
+                if (*name == '\0')
+                {
+                    if ( BLOCKS_scan_next(scan, &read_ptr) )
+                        read_ptr++;
+                    else
+                        done = TRUE;
+                    continue;
+                }
+                current = nodes->len;
+                g_ptr_array_add(nodes, g_strdup(name));
+                g_hash_table_insert(node_hash, g_ptr_array_index(nodes, current), GUINT_TO_POINTER(current + 1));
+            break;
+
+            case INCLUDE:
+                is_local    = (*(read_ptr + 1) == '"');
+                edge.offset = BLOCKS_scan_offset(scan, read_ptr + 2);  /* skip the '~<' or '~"' */
+                read_ptr    = get_name(name, read_ptr + 2);
+
+                if ( (value = g_hash_table_lookup(name_hash, name)) == NULL )
+                {
+                    g_ptr_array_add(names, g_strdup(name));
+                    value = GUINT_TO_POINTER(names->len);
+                    g_hash_table_insert(name_hash, g_ptr_array_index(names, names->len - 1), value);
+                }
+                edge.from = current;
+                edge.to   = UNRESOLVED;
+                edge.name = GPOINTER_TO_UINT(value) - 1;
+                g_array_append_val(edges, edge);
+                g_byte_array_append(local, &is_local, 1);
+            break;
+
+            default:
+                /* do nothing */
+            break;
+        }
+
+        /* Find the next scan token */
+        while (*read_ptr++ != '\t');
+    }
+    BLOCKS_scan_stop(scan);
+
+    /* Now that every file is known, resolve each #include to its node */
+    for (i = 0; i < edges->len; i++)
+    {
+        edge_ptr = &g_array_index(edges, inc_edge_t, i);
+        resolved = DIR_resolve_incfile(g_ptr_array_index(nodes, edge_ptr->from),
+                                       g_ptr_array_index(names, edge_ptr->name),
+                                       local->data[i]);
+
+        if ( resolved && (value = g_hash_table_lookup(node_hash, resolved)) != NULL )
+            edge_ptr->to = GPOINTER_TO_UINT(value) - 1;
+    }
+
+    g->node_count = nodes->len;
+    g->nodes      = (gchar **) g_ptr_array_free(nodes, FALSE);
+    g->name_count = names->len;
+    g->names      = (gchar **) g_ptr_array_free(names, FALSE);
+    g->edge_count = edges->len;
+    g->edges      = (inc_edge_t *) g_array_free(edges, FALSE);
+
+    g_byte_array_free(local, TRUE);
+    g_hash_table_destroy(node_hash);
+    g_hash_table_destroy(name_hash);
+}
+
+
+
+/* Bucket the edges by #included node (counting sort, keeps cross-reference order within a bucket) */
+static void build_reverse_index(inc_graph_t *g)
+{
+    guint   i;
+    guint   *fill;
+
+    g->rev_start = g_malloc0( (g->node_count + 1) * sizeof(guint) );
+    g->rev_edges = g_malloc( (g->edge_count + 1) * sizeof(guint) );
+
+    for (i = 0; i < g->edge_count; i++)
+    {
+        if (g->edges[i].to != UNRESOLVED)
+            g->rev_start[g->edges[i].to + 1]++;
+    }
+
+    for (i = 0; i < g->node_count; i++)
+        g->rev_start[i + 1] += g->rev_start[i];
+
+    fill = g_malloc( (g->node_count + 1) * sizeof(guint) );
+    memcpy(fill, g->rev_start, (g->node_count + 1) * sizeof(guint));
+
+    for (i = 0; i < g->edge_count; i++)
+    {
+        if (g->edges[i].to != UNRESOLVED)
+            g->rev_edges[ fill[g->edges[i].to]++ ] = i;
+    }
+
+    g_free(fill);
+}
+
+
+
+/* Load a persisted index.  Returns FALSE if the index is missing, stale or damaged */
+static gboolean load_index(inc_graph_t *g, const char *filename, struct stat *cref_stat)
+{
+    FILE        *index_file;
+    char        line[PATHLEN + 1];
+    guint       version;
+    guint64     size, mtime, inode;
+    guint       i;
+    gint        to;
+    gboolean    ok = FALSE;
+
+    if ( (index_file = fopen(filename, "r")) == NULL )
+        return(FALSE);
+
+    if ( !read_line(line, index_file) ||
+         sscanf(line, "gscope-incgraph %u %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT,
+                &version, &size, &mtime, &inode) != 4 ||
+         version != INCGRAPH_VERSION                ||
+         size    != (guint64) cref_stat->st_size    ||
+         mtime   != (guint64) cref_stat->st_mtime   ||
+         inode   != (guint64) cref_stat->st_ino )
+    {
+        fclose(index_file);
+        return(FALSE);     /* The index does not describe this cross-reference */
+    }
+
+    if ( !read_line(line, index_file) ||
+         sscanf(line, "%u %u %u", &g->node_count, &g->name_count, &g->edge_count) != 3 )
+    {
+        fclose(index_file);
+        return(FALSE);
+    }
+
+    g->nodes = g_malloc0( (g->node_count + 1) * sizeof(gchar *) );
+    g->names = g_malloc0( (g->name_count + 1) * sizeof(gchar *) );
+    g->edges = g_malloc( (g->edge_count + 1) * sizeof(inc_edge_t) );
+
+    for (i = 0; i < g->node_count; i++)
+    {
+        if ( !read_line(line, index_file) ) goto done;
+        g->nodes[i] = g_strdup(line);
+    }
+
+    for (i = 0; i < g->name_count; i++)
+    {
+        if ( !read_line(line, index_file) ) goto done;
+        g->names[i] = g_strdup(line);
+    }
+
+    for (i = 0; i < g->edge_count; i++)
+    {
+        if ( !read_line(line, index_file) ||
+             sscanf(line, "%u %d %u %" G_GUINT64_FORMAT,
+                    &g->edges[i].from, &to, &g->edges[i].name, &g->edges[i].offset) != 4 )
+            goto done;
+
+        g->edges[i].to = (to < 0) ? UNRESOLVED : (guint32) to;
+
+        if ( g->edges[i].from >= g->node_count || g->edges[i].name >= g->name_count ||
+             (g->edges[i].to != UNRESOLVED && g->edges[i].to >= g->node_count) ||
+             g->edges[i].offset >= (guint64) cref_stat->st_size )
+            goto done;
+    }
+    ok = TRUE;
+
+done:
+    fclose(index_file);
+    if (!ok)
+    {
+        fprintf(stderr, "Warning: Ignoring damaged #include graph index: %s\n", filename);
+        free_graph(g);
+    }
+    return(ok);
+}
+
+
+
+/* Persist the index.  Failure is not fatal, the index is re-derived by the next session */
+static void save_index(const inc_graph_t *g, const char *filename, struct stat *cref_stat)
+{
+    FILE    *index_file;
+    guint   i;
+
+    if ( (index_file = fopen(filename, "w")) == NULL )
+    {
+        fprintf(stderr, "Warning: Unable to save #include graph index: %s\n", filename);
+        return;
+    }
+
+    fprintf(index_file, "gscope-incgraph %d %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT "\n",
+            INCGRAPH_VERSION,
+            (guint64) cref_stat->st_size,
+            (guint64) cref_stat->st_mtime,
+            (guint64) cref_stat->st_ino);
+    fprintf(index_file, "%u %u %u\n", g->node_count, g->name_count, g->edge_count);
+
+    for (i = 0; i < g->node_count; i++)
+        fprintf(index_file, "%s\n", g->nodes[i]);
+
+    for (i = 0; i < g->name_count; i++)
+        fprintf(index_file, "%s\n", g->names[i]);
+
+    for (i = 0; i < g->edge_count; i++)
+        fprintf(index_file, "%u %d %u %" G_GUINT64_FORMAT "\n",
+                g->edges[i].from,
+                g->edges[i].to == UNRESOLVED ? -1 : (gint) g->edges[i].to,
+                g->edges[i].name,
+                g->edges[i].offset);
+
+    if ( fclose(index_file) != 0 )
+    {
+        fprintf(stderr, "Warning: Unable to save #include graph index: %s\n", filename);
+        unlink(filename);
+    }
+}
+
+
+
+static void free_graph(inc_graph_t *g)
+{
+    guint i;
+
+    if (g->nodes)
+    {
+        for (i = 0; i < g->node_count; i++)
+            g_free(g->nodes[i]);
+    }
+
+    if (g->names)
+    {
+        for (i = 0; i < g->name_count; i++)
+            g_free(g->names[i]);
+    }
+
+    g_free(g->nodes);
+    g_free(g->names);
+    g_free(g->edges);
+    g_free(g->rev_start);
+    g_free(g->rev_edges);
+
+    memset(g, 0, sizeof(*g));
+}
+
+
+
+/* Extract a (decompressed) name from the cross-reference.  Returns a pointer to the terminating newline */
+static char *get_name(char *dest, char *src)
+{
+    uint8_t     byte;
+    char        *end = dest + PATHLEN - 1;
+    guint       length;
+
+    while ( (byte = (unsigned) (*src)) != '\n' )
+    {
+        if (dest < end)
+        {
+            if (byte > 0x7f)
+            {
+                length = MIN(TEXTDICT_LENGTH(&text_dict, byte), end - dest);
+                memcpy(dest, TEXTDICT_TEXT(&text_dict, byte), length);
+                dest  += length;
+            }
+            else
+            {
+                *dest++ = byte;
+            }
+        }
+        src++;
+    }
+    *dest = '\0';
+
+    return(src);
+}
+
+
+
+static gboolean is_header_file(const char *filename)
+{
+    char *ptr;
+
+    ptr = strrchr(filename, (int) '.');
+
+    if (ptr == NULL) return(FALSE);
+    ptr++;
+
+    return( STREQUAL(ptr, "h")   || STREQUAL(ptr, "hpp") || STREQUAL(ptr, "hh") ||
+            STREQUAL(ptr, "hxx") || STREQUAL(ptr, "inc") || STREQUAL(ptr, "inl") );
+}
+
+
+
+static gboolean read_line(char *dest, FILE *fp)
+{
+    char *nl;
+
+    if ( fgets(dest, PATHLEN + 1, fp) == NULL )
+        return(FALSE);
+
+    if ( (nl = strchr(dest, '\n')) == NULL )
+        return(FALSE);      /* Line too long (or truncated file) */
+
+    *nl = '\0';
+    return(TRUE);
+}
+
+
+
+//===============================================================
+//       Public Functions
+//===============================================================
+
+/* Load (or derive and persist) the #include graph of a loaded cross-reference.  Touches no
+   search state (a build thread loads the next graph while lookups use the installed one).
+   Must be called while the source-file name hash is still available (see DIR_resolve_incfile) */
+inc_graph_t *INCGRAPH_load(BLOCKS_cref_t *cref_file, struct stat *cref_stat)
+{
+    inc_graph_t *g;
+    gchar       *index_file;
+
+    g = g_malloc0(sizeof(inc_graph_t));
+
+    my_asprintf(&index_file, "%s%s", settings.refFile, INCGRAPH_SUFFIX);
+
+    if ( !load_index(g, index_file, cref_stat) )
+    {
+        build_from_cref(g, cref_file);
+        save_index(g, index_file, cref_stat);
+    }
+    g_free(index_file);
+
+    build_reverse_index(g);
+    return(g);
+}
+
+
+
+/* Make a loaded graph the one searched, freeing the previous one (main thread, between lookups) */
+void INCGRAPH_install(inc_graph_t *g)
+{
+    free_graph(&graph);
+    graph = *g;
+    g_free(g);
+}
+
+
+
+void INCGRAPH_free()
+{
+    free_graph(&graph);
+}
+
+
+
+/*
+ * Find the files that #include a file whose #include name matches 'regex_ptr'.
+ *
+ * A matching #include that resolves to a file in the cross-reference selects that file, and
+ * every #include of a selected file counts as a match, whatever its spelling ("../inc/foo.h",
+ * <sys/foo.h> or "foo.h").
+ *
+ * Direct mode reports every matching #include line (depth 1), in cross-reference order.
+ *
+ * Transitive mode walks the reverse #include edges breadth-first and reports each
+ * file that reaches a matching header exactly once, at its shortest #include depth.
+ * The reported offset identifies the #include line that links the file into the chain.
+ *
+ * When 'src_only' is set, headers are traversed but not reported.
+ *
+ * Returns the number of files reported.
+ */
+guint INCGRAPH_find_includers(const regex_t *regex_ptr, gboolean transitive, gboolean src_only,
+                              incgraph_report_t report, gpointer user_data)
+{
+    gboolean    *matched;
+    gboolean    *target;    /* nodes selected by a matching #include */
+    guint       *depth;
+    guint       *via;       /* edge that linked each node into the chain */
+    guint       *queue;
+    guint       head, tail;
+    guint       node, next;
+    guint       i, r;
+    guint       found = 0;
+
+    if (graph.edge_count == 0) return(0);
+
+    /* Match each unique #include name once, rather than once per #include line */
+    matched = g_malloc0(graph.name_count * sizeof(gboolean));
+    for (i = 0; i < graph.name_count; i++)
+        matched[i] = (regexec(regex_ptr, graph.names[i], (size_t) 0, NULL, 0) == 0);
+
+    /* Resolve the matching names to the files they #include */
+    target = g_malloc0((graph.node_count + 1) * sizeof(gboolean));
+    for (i = 0; i < graph.edge_count; i++)
+    {
+        if ( matched[graph.edges[i].name] && graph.edges[i].to != UNRESOLVED )
+            target[graph.edges[i].to] = TRUE;
+    }
+
+    if ( !transitive )
+    {
+        for (i = 0; i < graph.edge_count; i++)
+        {
+            if ( !INCLUDES_TARGET(i) ) continue;
+            if ( src_only && is_header_file(graph.nodes[graph.edges[i].from]) ) continue;
+
+            found++;
+            if ( !report(graph.nodes[graph.edges[i].from], 1, graph.edges[i].offset, user_data) )
+                break;
+        }
+        g_free(target);
+        g_free(matched);
+        return(found);
+    }
+
+    depth = g_malloc0(graph.node_count * sizeof(guint));
+    via   = g_malloc(graph.node_count * sizeof(guint));
+    queue = g_malloc(graph.node_count * sizeof(guint));
+    head  = tail = 0;
+
+    /* The matched headers themselves are never reported (guards against #include cycles) */
+    for (node = 0; node < graph.node_count; node++)
+    {
+        if ( target[node] )
+            depth[node] = SEED_TARGET;
+    }
+
+    /* Depth 1: the direct includers, in cross-reference order */
+    for (i = 0; i < graph.edge_count; i++)
+    {
+        node = graph.edges[i].from;
+        if ( INCLUDES_TARGET(i) && depth[node] == 0 )
+        {
+            depth[node]   = 1;
+            via[node]     = i;
+            queue[tail++] = node;
+        }
+    }
+
+    while (head < tail)
+    {
+        node = queue[head++];
+
+        for (r = graph.rev_start[node]; r < graph.rev_start[node + 1]; r++)
+        {
+            next = graph.edges[ graph.rev_edges[r] ].from;
+            if (depth[next] == 0)
+            {
+                depth[next]   = depth[node] + 1;
+                via[next]     = graph.rev_edges[r];
+                queue[tail++] = next;
+            }
+        }
+    }
+
+    /* The queue is in breadth-first (depth) order */
+    for (i = 0; i < tail; i++)
+    {
+        node = queue[i];
+        if ( src_only && is_header_file(graph.nodes[node]) ) continue;
+
+        found++;
+        if ( !report(graph.nodes[node], depth[node], graph.edges[ via[node] ].offset, user_data) )
+            break;
+    }
+
+    g_free(queue);
+    g_free(via);
+    g_free(depth);
+    g_free(target);
+    g_free(matched);
+    return(found);
+}
@@ -0,0 +1,23 @@
+
+#include <regex.h>
+#include <sys/stat.h>
+
+#define INCGRAPH_SUFFIX     ".inc"      /* Index file name: <refFile>.inc */
+
+
+typedef struct inc_graph inc_graph_t;    /* A loaded #include graph */
+
+
+/* Query result callback.  Return FALSE to stop the query (e.g. user cancel) */
+typedef gboolean (*incgraph_report_t)(const gchar *file, guint depth, guint64 offset, gpointer user_data);
+
+
+//===============================================================
+//      Public Interface Functions
+//===============================================================
+
+inc_graph_t *INCGRAPH_load      (BLOCKS_cref_t *cref_file, struct stat *cref_stat);
+void    INCGRAPH_install        (inc_graph_t *g);
+void    INCGRAPH_free           (void);
+guint   INCGRAPH_find_includers (const regex_t *regex_ptr, gboolean transitive, gboolean src_only,
+                                 incgraph_report_t report, gpointer user_data);
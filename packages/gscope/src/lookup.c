@@ -8,7 +8,7 @@
 #endif
 
 #include <sys/types.h>
-#include <gtk/gtk.h>
+#include <glib.h>
 #include <string.h>
 #include "lookup.h"
 #include "utils.h"
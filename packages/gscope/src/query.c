@@ -0,0 +1,296 @@
+/*
+ *  gscope line-oriented query mode
+ *
+ *  Answers cross-reference queries on stdout without the GUI, for scripts, editors
+ *  and benchmarks.  Queries go through SEARCH_lookup(), exactly as they do from the
+ *  GUI, so results are identical.  Batch mode loads the cross-reference once and
+ *  answers every query read from stdin against it.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "search.h"
+#include "build.h"
+#include "app_config.h"
+#include "query.h"
+
+
+//===============================================================
+//      Private Function Prototypes
+//===============================================================
+
+static gboolean select_query(const gchar *option_name, const gchar *value, gpointer data, GError **error);
+static gboolean select_line_mode(const gchar *option_name, const gchar *value, gpointer data, GError **error);
+static void     build_database(void);
+static void     load_database(void);
+static void     set_options(const gchar *options);
+static void     put_results(FILE *output, search_results_t *results);
+
+
+
+//===============================================================
+//      Private Globals
+//===============================================================
+
+static gboolean line_mode = FALSE;
+static search_t query_type = FIND_NULL;
+static gchar    *query_pattern = NULL;
+static gboolean transitive_includes = FALSE;
+static gboolean includers_src_only = FALSE;
+
+
+#define NO_FLAGS    0
+
+/* The query options are numbered by search_t value */
+GOptionEntry QUERY_options[] = {
+    {
+        "lineMode", 'L', G_OPTION_FLAG_NO_ARG, G_OPTION_ARG_CALLBACK, select_line_mode,
+        "Line-oriented output, no GUI.  Do the single query given by -0 .. -8, or read queries from stdin (\"<n><pattern>\" per line).", NULL
+    },
+    { "symbol",       '0', NO_FLAGS, G_OPTION_ARG_CALLBACK, select_query, "Line mode: Find this C symbol",                         "PATTERN" },
+    { "definition",   '1', NO_FLAGS, G_OPTION_ARG_CALLBACK, select_query, "Line mode: Find this global definition",                "PATTERN" },
+    { "calledBy",     '2', NO_FLAGS, G_OPTION_ARG_CALLBACK, select_query, "Line mode: Find functions called by this function",     "PATTERN" },
+    { "calling",      '3', NO_FLAGS, G_OPTION_ARG_CALLBACK, select_query, "Line mode: Find functions calling this function",       "PATTERN" },
+    { "string",       '4', NO_FLAGS, G_OPTION_ARG_CALLBACK, select_query, "Line mode: Find this text string",                      "PATTERN" },
+    { "regexp",       '5', NO_FLAGS, G_OPTION_ARG_CALLBACK, select_query, "Line mode: Find this regular expression",               "PATTERN" },
+    { "file",         '6', NO_FLAGS, G_OPTION_ARG_CALLBACK, select_query, "Line mode: Find this file",                             "PATTERN" },
+    { "including",    '7', NO_FLAGS, G_OPTION_ARG_CALLBACK, select_query, "Line mode: Find files #including this file",           "PATTERN" },
+    { "allFunctions", '8', G_OPTION_FLAG_OPTIONAL_ARG, G_OPTION_ARG_CALLBACK, select_query, "Line mode: List all function definitions", NULL },
+    { "transitive",   0,   NO_FLAGS, G_OPTION_ARG_NONE, &transitive_includes, "Line mode: -7 also finds the files that #include the file indirectly (rc file: transitiveIncludes)", NULL },
+    { "srcOnly",      0,   NO_FLAGS, G_OPTION_ARG_NONE, &includers_src_only,  "Line mode: -7 reports only source files, not #included headers (rc file: includersSrcOnly)",    NULL },
+    { NULL }
+};
+
+
+
+//===============================================================
+//      Private Functions
+//===============================================================
+
+static gboolean select_line_mode(const gchar *option_name, const gchar *value, gpointer data, GError **error)
+{
+    line_mode = TRUE;
+    return(TRUE);
+}
+
+
+static gboolean select_query(const gchar *option_name, const gchar *value, gpointer data, GError **error)
+{
+    guint i;
+
+    /* option_name is "-<n>" or "--<long name>" */
+    for (i = 1; QUERY_options[i].arg_data == (gpointer) select_query; i++)
+    {
+        if ( (option_name[1] == QUERY_options[i].short_name && option_name[2] == '\0') ||
+             (option_name[1] == '-' && strcmp(option_name + 2, QUERY_options[i].long_name) == 0) )
+            break;
+    }
+
+    if (QUERY_options[i].arg_data != (gpointer) select_query)     // Can't happen: GOption only calls us for our own options
+    {
+        g_set_error(error, G_OPTION_ERROR, G_OPTION_ERROR_FAILED, "Unknown query option %s", option_name);
+        return(FALSE);
+    }
+
+    if (query_type != FIND_NULL)
+    {
+        g_set_error(error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE, "Only one query option (-0 .. -8) may be given");
+        return(FALSE);
+    }
+
+    query_type = (search_t) (i - 1);
+    query_pattern = g_strdup(value ? value : "");
+    line_mode = TRUE;
+
+    return(TRUE);
+}
+
+
+/* Load the configuration and build (or update) the cross-reference.  Stdout is reserved
+   for query results, so any configuration or build reporting is sent to stderr. */
+static void build_database(void)
+{
+    APP_CONFIG_init(NULL);
+    if (transitive_includes) settings.transitiveIncludes = TRUE;
+    if (includers_src_only)  settings.includersSrcOnly   = TRUE;
+    load_database();
+}
+
+
+/* Apply a batch "=<options>" line (see query.h) */
+static void set_options(const gchar *options)
+{
+    settings.ignoreCase         = strchr(options, 'i') != NULL;
+    settings.transitiveIncludes = strchr(options, 't') != NULL;
+    settings.includersSrcOnly   = strchr(options, 's') != NULL;
+}
+
+
+/* Build (or load) the cross-reference: build reporting goes to stderr, stdout carries only answers */
+static void load_database(void)
+{
+    int saved_stdout;
+
+    fflush(stdout);
+    saved_stdout = dup(STDOUT_FILENO);
+    if (saved_stdout < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0)
+    {
+        fprintf(stderr, "Error: Unable to redirect build output: %s\n", g_strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    BUILD_initDatabase();
+
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+}
+
+
+/* Write the results buffer in line format: the results use '|' between the file name and function */
+static void put_results(FILE *output, search_results_t *results)
+{
+    gchar *line;
+    gchar *eol;
+    gchar *sep;
+
+    for (line = results->start_ptr; line < results->end_ptr; line = eol + 1)
+    {
+        eol = memchr(line, '\n', results->end_ptr - line);
+        if (eol == NULL)
+            eol = results->end_ptr - 1;
+
+        sep = memchr(line, '|', eol - line);
+        if (sep)
+        {
+            fwrite(line, 1, sep - line, output);
+            putc(' ', output);
+            fwrite(sep + 1, 1, eol - sep, output);
+        }
+        else
+            fwrite(line, 1, eol - line + 1, output);
+    }
+}
+
+
+
+//===============================================================
+//      Public Interface Functions
+//===============================================================
+
+/* TRUE if the command line asked for line-oriented query mode */
+gboolean QUERY_requested(void)
+{
+    return(line_mode);
+}
+
+
+/* Run line-oriented query mode, returns the process exit status */
+int QUERY_main(void)
+{
+    build_database();
+
+    if (query_type != FIND_NULL)
+        QUERY_lookup(stdout, query_type, query_pattern);
+    else
+        QUERY_batch(stdin, stdout);
+
+    fflush(stdout);
+    SEARCH_cleanup();
+    g_free(query_pattern);
+
+    return(EXIT_SUCCESS);
+}
+
+
+/* Answer one query, returns the number of result lines written */
+guint QUERY_lookup(FILE *output, search_t type, gchar *pattern)
+{
+    search_results_t *results;
+    guint            count = 0;
+
+    results = SEARCH_lookup(type, pattern);
+    if (results)
+    {
+        put_results(output, results);
+        count = results->match_count;
+        SEARCH_free_results(results);
+    }
+    return(count);
+}
+
+
+/* Answer one "<n><pattern>" request: a "gscope: <count> lines" header followed by the results.
+   Returns FALSE if the request is invalid (an empty answer is still written). */
+gboolean QUERY_answer(FILE *output, gchar *request)
+{
+    search_results_t *results;
+
+    if (request[0] < '0' || request[0] >= '0' + FIND_NULL)
+    {
+        fprintf(stderr, "Error: Invalid query type '%c' (expected 0 .. %d): %s\n", request[0], FIND_NULL - 1, request);
+        fprintf(output, "gscope: 0 lines\n");
+        return(FALSE);
+    }
+
+    results = SEARCH_lookup((search_t) (request[0] - '0'), request + 1);
+    if (results)
+    {
+        fprintf(output, "gscope: %u lines\n", results->match_count);
+        put_results(output, results);
+        SEARCH_free_results(results);
+    }
+    else
+        fprintf(output, "gscope: 0 lines\n");
+
+    return(TRUE);
+}
+
+
+/* Answer "<n><pattern>" queries (and apply "=<options>" lines) until end of input, returns the number of queries answered */
+guint QUERY_batch(FILE *input, FILE *output)
+{
+    char    *line = NULL;
+    size_t  size = 0;
+    ssize_t length;
+    guint   queries = 0;
+
+    while ( (length = getline(&line, &size, input)) >= 0 )
+    {
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+            line[--length] = '\0';
+
+        if (length == 0)
+            continue;
+
+        if (line[0] == QUERY_OPTIONS_MARK)
+        {
+            set_options(line + 1);
+            continue;
+        }
+
+        /* Answer from the current cross-reference: a rebuild replaces the file (see SEARCH_cref_replaced) */
+        if ( SEARCH_cref_replaced() )
+        {
+            fprintf(stderr, "gscope: Cross-reference %s has changed, reloading\n", settings.refFile);
+            settings.noBuild = TRUE;    /* Load the new file as-is, never rebuild it here */
+            load_database();
+        }
+
+        queries++;
+        QUERY_answer(output, line);
+        fflush(output);     // The caller may be waiting for this answer before sending the next query
+    }
+
+    free(line);
+    return(queries);
+}
@@ -0,0 +1,37 @@
+
+/* Line-oriented query mode:
+ *
+ *   gscope -L -<n> pattern     Answer one query and exit
+ *   gscope -L                  Answer queries read from stdin ("<n><pattern>" per line)
+ *
+ *   gscope -L --transitive --srcOnly -7 pattern
+ *                              Find files #including: indirect includers too (with their
+ *                              #include depth), source files only
+ *
+ * <n> is the search_t query type.  Each result is written as one line:
+ *
+ *   <file> <function> <line number> <source text>
+ *
+ * In batch mode every answer is preceded by a "gscope: <count> lines" header so a
+ * script can match answers to queries.  A cross-reference that is replaced (rebuilt)
+ * meanwhile is reloaded before the next query is answered.
+ *
+ * A batch line "=<options>" (not answered) sets the search options of the following
+ * queries, overriding the rc file and command line: 'i' ignore case, 't' transitive
+ * includers, 's' source file includers only.  A bare "=" turns all three off.
+ */
+
+#define QUERY_OPTIONS_MARK  '='         /* Batch line: search options, see above */
+
+extern GOptionEntry QUERY_options[];    /* Command line options: -L, -0 .. -8, --transitive, --srcOnly */
+
+
+//===============================================================
+//      Public Interface Functions
+//===============================================================
+
+gboolean    QUERY_requested (void);
+int         QUERY_main      (void);
+guint       QUERY_lookup    (FILE *output, search_t type, gchar *pattern);
+gboolean    QUERY_answer    (FILE *output, gchar *request);
+guint       QUERY_batch     (FILE *input, FILE *output);
@@ -0,0 +1,315 @@
+/*
+ *  gscope per-file build cost report
+ *
+ *  When a build suddenly gets slower, this report shows which sources are responsible:
+ *  the slowest and largest files parsed, and how parse time and file size are
+ *  distributed.  Pathological (typically generated) files found this way can then be
+ *  moved to the ignore list or suffix list.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include "crossref.h"
+#include "utils.h"
+#include "report.h"
+
+
+//===============================================================
+//      Defines
+//===============================================================
+
+typedef struct
+{
+    gchar           *file;      /* Copy: the build's source file list is compacted before the report is written */
+    crossref_cost_t cost;
+} file_cost_t;
+
+
+typedef struct
+{
+    const char  *label;
+    guint64     limit;          /* Upper bound (exclusive) of the bucket */
+} bucket_t;
+
+static const bucket_t time_buckets[] = {        /* microseconds */
+    { "< 100 us",    100 },
+    { "< 300 us",    300 },
+    { "< 1 ms",     1000 },
+    { "< 3 ms",     3000 },
+    { "< 10 ms",   10000 },
+    { "< 30 ms",   30000 },
+    { "< 100 ms", 100000 },
+    { "< 300 ms", 300000 },
+    { "< 1 s",   1000000 },
+    { ">= 1 s",  G_MAXUINT64 },
+};
+
+static const bucket_t size_buckets[] = {        /* bytes */
+    { "< 1 KB",       1024 },
+    { "< 4 KB",   4 * 1024 },
+    { "< 16 KB", 16 * 1024 },
+    { "< 64 KB", 64 * 1024 },
+    { "< 256 KB", 256 * 1024 },
+    { "< 1 MB",  1024 * 1024 },
+    { "< 4 MB",  4 * 1024 * 1024 },
+    { ">= 4 MB", G_MAXUINT64 },
+};
+
+#define MAX_BUCKETS             10      /* Largest bucket table */
+#define HISTOGRAM_BAR_WIDTH     40
+
+
+
+//===============================================================
+//      Private Function Prototypes
+//===============================================================
+
+static int  compare_time(const void *a, const void *b);
+static int  compare_size(const void *a, const void *b);
+static void put_top(FILE *output, const char *title, file_cost_t *entries, guint count);
+static void put_histogram(FILE *output, const char *title, const bucket_t *buckets, guint nbuckets, gboolean by_time);
+
+
+
+//===============================================================
+//      Private Globals
+//===============================================================
+
+static gchar    *report_file = NULL;
+static GArray   *costs = NULL;          /* file_cost_t for every file parsed by the current build */
+static guint    reused_count = 0;       /* Files copied from the old cross-reference */
+
+
+GOptionEntry REPORT_options[] = {
+    {
+        "build-report", 0, 0, G_OPTION_ARG_FILENAME, &report_file,
+        "Write a per-file build cost report (slowest and largest files) to FILE.", "FILE"
+    },
+    { NULL }
+};
+
+
+
+//===============================================================
+//      Private Functions
+//===============================================================
+
+/* qsort: slowest first */
+static int compare_time(const void *a, const void *b)
+{
+    guint64 ta = ((const file_cost_t *) a)->cost.usec;
+    guint64 tb = ((const file_cost_t *) b)->cost.usec;
+
+    return( (ta < tb) - (ta > tb) );
+}
+
+
+/* qsort: largest first */
+static int compare_size(const void *a, const void *b)
+{
+    guint64 sa = ((const file_cost_t *) a)->cost.bytes;
+    guint64 sb = ((const file_cost_t *) b)->cost.bytes;
+
+    return( (sa < sb) - (sa > sb) );
+}
+
+
+static void put_top(FILE *output, const char *title, file_cost_t *entries, guint count)
+{
+    guint i;
+
+    fprintf(output, "%s\n\n", title);
+    fprintf(output, "  %10s  %10s  %8s  %8s  %8s  %s\n", "ms", "bytes", "lines", "symbols", "us/KB", "file");
+
+    for (i = 0; i < count && i < REPORT_TOP_N; i++)
+    {
+        fprintf(output, "  %10.3f  %10" G_GUINT64_FORMAT "  %8u  %8u  %8.1f  %s\n",
+                entries[i].cost.usec / 1000.0,
+                entries[i].cost.bytes,
+                entries[i].cost.lines,
+                entries[i].cost.symbols,
+                entries[i].cost.bytes ? entries[i].cost.usec * 1024.0 / entries[i].cost.bytes : 0.0,
+                entries[i].file);
+    }
+    fprintf(output, "\n\n");
+}
+
+
+static void put_histogram(FILE *output, const char *title, const bucket_t *buckets, guint nbuckets, gboolean by_time)
+{
+    guint   files[MAX_BUCKETS];
+    guint64 usec[MAX_BUCKETS];
+    guint64 total_usec = 0;
+    guint   max_files = 0;
+    guint   i, b;
+    char    bar[HISTOGRAM_BAR_WIDTH + 1];
+
+    memset(files, 0, sizeof(files));
+    memset(usec,  0, sizeof(usec));
+
+    for (i = 0; i < costs->len; i++)
+    {
+        file_cost_t *entry = &g_array_index(costs, file_cost_t, i);
+        guint64     value  = by_time ? entry->cost.usec : entry->cost.bytes;
+
+        for (b = 0; value >= buckets[b].limit; b++)
+            ;
+        files[b]++;
+        usec[b] += entry->cost.usec;
+        total_usec += entry->cost.usec;
+    }
+
+    for (b = 0; b < nbuckets; b++)
+        max_files = MAX(max_files, files[b]);
+
+    fprintf(output, "%s\n\n", title);
+    fprintf(output, "  %-10s  %8s  %6s  %10s  %6s\n", "", "files", "%", "ms", "% time");
+
+    for (b = 0; b < nbuckets; b++)
+    {
+        guint width = max_files ? (guint) ((guint64) files[b] * HISTOGRAM_BAR_WIDTH / max_files) : 0;
+
+        memset(bar, '#', width);
+        bar[width] = '\0';
+
+        fprintf(output, "  %-10s  %8u  %6.2f  %10.1f  %6.2f  %s\n",
+                buckets[b].label,
+                files[b],
+                costs->len ? files[b] * 100.0 / costs->len : 0.0,
+                usec[b] / 1000.0,
+                total_usec ? usec[b] * 100.0 / total_usec : 0.0,
+                bar);
+    }
+    fprintf(output, "\n\n");
+}
+
+
+
+//===============================================================
+//      Public Interface Functions
+//===============================================================
+
+/* Start recording a new build */
+void REPORT_reset(void)
+{
+    guint i;
+
+    if (costs)
+    {
+        for (i = 0; i < costs->len; i++)
+            g_free(g_array_index(costs, file_cost_t, i).file);
+        g_array_set_size(costs, 0);
+    }
+    reused_count = 0;
+}
+
+
+/* Record the cost of one file parsed by crossref() */
+void REPORT_add(const gchar *file, const crossref_cost_t *cost)
+{
+    file_cost_t entry;
+
+    if (report_file == NULL)
+        return;
+
+    if (costs == NULL)
+        costs = g_array_new(FALSE, FALSE, sizeof(file_cost_t));
+
+    entry.file = g_strdup(file);
+    entry.cost = *cost;
+    g_array_append_val(costs, entry);
+}
+
+
+/* Count one file section re-used from the old cross-reference */
+void REPORT_reused(void)
+{
+    reused_count++;
+}
+
+
+/* Write the report file and append a short summary (for the build statistics) to summary */
+void REPORT_write(gchar *summary, gsize summary_size)
+{
+    FILE        *output;
+    file_cost_t *entries;
+    file_cost_t *by_size;
+    guint       count;
+    guint       i;
+    guint64     total_bytes = 0;
+    guint64     total_usec = 0;
+    guint64     total_lines = 0;
+    guint64     total_symbols = 0;
+    time_t      now;
+    gchar       *msg;
+
+    if (report_file == NULL)
+        return;
+
+    if ( (output = fopen(report_file, "w")) == NULL )
+    {
+        fprintf(stderr, "Warning: Unable to create build report %s: %s\n", report_file, strerror(errno));
+        return;
+    }
+
+    if (costs == NULL)
+        costs = g_array_new(FALSE, FALSE, sizeof(file_cost_t));
+
+    count   = costs->len;
+    entries = (file_cost_t *) costs->data;
+
+    for (i = 0; i < count; i++)
+    {
+        total_bytes   += entries[i].cost.bytes;
+        total_usec    += entries[i].cost.usec;
+        total_lines   += entries[i].cost.lines;
+        total_symbols += entries[i].cost.symbols;
+    }
+
+    now = time(NULL);
+    fprintf(output, "Gscope build report: %s", ctime(&now));
+    fprintf(output, "\n");
+    fprintf(output, "Files parsed:      %u\n", count);
+    fprintf(output, "Files re-used:     %u\n", reused_count);
+    fprintf(output, "Source bytes:      %" G_GUINT64_FORMAT "\n", total_bytes);
+    fprintf(output, "Source lines:      %" G_GUINT64_FORMAT "\n", total_lines);
+    fprintf(output, "Symbols written:   %" G_GUINT64_FORMAT "\n", total_symbols);
+    fprintf(output, "Parse time:        %.3f seconds\n", total_usec / 1e6);
+    fprintf(output, "\n\n");
+
+    /* The size ranking needs its own copy: the time ranking sorts in place */
+    by_size = g_malloc(count * sizeof(file_cost_t) + 1);
+    memcpy(by_size, entries, count * sizeof(file_cost_t));
+    qsort(entries, count, sizeof(file_cost_t), compare_time);
+    qsort(by_size, count, sizeof(file_cost_t), compare_size);
+
+    put_top(output, "Slowest files", entries, count);
+    put_top(output, "Largest files", by_size, count);
+    put_histogram(output, "Parse time histogram", time_buckets, G_N_ELEMENTS(time_buckets), TRUE);
+    put_histogram(output, "File size histogram",  size_buckets, G_N_ELEMENTS(size_buckets), FALSE);
+
+    g_free(by_size);
+
+    if (fclose(output) != 0)
+        fprintf(stderr, "Warning: Write error on build report %s\n", report_file);
+
+    /* Summary: the slowest file and its share of the parse time */
+    if (count > 0)
+        my_asprintf(&msg, "\nSlowest file: %s (%.1f ms, %.1f%% of parse time)\nBuild report: %s",
+                    entries[0].file, entries[0].cost.usec / 1000.0,
+                    total_usec ? entries[0].cost.usec * 100.0 / total_usec : 0.0, report_file);
+    else
+        my_asprintf(&msg, "\nBuild report: %s", report_file);
+
+    g_strlcat(summary, msg, summary_size);
+    g_free(msg);
+}
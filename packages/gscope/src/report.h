@@ -0,0 +1,24 @@
+
+/* Per-file build cost report:
+ *
+ *   gscope --build-report FILE ...
+ *
+ * Records the cost of every file parsed by crossref() during a build and writes a report
+ * of the slowest and largest files plus time and size histograms to FILE.  A one-line
+ * summary is added to the build statistics.  Files re-used from an old cross-reference
+ * (incremental build) cost nothing to parse and are counted but not ranked.
+ */
+
+#define REPORT_TOP_N    20          /* Entries in each "top" table */
+
+extern GOptionEntry REPORT_options[];   /* Command line options: --build-report */
+
+
+//===============================================================
+//      Public Interface Functions
+//===============================================================
+
+void        REPORT_reset    (void);
+void        REPORT_add      (const gchar *file, const crossref_cost_t *cost);
+void        REPORT_reused   (void);
+void        REPORT_write    (gchar *summary, gsize summary_size);
@@ -0,0 +1,734 @@
+/*
+ *  gscope search results tree model
+ *
+ *  A list-only GtkTreeModel that is backed directly by the search results
+ *  buffer returned by SEARCH_lookup().  Each result line has the format:
+ *
+ *      <file name>|<function name> <line number> <source text>\n
+ *
+ *  Rather than copying every field of every result into a GtkListStore, the
+ *  model indexes each line once (16 bytes per row) and produces the cell
+ *  values on demand, as the tree view asks for the rows it actually draws.
+ *  File names are interned (results are grouped by file, so most rows share
+ *  a name with the previous row) and line numbers are stored as integers, so
+ *  the LINE column sorts numerically.
+ *
+ *  Sorting (GtkTreeSortable) permutes the row index in place.  The default
+ *  (unsorted) order is the original search results order.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtk/gtk.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "search.h"
+#include "results.h"
+
+
+//===============================================================
+//      Defines
+//===============================================================
+
+#define MAX_FUNCTION_SIZE       100     /* Max size of function name */
+#define MAX_DISPLAY_SOURCE      511     /* Max number of character to display for source text */
+#define MAX_CRAZY_BIG_SIZE      15000   /* Max nubmer of source text chars before warnings are generated */
+#define MAX_EXCERPT_SIZE        100
+
+
+//===============================================================
+//      Typedefs
+//===============================================================
+
+typedef struct
+{
+    guint32     offset;     /* Offset of the result line in the results buffer */
+    guint32     text;       /* Offset of the source text field */
+    guint32     file;       /* Interned file name index */
+    guint32     line;       /* Line number */
+} result_row_t;
+
+
+struct _ResultsModel
+{
+    GObject         parent;
+
+    gint            stamp;          /* Iterator validity stamp, changes whenever the rows change */
+    gchar           *buf;           /* The search results buffer (owned by the model) */
+    result_row_t    *rows;
+    guint           nrows;
+
+    GPtrArray       *files;         /* Interned file names */
+    GHashTable      *file_hash;     /* File name -> (index + 1) */
+    guint           *file_rank;     /* Alphabetical rank of each interned file name (built on first sort) */
+
+    gint            sort_column;
+    GtkSortType     sort_order;
+};
+
+
+struct _ResultsModelClass
+{
+    GObjectClass    parent_class;
+};
+
+
+
+//===============================================================
+//      Local Functions
+//===============================================================
+
+static void     results_tree_model_init (GtkTreeModelIface *iface);
+static void     results_sortable_init   (GtkTreeSortableIface *iface);
+static void     results_finalize        (GObject *object);
+
+static GtkTreeModelFlags results_get_flags  (GtkTreeModel *tree_model);
+static gint     results_get_n_columns   (GtkTreeModel *tree_model);
+static GType    results_get_column_type (GtkTreeModel *tree_model, gint index);
+static gboolean results_get_iter        (GtkTreeModel *tree_model, GtkTreeIter *iter, GtkTreePath *path);
+static GtkTreePath *results_get_path    (GtkTreeModel *tree_model, GtkTreeIter *iter);
+static void     results_get_value       (GtkTreeModel *tree_model, GtkTreeIter *iter, gint column, GValue *value);
+static gboolean results_iter_next       (GtkTreeModel *tree_model, GtkTreeIter *iter);
+static gboolean results_iter_children   (GtkTreeModel *tree_model, GtkTreeIter *iter, GtkTreeIter *parent);
+static gboolean results_iter_has_child  (GtkTreeModel *tree_model, GtkTreeIter *iter);
+static gint     results_iter_n_children (GtkTreeModel *tree_model, GtkTreeIter *iter);
+static gboolean results_iter_nth_child  (GtkTreeModel *tree_model, GtkTreeIter *iter, GtkTreeIter *parent, gint n);
+static gboolean results_iter_parent     (GtkTreeModel *tree_model, GtkTreeIter *iter, GtkTreeIter *child);
+
+static gboolean results_get_sort_column_id  (GtkTreeSortable *sortable, gint *sort_column_id, GtkSortType *order);
+static void     results_set_sort_column_id  (GtkTreeSortable *sortable, gint sort_column_id, GtkSortType order);
+static void     results_set_sort_func       (GtkTreeSortable *sortable, gint sort_column_id,
+                                             GtkTreeIterCompareFunc func, gpointer data, GDestroyNotify destroy);
+static void     results_set_default_sort_func(GtkTreeSortable *sortable, GtkTreeIterCompareFunc func,
+                                             gpointer data, GDestroyNotify destroy);
+static gboolean results_has_default_sort_func(GtkTreeSortable *sortable);
+
+static guint32  intern_file         (ResultsModel *model, const gchar *name, gsize length);
+static void     build_file_rank     (ResultsModel *model);
+static void     sort_rows           (ResultsModel *model, gboolean notify);
+static gint     compare_rows        (gconstpointer a, gconstpointer b, gpointer user_data);
+static gint     compare_field       (const gchar *a, const gchar *b, gchar terminator);
+static gchar    *function_field     (ResultsModel *model, result_row_t *row);
+
+
+G_DEFINE_TYPE_WITH_CODE(ResultsModel, RESULTS_model, G_TYPE_OBJECT,
+                        G_IMPLEMENT_INTERFACE(GTK_TYPE_TREE_MODEL,    results_tree_model_init)
+                        G_IMPLEMENT_INTERFACE(GTK_TYPE_TREE_SORTABLE, results_sortable_init))
+
+
+
+//===============================================================
+//      GObject Boilerplate
+//===============================================================
+
+static void RESULTS_model_class_init(ResultsModelClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS(klass);
+
+    object_class->finalize = results_finalize;
+}
+
+
+
+static void RESULTS_model_init(ResultsModel *model)
+{
+    model->stamp       = g_random_int();
+    model->buf         = NULL;
+    model->rows        = NULL;
+    model->nrows       = 0;
+    model->files       = g_ptr_array_new_with_free_func(g_free);
+    model->file_hash   = g_hash_table_new(g_str_hash, g_str_equal);
+    model->file_rank   = NULL;
+    model->sort_column = GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID;
+    model->sort_order  = GTK_SORT_ASCENDING;
+}
+
+
+
+static void results_finalize(GObject *object)
+{
+    ResultsModel *model = RESULTS_MODEL(object);
+
+    RESULTS_model_clear(model);
+    g_ptr_array_free(model->files, TRUE);
+    g_hash_table_destroy(model->file_hash);
+
+    G_OBJECT_CLASS(RESULTS_model_parent_class)->finalize(object);
+}
+
+
+
+static void results_tree_model_init(GtkTreeModelIface *iface)
+{
+    iface->get_flags       = results_get_flags;
+    iface->get_n_columns   = results_get_n_columns;
+    iface->get_column_type = results_get_column_type;
+    iface->get_iter        = results_get_iter;
+    iface->get_path        = results_get_path;
+    iface->get_value       = results_get_value;
+    iface->iter_next       = results_iter_next;
+    iface->iter_children   = results_iter_children;
+    iface->iter_has_child  = results_iter_has_child;
+    iface->iter_n_children = results_iter_n_children;
+    iface->iter_nth_child  = results_iter_nth_child;
+    iface->iter_parent     = results_iter_parent;
+}
+
+
+
+static void results_sortable_init(GtkTreeSortableIface *iface)
+{
+    iface->get_sort_column_id    = results_get_sort_column_id;
+    iface->set_sort_column_id    = results_set_sort_column_id;
+    iface->set_sort_func         = results_set_sort_func;
+    iface->set_default_sort_func = results_set_default_sort_func;
+    iface->has_default_sort_func = results_has_default_sort_func;
+}
+
+
+
+//===============================================================
+//      Public Interface Functions
+//===============================================================
+
+ResultsModel *RESULTS_model_new(void)
+{
+    return( g_object_new(RESULTS_TYPE_MODEL, NULL) );
+}
+
+
+
+/* Index the search results.  The model takes ownership of the results buffer
+   (results->start_ptr is set to NULL).  No row signals are emitted, so the
+   model should be detached from its view while the rows are replaced. */
+void RESULTS_model_set(ResultsModel *model, search_results_t *results)
+{
+    gchar           *work_ptr;
+    gchar           *end_ptr;
+    gchar           *bar_ptr;
+    gchar           *line_ptr;
+    gchar           *text_ptr;
+    gchar           *eol_ptr;
+    result_row_t    *row;
+    guint           rows_alloc;
+    guint32         line;
+    gsize           text_len;
+    gsize           buf_size;
+
+    RESULTS_model_clear(model);
+
+    if (results->start_ptr == NULL)
+        return;
+
+    /* Adopt the results buffer, null-terminated so the cell functions can use the string library */
+    buf_size   = results->end_ptr - results->start_ptr;
+    model->buf = g_realloc(results->start_ptr, buf_size + 1);
+    model->buf[buf_size] = '\0';
+    results->start_ptr = NULL;
+
+    rows_alloc  = results->match_count;
+    model->rows = g_malloc(rows_alloc * sizeof(result_row_t));
+
+    work_ptr = model->buf;
+    end_ptr  = model->buf + buf_size;
+
+    while (work_ptr < end_ptr && model->nrows < rows_alloc)
+    {
+        /*** File Name ***/
+        if ( (bar_ptr = memchr(work_ptr, '|', end_ptr - work_ptr)) == NULL )
+            break;
+
+        /*** Function Name ***/
+        if ( (line_ptr = memchr(bar_ptr + 1, ' ', end_ptr - bar_ptr - 1)) == NULL )
+            break;
+        line_ptr++;
+
+        /*** Line Number ***/
+        line = 0;
+        text_ptr = line_ptr;
+        while (text_ptr < end_ptr && *text_ptr >= '0' && *text_ptr <= '9')
+            line = (line * 10) + (*text_ptr++ - '0');
+        while (text_ptr < end_ptr && *text_ptr != ' ' && *text_ptr != '\n')
+            text_ptr++;
+        if (text_ptr < end_ptr && *text_ptr == ' ')
+            text_ptr++;
+
+        /*** Source Line Text ***/
+        if ( (eol_ptr = memchr(text_ptr, '\n', end_ptr - text_ptr)) == NULL )
+            eol_ptr = end_ptr;
+
+        text_len = eol_ptr - text_ptr;
+        if (text_len > MAX_DISPLAY_SOURCE)
+        {
+            if (line == 1)
+            {
+                fprintf(stderr, "*** Warning: File %.*s is not using Linux newline format\n", (int) (bar_ptr - work_ptr), work_ptr);
+            }
+
+            if (text_len > MAX_CRAZY_BIG_SIZE)  // We have so many "big" source lines, we need to filter it down to the "worst".
+            {
+                fprintf(stderr, "Warning: Field width overflow: [Source Text] will be truncated.\n");
+                fprintf(stderr, "    Max Source Text length allowed: %d, Actual Source Text length: %d\n", MAX_DISPLAY_SOURCE, (int) text_len);
+                fprintf(stderr, "    File: %.*s\n    Line: %u\n", (int) (bar_ptr - work_ptr), work_ptr, line);
+                fprintf(stderr, "    Excerpt [Head]: %.*s\n", MAX_EXCERPT_SIZE, text_ptr);
+                fprintf(stderr, "    Excerpt [Tail]: %.*s\n\n", MAX_EXCERPT_SIZE, eol_ptr - MAX_EXCERPT_SIZE);
+            }
+        }
+
+        row = &(model->rows[model->nrows++]);
+        row->offset = work_ptr - model->buf;
+        row->text   = text_ptr - model->buf;
+        row->file   = intern_file(model, work_ptr, bar_ptr - work_ptr);
+        row->line   = line;
+
+        work_ptr = eol_ptr + 1;
+    }
+
+    /* Keep the user's column sort across queries */
+    if (model->sort_column != GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID &&
+        model->sort_column != GTK_TREE_SORTABLE_DEFAULT_SORT_COLUMN_ID)
+    {
+        sort_rows(model, FALSE);
+    }
+}
+
+
+
+/* Drop all rows (and the results buffer).  No row signals are emitted. */
+void RESULTS_model_clear(ResultsModel *model)
+{
+    g_free(model->buf);
+    model->buf = NULL;
+    g_free(model->rows);
+    model->rows = NULL;
+    model->nrows = 0;
+
+    g_hash_table_remove_all(model->file_hash);
+    g_ptr_array_set_size(model->files, 0);
+    g_free(model->file_rank);
+    model->file_rank = NULL;
+
+    model->stamp++;
+}
+
+
+
+/* Return the (interned) file name and the line number of the row at 'path'.
+   The file name remains valid until the model's rows are replaced. */
+gboolean RESULTS_model_get_row(ResultsModel *model, GtkTreePath *path, const gchar **file, guint *line)
+{
+    gint index;
+
+    if (gtk_tree_path_get_depth(path) != 1)
+        return(FALSE);
+
+    index = gtk_tree_path_get_indices(path)[0];
+    if (index < 0 || index >= (gint) model->nrows)
+        return(FALSE);
+
+    *file = g_ptr_array_index(model->files, model->rows[index].file);
+    *line = model->rows[index].line;
+    return(TRUE);
+}
+
+
+
+//===============================================================
+//      GtkTreeModel Interface
+//===============================================================
+
+static GtkTreeModelFlags results_get_flags(GtkTreeModel *tree_model)
+{
+    return(GTK_TREE_MODEL_LIST_ONLY);
+}
+
+
+
+static gint results_get_n_columns(GtkTreeModel *tree_model)
+{
+    return(COLUMNS);
+}
+
+
+
+static GType results_get_column_type(GtkTreeModel *tree_model, gint index)
+{
+    return( (index == LINE) ? G_TYPE_UINT : G_TYPE_STRING );
+}
+
+
+
+static gboolean results_get_iter(GtkTreeModel *tree_model, GtkTreeIter *iter, GtkTreePath *path)
+{
+    ResultsModel *model = RESULTS_MODEL(tree_model);
+    gint index;
+
+    if (gtk_tree_path_get_depth(path) != 1)
+        return(FALSE);
+
+    index = gtk_tree_path_get_indices(path)[0];
+    if (index < 0 || index >= (gint) model->nrows)
+        return(FALSE);
+
+    iter->stamp     = model->stamp;
+    iter->user_data = GUINT_TO_POINTER(index);
+    return(TRUE);
+}
+
+
+
+static GtkTreePath *results_get_path(GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+    return( gtk_tree_path_new_from_indices(GPOINTER_TO_UINT(iter->user_data), -1) );
+}
+
+
+
+static void results_get_value(GtkTreeModel *tree_model, GtkTreeIter *iter, gint column, GValue *value)
+{
+    ResultsModel    *model = RESULTS_MODEL(tree_model);
+    result_row_t    *row = &(model->rows[GPOINTER_TO_UINT(iter->user_data)]);
+    gchar           *text_ptr;
+    gchar           *eol_ptr;
+    gsize           length;
+
+    g_value_init(value, results_get_column_type(tree_model, column));
+
+    switch (column)
+    {
+        case FILENAME:
+            /* Interned names outlive any cell value, no copy needed */
+            g_value_set_static_string(value, g_ptr_array_index(model->files, row->file));
+        break;
+
+        case FUNCTION:
+            g_value_take_string(value, function_field(model, row));
+        break;
+
+        case LINE:
+            g_value_set_uint(value, row->line);
+        break;
+
+        case TEXT:
+            text_ptr = model->buf + row->text;
+            eol_ptr  = strchr(text_ptr, '\n');
+            length   = (eol_ptr != NULL) ? (gsize) (eol_ptr - text_ptr) : strlen(text_ptr);
+
+            if (length > MAX_DISPLAY_SOURCE)    // Ellipsize the overflow string
+                g_value_take_string(value, g_strdup_printf("%.*s...", MAX_DISPLAY_SOURCE - 3, text_ptr));
+            else
+                g_value_take_string(value, g_strndup(text_ptr, length));
+        break;
+    }
+}
+
+
+
+static gboolean results_iter_next(GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+    ResultsModel *model = RESULTS_MODEL(tree_model);
+    guint index = GPOINTER_TO_UINT(iter->user_data) + 1;
+
+    if (index >= model->nrows)
+        return(FALSE);
+
+    iter->user_data = GUINT_TO_POINTER(index);
+    return(TRUE);
+}
+
+
+
+static gboolean results_iter_children(GtkTreeModel *tree_model, GtkTreeIter *iter, GtkTreeIter *parent)
+{
+    return( results_iter_nth_child(tree_model, iter, parent, 0) );
+}
+
+
+
+static gboolean results_iter_has_child(GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+    return(FALSE);
+}
+
+
+
+static gint results_iter_n_children(GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+    if (iter != NULL)
+        return(0);
+
+    return( RESULTS_MODEL(tree_model)->nrows );
+}
+
+
+
+static gboolean results_iter_nth_child(GtkTreeModel *tree_model, GtkTreeIter *iter, GtkTreeIter *parent, gint n)
+{
+    ResultsModel *model = RESULTS_MODEL(tree_model);
+
+    if (parent != NULL || n < 0 || n >= (gint) model->nrows)
+        return(FALSE);
+
+    iter->stamp     = model->stamp;
+    iter->user_data = GINT_TO_POINTER(n);
+    return(TRUE);
+}
+
+
+
+static gboolean results_iter_parent(GtkTreeModel *tree_model, GtkTreeIter *iter, GtkTreeIter *child)
+{
+    return(FALSE);
+}
+
+
+
+//===============================================================
+//      GtkTreeSortable Interface
+//===============================================================
+
+static gboolean results_get_sort_column_id(GtkTreeSortable *sortable, gint *sort_column_id, GtkSortType *order)
+{
+    ResultsModel *model = RESULTS_MODEL(sortable);
+
+    if (sort_column_id)
+        *sort_column_id = model->sort_column;
+    if (order)
+        *order = model->sort_order;
+
+    return( model->sort_column != GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID &&
+            model->sort_column != GTK_TREE_SORTABLE_DEFAULT_SORT_COLUMN_ID );
+}
+
+
+
+static void results_set_sort_column_id(GtkTreeSortable *sortable, gint sort_column_id, GtkSortType order)
+{
+    ResultsModel *model = RESULTS_MODEL(sortable);
+
+    if (model->sort_column == sort_column_id && model->sort_order == order)
+        return;
+
+    model->sort_column = sort_column_id;
+    model->sort_order  = order;
+
+    gtk_tree_sortable_sort_column_changed(sortable);
+    sort_rows(model, TRUE);
+}
+
+
+
+static void results_set_sort_func(GtkTreeSortable *sortable, gint sort_column_id,
+                                  GtkTreeIterCompareFunc func, gpointer data, GDestroyNotify destroy)
+{
+    fprintf(stderr, "Warning: The search results model does not support custom sort functions.\n");
+}
+
+
+
+static void results_set_default_sort_func(GtkTreeSortable *sortable, GtkTreeIterCompareFunc func,
+                                          gpointer data, GDestroyNotify destroy)
+{
+    fprintf(stderr, "Warning: The search results model does not support custom sort functions.\n");
+}
+
+
+
+/* The default sort order is the original search results order */
+static gboolean results_has_default_sort_func(GtkTreeSortable *sortable)
+{
+    return(TRUE);
+}
+
+
+
+//===============================================================
+//      Private Functions
+//===============================================================
+
+static guint32 intern_file(ResultsModel *model, const gchar *name, gsize length)
+{
+    gchar       *key;
+    gpointer    value;
+    guint       last = model->files->len;
+
+    /* Fast path: results are grouped by file */
+    if (last > 0)
+    {
+        key = g_ptr_array_index(model->files, last - 1);
+        if (strncmp(key, name, length) == 0 && key[length] == '\0')
+            return(last - 1);
+    }
+
+    key = g_strndup(name, length);
+    if ( (value = g_hash_table_lookup(model->file_hash, key)) != NULL )
+    {
+        g_free(key);
+        return( GPOINTER_TO_UINT(value) - 1 );
+    }
+
+    g_ptr_array_add(model->files, key);
+    g_hash_table_insert(model->file_hash, key, GUINT_TO_POINTER(model->files->len));
+    return(model->files->len - 1);
+}
+
+
+
+static gint compare_file_names(gconstpointer a, gconstpointer b, gpointer user_data)
+{
+    GPtrArray *files = user_data;
+
+    return( strcmp(g_ptr_array_index(files, *(const guint *) a), g_ptr_array_index(files, *(const guint *) b)) );
+}
+
+
+
+/* Rank the interned file names alphabetically so file sorts compare integers */
+static void build_file_rank(ResultsModel *model)
+{
+    guint   *order;
+    guint   i;
+
+    order = g_malloc(model->files->len * sizeof(guint));
+    for (i = 0; i < model->files->len; i++)
+        order[i] = i;
+
+    g_qsort_with_data(order, model->files->len, sizeof(guint), compare_file_names, model->files);
+
+    model->file_rank = g_malloc(model->files->len * sizeof(guint));
+    for (i = 0; i < model->files->len; i++)
+        model->file_rank[order[i]] = i;
+
+    g_free(order);
+}
+
+
+
+/* Sort the row index for the current sort column (and tell the view, if 'notify') */
+static void sort_rows(ResultsModel *model, gboolean notify)
+{
+    gint            *new_order;
+    result_row_t    *sorted;
+    GtkTreePath     *path;
+    guint           i;
+
+    if (model->nrows < 2)
+        return;
+
+    if (model->file_rank == NULL)
+        build_file_rank(model);
+
+    /* new_order[new position] = old position */
+    new_order = g_malloc(model->nrows * sizeof(gint));
+    for (i = 0; i < model->nrows; i++)
+        new_order[i] = i;
+
+    g_qsort_with_data(new_order, model->nrows, sizeof(gint), compare_rows, model);
+
+    sorted = g_malloc(model->nrows * sizeof(result_row_t));
+    for (i = 0; i < model->nrows; i++)
+        sorted[i] = model->rows[new_order[i]];
+
+    g_free(model->rows);
+    model->rows = sorted;
+
+    if (notify)
+    {
+        path = gtk_tree_path_new();
+        gtk_tree_model_rows_reordered(GTK_TREE_MODEL(model), path, NULL, new_order);
+        gtk_tree_path_free(path);
+    }
+
+    g_free(new_order);
+}
+
+
+
+static gint compare_rows(gconstpointer a, gconstpointer b, gpointer user_data)
+{
+    ResultsModel    *model = user_data;
+    result_row_t    *row_a = &(model->rows[*(const gint *) a]);
+    result_row_t    *row_b = &(model->rows[*(const gint *) b]);
+    gchar           *func_a;
+    gchar           *func_b;
+    gint            result = 0;
+
+    switch (model->sort_column)
+    {
+        case FILENAME:
+            result = (gint) model->file_rank[row_a->file] - (gint) model->file_rank[row_b->file];
+            if (result == 0)
+                result = (row_a->line > row_b->line) - (row_a->line < row_b->line);
+        break;
+
+        case FUNCTION:
+            func_a = strchr(model->buf + row_a->offset, '|') + 1;
+            func_b = strchr(model->buf + row_b->offset, '|') + 1;
+            result = compare_field(func_a, func_b, ' ');
+        break;
+
+        case LINE:
+            result = (row_a->line > row_b->line) - (row_a->line < row_b->line);
+            if (result == 0)
+                result = (gint) model->file_rank[row_a->file] - (gint) model->file_rank[row_b->file];
+        break;
+
+        case TEXT:
+            result = compare_field(model->buf + row_a->text, model->buf + row_b->text, '\n');
+        break;
+
+        default:
+            // Unsorted: original search results order
+        break;
+    }
+
+    if (model->sort_order == GTK_SORT_DESCENDING)
+        result = -result;
+
+    /* Ties keep the original search results order */
+    if (result == 0)
+        result = (row_a->offset > row_b->offset) - (row_a->offset < row_b->offset);
+
+    return(result);
+}
+
+
+
+/* Compare two buffer fields, each ending at 'terminator' */
+static gint compare_field(const gchar *a, const gchar *b, gchar terminator)
+{
+    guchar  char_a, char_b;
+
+    while (*a == *b && *a != terminator && *a != '\0')
+    {
+        a++;
+        b++;
+    }
+
+    char_a = (*a == terminator) ? 0 : (guchar) *a;
+    char_b = (*b == terminator) ? 0 : (guchar) *b;
+
+    return( (gint) char_a - (gint) char_b );
+}
+
+
+
+static gchar *function_field(ResultsModel *model, result_row_t *row)
+{
+    gchar   *func_ptr;
+    gchar   *end_ptr;
+    gsize   length;
+
+    func_ptr = strchr(model->buf + row->offset, '|') + 1;
+    end_ptr  = strchr(func_ptr, ' ');
+    length   = (end_ptr != NULL) ? (gsize) (end_ptr - func_ptr) : strlen(func_ptr);
+
+    if (length > MAX_FUNCTION_SIZE)     // Ellipsize the overflow string
+        return( g_strdup_printf("%.*s...", MAX_FUNCTION_SIZE - 3, func_ptr) );
+
+    return( g_strndup(func_ptr, length) );
+}
@@ -0,0 +1,29 @@
+
+/* Search results tree model columns */
+enum
+{
+    FILENAME = 0,
+    FUNCTION,
+    LINE,
+    TEXT,
+    COLUMNS
+};
+
+
+#define RESULTS_TYPE_MODEL      (RESULTS_model_get_type())
+#define RESULTS_MODEL(obj)      (G_TYPE_CHECK_INSTANCE_CAST((obj), RESULTS_TYPE_MODEL, ResultsModel))
+#define RESULTS_IS_MODEL(obj)   (G_TYPE_CHECK_INSTANCE_TYPE((obj), RESULTS_TYPE_MODEL))
+
+typedef struct _ResultsModel        ResultsModel;
+typedef struct _ResultsModelClass   ResultsModelClass;
+
+
+//===============================================================
+//      Public Interface Functions
+//===============================================================
+
+GType           RESULTS_model_get_type  (void);
+ResultsModel *  RESULTS_model_new       (void);
+void            RESULTS_model_set       (ResultsModel *model, search_results_t *results);
+void            RESULTS_model_clear     (ResultsModel *model);
+gboolean        RESULTS_model_get_row   (ResultsModel *model, GtkTreePath *path, const gchar **file, guint *line);
@@ -1104,7 +1104,6 @@ char *yytext;
 #include "config.h"
 #endif
 
-#include <gtk/gtk.h>
 #include <assert.h>
 #include <string.h>
 #include <glib.h>
@@ -7,12 +7,14 @@
 #include "config.h"
 #endif
 
-#include <gtk/gtk.h>
+#include <glib.h>
 #include <errno.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <time.h>
 #include <ctype.h>
 #include <unistd.h>
@@ -27,7 +29,16 @@
 #include "lookup.h"
 #include "crossref.h"
 #include "utils.h"
-#include "display.h"
+#include "core.h"
+#include "trace.h"
+#include "blocks.h"
+#include "incgraph.h"
+#include "symdict.h"
+#include "fileindex.h"
+#include "watch.h"
+#include "stale.h"
+#include "federate.h"
+#include "textdict.h"
 #include "app_config.h"
 
 
@@ -42,9 +53,23 @@
 //       Local Type Definitions
 //===============================================================
 
+/* A loaded cross-reference and the indexes derived from it (SEARCH_load_cref) */
+struct search_cref
+{
+    BLOCKS_cref_t   *file;
+    struct stat     stat;
+    textdict_t      dict;
+    section_stats_t *section_table;
+    guint           nsections;
+    inc_graph_t     *graph;
+    symdict_t       *symbols;
+};
+
+
 typedef enum    {       /* Search result codes */
     NOERROR,
     NOTSYMBOL,
+    NOTFOUND,
     REGCMPERROR
 } search_result_t;
 
@@ -60,14 +85,29 @@ FILE     *refsfound;
 //       Private Global Variables
 //===============================================================
 
-static char         *cref_file_buf = NULL;  /* Buffer the holds the entire cross reference database */
+static BLOCKS_cref_t *cref_file = NULL;    /* The mapped cross reference database (see blocks.h) */
+static struct stat  cref_file_stat;         /* Identity of the file cref_file was mapped from */
 static char         global[] = "<global>";  /* dummy global function name */
 static uint32_t     starttime;              /* start time for progress messages */
 static char         temp1[PATHLEN + 1];     /* temporary file name */
 static char         temp2[PATHLEN + 1];     /* temporary file name */
+static pid_t        temp_pid = 0;           /* Process the temporary file names belong to */
 static FILE         *nonglobalrefs;
 static gboolean     cancel_search = FALSE;  /* UI hook to abort a lengthy search */
+static gboolean     search_busy   = FALSE;  /* A lookup is using cref_file (it may yield to the front-end) */
 static gboolean     cref_status   = TRUE;   /* Cross reference up-to-date status */
+static textdict_t   cref_dict;              /* Text compression dictionary of the memory-resident cross-reference */
+static gboolean     fold_case     = FALSE;  /* Current symbol search uses case-folded byte matching */
+static section_stats_t  *section_table = NULL;  /* Per-file-section symbol counts (the cross-reference trailer) */
+static guint        nsections     = 0;      /* Number of section table entries */
+
+#ifdef GSCOPE_TRACE
+/* Trace span names for the SEARCH_lookup() handlers, indexed by search_t */
+static const gchar  *lookup_span[FIND_NULL + 1] = {
+    "find_symbol", "find_def", "find_called_by", "find_calling", "find_string",
+    "find_regexp", "find_file", "find_include", "find_all_functions", "find_null"
+};
+#endif
 
 //===============================================================
 //      Local Functions
@@ -88,9 +128,12 @@ static search_result_t  find_file     (char *pattern);
 static search_result_t  find_include  (char *pattern);
 static search_result_t  find_all_functions(void);
 static void             find_called_by_sub(char *file, char **src);
+static gboolean         put_includer  (const gchar *file, guint depth, guint64 offset, gpointer user_data);
 
 static gboolean         writerefsfound(void);
+static void             make_temp_names(void);
 static void             get_string(char *dest, char **src);
+static gboolean         next_block(BLOCKS_scan_t *scan, char *file, char **read_ptr);
 static char             *html_copy(FILE *output_file, char *read_ptr, char match_char);
 static char             *open_results_file(char *results_file, off_t *size);
 static FILE             *open_out_file(gchar *full_filename);
@@ -98,8 +141,18 @@ static gboolean         is_regexp(char *pattern);
 static void             match_file(char *infile_name, regex_t regex_ptr, char *format);
 static gboolean         match_regex(char **src, regex_t regex_ptr);
 static gboolean         match_bytes(char **src_ptr, char *cpattern);
+static gboolean         match_bytes_nocase(char **src_ptr, char *fpattern);
 static void             strip_anchors(char *pattern);
+static gboolean         valid_symbol_pattern(char *pattern);
 static gboolean         compress_search_pattern(char *cpattern, char *pattern);
+static gboolean         fold_search_pattern(char *fpattern, char *pattern);
+
+static void             add_stats(stats_struct_t *sum, const stats_struct_t *counts);
+static gint             compare_dir_stats(gconstpointer a, gconstpointer b);
+static gboolean         parse_uint(char **src_ptr, char *end_ptr, guint64 *value);
+static BLOCKS_cref_t *  read_cref(struct stat *cref_stat);
+static gboolean         load_section_table(search_cref_t *cref);
+static void             derive_section_table(search_cref_t *cref);
 
 static search_result_t  configure_search(char *pattern,   gboolean *use_regexp, regex_t *regex_ptr,       char *cpattern);
 static gboolean         mega_match(      char **read_ptr, gboolean use_regexp,  const regex_t *regex_ptr, char *cpattern);
@@ -114,6 +167,7 @@ static search_result_t find_symbol(char *pattern)
     char        macro[MAX_SYMBOL_SIZE + 1];     /* macro name */
     char        match_string[MAX_SYMBOL_SIZE + 1];
     char        *read_ptr;
+    BLOCKS_scan_t   *scan;
     char        *tmp_ptr;
 
     gboolean    in_macro    = FALSE;
@@ -135,7 +189,7 @@ static search_result_t find_symbol(char *pattern)
 
     /*** Start the searching the cross-reference data ***/
 
-    read_ptr = cref_file_buf;
+    scan = BLOCKS_scan_start(cref_file, &read_ptr);
 
     while (*read_ptr++ != '\t');            /* Skip the header, scan past the next tab char */
     read_ptr++;                             /* Skip the file marker */
@@ -167,13 +221,13 @@ static search_result_t find_symbol(char *pattern)
                     get_string(file, &read_ptr);
 
                     /* check for the end of the symbols */
-                    if (*file == '\0')
+                    if (*file == '\0' && !next_block(scan, file, &read_ptr))
                     {
                         done = TRUE;
                         continue;
                     }
                     fcount++;
-                    progress("Searched %d of %d files", fcount, nsrcfiles);
+                    progress("Searched %d of %d files", fcount, DIR_src_count());
                     /* FALLTHROUGH */
 
                 case FCNEND:        /* function end */
@@ -245,6 +299,8 @@ static search_result_t find_symbol(char *pattern)
         }
     }
 
+    BLOCKS_scan_stop(scan);
+
     /* Free memory allocated to the pattern buffer by the regcom() compiling process (performed in configure_search() */
     if (use_regexp) regfree(&regex_ptr);
 
@@ -259,6 +315,7 @@ static search_result_t find_def(char *pattern)
     char        file[MAX_SYMBOL_SIZE + 1];  /* source file name */
 
     char        *read_ptr;
+    BLOCKS_scan_t   *scan;
     uint32_t    fcount = 0;
     gboolean    done = FALSE;
     regex_t     regex_ptr;
@@ -275,7 +332,7 @@ static search_result_t find_def(char *pattern)
 
     /*** Start the searching the cross-reference data ***/
 
-    read_ptr = cref_file_buf;
+    scan = BLOCKS_scan_start(cref_file, &read_ptr);
 
     /* find the next file name */
     while (*read_ptr++ != '\t');        /* Skip the header.  Scan past the next tab char */
@@ -296,13 +353,13 @@ static search_result_t find_def(char *pattern)
                 get_string(file, &read_ptr);
 
                 /* check for the end of the symbols */
-                if (*file == '\0')
+                if (*file == '\0' && !next_block(scan, file, &read_ptr))
                 {
                     done = TRUE;
                     continue;
                 }
                 fcount++;
-                progress("Searched %ld of %ld files", fcount, nsrcfiles);
+                progress("Searched %ld of %ld files", fcount, DIR_src_count());
             break;
 
             case DEFINE:        /* could be a macro */
@@ -334,6 +391,8 @@ static search_result_t find_def(char *pattern)
         }
     }
 
+    BLOCKS_scan_stop(scan);
+
     /* Free memory allocated to the pattern buffer by the regcom() compiling process (performed in configure_search() */
     if (use_regexp) regfree(&regex_ptr);
 
@@ -349,10 +408,11 @@ static search_result_t find_all_functions()
     char        function[MAX_SYMBOL_SIZE + 1];   /* function name */
 
     char        *read_ptr;
+    BLOCKS_scan_t   *scan;
     uint32_t    fcount = 0;
     gboolean    done = FALSE;
 
-    read_ptr = cref_file_buf;
+    scan = BLOCKS_scan_start(cref_file, &read_ptr);
 
     /* find the next file name */
     while (*read_ptr++ != '\t');        /* Skip the header.  Scan past the next tab char */
@@ -372,13 +432,13 @@ static search_result_t find_all_functions()
                 get_string(file, &read_ptr);
 
                 /* Check for end-of-symbols */
-                if (*file == '\0')
+                if (*file == '\0' && !next_block(scan, file, &read_ptr))
                 {
                     done = TRUE;
                     continue;
                 }
                 fcount++;
-                progress("Searched %ld of %ld files", fcount, nsrcfiles);
+                progress("Searched %ld of %ld files", fcount, DIR_src_count());
                 /* FALLTHROUGH */
 
             case FCNEND:        /* function end */
@@ -400,6 +460,8 @@ static search_result_t find_all_functions()
             break;
         }
     }
+
+    BLOCKS_scan_stop(scan);
     return(NOERROR);
 }
 
@@ -411,6 +473,7 @@ static search_result_t find_called_by(char *pattern)
     char        file[MAX_SYMBOL_SIZE + 1];  /* source file name */
 
     char        *read_ptr;
+    BLOCKS_scan_t   *scan;
     uint32_t    fcount = 0;
     gboolean    done = FALSE;
     regex_t     regex_ptr;
@@ -424,12 +487,12 @@ static search_result_t find_called_by(char *pattern)
 
     if (error != NOERROR) return(error);
 
-    /* Note: User provided regular expression and/or ignoreCase (use_regexp == TRUE) might match more than a */
+    /* Note: User provided regular expression and/or ignoreCase (fold_case == TRUE) might match more than a */
     /*       single calling function. TF - 8/5/13 */
 
     /*** Start the searching the cross-reference data ***/
 
-    read_ptr = cref_file_buf;
+    scan = BLOCKS_scan_start(cref_file, &read_ptr);
 
     /* find the next file name */
     while (*read_ptr++ != '\t');    /* Skip the header */
@@ -455,13 +518,13 @@ static search_result_t find_called_by(char *pattern)
                     get_string(file, &read_ptr);
 
                     /* Check for the end of the symbols */
-                    if (*file == '\0')
+                    if (*file == '\0' && !next_block(scan, file, &read_ptr))
                     {
                         done = TRUE;
                         continue;
                     }
                     fcount++;
-                    progress("Searched %ld of %ld files", fcount, nsrcfiles);
+                    progress("Searched %ld of %ld files", fcount, DIR_src_count());
                 break;
 
                 case FCNDEF:
@@ -485,6 +548,8 @@ static search_result_t find_called_by(char *pattern)
         }
     }
 
+    BLOCKS_scan_stop(scan);
+
     /* Free memory allocated to the pattern buffer by the regcom() compiling process (performed in configure_search() */
     if (use_regexp) regfree(&regex_ptr);
 
@@ -513,7 +578,11 @@ static void find_called_by_sub(char *file, char **src)
             break;
 
             case FCNEND:        /* function end */
-            case NEWFILE:       /* file end */
+                done = TRUE;
+            break;
+
+            case NEWFILE:       /* file end (or the end of a block): the caller must see the file mark */
+                *src -= 2;      /* Back to the newline that ends the previous line */
                 done = TRUE;
             break;
 
@@ -534,6 +603,7 @@ static search_result_t find_calling(char *pattern)
     char        macro[MAX_SYMBOL_SIZE + 1];     /* macro name */
 
     char        *read_ptr;
+    BLOCKS_scan_t   *scan;
     uint32_t    fcount = 0;
     gboolean    done = FALSE;
     regex_t     regex_ptr;
@@ -550,7 +620,7 @@ static search_result_t find_calling(char *pattern)
 
     /*** Start the searching the cross-reference data ***/
 
-    read_ptr = cref_file_buf;
+    scan = BLOCKS_scan_start(cref_file, &read_ptr);
 
     /* If the function call is from a macro, report the host 'macro' as the calling function */
     *macro = '\0';
@@ -573,13 +643,13 @@ static search_result_t find_calling(char *pattern)
                 get_string(file, &read_ptr);
 
                 /* Check for the end of the symbols */
-                if (*file == '\0')
+                if (*file == '\0' && !next_block(scan, file, &read_ptr))
                 {
                     done = TRUE;
                     continue;
                 }
                 fcount++;
-                progress("Searched %ld of %ld files", fcount, nsrcfiles);
+                progress("Searched %ld of %ld files", fcount, DIR_src_count());
                 (void) strcpy(function, global);
             break;
 
@@ -630,6 +700,8 @@ static search_result_t find_calling(char *pattern)
         }
     }
 
+    BLOCKS_scan_stop(scan);
+
     /* Free memory allocated to the pattern buffer by the regcom() compiling process (performed in configure_search() */
     if (use_regexp) regfree(&regex_ptr);
 
@@ -645,6 +717,7 @@ static search_result_t find_string(char *pattern)
     uint32_t    i;
     regex_t     regex_ptr;
     char        new_pattern[MAX_SYMBOL_SIZE * 2];
+    DIR_src_iter_t  iter;
 
     char        *file;
     char        *write_ptr;
@@ -679,10 +752,10 @@ static search_result_t find_string(char *pattern)
 
     /*** Perform the search ***/
 
-    for (i = 0; i < nsrcfiles; ++i)
+    DIR_src_iter_init(&iter, 0);
+    for (i = 0; (file = (char *) DIR_src_iter_next(&iter)) != NULL; ++i)
     {
-        file = DIR_src_files[i];
-        progress("%ld of %ld files searched", i, nsrcfiles);
+        progress("%ld of %ld files searched", i, DIR_src_count());
 
         match_file(file, regex_ptr, "%s|<unknown> %ld %s\n");
 
@@ -708,6 +781,7 @@ static search_result_t find_regexp(char *pattern)
     uint32_t    i;
     regex_t     regex_ptr;
     char        *file;
+    DIR_src_iter_t  iter;
 
     /* This search utilizes regexec() even if there are no metacharacters in the user-provided search pattern. */
     /* allow a match anywhere inside the string */
@@ -716,10 +790,10 @@ static search_result_t find_regexp(char *pattern)
 
     /*** Perform the search ***/
 
-    for (i = 0; i < nsrcfiles; ++i)
+    DIR_src_iter_init(&iter, 0);
+    for (i = 0; (file = (char *) DIR_src_iter_next(&iter)) != NULL; ++i)
     {
-        file = DIR_src_files[i];
-        progress("%ld of %ld files searched", i, nsrcfiles);
+        progress("%ld of %ld files searched", i, DIR_src_count());
 
         match_file(file, regex_ptr, "%s|<unknown> %ld %s\n");
 
@@ -739,9 +813,15 @@ static search_result_t find_regexp(char *pattern)
 /* find matching file names */
 static search_result_t find_file(char *pattern)
 {
-    uint32_t    i;
     regex_t     regex_ptr;
     char        *s;
+    const char  *file;
+    DIR_src_iter_t  iter;
+    GArray      *ranges;
+    fileindex_range_t   *range;
+    fileindex_range_t   all_files;
+    guint       r;
+    guint32     i;
 
     /* remove trailing white space */
     for (s = pattern + strlen(pattern) - 1; isspace(*s); --s) *s = '\0';
@@ -752,20 +832,30 @@ static search_result_t find_file(char *pattern)
         return(REGCMPERROR);
 
 
-    for (i = 0; i < nsrcfiles; ++i)
+    /* Only the files the file name index can't rule out need regexec() (still in list order) */
+    ranges = g_array_new(FALSE, FALSE, sizeof(fileindex_range_t));
+    if ( !FILEINDEX_candidates(pattern, ranges) )
     {
-        s = DIR_src_files[i];
-        if (regexec (&regex_ptr, s, (size_t)0, NULL, 0) == 0)
-        {
-            fprintf(refsfound, "%s|<unknown> 1 <unknown>\n", DIR_src_files[i]);
-        }
+        all_files.start = 0;
+        all_files.end   = DIR_src_count();
+        g_array_append_val(ranges, all_files);
+    }
 
-        if (cancel_search)
+    for (r = 0; r < ranges->len && !cancel_search; r++)
+    {
+        range = &g_array_index(ranges, fileindex_range_t, r);
+
+        DIR_src_iter_init(&iter, range->start);
+        for (i = range->start; i < range->end && !cancel_search && (file = DIR_src_iter_next(&iter)) != NULL; i++)
         {
-            cancel_search = FALSE;
-            break;
+            if (regexec (&regex_ptr, file, (size_t)0, NULL, 0) == 0)
+            {
+                fprintf(refsfound, "%s|<unknown> 1 <unknown>\n", file);
+            }
         }
     }
+    cancel_search = FALSE;
+    g_array_free(ranges, TRUE);
 
     regfree(&regex_ptr);    /* Avoid memory leak, free memory allocated to the pattern buffer by regcomp() compiling process */
     return(NOERROR);
@@ -776,10 +866,6 @@ static search_result_t find_file(char *pattern)
 /* find files #including this file */
 static search_result_t find_include(char *pattern)
 {
-    char        file[MAX_SYMBOL_SIZE + 1];  /* source file name */
-    uint32_t    searchcount = 0;
-    char        *read_ptr;
-    gboolean    done = FALSE;
     char        *s;
     regex_t     regex_ptr;
 
@@ -791,59 +877,33 @@ static search_result_t find_include(char *pattern)
     if (regcomp (&regex_ptr, pattern, REG_EXTENDED | REG_NOSUB | (settings.ignoreCase ? REG_ICASE : 0) ) != 0)
         return(REGCMPERROR);
 
-    read_ptr = cref_file_buf;
-
-    /* find the next source file name or #include */
-    while (*read_ptr++ != '\t');    /* Skip the header, Scan past the next tab char */
-    read_ptr++;                     /* Skip the file marker */
-    get_string(file, &read_ptr);    /* Get the first file name */
-
-    while (!done)
-    {
-        /* Find the next scan token */
-        while (*read_ptr++ != '\t');
+    /* The #include graph index replaces a scan of every #include mark in the cross-reference */
+    INCGRAPH_find_includers(&regex_ptr, settings.transitiveIncludes, settings.includersSrcOnly, put_includer, NULL);
 
-        switch (*read_ptr)
-        {
+    cancel_search = FALSE;
+    regfree(&regex_ptr);    /* Avoid memory leak, free memory allocated to the pattern buffer by regcomp() compiling process */
+    return(NOERROR);
+}
 
-            case NEWFILE:       /* save file name */
-                read_ptr++;
-                get_string(file, &read_ptr);
 
-                /* Check for end of symbols */
-                if (*file == '\0')
-                {
-                    done = TRUE;
-                    continue;
-                }
-                searchcount++;
-                progress("Searched %ld of %ld files", searchcount, nsrcfiles);
-            break;
 
-            case INCLUDE:
-                read_ptr++;
-                read_ptr++;  /* skip global or local #include marker '<' or '"' */
-                if (match_regex(&read_ptr, regex_ptr))
-                {
-                    /* output the file and source line */
-                    putref(file, global, &read_ptr);
-                }
-            break;
+/* output an #including file and its #include source line */
+static gboolean put_includer(const gchar *file, guint depth, guint64 offset, gpointer user_data)
+{
+    char    func[MAX_SYMBOL_SIZE + 1];
+    char    *read_ptr;
 
-            default:
-                /* do nothing */
-            break;
-        }
+    read_ptr = BLOCKS_at(cref_file, offset);
 
-        if (cancel_search)
-        {
-            cancel_search = FALSE;
-            break;
-        }
+    if (settings.transitiveIncludes)
+    {
+        sprintf(func, "<depth-%u>", depth);     /* One token: the function field of a result line */
+        putref((char *) file, func, &read_ptr);
     }
+    else
+        putref((char *) file, global, &read_ptr);
 
-    regfree(&regex_ptr);    /* Avoid memory leak, free memory allocated to the pattern buffer by regcomp() compiling process */
-    return(NOERROR);
+    return( !cancel_search );
 }
 
 
@@ -903,6 +963,49 @@ static gboolean match_bytes(char **src_ptr, char *cpattern)
 
 
 
+/* Case-insensitive match of the (dictionary compressed) symbol at *src_ptr to a lowercased, uncompressed pattern */
+static gboolean match_bytes_nocase(char **src_ptr, char *fpattern)
+{
+    uint8_t     byte;
+    char        *match_ptr = *src_ptr;
+    char        *pat_ptr   = fpattern;
+    const char  *text;
+    guint       i;
+
+    while ( (byte = (unsigned) (*match_ptr)) != '\n' )
+    {
+        if (byte > 0x7f)
+        {
+            /* A trained dictionary may hold uppercase characters */
+            text = TEXTDICT_TEXT(&cref_dict, byte);
+            for (i = 0; i < TEXTDICT_LENGTH(&cref_dict, byte); i++)
+            {
+                if ( tolower((unsigned char) text[i]) != pat_ptr[i] )
+                    break;
+            }
+            if ( i < TEXTDICT_LENGTH(&cref_dict, byte) )
+                break;
+            pat_ptr += i;
+        }
+        else
+        {
+            if ( tolower(byte) != *pat_ptr )
+                break;
+            pat_ptr++;
+        }
+        ++match_ptr;
+    }
+
+    *src_ptr = match_ptr;
+    if (*match_ptr == '\n' && *pat_ptr == '\0')
+    {
+        return(TRUE);
+    }
+    return(FALSE);
+}
+
+
+
 /* put the reference into the file */
 static void putref(char *file, char *func, char **src)
 {
@@ -981,12 +1084,10 @@ static void putline(FILE *output, char **src_ptr)
     while ((c = (unsigned)(*line_ptr)) != '\n')
     {
 
-        /* check for a compressed digraph */
+        /* check for a compressed digraph or dictionary substring */
         if (c > 0x7f)
         {
-            c &= 0x7f;
-            (void) putc(dichar1[c / 8], output);
-            (void) putc(dichar2[c & 7], output);
+            (void) fwrite(TEXTDICT_TEXT(&cref_dict, c), 1, TEXTDICT_LENGTH(&cref_dict, c), output);
         }
         /* check for a compressed keyword */
         else if (c < ' ')
@@ -1025,16 +1126,15 @@ static void get_string(char *dest, char **src)
     {
         if (byte > 0x7f)
         {
-            if (byte_count + 2 > MAX_SYMBOL_SIZE)
+            if (byte_count + TEXTDICT_LENGTH(&cref_dict, byte) > MAX_SYMBOL_SIZE)
             {
                 truncated = TRUE;
                 break;    // The dicode expansion would overrun our buffer, so truncate
             }
 
-            byte   &= 0x7f;
-            *dest++ = dichar1[byte / 8];
-            *dest++ = dichar2[byte & 7];
-            byte_count += 2;
+            memcpy(dest, TEXTDICT_TEXT(&cref_dict, byte), TEXTDICT_LENGTH(&cref_dict, byte));
+            dest       += TEXTDICT_LENGTH(&cref_dict, byte);
+            byte_count += TEXTDICT_LENGTH(&cref_dict, byte);
         }
         else
         {
@@ -1064,6 +1164,20 @@ static void get_string(char *dest, char **src)
 
 
 
+/* At a block's end-of-symbols mark: go on with the next block of a block-compressed
+   cross-reference, getting its first file name as for any NEWFILE mark.  Returns FALSE at the end. */
+static gboolean next_block(BLOCKS_scan_t *scan, char *file, char **read_ptr)
+{
+    if ( !BLOCKS_scan_next(scan, read_ptr) )
+        return(FALSE);
+
+    *read_ptr += 2;     /* Skip the tab and the file marker */
+    get_string(file, read_ptr);
+    return(TRUE);
+}
+
+
+
 /* initialize the progress message */
 static void initprogress()
 {
@@ -1084,13 +1198,12 @@ static void progress(char *format, uint32_t n1, uint32_t n2)
     {
         starttime = now;
         my_asprintf(&msg, format, n1, n2);
-        DISPLAY_status(msg);
-        DISPLAY_update_progress_bar(n1, n2);
+        CORE_status(msg);
+        CORE_search_progress(n1, n2);
         g_free(msg);
 
-        // Process any pending gtk events
-        while (gtk_events_pending() )
-            gtk_main_iteration();
+        // Let the front-end process any pending events
+        CORE_yield();
     }
 }
 
@@ -1104,6 +1217,12 @@ static void periodic_check_cref()
 
     time_t now;
 
+    if ( WATCH_active() )   // Changes are picked up as they happen
+        return;
+
+    if ( !CORE_front_end() )    // -L, --serve: no main loop to report to (and --serve forks)
+        return;
+
     if ( !initialized )
     {
         last_check_time = time( (time_t *) NULL);
@@ -1121,6 +1240,26 @@ static void periodic_check_cref()
 
 
 
+/* Name the temporary files after the process using them */
+static void make_temp_names()
+{
+    char    *tmpdir;    /* temporary directory */
+    pid_t   pid;
+
+    pid = getpid();
+    if (pid == temp_pid)
+        return;
+
+    tmpdir = getenv("TMPDIR");
+    if (tmpdir == NULL) tmpdir = TMPDIR;
+
+    sprintf(temp1, "%s/cscope%d.1", tmpdir, pid);
+    sprintf(temp2, "%s/cscope%d.2", tmpdir, pid);
+    temp_pid = pid;
+}
+
+
+
 /* open the references found file for writing */
 static gboolean writerefsfound()
 {
@@ -1204,9 +1343,7 @@ static FILE *open_out_file(gchar *full_filename)
 /* Prepare to perform a Case Sensitive, non-regexp search */
 gboolean symbol_search_init(char *cpattern, char *pattern)
 {
-    uint32_t i;
     char    *read_ptr;
-    char    c;
 
     if (settings.truncateSymbols) pattern[8] = '\0';    /* if requested, try to truncate a C symbol pattern */
 
@@ -1226,16 +1363,7 @@ gboolean symbol_search_init(char *cpattern, char *pattern)
     }
 
     /* compress the string pattern for matching */
-    for (i = 0; (c = pattern[i]) != '\0'; ++i)
-    {
-        if (IS_A_DICODE(c, pattern[i + 1]))
-        {
-            c = DICODE_COMPRESS(c, pattern[i + 1]);
-            ++i;
-        }
-        /*(unsigned char)*/ *cpattern++ = c;
-    }
-    *cpattern = '\0';
+    TEXTDICT_compress(&cref_dict, cpattern, pattern);
 
     return(TRUE);
 }
@@ -1305,7 +1433,7 @@ void match_file(char *infile_name, regex_t regex_ptr, char *format)
     }
     else
     {
-        DISPLAY_set_cref_current(FALSE);    /* Set the out-of-date indicator */
+        CORE_cref_current(FALSE);    /* Set the out-of-date indicator */
         fprintf(stderr, "File open error: %s\n", infile_name);
     }
 }
@@ -1340,18 +1468,16 @@ static void strip_anchors(char *pattern)
 
 
 
-static gboolean compress_search_pattern(char *cpattern, char *pattern)
+/* check for a valid C symbol (truncating the pattern if requested) */
+static gboolean valid_symbol_pattern(char *pattern)
 {
     char *s;
-    char c;
-    int i;
 
     s = pattern;
 
     if (settings.truncateSymbols)
         s[8] = '\0';    /* if requested, try to truncate a C symbol pattern */
 
-    /* check for a valid C symbol */
     if (!isalpha(*s) && *s != '_')
     {
         return(FALSE);
@@ -1363,19 +1489,34 @@ static gboolean compress_search_pattern(char *cpattern, char *pattern)
             return(FALSE);
         }
     }
+    return(TRUE);
+}
+
+
+
+/* Compress the pattern with the cross-reference's own dictionary, so it matches the stored symbol byte for byte */
+static gboolean compress_search_pattern(char *cpattern, char *pattern)
+{
+    if ( !valid_symbol_pattern(pattern) )
+        return(FALSE);
+
+    TEXTDICT_compress(&cref_dict, cpattern, pattern);
+
+    return(TRUE);
+}
 
-    /* compress the string pattern for matching */
-    s = cpattern;
-    for (i = 0; (c = pattern[i]) != '\0'; ++i)
-    {
-        if (IS_A_DICODE(c, pattern[i + 1]))
-        {
-            c = DICODE_COMPRESS(c, pattern[i + 1]);
-            ++i;
-        }
-        /*(unsigned char)*/ *s++ = c;
-    }
-    *s = '\0';
+
+
+/* Lowercase the symbol pattern for case-folded matching.  The pattern is NOT compressed:
+   the matcher expands (and lowercases) the dictionary codes in the cross-reference instead. */
+static gboolean fold_search_pattern(char *fpattern, char *pattern)
+{
+    if ( !valid_symbol_pattern(pattern) )
+        return(FALSE);
+
+    while (*pattern != '\0')
+        *fpattern++ = tolower((unsigned char) *pattern++);
+    *fpattern = '\0';
 
     return(TRUE);
 }
@@ -1396,9 +1537,11 @@ static search_result_t configure_search(char *pattern, gboolean *use_regexp, reg
         memmove(pattern, s_ptr, strlen(s_ptr) + 1);
 
 
+    fold_case = FALSE;
+
     /* This search utilizes regexec() ONLY if there are metacharacters in the search pattern */
     /* The match must be an exact match */
-    if (is_regexp(pattern) || settings.ignoreCase)          // Configure regex search
+    if (is_regexp(pattern))                                 // Configure regex search
     {
         /* remove leading ^ and trailing $ (if present) */
         strip_anchors(pattern);
@@ -1409,11 +1552,23 @@ static search_result_t configure_search(char *pattern, gboolean *use_regexp, reg
 
         *use_regexp = TRUE;
     }
+    else if (settings.ignoreCase)                           // Configure case-folded byte-matching search
+    {
+        if ( !fold_search_pattern(cpattern, pattern) )
+            return(NOTSYMBOL);
+
+        fold_case   = TRUE;
+        *use_regexp = FALSE;
+    }
     else                                                    // Configure byte-matching search
     {
         if ( !compress_search_pattern(cpattern, pattern) )
             return(NOTSYMBOL);
 
+        /* The symbol dictionary answers "no such symbol" without a cross-reference scan */
+        if ( !SYMDICT_contains(pattern) )
+            return(NOTFOUND);
+
         *use_regexp = FALSE;
     }
     return(NOERROR);
@@ -1444,7 +1599,7 @@ static gboolean mega_match(char **read_ptr, gboolean use_regexp, const regex_t *
          **************************************************/
         if (**read_ptr & 0x80)
         {   /* digraph char? */
-            firstchar = dichar1[(**read_ptr & 0x7f) / 8];
+            firstchar = TEXTDICT_TEXT(&cref_dict, **read_ptr)[0];
         }
         else
         {
@@ -1462,6 +1617,10 @@ static gboolean mega_match(char **read_ptr, gboolean use_regexp, const regex_t *
             }
         }
     }
+    else if (fold_case)     /* Not a regexp, perform a case-folded byte-for-byte pattern match */
+    {
+        match_found = match_bytes_nocase(read_ptr, cpattern);
+    }
     else    /* Not a regexp, perform a direct byte-for-byte (compressed text) pattern match */
     {
         if (**read_ptr == cpattern[0])
@@ -1488,63 +1647,147 @@ static gboolean mega_match(char **read_ptr, gboolean use_regexp, const regex_t *
 
 void SEARCH_init()
 {
-    FILE    *cref_file;
-    struct  stat statstruct;
-    char    *tmpdir;    /* temporary directory */
-    pid_t   pid;
+    TRACE_BEGIN("SEARCH_init", settings.refFile);
+
+    SEARCH_install_cref( SEARCH_load_cref() );
+
+    TRACE_END("SEARCH_init");
+}
 
-    if (cref_file_buf != NULL)
-    {
-        g_free(cref_file_buf);    /* Avoid a memory leak.  Free any old file buffer first */
-        cref_file_buf = NULL;
-    }
 
-    /* How big is the file?  And can we acces it? Should always succeed */
-    if ( stat(settings.refFile, &statstruct) != 0 )
-    {
-        fprintf(stderr, "Fatal Error: Unable to stat() cross-reference file.\n");
-        exit(EXIT_FAILURE);
-    }
+
+/* Map the entire cross-reference file (read-only).  The mapping is shared, block-compressed
+   or not: every gscope instance using this cross-reference uses the same page cache copy.
+   A rebuild replaces the file (movefile() links a new inode), so the mapping never changes under us. */
+static BLOCKS_cref_t *read_cref(struct stat *cref_stat)
+{
+    int             cref_fd;
+    BLOCKS_cref_t   *file;
 
     /* Open the file for reading.   Should always succeed */
-    if ( (cref_file = fopen(settings.refFile, "rb")) == NULL)
+    if ( (cref_fd = open(settings.refFile, O_RDONLY)) < 0 )
     {
         fprintf(stderr, "Fatal Error: Unable to open() cross-reference file.\n");
         exit(EXIT_FAILURE);
     }
 
-    /* Allocate a buffer to hold the entire file.  A really big cross reference
-       (like: ~1 GBbyte) on a memory-constrained host (like 2GB) MIGHT fail. */
-    cref_file_buf = g_malloc(statstruct.st_size);  /* malloc a buffer to hold the entire file */
-    if ( cref_file_buf == NULL )
+    /* How big is the file?  And can we acces it? Should always succeed */
+    if ( fstat(cref_fd, cref_stat) != 0 || cref_stat->st_size == 0 )
     {
-        fprintf(stderr, "Fatal Error: Unable to allocate memory to load cross-reference file.\n");
-        fprintf(stderr, "             Add more memory to your system.\n");
+        fprintf(stderr, "Fatal Error: Unable to stat() cross-reference file.\n");
         exit(EXIT_FAILURE);
     }
 
-    /* Read the entire file into memory.  Sould always succeed */
-    if ( fread(cref_file_buf, 1, statstruct.st_size, cref_file) != statstruct.st_size )
+    /* st_size becomes the size of the data (smaller than the file if it is block-compressed) */
+    if ( (file = BLOCKS_open(cref_fd, cref_stat)) == NULL )
     {
-        fprintf(stderr, "Fatal Error: Unable to load cross-reference file.\n");
+        if ( BLOCKS_is_compressed(cref_fd) )
+            fprintf(stderr, "Fatal Error: Damaged block-compressed cross-reference file [%s]\n", settings.refFile);
+        else
+            fprintf(stderr, "Fatal Error: Unable to load cross-reference file: %s\n", strerror(errno));
         exit(EXIT_FAILURE);
     }
 
+    close(cref_fd);
+    return(file);
+}
+
+
+
+/* Map the cross-reference and derive its indexes: the text dictionary, the section table,
+   the #include graph and the symbol dictionary.  Touches no search state, so a build thread
+   loads the next generation while lookups use the current one.  Must be called while the
+   source-file name hash is still available (see INCGRAPH_load). */
+search_cref_t *SEARCH_load_cref()
+{
+    search_cref_t   *cref;
+
+    cref = g_malloc0(sizeof(search_cref_t));
+    cref->file = read_cref(&cref->stat);
+
+    /* Symbols and patterns are compressed with the dictionary in the cross-reference header */
+    (void) TEXTDICT_load(&cref->dict, BLOCKS_at(cref->file, 0));
+
+    /*** Load the per-section symbol counts (derive them if the trailer is missing) ***/
+    if ( !load_section_table(cref) )
+        derive_section_table(cref);
+
+    /*** Load (or derive) the #include graph index for this cross-reference ***/
+    TRACE_BEGIN("INCGRAPH_load", NULL);
+    cref->graph = INCGRAPH_load(cref->file, &cref->stat);
+    TRACE_END("INCGRAPH_load");
+
+    /*** Load (or derive) the symbol dictionary for this cross-reference ***/
+    TRACE_BEGIN("SYMDICT_load", NULL);
+    cref->symbols = SYMDICT_load(cref->file, &cref->stat);
+    TRACE_END("SYMDICT_load");
+
+    return(cref);
+}
+
+
+
+/* Make a loaded cross-reference (SEARCH_load_cref) the one searched, freeing the previous one
+   (and 'cref').  Only swaps in the finished indexes.  Must not be called while a lookup is in
+   progress (see SEARCH_busy). */
+void SEARCH_install_cref(search_cref_t *cref)
+{
+    if (cref_file != NULL)
+        BLOCKS_close(cref_file);    /* Release the previous cross-reference first */
+    cref_file      = cref->file;
+    cref_file_stat = cref->stat;
+    cref_dict      = cref->dict;
+
     /* At this point we have a valid, memory-resident, cross-reference database available
-       (cref_file_buf) for use by the various functions of the SEARCH component */
+       (cref_file) for use by the various functions of the SEARCH component */
 
-    /*** create the temporary file names ***/
-    tmpdir = getenv("TMPDIR");
-    if (tmpdir == NULL) tmpdir = TMPDIR;
+    g_free(section_table);
+    section_table = cref->section_table;
+    nsections     = cref->nsections;
 
-    pid = getpid();
-    sprintf(temp1, "%s/cscope%d.1", tmpdir, pid);
-    sprintf(temp2, "%s/cscope%d.2", tmpdir, pid);
+    INCGRAPH_install(cref->graph);
+    SYMDICT_install(cref->symbols);
+
+    g_free(cref);
 
     /*** Initialize the Cross-Reference "periodic check" timer ***/
     periodic_check_cref();
+}
+
+
+
+/* Has the cross-reference file been replaced since the one searched was loaded?
+   A rebuild writes a new file and links it into place, so a new inode (or mtime) means a
+   complete new database.  The loaded identity is the fstat() of the file that was mapped: a
+   stat() of the name afterwards could already see a newer file, which would then never be
+   loaded.  (The loaded size is that of the data, which differs from the file size for a
+   block-compressed file.)  A missing file (mid-replacement) is not a replacement. */
+gboolean SEARCH_cref_replaced()
+{
+    struct stat statstruct;
+
+    if ( stat(settings.refFile, &statstruct) != 0 )
+        return(FALSE);
+
+    return( statstruct.st_ino   != cref_file_stat.st_ino  ||
+            statstruct.st_dev   != cref_file_stat.st_dev  ||
+            statstruct.st_mtime != cref_file_stat.st_mtime );
+}
+
+
+
+/* Has a cross-reference been installed?  (The first build may still be running) */
+gboolean SEARCH_ready()
+{
+    return(cref_file != NULL);
+}
+
+
 
-    fclose(cref_file);
+/* Is a lookup using the cross-reference?  (It may be servicing the front-end main loop) */
+gboolean SEARCH_busy()
+{
+    return(search_busy);
 }
 
 
@@ -1571,6 +1814,9 @@ search_results_t *SEARCH_lookup(search_t search_operation, gchar *pattern)
     search_result_t         result = NOERROR;          /* findinit return code */
     static search_results_t results = { NULL, NULL, 0 };
 
+    /* create the temporary file names (a forked query process gets its own) */
+    make_temp_names();
+
     /* open the references found (search results) file for writing */
     if ( !writerefsfound() ) return(0);
 
@@ -1580,10 +1826,15 @@ search_results_t *SEARCH_lookup(search_t search_operation, gchar *pattern)
         return(0);
     }
 
+    /* The additional cross-references (if any) are searched while we search ours */
+    FEDERATE_send(search_operation, pattern);
+
     /* find the pattern */
     initprogress();
-    DISPLAY_status("Searching ...");
+    CORE_status("Searching ...");
 
+    TRACE_BEGIN(lookup_span[search_operation], pattern);
+    search_busy = TRUE;
 
     switch (search_operation)
     {
@@ -1628,6 +1879,9 @@ search_results_t *SEARCH_lookup(search_t search_operation, gchar *pattern)
         break;
     }
 
+    search_busy = FALSE;
+    TRACE_END(lookup_span[search_operation]);
+
     /* append the non-global references */
     if ( freopen(temp2, "r", nonglobalrefs) == NULL )   // This must never happen
     {
@@ -1641,6 +1895,9 @@ search_results_t *SEARCH_lookup(search_t search_operation, gchar *pattern)
 
     fclose(nonglobalrefs);
 
+    /* append the additional cross-references' results, in order */
+    FEDERATE_collect(refsfound);
+
     periodic_check_cref();
 
     // Avoid memory leaks - Free any old "results" - This should not be needed.
@@ -1715,7 +1972,7 @@ search_results_t *SEARCH_lookup(search_t search_operation, gchar *pattern)
             my_asprintf(&msg, "<span foreground=\"red\">Could not find:</span> %s", esc_pattern);
         }
 
-        DISPLAY_status(msg);
+        CORE_status(msg);
         g_free(esc_pattern);
         g_free(msg);
     }
@@ -1789,83 +2046,294 @@ void SEARCH_cleanup()
 
 
 
-/* Collect Search Statistics*/
-void SEARCH_stats(stats_struct_t *sptr)
+/* Tally one cross-reference mark in a statistics structure */
+void SEARCH_count_mark(stats_struct_t *sptr, char mark)
 {
-    char        file[MAX_SYMBOL_SIZE + 1];  /* source file name */
+    switch (mark)
+    {
+        case CLASSDEF:          // C++ class definitions
+            sptr->define_cnt++;
+            sptr->class_cnt++;
+        break;
 
-    char        *read_ptr;
-    gboolean    done = FALSE;
+        case DEFINE:
+            sptr->define_cnt++;
+            sptr->identifier_cnt++;
+        break;
+
+        case FCNCALL:
+            sptr->fn_calls_cnt++;
+        break;
+
+        case FCNDEF:
+            sptr->define_cnt++;
+            sptr->identifier_cnt++;
+            sptr->fn_cnt++;
+        break;
+
+        case INCLUDE:
+            sptr->include_cnt++;
+        break;
+
+        case ENUMDEF:
+        case GLOBALDEF:
+        case MEMBERDEF:
+        case STRUCTDEF:
+        case TYPEDEF:
+        case UNIONDEF:
+            sptr->define_cnt++;
+        break;
+
+        default:
+            // DEFINEEND, FCNEND, NEWFILE: not counted
+        break;
+    }
+}
+
+
+
+/* Collect Search Statistics:  A sum over the section table, not a scan of the cross-reference */
+void SEARCH_stats(stats_struct_t *sptr)
+{
+    guint       i;
 
     /* Initialize the statistics structure */
     memset(sptr, 0, sizeof(stats_struct_t));
 
-    read_ptr = cref_file_buf;   /* Initialize the read pointer to the beginning of the database */
+    if (cref_file == NULL)          // No cross-reference yet
+        return;
 
-    /* find the next file name or definition */
-    do
+    for (i = 0; i < nsections; i++)
+        add_stats(sptr, &(section_table[i].counts));
+    return;
+}
+
+
+
+/* Collect Search Statistics per top-level directory (also a sum over the section table).  Returns a
+   dir_stats_t array sorted by directory name, to be released with SEARCH_free_dir_stats(). */
+GArray *SEARCH_stats_by_dir(void)
+{
+    GArray      *dir_stats = g_array_new(FALSE, TRUE, sizeof(dir_stats_t));
+    GHashTable  *index;             /* directory name -> dir_stats position + 1 */
+    dir_stats_t *entry;
+    gchar       *dir;
+    char        *file;
+    size_t      length;
+    char        *slash;
+    guint       i, pos;
+
+    if (cref_file == NULL)          // No cross-reference yet
+        return(dir_stats);
+
+    index = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+    for (i = 0; i < nsections; i++)
     {
-        while (*read_ptr++ != '\t');    /* Scan past the next tab */
+        file   = BLOCKS_at(cref_file, section_table[i].offset) + 1;    /* skip the NEWFILE mark */
+        length = strcspn(file, "\n");
 
-        switch (*read_ptr)
+        /* An absolute (#include search path) file name keeps its leading '/' */
+        slash = (length > 1) ? memchr(file + 1, '/', length - 1) : NULL;
+        dir   = slash ? g_strndup(file, slash - file) : g_strdup(".");
+
+        pos = GPOINTER_TO_UINT(g_hash_table_lookup(index, dir));
+        if (pos == 0)
         {
-            case CLASSDEF:          // C++ class definitions
-                sptr->define_cnt++;
-                sptr->class_cnt++;
-            break;
+            g_array_set_size(dir_stats, dir_stats->len + 1);
+            pos = dir_stats->len;
+            g_array_index(dir_stats, dir_stats_t, pos - 1).dir = g_strdup(dir);
+            g_hash_table_insert(index, dir, GUINT_TO_POINTER(pos));
+        }
+        else
+            g_free(dir);
 
-            case DEFINE:
-                sptr->define_cnt++;
-                sptr->identifier_cnt++;
-            break;
+        entry = &g_array_index(dir_stats, dir_stats_t, pos - 1);
+        entry->files++;
+        add_stats(&(entry->counts), &(section_table[i].counts));
+    }
 
-            case DEFINEEND:
-            case FCNEND:
-                // do nothing
-            break;
+    g_hash_table_destroy(index);
+    g_array_sort(dir_stats, compare_dir_stats);
+    return(dir_stats);
+}
 
-            case NEWFILE:
-                read_ptr++;  /* save file name */
-                get_string(file, &read_ptr);
 
-                /* Check for end-of-symbols */
-                if (*file == '\0')
-                {
-                    done = TRUE;
-                    continue;
-                }
-            break;
 
-            case FCNCALL:
-                sptr->fn_calls_cnt++;
-            break;
+void SEARCH_free_dir_stats(GArray *dir_stats)
+{
+    guint   i;
 
-            case FCNDEF:
-                sptr->define_cnt++;
-                sptr->identifier_cnt++;
-                sptr->fn_cnt++;
-            break;
+    for (i = 0; i < dir_stats->len; i++)
+        g_free(g_array_index(dir_stats, dir_stats_t, i).dir);
+    g_array_free(dir_stats, TRUE);
+}
 
-            case INCLUDE:
-                sptr->include_cnt++;
-            break;
 
-            case ENUMDEF:
-            case GLOBALDEF:
-            case MEMBERDEF:
-            case STRUCTDEF:
-            case TYPEDEF:
-            case UNIONDEF:
-                sptr->define_cnt++;
-            break;
 
-            default:
-                fprintf(stderr, "Error in statistics collection: should never reach here: char = %c\n", *read_ptr);
+static void add_stats(stats_struct_t *sum, const stats_struct_t *counts)
+{
+    sum->define_cnt     += counts->define_cnt;
+    sum->identifier_cnt += counts->identifier_cnt;
+    sum->fn_calls_cnt   += counts->fn_calls_cnt;
+    sum->fn_cnt         += counts->fn_cnt;
+    sum->class_cnt      += counts->class_cnt;
+    sum->include_cnt    += counts->include_cnt;
+}
+
+
+
+/* g_array_sort: by directory name */
+static gint compare_dir_stats(gconstpointer a, gconstpointer b)
+{
+    return( strcmp(((const dir_stats_t *) a)->dir, ((const dir_stats_t *) b)->dir) );
+}
+
+
+
+/* read an unsigned decimal value, without running off the end of the buffer */
+static gboolean parse_uint(char **src_ptr, char *end_ptr, guint64 *value)
+{
+    char    *ptr = *src_ptr;
+
+    *value = 0;
+
+    if (ptr >= end_ptr || !isdigit((unsigned char) *ptr))
+        return(FALSE);
+
+    while (ptr < end_ptr && isdigit((unsigned char) *ptr))
+        *value = (*value * 10) + (*ptr++ - '0');
+
+    /* skip the field delimiter */
+    if (ptr < end_ptr && (*ptr == ' ' || *ptr == '\n'))
+        ptr++;
+
+    *src_ptr = ptr;
+    return(TRUE);
+}
+
+
 
-         }
+/* Load the section table written by BUILD.  Returns FALSE if the cross-reference
+   has no (or a damaged) section table, in which case it must be derived. */
+static gboolean load_section_table(search_cref_t *cref)
+{
+    char        *buf = BLOCKS_at(cref->file, 0);
+    guint64     cref_size = cref->stat.st_size;
+    char        *header_end;
+    char        *read_ptr;
+    char        *end_ptr = buf + cref_size;
+    char        *trailer;
+    guint64     trailer_offset;
+    guint64     count;
+    guint64     value[7];
+    guint64     prev_offset = 0;
+    guint       i, j;
+
+    /* The trailer offset is the last field of the header line */
+    header_end = memchr(buf, '\n', cref_size);
+    if (header_end == NULL || header_end - buf < 10)
+        return(FALSE);
+
+    read_ptr = header_end - 10;
+    if ( !parse_uint(&read_ptr, end_ptr, &trailer_offset) )
+        return(FALSE);
+
+    if ( trailer_offset + strlen(SECTION_TABLE_TAG) + 1 >= cref_size )
+        return(FALSE);
+
+    /* The trailer runs to the end of the data (the last block of a block-compressed file) */
+    trailer = BLOCKS_at(cref->file, trailer_offset);
+    end_ptr = trailer + (cref_size - trailer_offset);
+
+    /* Databases without a section table carry the obsolete (dummy) trailer offset */
+    if ( strncmp(trailer, SECTION_TABLE_TAG " ", strlen(SECTION_TABLE_TAG) + 1) != 0 )
+        return(FALSE);
+
+    read_ptr = trailer + strlen(SECTION_TABLE_TAG) + 1;
+    if ( !parse_uint(&read_ptr, end_ptr, &count) || count > cref_size )
+        return(FALSE);
+
+    cref->section_table = g_malloc(count * sizeof(section_stats_t));
+
+    for (i = 0; i < count; i++)
+    {
+        for (j = 0; j < 7; j++)
+        {
+            if ( !parse_uint(&read_ptr, end_ptr, &value[j]) )
+                break;
+        }
+
+        /* Every entry must point at a file mark, in database order (the mark is not checked in
+           a block-compressed file: that would decompress all of it) */
+        if ( j < 7 || value[0] >= trailer_offset || value[0] < prev_offset ||
+             (!BLOCKS_compressed(cref->file) && *BLOCKS_at(cref->file, value[0]) != NEWFILE) )
+        {
+            fprintf(stderr, "Warning: Ignoring damaged cross-reference section table\n");
+            g_free(cref->section_table);
+            cref->section_table = NULL;
+            return(FALSE);
+        }
+        prev_offset = value[0] + 1;
+
+        cref->section_table[i].offset               = value[0];
+        cref->section_table[i].counts.define_cnt     = value[1];
+        cref->section_table[i].counts.identifier_cnt = value[2];
+        cref->section_table[i].counts.fn_calls_cnt   = value[3];
+        cref->section_table[i].counts.fn_cnt         = value[4];
+        cref->section_table[i].counts.class_cnt      = value[5];
+        cref->section_table[i].counts.include_cnt    = value[6];
     }
-    while (!done);
-    return;
+
+    cref->nsections = count;
+    return(TRUE);
+}
+
+
+
+/* Construct the section table by scanning the cross-reference (databases written before the table existed) */
+static void derive_section_table(search_cref_t *cref)
+{
+    char        *read_ptr;
+    BLOCKS_scan_t   *scan;
+    guint       msections = 256;
+    section_stats_t *current = NULL;
+
+    cref->section_table = g_malloc(msections * sizeof(section_stats_t));
+    cref->nsections = 0;
+
+    scan = BLOCKS_scan_start(cref->file, &read_ptr);    /* Start at the beginning of the database */
+
+    for (;;)
+    {
+        while (*read_ptr++ != '\t');    /* Scan past the next tab */
+
+        if (*read_ptr == NEWFILE)
+        {
+            /* Check for end-of-symbols (the next block starts with a file mark's tab) */
+            if (read_ptr[1] == '\n')
+            {
+                if ( !BLOCKS_scan_next(scan, &read_ptr) )
+                    break;
+                continue;
+            }
+
+            if (cref->nsections == msections)
+            {
+                msections *= 2;
+                cref->section_table = g_realloc(cref->section_table, msections * sizeof(section_stats_t));
+            }
+            current = &(cref->section_table[cref->nsections++]);
+            current->offset = BLOCKS_scan_offset(scan, read_ptr);
+            memset(&(current->counts), 0, sizeof(stats_struct_t));
+        }
+        else if (current != NULL)
+        {
+            SEARCH_count_mark(&(current->counts), *read_ptr);
+        }
+    }
+
+    BLOCKS_scan_stop(scan);
 }
 
 
@@ -2374,51 +2842,12 @@ gboolean SEARCH_save_csv(gchar *filename)
 }
 
 
-/* Check for missing our updated source files */
+/* Check for missing, added or updated source files.  The check runs in the background (see
+   stale.c) and updates the cross-reference status indicator when it completes. */
 void SEARCH_check_cref()
 {
-    uint32_t    i;
-    char        *src_file;
-    struct      stat statstruct;
-    time_t      ref_time;
-    gboolean    ref_status = TRUE;
-
     if ( cref_status )     // Don't bother checking if we already know the cref is out-of-date
-    {
-        /* Get the update time for the current cross-reference file */
-        if ( stat(settings.refFile, &statstruct) != 0 )
-        {
-            /* Cross reference file doesn't exist, must have been deleted out from under us */
-            DISPLAY_set_cref_current(FALSE);
-            ref_status = FALSE;
-        }
-        else
-        {
-            ref_time = statstruct.st_mtime;
-
-            for (i = 0; i < nsrcfiles; ++i)
-            {
-                src_file = DIR_src_files[i];
-
-                if ( stat(src_file, &statstruct) != 0 )
-                {
-                    DISPLAY_set_cref_current(FALSE);
-                    ref_status = FALSE;
-                    break;
-                }
-
-                if ( statstruct.st_mtime > ref_time )
-                {
-                    DISPLAY_set_cref_current(FALSE);
-                    ref_status = FALSE;
-                    break;
-                }
-            }
-        }
-
-        DISPLAY_set_cref_current(ref_status);
-        SEARCH_set_cref_status(ref_status);
-    }
+        STALE_start();
 }
 
 
@@ -1,4 +1,6 @@
 
+#include <sys/stat.h>
+
 typedef enum  {
     FIND_SYMBOL = 0,
     FIND_DEF,
@@ -30,6 +32,28 @@ typedef struct
 } stats_struct_t;
 
 
+/* Section table entry: symbol counts for one file section of the cross-reference */
+typedef struct
+{
+    guint64         offset;     /* Offset of the section's NEWFILE mark */
+    stats_struct_t  counts;
+} section_stats_t;
+
+#define SECTION_TABLE_TAG   "sections"  /* First word of the section table (the cross-reference trailer) */
+
+
+/* Symbol counts for the files in one top-level directory (see SEARCH_stats_by_dir) */
+typedef struct
+{
+    gchar           *dir;       /* "." for the files directly in the source directory */
+    guint           files;
+    stats_struct_t  counts;
+} dir_stats_t;
+
+
+typedef struct search_cref search_cref_t;   /* A loaded cross-reference and its derived indexes */
+
+
 typedef struct
 {
     gchar       *start_ptr;
@@ -43,8 +67,16 @@ typedef struct
 //===============================================================
 
 void                SEARCH_init     (void);
+search_cref_t *     SEARCH_load_cref(void);
+void                SEARCH_install_cref(search_cref_t *cref);
+gboolean            SEARCH_cref_replaced(void);
+gboolean            SEARCH_ready    (void);
+gboolean            SEARCH_busy     (void);
 search_results_t *  SEARCH_lookup   (search_t search_operation, gchar *pattern);
 void                SEARCH_stats    (stats_struct_t *sptr);
+GArray *            SEARCH_stats_by_dir(void);
+void                SEARCH_free_dir_stats(GArray *dir_stats);
+void                SEARCH_count_mark(stats_struct_t *sptr, char mark);
 void                SEARCH_cleanup  (void);
 gboolean            SEARCH_save_html(gchar *filename);
 gboolean            SEARCH_save_text(gchar *filename);
@@ -60,3 +92,4 @@ void                SEARCH_free_results   (search_results_t *results);
 //===============================================================
 
 extern FILE     *refsfound;    /* references found file */
+extern stats_struct_t section_stats;    /* symbol counts for the file section being written (crossref.c) */
@@ -0,0 +1,246 @@
+/*
+ *  gscope cross-reference section cache
+ *
+ *  An entry is one file:
+ *
+ *      gscope-section <format> <size> <mtime> <fingerprint>
+ *      <file path>
+ *      <cross-reference section: file mark ... trailing tab>
+ *      <file mark>
+ *
+ *  The trailing file mark ends the section for copydata(), which copies a cached section
+ *  into the new cross-reference exactly as it copies an old cross-reference's section.
+ *  Entries are written to a temporary file and renamed into place, so concurrent builds
+ *  (and other users of a shared cache) never see a partial entry.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "dir.h"
+#include "scanner.h"
+#include "sectcache.h"
+
+
+//===============================================================
+//      Private Function Prototypes
+//===============================================================
+
+static gboolean select_cache    (const gchar *option_name, const gchar *value, gpointer data, GError **error);
+static gchar    *entry_name     (const gchar *file);
+static gchar    *fingerprint    (const gchar *file);
+static gchar    *entry_header   (const gchar *format, struct stat *file_stat, const gchar *file_fingerprint, const gchar *file);
+
+
+
+//===============================================================
+//      Private Globals
+//===============================================================
+
+static gchar    *cache_dir = NULL;      /* NULL: no section cache */
+
+
+
+//===============================================================
+//      Public Globals
+//===============================================================
+
+GOptionEntry SECTCACHE_options[] = {
+    {
+        "section-cache", 0, G_OPTION_FLAG_OPTIONAL_ARG, G_OPTION_ARG_CALLBACK, select_cache,
+        "Cache the cross-reference of files found on the #include search path in DIR (default ~/.cache/" SECTCACHE_DEFAULT_DIR ").", "DIR"
+    },
+    { NULL }
+};
+
+
+
+//===============================================================
+//      Private Functions
+//===============================================================
+
+static gboolean select_cache(const gchar *option_name, const gchar *value, gpointer data, GError **error)
+{
+    g_free(cache_dir);
+
+    if (value && *value)
+        cache_dir = g_strdup(value);
+    else
+        cache_dir = g_build_filename(g_get_user_cache_dir(), SECTCACHE_DEFAULT_DIR, NULL);
+
+    return(TRUE);
+}
+
+
+
+static gchar *entry_name(const gchar *file)
+{
+    gchar   *key;
+    gchar   *name;
+
+    key  = g_compute_checksum_for_string(G_CHECKSUM_SHA1, file, -1);
+    name = g_strconcat(cache_dir, "/", key, SECTCACHE_SUFFIX, NULL);
+    g_free(key);
+
+    return(name);
+}
+
+
+
+/* SHA-1 of the file contents (NULL if the file can't be read) */
+static gchar *fingerprint(const gchar *file)
+{
+    gchar   *contents;
+    gsize   length;
+    gchar   *result;
+
+    if ( !g_file_get_contents(file, &contents, &length, NULL) )
+        return(NULL);
+
+    result = g_compute_checksum_for_data(G_CHECKSUM_SHA1, (guchar *) contents, length);
+    g_free(contents);
+
+    return(result);
+}
+
+
+
+/* The entry's first two lines: everything that must match for the section to be re-used */
+static gchar *entry_header(const gchar *format, struct stat *file_stat, const gchar *file_fingerprint, const gchar *file)
+{
+    return( g_strdup_printf("%s %s %" G_GINT64_FORMAT " %" G_GINT64_FORMAT " %s\n%s\n", SECTCACHE_MAGIC, format,
+                            (gint64) file_stat->st_size, (gint64) file_stat->st_mtime, file_fingerprint, file) );
+}
+
+
+
+//===============================================================
+//      Public Interface Functions
+//===============================================================
+
+/* Is the file's section cached?  (Only files found on the #include search path are) */
+gboolean SECTCACHE_enabled(gchar *file)
+{
+    return( cache_dir != NULL && file[0] == '/' && DIR_file_on_include_search_path(file) );
+}
+
+
+
+/* Look up a file's cached section.  'format' describes the cross-reference section format
+   (version and options).  Returns the entry (g_free() it once the section has been copied)
+   with *section pointing at the section, or NULL if there is no current entry. */
+gchar *SECTCACHE_lookup(const gchar *file, const gchar *format, gchar **section)
+{
+    struct stat file_stat;
+    gchar       *name;
+    gchar       *entry;
+    gsize       length;
+    gchar       *file_fingerprint;
+    gchar       *header;
+    gsize       header_length;
+    gboolean    current = FALSE;
+
+    if ( stat(file, &file_stat) != 0 )
+        return(NULL);
+
+    name = entry_name(file);
+    if ( !g_file_get_contents(name, &entry, &length, NULL) )
+    {
+        g_free(name);
+        return(NULL);
+    }
+    g_free(name);
+
+    /* Check the size and time first: the fingerprint means reading the file */
+    header = entry_header(format, &file_stat, "", file);
+    header_length = strchr(header, '\n') - header;
+
+    if ( length > header_length && strncmp(entry, header, header_length) == 0 &&
+         entry[length - 1] == NEWFILE && entry[length - 2] == '\t' &&
+         (file_fingerprint = fingerprint(file)) != NULL )
+    {
+        g_free(header);
+        header = entry_header(format, &file_stat, file_fingerprint, file);
+        header_length = strlen(header);
+        g_free(file_fingerprint);
+
+        current = ( length > header_length + 2 && strncmp(entry, header, header_length) == 0 &&
+                    entry[header_length] == NEWFILE );
+    }
+    g_free(header);
+
+    if ( !current )
+    {
+        g_free(entry);
+        return(NULL);
+    }
+
+    *section = entry + header_length;
+    return(entry);
+}
+
+
+
+/* Save the section just written to the new cross-reference (cref_fd) at 'offset' */
+void SECTCACHE_store(const gchar *file, const gchar *format, int cref_fd, guint32 offset, guint32 size)
+{
+    struct stat file_stat;
+    gchar       *file_fingerprint;
+    gchar       *header;
+    gchar       *name;
+    gchar       *temp_name;
+    gchar       *data;
+    FILE        *temp;
+    int         temp_fd;
+    gboolean    written;
+
+    if ( stat(file, &file_stat) != 0 || (file_fingerprint = fingerprint(file)) == NULL )
+        return;
+
+    data = g_malloc(size);
+    if ( pread(cref_fd, data, size, offset) != (ssize_t) size )
+    {
+        g_free(data);
+        g_free(file_fingerprint);
+        return;
+    }
+
+    header = entry_header(format, &file_stat, file_fingerprint, file);
+    g_free(file_fingerprint);
+
+    (void) g_mkdir_with_parents(cache_dir, 0777);
+    name      = entry_name(file);
+    temp_name = g_strconcat(name, ".XXXXXX", NULL);
+
+    if ( (temp_fd = g_mkstemp(temp_name)) >= 0 && (temp = fdopen(temp_fd, "w")) != NULL )
+    {
+        (void) fchmod(temp_fd, 0644);
+
+        written = fputs(header, temp) != EOF &&
+                  fwrite(data, 1, size, temp) == size &&
+                  putc(NEWFILE, temp) != EOF;
+
+        if ( fclose(temp) != 0 || !written || rename(temp_name, name) != 0 )
+            (void) unlink(temp_name);
+    }
+    else if (temp_fd >= 0)
+    {
+        close(temp_fd);
+        (void) unlink(temp_name);
+    }
+
+    g_free(header);
+    g_free(name);
+    g_free(temp_name);
+    g_free(data);
+}
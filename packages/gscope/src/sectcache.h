@@ -0,0 +1,29 @@
+
+/* Cross-reference section cache for #include search path files:
+ *
+ *   gscope --section-cache[=DIR] ...
+ *
+ * System and SDK headers pulled in through the #include search path (-I) are the same for
+ * every checkout, yet every new cross-reference parses them again.  With a section cache,
+ * the cross-reference section of every such file is saved in DIR (default: the per-user
+ * cache directory, see SECTCACHE_DEFAULT_DIR) and later builds copy the saved section
+ * instead of parsing the file.  DIR may be shared by several users.
+ *
+ * An entry is keyed by the file's path and checked against the file's size, modification
+ * time and content fingerprint (SHA-1), and against the cross-reference format options.
+ */
+
+#define SECTCACHE_DEFAULT_DIR   "gscope/sections"   /* Under g_get_user_cache_dir() */
+#define SECTCACHE_SUFFIX        ".sec"              /* Entry file name: <SHA-1 of the path>.sec */
+#define SECTCACHE_MAGIC         "gscope-section"    /* First word of an entry */
+
+extern GOptionEntry SECTCACHE_options[];    /* Command line options: --section-cache */
+
+
+//===============================================================
+//      Public Interface Functions
+//===============================================================
+
+gboolean    SECTCACHE_enabled   (gchar *file);
+gchar *     SECTCACHE_lookup    (const gchar *file, const gchar *format, gchar **section);
+void        SECTCACHE_store     (const gchar *file, const gchar *format, int cref_fd, guint32 offset, guint32 size);
@@ -0,0 +1,515 @@
+/*
+ *  gscope query daemon
+ *
+ *  Keeps the cross-reference database resident and answers queries from any number of
+ *  local clients (editor integrations, scripts) over a Unix domain socket, so a lookup
+ *  costs only the matching work instead of a full database load.
+ *
+ *  Connections are multiplexed with poll().  The search module is not re-entrant, so each
+ *  request is answered by a forked worker process: it shares the daemon's cross-reference
+ *  mapping (copy-on-write, nothing is copied), writes its answer to a pipe and exits.  Up to
+ *  SERVE_MAX_WORKERS requests are answered at once, so one slow regular expression doesn't
+ *  hold up every other client.  A client has at most one request in progress (its answers
+ *  stay in request order), and clients are served round-robin (one request per client per
+ *  pass) so a long pipelined batch from one client cannot starve the others.  Answers are
+ *  queued per client and written as the socket drains.
+ *
+ *  With --search-also the helper processes can only serve one lookup at a time, so requests
+ *  are answered in the daemon itself, one at a time.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "search.h"
+#include "build.h"
+#include "app_config.h"
+#include "query.h"
+#include "federate.h"
+#include "serve.h"
+
+
+//===============================================================
+//      Defines
+//===============================================================
+
+#define MAX_REQUEST_SIZE    (64 * 1024)     /* A longer request line drops the client */
+#define READ_CHUNK          4096
+#define SERVE_MAX_WORKERS   8               /* Requests answered at the same time */
+
+
+typedef struct
+{
+    int         fd;
+    GString     *input;         /* Received bytes not yet answered */
+    GString     *output;        /* Queued answer bytes */
+    gsize       output_pos;     /* Bytes of output already sent */
+    gboolean    eof;            /* Client closed its sending side */
+    int         answer_fd;      /* Pipe from the worker answering its request (-1: none) */
+    pid_t       worker;
+} client_t;
+
+
+
+//===============================================================
+//      Private Function Prototypes
+//===============================================================
+
+static void     on_signal(int signum);
+static int      open_socket(const gchar *path);
+static void     reload_if_replaced(void);
+static void     client_add(GPtrArray *clients, int fd);
+static void     client_free(client_t *client);
+static gboolean client_read(client_t *client);
+static gboolean client_answer_one(client_t *client);
+static gboolean start_worker(client_t *client, const gchar *request);
+static void     read_worker(client_t *client);
+static void     stop_worker(client_t *client);
+static gboolean client_write(client_t *client);
+
+
+
+//===============================================================
+//      Private Globals
+//===============================================================
+
+static gchar    *socket_path = NULL;
+static guint    nworkers = 0;
+static volatile sig_atomic_t stop_requested = 0;
+
+
+GOptionEntry SERVE_options[] = {
+    {
+        "serve", 0, 0, G_OPTION_ARG_FILENAME, &socket_path,
+        "Daemon mode, no GUI.  Answer line-mode queries (see -L) from clients connected to this Unix socket.  "
+        "Up to 8 queries are answered at once (one at a time with --search-also).", "SOCKET"
+    },
+    { NULL }
+};
+
+
+
+//===============================================================
+//      Private Functions
+//===============================================================
+
+static void on_signal(int signum)
+{
+    stop_requested = 1;
+}
+
+
+/* Create the listening socket.  A stale socket left by a daemon that died is replaced;
+   a live one (or any other kind of file) is an error. */
+static int open_socket(const gchar *path)
+{
+    struct sockaddr_un  addr;
+    struct stat         statstruct;
+    int                 fd;
+
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "Error: Socket path is too long: %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    if ( (fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 )
+    {
+        fprintf(stderr, "Error: Unable to create socket: %s\n", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    if ( lstat(path, &statstruct) == 0 )
+    {
+        if ( !S_ISSOCK(statstruct.st_mode) )
+        {
+            fprintf(stderr, "Error: %s exists and is not a socket\n", path);
+            exit(EXIT_FAILURE);
+        }
+        if ( connect(fd, (struct sockaddr *) &addr, sizeof(addr)) == 0 )
+        {
+            fprintf(stderr, "Error: Another gscope daemon is already serving %s\n", path);
+            exit(EXIT_FAILURE);
+        }
+        (void) unlink(path);
+    }
+
+    if ( bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0 )
+    {
+        fprintf(stderr, "Error: Unable to listen on %s: %s\n", path, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return(fd);
+}
+
+
+/* Swap in a new cross-reference if the file has been replaced since it was loaded
+   (see SEARCH_cref_replaced).  A missing file (mid-replacement) keeps the old one. */
+static void reload_if_replaced(void)
+{
+    if ( !SEARCH_cref_replaced() )
+        return;
+
+    fprintf(stderr, "gscope: Cross-reference %s has changed, reloading\n", settings.refFile);
+
+    settings.noBuild = TRUE;    /* Load the new file as-is, never rebuild it here */
+    BUILD_initDatabase();
+}
+
+
+static void client_add(GPtrArray *clients, int fd)
+{
+    client_t *client;
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    client = g_malloc0(sizeof(client_t));
+    client->fd     = fd;
+    client->input  = g_string_new(NULL);
+    client->output = g_string_new(NULL);
+    client->answer_fd = -1;
+
+    g_ptr_array_add(clients, client);
+}
+
+
+static void client_free(client_t *client)
+{
+    if (client->answer_fd >= 0)
+        stop_worker(client);
+
+    close(client->fd);
+    g_string_free(client->input, TRUE);
+    g_string_free(client->output, TRUE);
+    g_free(client);
+}
+
+
+/* Returns FALSE if the client must be dropped */
+static gboolean client_read(client_t *client)
+{
+    char    buf[READ_CHUNK];
+    ssize_t length;
+
+    length = read(client->fd, buf, sizeof(buf));
+
+    if (length < 0)
+        return(errno == EAGAIN || errno == EINTR);
+
+    if (length == 0)
+    {
+        client->eof = TRUE;
+        return(TRUE);
+    }
+
+    g_string_append_len(client->input, buf, length);
+
+    if (client->input->len > MAX_REQUEST_SIZE && memchr(client->input->str, '\n', client->input->len) == NULL)
+    {
+        fprintf(stderr, "gscope: Dropping client: request exceeds %d bytes\n", MAX_REQUEST_SIZE);
+        return(FALSE);
+    }
+    return(TRUE);
+}
+
+
+/* Answer the first complete request line, if any.  Returns TRUE if a request was answered
+   (in the daemon), FALSE if there is none or it has been handed to a worker. */
+static gboolean client_answer_one(client_t *client)
+{
+    gchar   *eol;
+    gchar   *answer;
+    size_t  answer_size;
+    FILE    *output;
+    gsize   length;
+
+    if (client->answer_fd >= 0)     /* Its previous request is still being answered */
+        return(FALSE);
+
+    while ( (eol = memchr(client->input->str, '\n', client->input->len)) != NULL )
+    {
+        length = eol - client->input->str;
+        *eol = '\0';
+        if (length > 0 && eol[-1] == '\r')
+            eol[-1] = '\0';
+
+        if (client->input->str[0] != '\0')
+        {
+            if ( !FEDERATE_active() )
+            {
+                if (nworkers >= SERVE_MAX_WORKERS)
+                {
+                    *eol = '\n';       /* Answered once a worker is free */
+                    return(FALSE);
+                }
+
+                reload_if_replaced();
+                if ( start_worker(client, client->input->str) )
+                {
+                    g_string_erase(client->input, 0, length + 1);
+                    return(FALSE);
+                }
+            }
+
+            if ( (output = open_memstream(&answer, &answer_size)) == NULL )
+            {
+                fprintf(stderr, "Error: Unable to allocate an answer buffer: %s\n", strerror(errno));
+                exit(EXIT_FAILURE);
+            }
+
+            reload_if_replaced();
+            QUERY_answer(output, client->input->str);
+            fclose(output);
+
+            g_string_append_len(client->output, answer, answer_size);
+            free(answer);
+            g_string_erase(client->input, 0, length + 1);
+            return(TRUE);
+        }
+
+        g_string_erase(client->input, 0, length + 1);     /* Skip blank lines */
+    }
+    return(FALSE);
+}
+
+
+/* Fork a worker to answer a request.  Returns FALSE if it can't be started. */
+static gboolean start_worker(client_t *client, const gchar *request)
+{
+    int     pipe_fds[2];
+    pid_t   pid;
+    FILE    *output;
+
+    if ( pipe(pipe_fds) != 0 )
+        return(FALSE);
+
+    if ( (pid = fork()) < 0 )
+    {
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+        return(FALSE);
+    }
+
+    if (pid == 0)
+    {
+        /* The worker: answer, remove its temporary files and exit without touching the daemon's state */
+        signal(SIGINT,  SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        signal(SIGHUP,  SIG_DFL);
+        close(pipe_fds[0]);
+
+        if ( (output = fdopen(pipe_fds[1], "w")) != NULL )
+        {
+            QUERY_answer(output, (gchar *) request);
+            fclose(output);
+        }
+        SEARCH_cleanup();
+        _exit(EXIT_SUCCESS);
+    }
+
+    close(pipe_fds[1]);
+    fcntl(pipe_fds[0], F_SETFL, fcntl(pipe_fds[0], F_GETFL) | O_NONBLOCK);
+
+    client->answer_fd = pipe_fds[0];
+    client->worker    = pid;
+    nworkers++;
+    return(TRUE);
+}
+
+
+/* Queue what the worker has answered so far.  The answer is complete at end-of-file. */
+static void read_worker(client_t *client)
+{
+    char    buf[READ_CHUNK];
+    ssize_t length;
+
+    while ( (length = read(client->answer_fd, buf, sizeof(buf))) > 0 )
+        g_string_append_len(client->output, buf, length);
+
+    if (length == 0 || (errno != EAGAIN && errno != EINTR))
+    {
+        close(client->answer_fd);
+        (void) waitpid(client->worker, NULL, 0);
+        client->answer_fd = -1;
+        nworkers--;
+    }
+}
+
+
+/* The client has gone: its answer is not needed */
+static void stop_worker(client_t *client)
+{
+    kill(client->worker, SIGKILL);
+    close(client->answer_fd);
+    (void) waitpid(client->worker, NULL, 0);
+    client->answer_fd = -1;
+    nworkers--;
+}
+
+
+/* Returns FALSE if the client must be dropped */
+static gboolean client_write(client_t *client)
+{
+    ssize_t length;
+
+    length = send(client->fd, client->output->str + client->output_pos,
+                  client->output->len - client->output_pos, MSG_NOSIGNAL);
+    if (length < 0)
+        return(errno == EAGAIN || errno == EINTR);
+
+    client->output_pos += length;
+    if (client->output_pos == client->output->len)
+    {
+        g_string_truncate(client->output, 0);
+        client->output_pos = 0;
+    }
+    return(TRUE);
+}
+
+
+
+//===============================================================
+//      Public Interface Functions
+//===============================================================
+
+/* TRUE if the command line asked for daemon mode */
+gboolean SERVE_requested(void)
+{
+    return(socket_path != NULL);
+}
+
+
+/* Run the query daemon until SIGINT/SIGTERM, returns the process exit status */
+int SERVE_main(void)
+{
+    struct sigaction action;
+    struct pollfd   *fds = NULL;
+    GPtrArray       *clients;
+    client_t        *client;
+    int             listen_fd;
+    int             fd;
+    guint           i;
+    gboolean        answered;
+    gboolean        keep;
+
+    /* Stdout is not used by the daemon: configuration and build reporting goes to stderr */
+    fflush(stdout);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+
+    listen_fd = open_socket(socket_path);
+
+    APP_CONFIG_init(NULL);
+    BUILD_initDatabase();
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = on_signal;
+    sigaction(SIGINT,  &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    sigaction(SIGHUP,  &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    fprintf(stderr, "gscope: Serving %s on %s\n", settings.refFile, socket_path);
+
+    clients = g_ptr_array_new();
+
+    while (!stop_requested)
+    {
+        /* Answer one pending request per client per pass */
+        answered = FALSE;
+        for (i = 0; i < clients->len; i++)
+            answered |= client_answer_one(g_ptr_array_index(clients, i));
+
+        /* fds[0]: the listening socket, then each client's socket and worker pipe (-1: ignored by poll) */
+        fds = g_realloc(fds, (2 * clients->len + 1) * sizeof(struct pollfd));
+        fds[0].fd = listen_fd;
+        fds[0].events = POLLIN;
+        for (i = 0; i < clients->len; i++)
+        {
+            client = g_ptr_array_index(clients, i);
+            fds[2 * i + 1].fd = client->fd;
+            fds[2 * i + 1].events = (client->eof ? 0 : POLLIN) | (client->output->len ? POLLOUT : 0);
+            fds[2 * i + 1].revents = 0;
+            fds[2 * i + 2].fd = client->answer_fd;
+            fds[2 * i + 2].events = POLLIN;
+            fds[2 * i + 2].revents = 0;
+        }
+
+        /* Don't block while answers can still be produced from buffered requests */
+        if ( poll(fds, 2 * clients->len + 1, answered ? 0 : -1) < 0 )
+        {
+            if (errno == EINTR)
+                continue;
+            fprintf(stderr, "Error: poll() failed: %s\n", strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+
+        /* Service the existing clients (back to front so removal doesn't disturb the indexes) */
+        for (i = clients->len; i-- > 0; )
+        {
+            client = g_ptr_array_index(clients, i);
+            keep = TRUE;
+
+            if (client->answer_fd >= 0 && (fds[2 * i + 2].revents & (POLLIN | POLLHUP | POLLERR)))
+                read_worker(client);
+
+            if (fds[2 * i + 1].revents & (POLLERR | POLLNVAL))
+                keep = FALSE;
+            if (keep && (fds[2 * i + 1].revents & (POLLIN | POLLHUP)) && !client->eof)
+                keep = client_read(client);
+            if (keep && (fds[2 * i + 1].revents & POLLOUT))
+                keep = client_write(client);
+
+            /* A client that has hung up is done once its answers are all sent */
+            if (client->eof && client->answer_fd < 0 && client->output->len == 0 &&
+                memchr(client->input->str, '\n', client->input->len) == NULL)
+                keep = FALSE;
+
+            if (!keep)
+            {
+                client_free(client);
+                g_ptr_array_remove_index(clients, i);
+            }
+        }
+
+        if (fds[0].revents & POLLIN)
+        {
+            while ( (fd = accept(listen_fd, NULL, NULL)) >= 0 )
+                client_add(clients, fd);
+        }
+    }
+
+    fprintf(stderr, "gscope: Daemon stopping\n");
+
+    for (i = 0; i < clients->len; i++)
+        client_free(g_ptr_array_index(clients, i));
+    g_ptr_array_free(clients, TRUE);
+    g_free(fds);
+
+    close(listen_fd);
+    (void) unlink(socket_path);
+    SEARCH_cleanup();
+
+    return(EXIT_SUCCESS);
+}
@@ -0,0 +1,27 @@
+
+/* Query daemon:
+ *
+ *   gscope --serve SOCKET      Load the cross-reference once and answer queries on a Unix socket
+ *
+ * Requests and answers use the batch query protocol (see query.h).  Each request is one line:
+ *
+ *   <n><pattern>\n
+ *
+ * and each answer is a "gscope: <count> lines" header followed by exactly <count> result lines.
+ * A client may send any number of requests on one connection; they are answered in order.  Requests
+ * from different clients are answered concurrently by forked worker processes (one at a time with
+ * --search-also).  When the cross-reference file is replaced (by a rebuild in another process) the
+ * daemon reloads it before the next answer.
+ *
+ * Example client:  echo "1main" | socat - UNIX-CONNECT:SOCKET
+ */
+
+extern GOptionEntry SERVE_options[];    /* Command line options: --serve */
+
+
+//===============================================================
+//      Public Interface Functions
+//===============================================================
+
+gboolean    SERVE_requested (void);
+int         SERVE_main      (void);
@@ -0,0 +1,143 @@
+/*
+ *  gscope distributed (sharded) cross-reference builds
+ *
+ *  A shard is a contiguous range of the sorted original source file list, so shard 0 holds
+ *  the first files a single-process build would write and the merged file sections come
+ *  out of the partials largely in order.  The merge itself (see BUILD_merge) never parses a
+ *  source file: it reads the partial section tables and copies section data.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "app_config.h"
+#include "dir.h"
+#include "build.h"
+#include "shard.h"
+
+
+//===============================================================
+//      Private Globals
+//===============================================================
+
+static gchar    *shard_arg = NULL;      /* --shard I/N */
+static gboolean merge_requested = FALSE;
+static gboolean shard_parsed = FALSE;
+static guint32  shard_index;
+static guint32  shard_count;
+
+
+
+//===============================================================
+//      Public Globals
+//===============================================================
+
+GOptionEntry SHARD_options[] = {
+    {
+        "shard", 0, 0, G_OPTION_ARG_STRING, &shard_arg,
+        "Build a partial cross-reference for shard I (0-based) of N of the source files (see --merge).", "I/N"
+    },
+    {
+        "merge", 0, 0, G_OPTION_ARG_NONE, &merge_requested,
+        "Combine the partial cross-references named on the command line (built with --shard) into the cross-reference file.", NULL
+    },
+    { NULL }
+};
+
+
+
+//===============================================================
+//      Public Interface Functions
+//===============================================================
+
+/* Was --shard given?  Exits on a malformed I/N argument. */
+gboolean SHARD_build_requested()
+{
+    guint64 index;
+    guint64 count;
+    gchar   *end;
+
+    if (shard_arg == NULL)
+        return(FALSE);
+
+    if (!shard_parsed)
+    {
+        index = g_ascii_strtoull(shard_arg, &end, 10);
+        if (end == shard_arg || *end != '/')
+            index = G_MAXUINT64;
+
+        count = g_ascii_strtoull(end + 1, &end, 10);
+        if (*end != '\0' || count == 0 || count > G_MAXUINT32 || index >= count)
+        {
+            fprintf(stderr, "Error: Invalid --shard argument '%s' (expected I/N with 0 <= I < N)\n", shard_arg);
+            exit(EXIT_FAILURE);
+        }
+
+        shard_index  = index;
+        shard_count  = count;
+        shard_parsed = TRUE;
+    }
+
+    return(TRUE);
+}
+
+
+
+/* Get this build's shard (returns FALSE for a normal, complete, build) */
+gboolean SHARD_get(guint32 *index, guint32 *count)
+{
+    if ( !SHARD_build_requested() )
+        return(FALSE);
+
+    *index = shard_index;
+    *count = shard_count;
+    return(TRUE);
+}
+
+
+
+/* Narrow [first, last) of the nfiles original source files to this build's shard */
+void SHARD_range(guint32 nfiles, guint32 *first, guint32 *last)
+{
+    if ( !SHARD_build_requested() )
+        return;
+
+    *first = ((guint64) nfiles * shard_index) / shard_count;
+    *last  = ((guint64) nfiles * (shard_index + 1)) / shard_count;
+}
+
+
+
+gboolean SHARD_merge_requested()
+{
+    return(merge_requested);
+}
+
+
+
+/* Run the --merge mode, returns the process exit status */
+int SHARD_merge_main(int nfiles, char **files)
+{
+    if (nfiles == 0)
+    {
+        fprintf(stderr, "Error: --merge requires the partial cross-reference files to combine\n");
+        return(EXIT_FAILURE);
+    }
+
+    if (shard_arg)
+    {
+        fprintf(stderr, "Error: --merge and --shard cannot be used together\n");
+        return(EXIT_FAILURE);
+    }
+
+    DIR_get_path(DIR_INITIALIZE);   /* The data directory (header) and the ".new" file name */
+    BUILD_merge(nfiles, files);
+
+    return(EXIT_SUCCESS);
+}
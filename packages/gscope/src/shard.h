@@ -0,0 +1,29 @@
+
+/* Distributed cross-reference builds:
+ *
+ *   gscope -b -f part3.out --shard 3/8 ...     Build partial cross-reference 3 of 8
+ *   gscope -f cscope_db.out --merge part*.out  Combine the partials into one cross-reference
+ *
+ * Every shard walks the same source tree and sorts the same source file list, then parses
+ * only its own contiguous range of the original files (shard I of N, 0-based) plus the
+ * #include files that its files lead to.  A partial cross-reference is a normal one with an
+ * extra table after the section table: the build pass (1: original source file, 2: first
+ * level of #include files, ...) of every section.  The merge copies the sections, unparsed,
+ * in the order a single-process build would have written them, so run every shard with the
+ * same source options (-R, -S, -I, -i, source files) and from the same source tree.
+ */
+
+#define SHARD_TABLE_TAG     "shard"     /* First word of a partial cross-reference's pass table */
+
+extern GOptionEntry SHARD_options[];    /* Command line options: --shard, --merge */
+
+
+//===============================================================
+//      Public Interface Functions
+//===============================================================
+
+gboolean    SHARD_build_requested   (void);
+gboolean    SHARD_get               (guint32 *index, guint32 *count);
+void        SHARD_range             (guint32 nfiles, guint32 *first, guint32 *last);
+gboolean    SHARD_merge_requested   (void);
+int         SHARD_merge_main        (int nfiles, char **files);
@@ -0,0 +1,196 @@
+/*
+ *  gscope cross-reference sharing between instances
+ *
+ *  The build lock is an fcntl() write lock on <refFile>.lock (fcntl locks also work on NFS,
+ *  where shared checkouts usually live).  It is held from the start of a build until the new
+ *  cross-reference has been mapped, so a waiting instance never sees the short window in which
+ *  movefile() has unlinked the old file.  The generation stamp is a decimal number in
+ *  <refFile>.gen, replaced (write + rename) under the lock.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "app_config.h"
+#include "build.h"
+#include "core.h"
+#include "share.h"
+
+
+//===============================================================
+//      Private Function Prototypes
+//===============================================================
+
+static gchar    *side_file          (const gchar *suffix);
+static gint     read_generation     (void);
+static gboolean check_generation    (gpointer data);
+
+
+
+//===============================================================
+//      Private Globals
+//===============================================================
+
+static int                  lock_fd = -1;
+static gint                 lock_generation = 0;    /* Generation on disk while the lock is held */
+static gint                 loaded_generation = 0;  /* Generation this instance loaded (atomic) */
+static SHARE_published_func published_hook = NULL;
+
+
+
+//===============================================================
+//      Private Functions
+//===============================================================
+
+static gchar *side_file(const gchar *suffix)
+{
+    return( g_strconcat(settings.refFile, suffix, NULL) );
+}
+
+
+
+/* The published generation (0 if none has been stamped yet) */
+static gint read_generation()
+{
+    gchar   *file;
+    gchar   *contents;
+    gint    generation = 0;
+
+    file = side_file(SHARE_GEN_SUFFIX);
+    if ( g_file_get_contents(file, &contents, NULL, NULL) )
+    {
+        generation = atoi(contents);
+        g_free(contents);
+    }
+    g_free(file);
+
+    return(generation);
+}
+
+
+
+/* Main loop: has another instance published a cross-reference? */
+static gboolean check_generation(gpointer data)
+{
+    if ( !BUILD_in_progress() && read_generation() != g_atomic_int_get(&loaded_generation) )
+        published_hook();
+
+    return(TRUE);
+}
+
+
+
+//===============================================================
+//      Public Interface Functions
+//===============================================================
+
+/* Take the build lock, waiting while another instance builds.  Returns TRUE if that instance
+   published a new cross-reference meanwhile: load it instead of building the same one again.
+   The lock is released with SHARE_unlock() once the new cross-reference has been loaded. */
+gboolean SHARE_lock()
+{
+    struct flock    lock;
+    gchar           *file;
+    gint            generation;
+    gboolean        waited = FALSE;
+    int             status;
+
+    if (lock_fd < 0)
+    {
+        file = side_file(SHARE_LOCK_SUFFIX);
+        lock_fd = open(file, O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+        g_free(file);
+
+        if (lock_fd < 0)        /* e.g. no write permission in the data directory: build unshared */
+            return(FALSE);
+    }
+
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type   = F_WRLCK;
+    lock.l_whence = SEEK_SET;
+
+    generation = read_generation();
+
+    if ( fcntl(lock_fd, F_SETLK, &lock) == -1 && (errno == EACCES || errno == EAGAIN) )
+    {
+        if ( settings.refOnly )
+            fprintf(stderr, "Waiting for another gscope to finish building %s\n", settings.refFile);
+        else
+            CORE_build_phase("Waiting for another gscope to build the Cross Reference");
+
+        while ( (status = fcntl(lock_fd, F_SETLKW, &lock)) == -1 && errno == EINTR )
+            ;
+        waited = (status == 0);
+    }
+
+    lock_generation = read_generation();
+
+    return( waited && lock_generation != generation );
+}
+
+
+
+/* Stamp the cross-reference just built (and moved into place) with the next generation */
+void SHARE_publish()
+{
+    gchar   *file;
+    gchar   *new_file;
+    FILE    *stamp;
+
+    file     = side_file(SHARE_GEN_SUFFIX);
+    new_file = side_file(SHARE_GEN_SUFFIX ".new");
+
+    if ( (stamp = fopen(new_file, "w")) != NULL )
+    {
+        fprintf(stamp, "%d\n", lock_generation + 1);
+
+        if ( fclose(stamp) == 0 && rename(new_file, file) == 0 )
+            lock_generation++;
+        else
+            unlink(new_file);
+    }
+
+    g_free(file);
+    g_free(new_file);
+}
+
+
+
+/* The cross-reference (generation) has been loaded: let other instances build */
+void SHARE_unlock()
+{
+    struct flock    lock;
+
+    if (lock_fd < 0)
+    {
+        g_atomic_int_set(&loaded_generation, read_generation());
+        return;
+    }
+
+    g_atomic_int_set(&loaded_generation, lock_generation);
+
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type   = F_UNLCK;
+    lock.l_whence = SEEK_SET;
+    (void) fcntl(lock_fd, F_SETLK, &lock);
+}
+
+
+
+/* Call 'published' (on the main loop) whenever another instance publishes a cross-reference */
+void SHARE_monitor(SHARE_published_func published)
+{
+    if (published_hook == NULL)
+        g_timeout_add_seconds(SHARE_POLL_SEC, check_generation, NULL);
+
+    published_hook = published;
+}
@@ -0,0 +1,26 @@
+
+/* Cross-reference sharing between gscope instances (one project, several users).
+ *
+ * Builds are serialized with an advisory (fcntl) lock on <refFile>.lock.  An instance that
+ * finds another instance building waits for it and then loads the published result instead
+ * of building the same cross-reference again.  Each publish bumps a generation number kept
+ * in <refFile>.gen; running instances read it every SHARE_POLL_SEC seconds and load a
+ * generation that another instance published.  The cross-reference file itself is
+ * mapped read-only, so the page cache holds one copy for every instance.
+ */
+
+#define SHARE_LOCK_SUFFIX   ".lock"     /* Lock file name: <refFile>.lock */
+#define SHARE_GEN_SUFFIX    ".gen"      /* Generation stamp file name: <refFile>.gen */
+#define SHARE_POLL_SEC      5           /* Generation check interval */
+
+typedef void (*SHARE_published_func)(void);
+
+
+//===============================================================
+//      Public Interface Functions
+//===============================================================
+
+gboolean    SHARE_lock      (void);
+void        SHARE_publish   (void);
+void        SHARE_unlock    (void);
+void        SHARE_monitor   (SHARE_published_func published);
@@ -0,0 +1,432 @@
+/*
+ *  gscope background cross-reference staleness check
+ *
+ *  The check runs on its own thread so that slow (e.g. NFS) stat() calls never stall the
+ *  GTK main loop.  The thread only touches its own check record and a reference to the
+ *  source file list it was started with; everything else (status indicator, results,
+ *  rebuild) happens on the main loop when the thread hands the record back with g_idle_add().
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "app_config.h"
+#include "dir.h"
+#include "build.h"
+#include "core.h"
+#include "search.h"
+#include "utils.h"
+#include "stale.h"
+
+
+//===============================================================
+//      Defines
+//===============================================================
+
+#define STALE_NICE      19      /* Check thread scheduling priority */
+
+typedef struct
+{
+    DIR_src_list_t  *list;          /* Source file list being checked (referenced) */
+    gchar           *base;          /* Directory of relative source file names (with trailing '/') */
+    gchar           *ref_file;      /* Absolute cross-reference file name */
+    gboolean        find_added;     /* Search the list's directories for new source files */
+    gchar           *flat_prefix;   /* Flat search: the one directory searched.  NULL: recursive */
+    gint            cancel;
+
+    /* Results (file names as they appear in the source file list) */
+    gboolean        ref_missing;
+    GHashTable      *modified;
+    GHashTable      *added;
+    GHashTable      *deleted;
+} stale_check_t;
+
+
+//===============================================================
+//      Private Function Prototypes
+//===============================================================
+
+static gpointer     check_thread    (gpointer data);
+static gboolean     check_done      (gpointer data);
+static void         find_added      (stale_check_t *check, GHashTable *listed, GHashTable *dirs);
+static const gchar  *full_path      (stale_check_t *check, const gchar *name, GString *buf);
+static void         add_name        (GHashTable *set, const gchar *name);
+static void         append_names    (GString *summary, const gchar *label, GHashTable *set);
+static void         free_check      (stale_check_t *check);
+
+
+
+//===============================================================
+//      Private Globals
+//===============================================================
+
+static stale_check_t    *running = NULL;    /* Check in progress */
+static stale_check_t    *result  = NULL;    /* Last completed check (changes not yet taken) */
+
+
+
+//===============================================================
+//      Private Functions
+//===============================================================
+
+static gpointer check_thread(gpointer data)
+{
+    stale_check_t   *check = data;
+    DIR_src_iter_t  iter;
+    GHashTable      *listed = NULL;
+    GHashTable      *dirs = NULL;
+    GString         *path;
+    gchar           **batch;
+    const char      *name;
+    const char      *slash;
+    gchar           *dir;
+    struct stat     statstruct;
+    time_t          ref_time;
+    guint           count;
+    guint           i;
+
+    #ifdef __linux__
+    /* On Linux, this only lowers the priority of the calling thread */
+    (void) setpriority(PRIO_PROCESS, 0, STALE_NICE);
+    #endif
+
+    if ( stat(check->ref_file, &statstruct) != 0 )
+    {
+        /* Cross reference file doesn't exist, must have been deleted out from under us */
+        check->ref_missing = TRUE;
+        g_idle_add(check_done, check);
+        return(NULL);
+    }
+    ref_time = statstruct.st_mtime;
+
+    if (check->find_added)
+    {
+        listed = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+        dirs   = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    }
+
+    path  = g_string_new(NULL);
+    batch = g_new0(gchar *, STALE_BATCH_SIZE);
+
+    DIR_src_list_iter_init(&iter, check->list, 0);
+    do
+    {
+        /* Collect a batch of names, then stat them back-to-back */
+        for (count = 0; count < STALE_BATCH_SIZE && (name = DIR_src_iter_next(&iter)) != NULL; count++)
+            batch[count] = g_strdup(name);
+
+        for (i = 0; i < count; i++)
+        {
+            if ( stat(full_path(check, batch[i], path), &statstruct) != 0 )
+                add_name(check->deleted, batch[i]);
+            else if ( statstruct.st_mtime > ref_time )
+                add_name(check->modified, batch[i]);
+
+            if (listed)
+            {
+                /* Relative directories were searched (the flat search directory is added below) */
+                if ( check->flat_prefix == NULL && batch[i][0] != '/' && (slash = strrchr(batch[i], '/')) != NULL )
+                    dir = g_strndup(batch[i], slash - batch[i] + 1);
+                else if (check->flat_prefix == NULL && batch[i][0] != '/')
+                    dir = g_strdup("");
+                else
+                    dir = NULL;
+
+                if ( dir && g_hash_table_lookup_extended(dirs, dir, NULL, NULL) )
+                    g_free(dir);
+                else if (dir)
+                    g_hash_table_insert(dirs, dir, NULL);
+
+                g_hash_table_insert(listed, batch[i], NULL);    /* Takes the name */
+            }
+            else
+                g_free(batch[i]);
+        }
+    } while ( count == STALE_BATCH_SIZE && !g_atomic_int_get(&check->cancel) );
+
+    if ( listed && !g_atomic_int_get(&check->cancel) )
+    {
+        if (check->flat_prefix)
+            g_hash_table_insert(dirs, g_strdup(check->flat_prefix), NULL);
+        find_added(check, listed, dirs);
+    }
+
+    if (listed)
+    {
+        g_hash_table_destroy(listed);
+        g_hash_table_destroy(dirs);
+    }
+    g_string_free(path, TRUE);
+    g_free(batch);
+
+    g_idle_add(check_done, check);
+    return(NULL);
+}
+
+
+
+/* Source files in a searched directory that are not in the list are new */
+static void find_added(stale_check_t *check, GHashTable *listed, GHashTable *dirs)
+{
+    GHashTableIter  iter;
+    gpointer        prefix;
+    GString         *path;
+    GString         *name;
+    DIR             *dirfile;
+    struct dirent   *entry;
+
+    path = g_string_new(NULL);
+    name = g_string_new(NULL);
+
+    g_hash_table_iter_init(&iter, dirs);
+    while ( g_hash_table_iter_next(&iter, &prefix, NULL) && !g_atomic_int_get(&check->cancel) )
+    {
+        if ( (dirfile = opendir(full_path(check, (*(gchar *) prefix) ? prefix : ".", path))) == NULL )
+            continue;
+
+        while ( (entry = readdir(dirfile)) != NULL )
+        {
+            #ifdef _DIRENT_HAVE_D_TYPE
+            if (entry->d_type == DT_DIR)
+                continue;
+            #endif
+            if ( entry->d_ino == 0 || !DIR_is_src_file(entry->d_name) )
+                continue;
+
+            g_string_assign(name, prefix);
+            g_string_append(name, entry->d_name);
+
+            if ( !g_hash_table_lookup_extended(listed, name->str, NULL, NULL) )
+                add_name(check->added, name->str);
+        }
+        closedir(dirfile);
+    }
+
+    g_string_free(path, TRUE);
+    g_string_free(name, TRUE);
+}
+
+
+
+/* Source file names are relative to the source directory (the process CWD may change during a build) */
+static const gchar *full_path(stale_check_t *check, const gchar *name, GString *buf)
+{
+    if (name[0] == '/')
+        return(name);
+
+    g_string_assign(buf, check->base);
+    g_string_append(buf, name);
+    return(buf->str);
+}
+
+
+
+static void add_name(GHashTable *set, const gchar *name)
+{
+    gchar   *key;
+
+    key = g_strdup(name);
+    g_hash_table_insert(set, key, key);
+}
+
+
+
+/* Main loop: publish the result of a finished check */
+static gboolean check_done(gpointer data)
+{
+    stale_check_t   *check = data;
+    GString         *summary;
+    gboolean        up_to_date;
+
+    if (running == check)
+        running = NULL;
+
+    if ( g_atomic_int_get(&check->cancel) )
+    {
+        free_check(check);
+        return(FALSE);
+    }
+
+    if (result)
+        free_check(result);
+    result = check;
+
+    up_to_date = !check->ref_missing &&
+                 g_hash_table_size(check->modified) == 0 &&
+                 g_hash_table_size(check->added)    == 0 &&
+                 g_hash_table_size(check->deleted)  == 0;
+
+    CORE_cref_current(up_to_date);
+    SEARCH_set_cref_status(up_to_date);
+
+    if ( !up_to_date )
+    {
+        summary = g_string_new(NULL);
+
+        if (check->ref_missing)
+            g_string_append(summary, "The cross-reference file is missing.");
+        else
+        {
+            append_names(summary, "Modified", check->modified);
+            append_names(summary, "Added",    check->added);
+            append_names(summary, "Deleted",  check->deleted);
+        }
+
+        CORE_cref_changes(summary->str);
+        g_string_free(summary, TRUE);
+    }
+
+    return(FALSE);
+}
+
+
+
+static void append_names(GString *summary, const gchar *label, GHashTable *set)
+{
+    GHashTableIter  iter;
+    gpointer        name;
+    guint           shown = 0;
+
+    if ( g_hash_table_size(set) == 0 )
+        return;
+
+    if (summary->len)
+        g_string_append_c(summary, '\n');
+    g_string_append_printf(summary, "%s (%u):", label, g_hash_table_size(set));
+
+    g_hash_table_iter_init(&iter, set);
+    while ( shown < STALE_TOOLTIP_FILES && g_hash_table_iter_next(&iter, &name, NULL) )
+    {
+        g_string_append_printf(summary, "\n    %s", (gchar *) name);
+        shown++;
+    }
+
+    if ( g_hash_table_size(set) > shown )
+        g_string_append_printf(summary, "\n    ... and %u more", g_hash_table_size(set) - shown);
+}
+
+
+
+static void free_check(stale_check_t *check)
+{
+    DIR_src_list_unref(check->list);
+    g_free(check->base);
+    g_free(check->ref_file);
+    g_free(check->flat_prefix);
+    g_hash_table_destroy(check->modified);
+    g_hash_table_destroy(check->added);
+    g_hash_table_destroy(check->deleted);
+    g_free(check);
+}
+
+
+
+//===============================================================
+//      Public Interface Functions
+//===============================================================
+
+/* Start a staleness check of the published source file list (unless one is already running) */
+void STALE_start()
+{
+    stale_check_t   *check;
+    GThread         *thread;
+    const gchar     *cwd;
+    const gchar     *src_dir;
+
+    if ( running || BUILD_in_progress() )
+        return;
+
+    check = g_new0(stale_check_t, 1);
+
+    if ( (check->list = DIR_src_list_ref()) == NULL )
+    {
+        g_free(check);
+        return;
+    }
+
+    cwd     = DIR_get_path(DIR_CURRENT_WORKING);
+    src_dir = DIR_get_path(DIR_SOURCE);
+
+    if (src_dir[0] == '/')
+        check->base = g_strconcat(src_dir, "/", NULL);
+    else
+        check->base = g_strconcat(cwd, "/", src_dir, "/", NULL);
+
+    if (settings.refFile[0] == '/')
+        check->ref_file = g_strdup(settings.refFile);
+    else
+        check->ref_file = g_strconcat(cwd, "/", settings.refFile, NULL);
+
+    check->find_added = DIR_src_search_scope(&check->flat_prefix);
+    check->modified   = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    check->added      = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    check->deleted    = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+    running = check;
+
+    thread = g_thread_new("stale-check", check_thread, check);
+    g_thread_unref(thread);
+}
+
+
+
+/* Called when a cross-reference build starts: any check result is about to be out of date */
+void STALE_cancel()
+{
+    if (running)
+    {
+        g_atomic_int_set(&running->cancel, 1);
+        running = NULL;         /* check_done() frees it */
+    }
+
+    if (result)
+    {
+        free_check(result);
+        result = NULL;
+    }
+}
+
+
+
+/* Take the changed files (modified, added and deleted) found by the last check, or NULL if
+   there is no usable result.  The caller owns the set (keys == values); see BUILD_start_background(). */
+GHashTable *STALE_take_changes()
+{
+    GHashTable      *changes;
+    GHashTable      *sets[3];
+    GHashTableIter  iter;
+    gpointer        name;
+    guint           i;
+
+    if ( result == NULL || result->ref_missing )
+        return(NULL);
+
+    changes = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+    sets[0] = result->modified;
+    sets[1] = result->added;
+    sets[2] = result->deleted;
+
+    for (i = 0; i < 3; i++)
+    {
+        g_hash_table_iter_init(&iter, sets[i]);
+        while ( g_hash_table_iter_next(&iter, &name, NULL) )
+            add_name(changes, name);
+    }
+
+    free_check(result);
+    result = NULL;
+
+    return(changes);
+}
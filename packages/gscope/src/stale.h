@@ -0,0 +1,24 @@
+
+/* Background cross-reference staleness check.
+ *
+ * STALE_start() returns immediately.  A low-priority thread stats every file of (a reference
+ * to) the published source file list in batches, and reads the directories the list was found
+ * by searching for source files that are not in it yet.  The result -- every modified, added
+ * and deleted file -- is reported on the main loop: the cross-reference status indicator
+ * turns red (with the changed files in its tooltip) or blue.  STALE_take_changes() hands the
+ * changed-file set to BUILD_start_background() for a targeted rebuild.
+ *
+ * A check that overlaps a cross-reference build is cancelled and its result discarded.
+ */
+
+#define STALE_BATCH_SIZE        256     /* Files stat'd between cancellation checks */
+#define STALE_TOOLTIP_FILES     8       /* Files named per category in the status tooltip */
+
+
+//===============================================================
+//      Public Interface Functions
+//===============================================================
+
+void        STALE_start         (void);
+void        STALE_cancel        (void);
+GHashTable  *STALE_take_changes (void);
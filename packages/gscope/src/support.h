@@ -42,3 +42,9 @@ void        glade_set_atk_action_description (AtkAction       *action,
                                               const gchar     *action_name,
                                               const gchar     *description);
 
+#ifdef GTK3_BUILD
+/* GtkBuilder widget registry (GTK3 support.c only) */
+GtkWidget*  my_lookup_widget           (gchar           *name);
+void        my_add_widget              (gpointer         widget,
+                                        gpointer         user_data);
+#endif
@@ -0,0 +1,531 @@
+/*
+ *  gscope symbol dictionary
+ *
+ *  A sorted, front-coded dictionary of every symbol (defined or referenced) in
+ *  the cross-reference.  The dictionary is derived from the memory-resident
+ *  cross-reference when the search sub-system is initialized and is persisted
+ *  alongside the cross-reference (<refFile>.sym) so that later sessions with an
+ *  unchanged cross-reference can skip the derivation.
+ *
+ *  Front coding:  The sorted symbols are grouped into blocks of BLOCK_SIZE entries.
+ *  The first entry of each block is stored in full, each following entry is stored
+ *  as the length of the prefix it shares with its predecessor (one byte) plus the
+ *  remaining suffix.  All entries are null-terminated.  A lookup is a binary search
+ *  over the block heads followed by a short linear decode within the block.
+ *
+ *  Dictionary file format:
+ *
+ *      gscope-symdict <version> <cref size> <cref mtime> <cref inode> <symbol count> <block count> <data size>
+ *      <block offsets>     (block count * guint64, native byte order)
+ *      <data>              (data size bytes)
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "app_config.h"
+#include "build.h"
+#include "scanner.h"
+#include "utils.h"
+#include "lookup.h"
+#include "textdict.h"
+#include "blocks.h"
+#include "symdict.h"
+
+
+//===============================================================
+//       Defines
+//===============================================================
+#define     SYMDICT_VERSION     2
+#define     BLOCK_SIZE          16          /* Entries per front-coded block */
+#define     MAX_SYMBOL_SIZE     1024        /* Must match search.c */
+#define     MAX_SHARED_PREFIX   255
+
+
+//===============================================================
+//       Local Type Definitions
+//===============================================================
+
+struct symdict
+{
+    guint       count;          /* Number of symbols */
+    guint       block_count;
+    guint64     *blocks;        /* Offset of each block head in 'data' */
+    guint64     data_size;
+    gchar       *data;
+};
+
+
+typedef struct
+{
+    guint       index;          /* Index of the current entry */
+    gchar       *read_ptr;      /* Next entry to decode */
+    gchar       symbol[MAX_SYMBOL_SIZE + 1];
+} symdict_cursor_t;
+
+
+//===============================================================
+//       Private Global Variables
+//===============================================================
+
+static symdict_t    dict;           /* The installed dictionary (searched) */
+static textdict_t   text_dict;      /* Text compression dictionary of the cross-reference */
+
+
+//===============================================================
+//       Local Functions
+//===============================================================
+
+static void     build_from_cref (symdict_t *d, BLOCKS_cref_t *cref_file);
+static gboolean load_dict       (symdict_t *d, const char *filename, struct stat *cref_stat);
+static void     save_dict       (const symdict_t *d, const char *filename, struct stat *cref_stat);
+static void     free_dict       (symdict_t *d);
+static char     *get_symbol     (char *dest, char *src);
+static gboolean is_symbol       (char *text);
+static int      compare         (const void *s1, const void *s2);
+static guint    find_block      (const gchar *key);
+static void     cursor_init     (symdict_cursor_t *cursor, guint block);
+static gboolean cursor_next     (symdict_cursor_t *cursor);
+
+
+
+/* Derive the dictionary from the mapped cross-reference */
+static void build_from_cref(symdict_t *d, BLOCKS_cref_t *cref_file)
+{
+    BLOCKS_scan_t   *scan;
+    GHashTable      *symbol_hash;
+    GHashTableIter  hash_iter;
+    gpointer        key;
+    gchar           **symbols;
+    GByteArray      *data;
+    GArray          *blocks;
+    char            symbol[MAX_SYMBOL_SIZE + 1];
+    char            *read_ptr;
+    char            firstchar;
+    guint64         offset;
+    guint8          shared;
+    guint           i, len;
+    gboolean        done = FALSE;
+
+    symbol_hash = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+    initsymtab();       /* The keyword table, for is_symbol() */
+    scan = BLOCKS_scan_start(cref_file, &read_ptr);
+    (void) TEXTDICT_load(&text_dict, read_ptr);
+
+    while (*read_ptr != '\t') read_ptr++;   /* Skip the header */
+
+    /* Each pass through the loop examines one cross-reference line */
+    while (!done)
+    {
+        if (*read_ptr == '\t')
+        {
+            switch ( *(read_ptr + 1) )
+            {
+                case NEWFILE:
+                    if ( *(read_ptr + 2) == '\n' )    /* end of symbols (the next block starts with a file mark) */
+                    {
+                        done = !BLOCKS_scan_next(scan, &read_ptr);
+                        continue;
+                    }
+                    /* FALLTHROUGH */
+
+                case INCLUDE:       /* not a symbol */
+                case FCNEND:
+                case DEFINEEND:
+                    read_ptr = get_symbol(NULL, read_ptr);
+                break;
+
+                default:            /* marked symbol */
+                    read_ptr = get_symbol(symbol, read_ptr + 2);
+                    if (*symbol != '\0' && !g_hash_table_contains(symbol_hash, symbol))
+                        g_hash_table_add(symbol_hash, g_strdup(symbol));
+                break;
+            }
+        }
+        else
+        {
+            /* The first character may be a digraph'ed char */
+            firstchar = (*read_ptr & 0x80) ? TEXTDICT_TEXT(&text_dict, *read_ptr)[0] : *read_ptr;
+
+            if ( isalpha((unsigned char) firstchar) || firstchar == '_' )
+            {
+                /* An unmarked symbol, or source text: keywords are stored as plain text when
+                   compression is off (-c), and are not symbols */
+                read_ptr = get_symbol(symbol, read_ptr);
+                if ( is_symbol(symbol) && !g_hash_table_contains(symbol_hash, symbol) )
+                    g_hash_table_add(symbol_hash, g_strdup(symbol));
+            }
+            else
+                read_ptr = get_symbol(NULL, read_ptr);     /* source text, skip it */
+        }
+        read_ptr++;     /* skip the newline */
+    }
+    BLOCKS_scan_stop(scan);
+
+    /* Sort the unique symbols */
+    d->count = g_hash_table_size(symbol_hash);
+    symbols = g_malloc( (d->count + 1) * sizeof(gchar *) );
+
+    i = 0;
+    g_hash_table_iter_init(&hash_iter, symbol_hash);
+    while ( g_hash_table_iter_next(&hash_iter, &key, NULL) )
+        symbols[i++] = key;
+
+    qsort(symbols, d->count, sizeof(gchar *), compare);
+
+    /* Front-code the sorted symbols */
+    data   = g_byte_array_new();
+    blocks = g_array_new(FALSE, FALSE, sizeof(guint64));
+
+    for (i = 0; i < d->count; i++)
+    {
+        len = strlen(symbols[i]);
+
+        if (i % BLOCK_SIZE == 0)
+        {
+            offset = data->len;
+            g_array_append_val(blocks, offset);
+            g_byte_array_append(data, (guint8 *) symbols[i], len + 1);
+        }
+        else
+        {
+            for (shared = 0; shared < MAX_SHARED_PREFIX && symbols[i][shared] != '\0' &&
+                             symbols[i][shared] == symbols[i - 1][shared]; shared++);
+
+            g_byte_array_append(data, &shared, 1);
+            g_byte_array_append(data, (guint8 *) symbols[i] + shared, len - shared + 1);
+        }
+    }
+
+    d->block_count = blocks->len;
+    d->blocks      = (guint64 *) g_array_free(blocks, FALSE);
+    d->data_size   = data->len;
+    d->data        = (gchar *) g_byte_array_free(data, FALSE);
+
+    g_free(symbols);
+    g_hash_table_destroy(symbol_hash);
+}
+
+
+
+/* Load a persisted dictionary.  Returns FALSE if the dictionary is missing, stale or damaged */
+static gboolean load_dict(symdict_t *d, const char *filename, struct stat *cref_stat)
+{
+    FILE        *dict_file;
+    char        line[PATHLEN + 1];
+    guint       version;
+    guint64     size, mtime, inode;
+    guint       i;
+
+    if ( (dict_file = fopen(filename, "rb")) == NULL )
+        return(FALSE);
+
+    if ( fgets(line, sizeof(line), dict_file) == NULL ||
+         sscanf(line, "gscope-symdict %u %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT " %u %u %" G_GUINT64_FORMAT,
+                &version, &size, &mtime, &inode, &d->count, &d->block_count, &d->data_size) != 7 ||
+         version != SYMDICT_VERSION                 ||
+         size    != (guint64) cref_stat->st_size    ||
+         mtime   != (guint64) cref_stat->st_mtime   ||
+         inode   != (guint64) cref_stat->st_ino )
+    {
+        fclose(dict_file);
+        memset(d, 0, sizeof(*d));
+        return(FALSE);     /* The dictionary does not describe this cross-reference */
+    }
+
+    d->blocks = g_malloc( (d->block_count + 1) * sizeof(guint64) );
+    d->data   = g_malloc(d->data_size + 1);
+
+    if ( fread(d->blocks, sizeof(guint64), d->block_count, dict_file) != d->block_count ||
+         fread(d->data, 1, d->data_size, dict_file) != d->data_size )
+    {
+        fprintf(stderr, "Warning: Ignoring damaged symbol dictionary: %s\n", filename);
+        fclose(dict_file);
+        free_dict(d);
+        return(FALSE);
+    }
+    fclose(dict_file);
+
+    for (i = 0; i < d->block_count; i++)
+    {
+        if (d->blocks[i] >= d->data_size)
+        {
+            fprintf(stderr, "Warning: Ignoring damaged symbol dictionary: %s\n", filename);
+            free_dict(d);
+            return(FALSE);
+        }
+    }
+    d->data[d->data_size] = '\0';   /* Guard a truncated final entry */
+
+    return(TRUE);
+}
+
+
+
+/* Persist the dictionary.  Failure is not fatal, the dictionary is re-derived by the next session */
+static void save_dict(const symdict_t *d, const char *filename, struct stat *cref_stat)
+{
+    FILE    *dict_file;
+
+    if ( (dict_file = fopen(filename, "wb")) == NULL )
+    {
+        fprintf(stderr, "Warning: Unable to save symbol dictionary: %s\n", filename);
+        return;
+    }
+
+    fprintf(dict_file, "gscope-symdict %d %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT " %u %u %" G_GUINT64_FORMAT "\n",
+            SYMDICT_VERSION,
+            (guint64) cref_stat->st_size,
+            (guint64) cref_stat->st_mtime,
+            (guint64) cref_stat->st_ino,
+            d->count, d->block_count, d->data_size);
+
+    if ( fwrite(d->blocks, sizeof(guint64), d->block_count, dict_file) != d->block_count ||
+         fwrite(d->data, 1, d->data_size, dict_file) != d->data_size ||
+         fclose(dict_file) != 0 )
+    {
+        fprintf(stderr, "Warning: Unable to save symbol dictionary: %s\n", filename);
+        unlink(filename);
+    }
+}
+
+
+
+static void free_dict(symdict_t *d)
+{
+    g_free(d->blocks);
+    g_free(d->data);
+
+    memset(d, 0, sizeof(*d));
+}
+
+
+
+/* Extract a (decompressed) symbol from the cross-reference, or just skip it (dest == NULL).
+   Returns a pointer to the terminating newline */
+static char *get_symbol(char *dest, char *src)
+{
+    uint8_t     byte;
+    char        *end;
+    guint       length;
+
+    if (dest == NULL)
+    {
+        while (*src != '\n') src++;
+        return(src);
+    }
+
+    end = dest + MAX_SYMBOL_SIZE - 1;
+
+    while ( (byte = (unsigned) (*src)) != '\n' )
+    {
+        if (dest < end)
+        {
+            if (byte > 0x7f)
+            {
+                length = MIN(TEXTDICT_LENGTH(&text_dict, byte), end - dest);
+                memcpy(dest, TEXTDICT_TEXT(&text_dict, byte), length);
+                dest  += length;
+            }
+            else
+            {
+                *dest++ = byte;
+            }
+        }
+        src++;
+    }
+    *dest = '\0';
+
+    return(src);
+}
+
+
+
+/* Is the text of an unmarked cross-reference line an identifier (and not a keyword)? */
+static gboolean is_symbol(char *text)
+{
+    char    keyword_text[MAX_SYMBOL_SIZE + 1];
+    char    *ptr;
+
+    for (ptr = text; *ptr != '\0'; ptr++)
+    {
+        if ( !isalnum((unsigned char) *ptr) && *ptr != '_' )
+            return(FALSE);
+    }
+
+    strcpy(keyword_text, text);     /* lookup() may compress its argument */
+    return( lookup(keyword_text) == NULL );
+}
+
+
+
+static int compare(const void *s1, const void *s2)
+{
+    return( strcmp(*(char * const *) s1, *(char * const *) s2) );
+}
+
+
+
+/* Return the last block whose head is <= key (or 0) */
+static guint find_block(const gchar *key)
+{
+    guint   low  = 0;
+    guint   high = dict.block_count;
+    guint   mid;
+
+    while (high - low > 1)
+    {
+        mid = low + (high - low) / 2;
+        if ( strcmp(dict.data + dict.blocks[mid], key) <= 0 )
+            low = mid;
+        else
+            high = mid;
+    }
+    return(low);
+}
+
+
+
+static void cursor_init(symdict_cursor_t *cursor, guint block)
+{
+    cursor->index    = block * BLOCK_SIZE;
+    cursor->read_ptr = dict.data + dict.blocks[block];
+}
+
+
+
+/* Decode the next entry into cursor->symbol.  Returns FALSE at the end of the dictionary */
+static gboolean cursor_next(symdict_cursor_t *cursor)
+{
+    guint   shared = 0;
+    guint   len;
+
+    if (cursor->index >= dict.count)
+        return(FALSE);
+
+    if (cursor->index % BLOCK_SIZE != 0)
+        shared = (guint8) *cursor->read_ptr++;
+
+    len = strlen(cursor->read_ptr);
+    if (shared + len > MAX_SYMBOL_SIZE)
+        len = MAX_SYMBOL_SIZE - shared;
+
+    memcpy(cursor->symbol + shared, cursor->read_ptr, len);
+    cursor->symbol[shared + len] = '\0';
+
+    cursor->read_ptr += strlen(cursor->read_ptr) + 1;
+    cursor->index++;
+
+    return(TRUE);
+}
+
+
+
+//===============================================================
+//       Public Functions
+//===============================================================
+
+/* Load (or derive and persist) the symbol dictionary of a loaded cross-reference.  Touches no
+   search state (a build thread loads the next dictionary while lookups use the installed one) */
+symdict_t *SYMDICT_load(BLOCKS_cref_t *cref_file, struct stat *cref_stat)
+{
+    symdict_t   *d;
+    gchar       *dict_file;
+
+    d = g_malloc0(sizeof(symdict_t));
+
+    my_asprintf(&dict_file, "%s%s", settings.refFile, SYMDICT_SUFFIX);
+
+    if ( !load_dict(d, dict_file, cref_stat) )
+    {
+        build_from_cref(d, cref_file);
+        save_dict(d, dict_file, cref_stat);
+    }
+    g_free(dict_file);
+
+    return(d);
+}
+
+
+
+/* Make a loaded dictionary the one searched, freeing the previous one (main thread, between lookups) */
+void SYMDICT_install(symdict_t *d)
+{
+    free_dict(&dict);
+    dict = *d;
+    g_free(d);
+}
+
+
+
+void SYMDICT_free()
+{
+    free_dict(&dict);
+}
+
+
+
+/* Is 'symbol' defined or referenced anywhere in the cross-reference? */
+gboolean SYMDICT_contains(const gchar *symbol)
+{
+    symdict_cursor_t    cursor;
+    int                 cmp;
+
+    if (dict.count == 0) return(FALSE);
+
+    cursor_init(&cursor, find_block(symbol));
+
+    while ( cursor_next(&cursor) )
+    {
+        cmp = strcmp(cursor.symbol, symbol);
+        if (cmp == 0) return(TRUE);
+        if (cmp > 0)  break;
+    }
+    return(FALSE);
+}
+
+
+
+/* Report (in sorted order) up to 'max_results' symbols that begin with 'prefix'.
+   Returns the number of symbols reported. */
+guint SYMDICT_complete(const gchar *prefix, guint max_results, symdict_report_t report, gpointer user_data)
+{
+    symdict_cursor_t    cursor;
+    size_t              prefix_len;
+    guint               found = 0;
+
+    if (dict.count == 0) return(0);
+
+    prefix_len = strlen(prefix);
+    cursor_init(&cursor, find_block(prefix));
+
+    while ( found < max_results && cursor_next(&cursor) )
+    {
+        if ( strncmp(cursor.symbol, prefix, prefix_len) == 0 )
+        {
+            report(cursor.symbol, user_data);
+            found++;
+        }
+        else if ( strcmp(cursor.symbol, prefix) > 0 )
+            break;      /* Past the last possible match */
+    }
+    return(found);
+}
+
+
+
+guint SYMDICT_count()
+{
+    return(dict.count);
+}
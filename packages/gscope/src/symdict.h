@@ -0,0 +1,23 @@
+
+#include <sys/stat.h>
+
+#define SYMDICT_SUFFIX      ".sym"      /* Dictionary file name: <refFile>.sym */
+
+
+typedef struct symdict symdict_t;    /* A loaded symbol dictionary */
+
+
+/* Completion result callback */
+typedef void (*symdict_report_t)(const gchar *symbol, gpointer user_data);
+
+
+//===============================================================
+//      Public Interface Functions
+//===============================================================
+
+symdict_t * SYMDICT_load    (BLOCKS_cref_t *cref_file, struct stat *cref_stat);
+void        SYMDICT_install (symdict_t *d);
+void        SYMDICT_free    (void);
+gboolean    SYMDICT_contains(const gchar *symbol);
+guint       SYMDICT_complete(const gchar *prefix, guint max_results, symdict_report_t report, gpointer user_data);
+guint       SYMDICT_count   (void);
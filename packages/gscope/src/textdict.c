@@ -0,0 +1,724 @@
+/*
+ *  gscope cross-reference text compression dictionary
+ *
+ *  Training counts every substring of 2 to TEXTDICT_MAX_LEN characters in a sample of the
+ *  source files, the way the cross-reference will hold the text: symbols on their own, and
+ *  the source text between them with its blanks squeezed (a blank only ever starts a
+ *  substring) and without comments, keywords or preprocessor directives.  Substrings are
+ *  packed into a 64 bit key (one character per byte) and counted in an open addressing
+ *  table.  Codes are picked greedily by bytes saved, each pick discounting the occurrences of
+ *  the shorter candidates it contains, CODES_PER_ROUND at a time: the sample is then
+ *  compressed with the codes picked so far and only the text left uncompressed is recounted,
+ *  so later codes don't just repeat shifted fragments of earlier ones.
+ *
+ *  Training only reads the (sorted) original source file list, so every --shard of a build
+ *  trains the same dictionary.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "app_config.h"
+#include "dir.h"
+#include "lookup.h"
+#include "textdict.h"
+
+
+//===============================================================
+//      Defines
+//===============================================================
+
+#define SAMPLE_SIZE         (4 * 1024 * 1024)   /* Source text sampled for training */
+#define SAMPLE_FILE_SIZE    (64 * 1024)         /* Most text sampled from one file */
+#define SAMPLE_FILES        1024                /* Files sampled (evenly spread over the list) */
+#define NGRAM_TABLE_BITS    21                  /* Substring count table: 2M entries */
+#define NGRAM_TABLE_FILL    (3 << (NGRAM_TABLE_BITS - 2))   /* 3/4 full: count known substrings only */
+#define CANDIDATES          4096                /* Best substrings considered for the dictionary */
+#define CODES_PER_ROUND     16                  /* Codes picked between two counts */
+#define MIN_SAVING          64                  /* Bytes a sampled substring must save to be picked */
+
+typedef struct
+{
+    guint64     key;            /* Packed characters, first character most significant */
+    guint32     count;
+} ngram_t;
+
+
+typedef struct
+{
+    ngram_t     *table;
+    guint       used;
+} ngram_table_t;
+
+
+typedef struct
+{
+    char        text[TEXTDICT_MAX_LEN + 1];
+    guint       length;
+    gint64      count;          /* Occurrences not covered by a longer pick */
+    gboolean    picked;
+} candidate_t;
+
+
+
+//===============================================================
+//      Private Function Prototypes
+//===============================================================
+
+static void     build_index     (textdict_t *dict);
+static int      match           (const textdict_t *dict, guint8 first, const char *text, guint limit, guint *length);
+static gboolean valid_char      (guint8 c, guint position);
+static void     count_key       (ngram_table_t *ngrams, guint64 key);
+static void     count_text      (ngram_table_t *ngrams, const char *text, guint length);
+static void     add_run         (GByteArray *sample, const char *text, guint length);
+static void     count_sample    (ngram_table_t *ngrams, GByteArray *sample, const textdict_t *dict);
+static guint    pick_codes      (textdict_t *dict, ngram_table_t *ngrams, guint first_code, guint ncodes);
+static void     sample_file     (GByteArray *sample, const char *file, gsize *budget);
+static guint    unpack_key      (guint64 key, char *text);
+static int      compare_score   (const void *c1, const void *c2);
+static guint    occurrences     (const char *text, const char *substring);
+
+
+
+//===============================================================
+//      Private Globals
+//===============================================================
+
+static gboolean train_requested = FALSE;
+static gboolean retrain_requested = FALSE;
+
+/* The classic cscope digraphs: 16 most frequent first chars by 8 most frequent second chars */
+static const char dichar1[] = " teisaprnl(of)=c";
+static const char dichar2[] = " tnerpla";
+
+
+
+//===============================================================
+//      Public Globals
+//===============================================================
+
+GOptionEntry TEXTDICT_options[] = {
+    {
+        "train-dictionary", 0, 0, G_OPTION_ARG_NONE, &train_requested,
+        "Train a text compression dictionary on the project's source files when the cross-reference is built from scratch.", NULL
+    },
+    {
+        "retrain-dictionary", 0, 0, G_OPTION_ARG_NONE, &retrain_requested,
+        "Rebuild the cross-reference from scratch with a newly trained text dictionary (an update keeps the trained one).", NULL
+    },
+    { NULL }
+};
+
+
+
+//===============================================================
+//      Private Functions
+//===============================================================
+
+/* Order the codes for the encoder: by first character, longest text first */
+static void build_index(textdict_t *dict)
+{
+    guint   count[256];
+    guint   code;
+    guint   c;
+    guint   i, j;
+    guint8  swap;
+
+    memset(count, 0, sizeof(count));
+    for (code = 0; code < TEXTDICT_CODES; code++)
+    {
+        if (dict->length[code])
+            count[(guint8) dict->text[code][0]]++;
+    }
+
+    dict->first[0] = 0;
+    for (c = 0; c < 256; c++)
+        dict->first[c + 1] = dict->first[c] + count[c];
+
+    memset(count, 0, sizeof(count));
+    for (code = 0; code < TEXTDICT_CODES; code++)
+    {
+        if (dict->length[code])
+        {
+            c = (guint8) dict->text[code][0];
+            dict->order[dict->first[c] + count[c]++] = code;
+        }
+    }
+
+    /* Longest first within each first character (the lists are short) */
+    for (c = 0; c < 256; c++)
+    {
+        for (i = dict->first[c] + 1; i < dict->first[c + 1]; i++)
+        {
+            for (j = i; j > dict->first[c] && dict->length[dict->order[j]] > dict->length[dict->order[j - 1]]; j--)
+            {
+                swap = dict->order[j];
+                dict->order[j] = dict->order[j - 1];
+                dict->order[j - 1] = swap;
+            }
+        }
+    }
+}
+
+
+
+/* The longest code whose text is 'first' followed by the start of 'text' (at most 'limit' characters of it) */
+static int match(const textdict_t *dict, guint8 first, const char *text, guint limit, guint *length)
+{
+    guint   code;
+    guint   rest;
+    guint   i;
+
+    for (i = dict->first[first]; i < dict->first[first + 1]; i++)
+    {
+        code = dict->order[i];
+        rest = dict->length[code] - 1;
+
+        if ( rest <= limit && strncmp(dict->text[code] + 1, text, rest) == 0 )
+        {
+            *length = rest;
+            return(0x80 + code);
+        }
+    }
+    return(0);
+}
+
+
+
+/* Printable ASCII.  A blank only ever starts a substring: the cross-reference squeezes blanks,
+   and putcrossref() handles a blank before the text it compresses */
+static gboolean valid_char(guint8 c, guint position)
+{
+    return( c > ' ' ? c < 0x7f : (c == ' ' && position == 0) );
+}
+
+
+
+static void count_key(ngram_table_t *ngrams, guint64 key)
+{
+    guint64     mask = (1 << NGRAM_TABLE_BITS) - 1;
+    guint64     slot;
+
+    slot = (key * G_GUINT64_CONSTANT(0x9e3779b97f4a7c15)) >> (64 - NGRAM_TABLE_BITS);
+
+    while (ngrams->table[slot].key != 0 && ngrams->table[slot].key != key)
+        slot = (slot + 1) & mask;
+
+    if (ngrams->table[slot].key == 0)
+    {
+        if (ngrams->used >= NGRAM_TABLE_FILL)
+            return;
+        ngrams->table[slot].key = key;
+        ngrams->used++;
+    }
+    ngrams->table[slot].count++;
+}
+
+
+
+/* Count every substring of uncompressed text */
+static void count_text(ngram_table_t *ngrams, const char *text, guint length)
+{
+    guint64     key;
+    guint       i, n;
+
+    for (i = 0; i + 1 < length; i++)
+    {
+        key = 0;
+        for (n = 0; n < TEXTDICT_MAX_LEN && i + n < length && valid_char(text[i + n], n); n++)
+        {
+            key = (key << 8) | (guint8) text[i + n];
+            if (n > 0)
+                count_key(ngrams, key);
+        }
+    }
+}
+
+
+
+/* A run of text (a symbol, or the source text between two symbols) compresses on its own */
+static void add_run(GByteArray *sample, const char *text, guint length)
+{
+    if (length >= 2)
+    {
+        g_byte_array_append(sample, (const guint8 *) text, length);
+        g_byte_array_append(sample, (const guint8 *) "", 1);
+    }
+}
+
+
+
+/* Count the substrings of the sample text that the dictionary (so far) leaves uncompressed */
+static void count_sample(ngram_table_t *ngrams, GByteArray *sample, const textdict_t *dict)
+{
+    const char  *run;
+    const char  *end = (const char *) sample->data + sample->len;
+    guint       length;
+    guint       literal;        /* Start of the uncompressed text */
+    guint       code_length;
+    guint       i;
+
+    memset(ngrams->table, 0, sizeof(ngram_t) << NGRAM_TABLE_BITS);
+    ngrams->used = 0;
+
+    for (run = (const char *) sample->data; run < end; run += length + 1)
+    {
+        length  = strlen(run);
+        literal = 0;
+
+        for (i = 0; i < length; )
+        {
+            if ( TEXTDICT_encode(dict, run + i, length - i, &code_length) )
+            {
+                count_text(ngrams, run + literal, i - literal);
+                i += code_length;
+                literal = i;
+            }
+            else
+                i++;
+        }
+        count_text(ngrams, run + literal, length - literal);
+    }
+}
+
+
+
+/* Add up to 'ncodes' codes to the dictionary, from the counted substrings.  Returns the number added. */
+static guint pick_codes(textdict_t *dict, ngram_table_t *ngrams, guint first_code, guint ncodes)
+{
+    candidate_t     *candidates;
+    candidate_t     *best;
+    guint           ncandidates = 0;
+    guint           code;
+    guint           i, j;
+    guint64         slot;
+    gint64          score;
+
+    /* The best candidates by (over-estimated) saving */
+    candidates = g_new(candidate_t, ngrams->used + 1);
+    for (slot = 0; slot < (1 << NGRAM_TABLE_BITS); slot++)
+    {
+        if (ngrams->table[slot].count >= 2)
+        {
+            candidates[ncandidates].length = unpack_key(ngrams->table[slot].key, candidates[ncandidates].text);
+            candidates[ncandidates].count  = ngrams->table[slot].count;
+            candidates[ncandidates].picked = FALSE;
+            ncandidates++;
+        }
+    }
+
+    qsort(candidates, ncandidates, sizeof(candidate_t), compare_score);
+    ncandidates = MIN(ncandidates, CANDIDATES);
+
+    /* Text an earlier code overlapped (and so left uncompressed) is already in the dictionary */
+    for (i = 0; i < ncandidates; i++)
+    {
+        for (j = 0; j < first_code && !candidates[i].picked; j++)
+            candidates[i].picked = (strcmp(candidates[i].text, dict->text[j]) == 0);
+    }
+
+    /* Pick greedily: a pick's occurrences no longer count for the substrings it contains */
+    for (code = first_code; code < first_code + ncodes; code++)
+    {
+        best  = NULL;
+        score = MIN_SAVING - 1;
+        for (i = 0; i < ncandidates; i++)
+        {
+            if ( !candidates[i].picked && candidates[i].count * (candidates[i].length - 1) > score )
+            {
+                best  = &candidates[i];
+                score = best->count * (best->length - 1);
+            }
+        }
+        if (best == NULL)
+            break;
+
+        best->picked = TRUE;
+        for (j = 0; j < ncandidates; j++)
+        {
+            if ( !candidates[j].picked && candidates[j].length < best->length )
+                candidates[j].count -= best->count * occurrences(best->text, candidates[j].text);
+        }
+
+        strcpy(dict->text[code], best->text);
+        dict->length[code] = best->length;
+    }
+    g_free(candidates);
+
+    build_index(dict);
+    return(code - first_code);
+}
+
+
+
+/* Add (the start of) one source file to the sample: its symbols, and the source text between them */
+static void sample_file(GByteArray *sample, const char *file, gsize *budget)
+{
+    gchar   *contents;
+    gsize   size;
+    char    run[TEXTDICT_MAX_LEN * 16];     /* Source text between symbols */
+    guint   run_length = 0;
+    char    ident[64];
+    gsize   i, start;
+    guint8  c;
+    gboolean blank = FALSE;         /* A blank before the next source text */
+    gboolean line_start = TRUE;     /* Leading blanks are removed */
+    char    path[PATHLEN + 1];
+
+    if ( !g_file_get_contents(DIR_src_path(file, path), &contents, &size, NULL) )
+        return;
+
+    size = MIN(size, MIN(SAMPLE_FILE_SIZE, *budget));
+    *budget -= size;
+
+    for (i = 0; i < size; )
+    {
+        c = contents[i];
+
+        if ( c == '/' && i + 1 < size && (contents[i + 1] == '*' || contents[i + 1] == '/') )
+        {
+            /* Comments are not in the cross-reference */
+            if (contents[i + 1] == '*')
+            {
+                for (i += 2; i + 1 < size && !(contents[i] == '*' && contents[i + 1] == '/'); i++);
+                i += 2;
+            }
+            else
+            {
+                for (i += 2; i < size && contents[i] != '\n'; i++);
+            }
+            blank = !line_start;
+        }
+        else if (c == '\n' || c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v')
+        {
+            if (c == '\n')
+            {
+                add_run(sample, run, run_length);
+                run_length = 0;
+                line_start = TRUE;
+            }
+            blank = !line_start;
+            i++;
+        }
+        else if (isalpha(c) || c == '_' || c == '#')
+        {
+            /* A symbol (on its own line in the cross-reference), a keyword or a directive */
+            add_run(sample, run, run_length);
+            run_length = 0;
+            blank = FALSE;
+            line_start = FALSE;
+
+            start = i++;
+            if (c == '#')
+                while (i < size && (contents[i] == ' ' || contents[i] == '\t')) i++;
+            while (i < size && (isalnum((guint8) contents[i]) || contents[i] == '_')) i++;
+
+            if (c != '#' && i - start < sizeof(ident))
+            {
+                memcpy(ident, contents + start, i - start);
+                ident[i - start] = '\0';
+                if ( lookup(ident) == NULL )
+                    add_run(sample, contents + start, i - start);
+            }
+        }
+        else
+        {
+            /* Source text: numbers, operators, punctuation, string and character constants */
+            if ( run_length + 2 > sizeof(run) || c > 0x7e )
+            {
+                add_run(sample, run, run_length);
+                run_length = 0;
+            }
+            if (c <= 0x7e)
+            {
+                if (blank)
+                    run[run_length++] = ' ';
+                run[run_length++] = c;
+            }
+            blank = FALSE;
+            line_start = FALSE;
+            i++;
+        }
+    }
+    add_run(sample, run, run_length);
+
+    g_free(contents);
+}
+
+
+
+static guint unpack_key(guint64 key, char *text)
+{
+    guint   length = 0;
+    int     shift;
+
+    for (shift = 56; shift >= 0; shift -= 8)
+    {
+        if ( (key >> shift) & 0xff )
+            text[length++] = (key >> shift) & 0xff;
+    }
+    text[length] = '\0';
+
+    return(length);
+}
+
+
+
+/* Most bytes saved first (ties in text order, so every shard picks the same dictionary) */
+static int compare_score(const void *c1, const void *c2)
+{
+    const candidate_t   *a = c1;
+    const candidate_t   *b = c2;
+    gint64  score_a = a->count * (a->length - 1);
+    gint64  score_b = b->count * (b->length - 1);
+
+    if (score_a != score_b)
+        return( score_a > score_b ? -1 : 1 );
+    return( strcmp(a->text, b->text) );
+}
+
+
+
+static guint occurrences(const char *text, const char *substring)
+{
+    guint   count = 0;
+
+    while ( (text = strstr(text, substring)) != NULL )
+    {
+        count++;
+        text++;
+    }
+    return(count);
+}
+
+
+
+//===============================================================
+//      Public Interface Functions
+//===============================================================
+
+gboolean TEXTDICT_requested()
+{
+    return(train_requested || retrain_requested);
+}
+
+
+
+gboolean TEXTDICT_retrain_requested()
+{
+    return(retrain_requested);
+}
+
+
+
+/* The default (digraph) dictionary.  Without compression, the encoder finds no codes. */
+void TEXTDICT_init(textdict_t *dict, gboolean compress)
+{
+    guint   i, j;
+
+    memset(dict, 0, sizeof(*dict));
+
+    for (i = 0; i < 16; i++)
+    {
+        for (j = 0; j < 8; j++)
+        {
+            dict->text[i * 8 + j][0] = dichar1[i];
+            dict->text[i * 8 + j][1] = dichar2[j];
+            dict->length[i * 8 + j]  = 2;
+        }
+    }
+
+    if (compress)
+        build_index(dict);
+}
+
+
+
+/* Set up the dictionary of a cross-reference from its header line.  Returns FALSE (leaving
+   the default dictionary) if a trained dictionary is damaged. */
+gboolean TEXTDICT_load(textdict_t *dict, const char *header)
+{
+    const char  *read_ptr;
+    gboolean    compress = TRUE;
+    gboolean    trained = FALSE;
+    guint       code = 0;
+    guint       length = 0;
+    int         high, low;
+    int         i;
+
+    /* "cscope <format version> <current dir> <options> ..." */
+    read_ptr = header;
+    for (i = 0; i < 3; i++)
+    {
+        while (*read_ptr > ' ') read_ptr++;
+        if (*read_ptr++ != ' ')
+        {
+            TEXTDICT_init(dict, compress);
+            return(FALSE);
+        }
+    }
+
+    for ( ; read_ptr[0] > ' ' && read_ptr[1] > ' '; read_ptr += 2)
+    {
+        if (read_ptr[0] == 'c') compress = (read_ptr[1] != '1');
+        if (read_ptr[0] == 'D') trained  = (read_ptr[1] == '1');
+    }
+
+    TEXTDICT_init(dict, compress);
+    if (!trained)
+        return(TRUE);
+
+    /* <dictionary>: the text of each code, hex encoded, separated by commas */
+    if (*read_ptr++ != ' ')
+        return(FALSE);
+
+    memset(dict->length, 0, sizeof(dict->length));
+    memset(dict->text, 0, sizeof(dict->text));
+
+    for ( ; *read_ptr != ' '; read_ptr++)
+    {
+        if (*read_ptr == ',')
+        {
+            if (length < 2 || ++code >= TEXTDICT_CODES)
+                break;
+            length = 0;
+            continue;
+        }
+
+        high = g_ascii_xdigit_value(read_ptr[0]);
+        low  = (high < 0) ? -1 : g_ascii_xdigit_value(read_ptr[1]);
+        if ( low < 0 || length >= TEXTDICT_MAX_LEN || !valid_char(high * 16 + low, length) )
+            break;
+
+        dict->text[code][length++] = high * 16 + low;
+        dict->length[code] = length;
+        read_ptr++;
+    }
+
+    if (*read_ptr != ' ' || length < 2)
+    {
+        TEXTDICT_init(dict, compress);
+        return(FALSE);
+    }
+
+    dict->trained = TRUE;
+    build_index(dict);
+    return(TRUE);
+}
+
+
+
+/* The <dictionary> header field of a trained dictionary (g_free() it) */
+gchar *TEXTDICT_format(const textdict_t *dict)
+{
+    GString *field;
+    guint   code;
+    guint   i;
+
+    field = g_string_new(NULL);
+
+    for (code = 0; code < TEXTDICT_CODES && dict->length[code]; code++)
+    {
+        if (code > 0)
+            g_string_append_c(field, ',');
+        for (i = 0; i < dict->length[code]; i++)
+            g_string_append_printf(field, "%02x", (guint8) dict->text[code][i]);
+    }
+
+    return( g_string_free(field, FALSE) );
+}
+
+
+
+/* Train a dictionary on a sample of the source files.  Returns the number of codes, or 0
+   (leaving the dictionary as it is) if the sample is too small to train on. */
+guint TEXTDICT_train(textdict_t *dict, char **files, guint nfiles)
+{
+    ngram_table_t   ngrams;
+    GByteArray      *sample;
+    textdict_t      trained;
+    gsize           budget = SAMPLE_SIZE;
+    guint           stride;
+    guint           codes = 0;
+    guint           added;
+    guint           i;
+
+    sample = g_byte_array_new();
+    stride = MAX(1, nfiles / SAMPLE_FILES);
+    for (i = 0; i < nfiles && budget > 0; i += stride)
+        sample_file(sample, files[i], &budget);
+
+    memset(&trained, 0, sizeof(trained));
+    ngrams.table = g_new0(ngram_t, 1 << NGRAM_TABLE_BITS);
+
+    do
+    {
+        count_sample(&ngrams, sample, &trained);
+        added  = pick_codes(&trained, &ngrams, codes, MIN(CODES_PER_ROUND, TEXTDICT_CODES - codes));
+        codes += added;
+    } while (added > 0 && codes < TEXTDICT_CODES);
+
+    g_free(ngrams.table);
+    g_byte_array_free(sample, TRUE);
+
+    if (codes > 0)
+    {
+        trained.trained = TRUE;
+        *dict = trained;
+    }
+    return(codes);
+}
+
+
+
+/* Compress the text at 'text' (at most 'limit' characters of it): returns the code (and its
+   length) of the longest dictionary entry it starts with, or 0 */
+int TEXTDICT_encode(const textdict_t *dict, const char *text, guint limit, guint *length)
+{
+    int     code;
+
+    if (limit < 2)
+        return(0);
+
+    if ( (code = match(dict, (guint8) text[0], text + 1, limit - 1, length)) != 0 )
+        (*length)++;        /* The first character */
+    return(code);
+}
+
+
+
+/* As TEXTDICT_encode(), for text that follows a (squeezed) blank: the code includes the blank */
+int TEXTDICT_encode_blank(const textdict_t *dict, const char *text, guint limit, guint *length)
+{
+    return( match(dict, ' ', text, limit, length) );
+}
+
+
+
+/* Compress a string (a symbol or search pattern) the way the cross-reference stores it */
+void TEXTDICT_compress(const textdict_t *dict, char *dest, const char *src)
+{
+    guint   length;
+    int     code;
+
+    while (*src != '\0')
+    {
+        if ( (code = TEXTDICT_encode(dict, src, G_MAXUINT, &length)) != 0 )
+        {
+            *dest++ = code;
+            src    += length;
+        }
+        else
+        {
+            *dest++ = *src++;
+        }
+    }
+    *dest = '\0';
+}
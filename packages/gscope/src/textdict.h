@@ -0,0 +1,58 @@
+
+/* Cross-reference text compression dictionary:
+ *
+ *   gscope --train-dictionary ...
+ *
+ * Symbol and source text in the cross-reference is compressed by replacing substrings with
+ * meta-characters (bytes 0x80..0xff).  By default the 128 codes are the classic cscope
+ * digraphs: 16 frequent first characters by 8 frequent second characters.  With
+ * --train-dictionary, a full build first samples the project's source files and picks the
+ * 128 substrings (2 to TEXTDICT_MAX_LEN characters: frequent digraphs and identifier
+ * fragments) that save the most bytes.
+ *
+ * A trained dictionary is stored in the cross-reference header (option D1):
+ *
+ *   cscope <format version> <current dir> <options> <dictionary> <trailer offset>
+ *
+ * where <dictionary> lists the text of every code, in code order, hex encoded and separated
+ * by commas.  An incremental build keeps the dictionary of the cross-reference it updates,
+ * with or without --train-dictionary.  --train-dictionary forces a full build only when there
+ * is no trained dictionary to keep; --retrain-dictionary always does, to train a new one.
+ *
+ * Compression is greedy (longest substring first) and context free, so a search pattern
+ * compressed with the cross-reference's dictionary matches the stored symbol byte for byte.
+ */
+
+#define TEXTDICT_CODES          128         /* Codes 0x80..0xff */
+#define TEXTDICT_MAX_LEN        8           /* Longest substring */
+
+typedef struct
+{
+    guint8      length[TEXTDICT_CODES];                     /* Length of each code's text (0: unused code) */
+    char        text[TEXTDICT_CODES][TEXTDICT_MAX_LEN + 1]; /* Text of each code */
+    guint8      first[257];         /* Encoder: the codes whose text starts with c are order[first[c]] .. order[first[c + 1] - 1] */
+    guint8      order[TEXTDICT_CODES];  /* Encoder: codes by first character, longest text first */
+    gboolean    trained;            /* Not the default digraphs */
+} textdict_t;
+
+/* The text of a meta-character, and its length */
+#define TEXTDICT_TEXT(dict, byte)       ((dict)->text[(guint8) (byte) & 0x7f])
+#define TEXTDICT_LENGTH(dict, byte)     ((dict)->length[(guint8) (byte) & 0x7f])
+
+extern GOptionEntry TEXTDICT_options[];     /* Command line options: --train-dictionary, --retrain-dictionary */
+extern textdict_t   build_dict;             /* The dictionary of the cross-reference being built (build.c) */
+
+
+//===============================================================
+//      Public Interface Functions
+//===============================================================
+
+gboolean    TEXTDICT_requested      (void);
+gboolean    TEXTDICT_retrain_requested(void);
+void        TEXTDICT_init           (textdict_t *dict, gboolean compress);
+gboolean    TEXTDICT_load           (textdict_t *dict, const char *header);
+gchar *     TEXTDICT_format         (const textdict_t *dict);
+guint       TEXTDICT_train          (textdict_t *dict, char **files, guint nfiles);
+int         TEXTDICT_encode         (const textdict_t *dict, const char *text, guint limit, guint *length);
+int         TEXTDICT_encode_blank   (const textdict_t *dict, const char *text, guint limit, guint *length);
+void        TEXTDICT_compress       (const textdict_t *dict, char *dest, const char *src);
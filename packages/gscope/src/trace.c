@@ -0,0 +1,152 @@
+/*
+ *  gscope Chrome trace-event output
+ *
+ *  Writes "B" (begin) and "E" (end) duration events in the trace-event JSON array
+ *  format.  The file is opened on the first event (if GSCOPE_TRACE_FILE is set) and
+ *  the array is closed at exit.  Each event is a single buffered fprintf(), so the
+ *  cost of a span is two clock reads and two formatted writes.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef GSCOPE_TRACE
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include "trace.h"
+
+
+//===============================================================
+//      Private Function Prototypes
+//===============================================================
+
+static FILE    *trace_file(void);
+static void     trace_close(void);
+static long     trace_tid(void);
+static void     put_json_string(FILE *output, const gchar *text);
+
+
+
+//===============================================================
+//      Private Globals
+//===============================================================
+
+static FILE     *trace_output = NULL;
+static gboolean trace_initialized = FALSE;
+static gint64   trace_epoch;                /* Timestamps are microseconds since the first event */
+
+
+
+//===============================================================
+//      Private Functions
+//===============================================================
+
+static FILE *trace_file(void)
+{
+    const gchar *filename;
+
+    if (trace_initialized)
+        return(trace_output);
+
+    trace_initialized = TRUE;
+    trace_epoch = g_get_monotonic_time();
+
+    filename = getenv("GSCOPE_TRACE_FILE");
+    if (filename == NULL || *filename == '\0')
+        return(NULL);
+
+    if ( (trace_output = fopen(filename, "w")) == NULL )
+    {
+        fprintf(stderr, "Warning: Unable to create trace file %s\n", filename);
+        return(NULL);
+    }
+
+    fprintf(trace_output, "[\n");
+    atexit(trace_close);
+
+    return(trace_output);
+}
+
+
+static void trace_close(void)
+{
+    /* Every event is written with a trailing comma, so finish with the process name (metadata) event */
+    fprintf(trace_output, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"gscope\"}}\n]\n", (int) getpid());
+    fclose(trace_output);
+    trace_output = NULL;
+}
+
+
+static long trace_tid(void)
+{
+    #ifdef __linux__
+    return( (long) syscall(SYS_gettid) );
+    #else
+    return( (long) getpid() );
+    #endif
+}
+
+
+static void put_json_string(FILE *output, const gchar *text)
+{
+    putc('"', output);
+    for (; *text; text++)
+    {
+        if (*text == '"' || *text == '\\')
+            fprintf(output, "\\%c", *text);
+        else if ( (unsigned char) *text < 0x20 )
+            fprintf(output, "\\u%04x", (unsigned char) *text);
+        else
+            putc(*text, output);
+    }
+    putc('"', output);
+}
+
+
+
+//===============================================================
+//      Public Interface Functions
+//===============================================================
+
+void TRACE_begin(const gchar *name, const gchar *detail)
+{
+    FILE    *output;
+
+    if ( (output = trace_file()) == NULL )
+        return;
+
+    flockfile(output);
+    fprintf(output, "{\"name\":\"%s\",\"ph\":\"B\",\"ts\":%" G_GINT64_FORMAT ",\"pid\":%d,\"tid\":%ld",
+            name, g_get_monotonic_time() - trace_epoch, (int) getpid(), trace_tid());
+    if (detail)
+    {
+        fprintf(output, ",\"args\":{\"detail\":");
+        put_json_string(output, detail);
+        putc('}', output);
+    }
+    fprintf(output, "},\n");
+    funlockfile(output);
+}
+
+
+void TRACE_end(const gchar *name)
+{
+    FILE    *output;
+
+    if ( (output = trace_file()) == NULL )
+        return;
+
+    fprintf(output, "{\"name\":\"%s\",\"ph\":\"E\",\"ts\":%" G_GINT64_FORMAT ",\"pid\":%d,\"tid\":%ld},\n",
+            name, g_get_monotonic_time() - trace_epoch, (int) getpid(), trace_tid());
+}
+
+#endif  /* GSCOPE_TRACE */
@@ -0,0 +1,26 @@
+
+/* Build and search phase tracing (configure --enable-trace).
+ *
+ * When compiled in, and the GSCOPE_TRACE_FILE environment variable names a file, every
+ * TRACE_BEGIN/TRACE_END pair is written to that file as a Chrome trace-event span
+ * (JSON array format, viewable in Perfetto or chrome://tracing).  Without --enable-trace
+ * the macros compile to nothing.
+ *
+ * Spans must nest on each thread.  The optional detail string (e.g. a file name or search
+ * pattern) is recorded as the span's "detail" argument.
+ */
+
+#ifdef GSCOPE_TRACE
+
+#define TRACE_BEGIN(name, detail)   TRACE_begin(name, detail)
+#define TRACE_END(name)             TRACE_end(name)
+
+void    TRACE_begin (const gchar *name, const gchar *detail);
+void    TRACE_end   (const gchar *name);
+
+#else
+
+#define TRACE_BEGIN(name, detail)   ((void) 0)
+#define TRACE_END(name)             ((void) 0)
+
+#endif
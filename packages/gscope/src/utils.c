@@ -9,15 +9,11 @@
 #include <unistd.h>
 #include <string.h>
 #include <glib.h>
-#include <gtk/gtk.h>
 #include <sys/wait.h>
 
 #include "utils.h"
 
 
-//----------------------- File-Private Globals ------------------------
-static GHashTable   *hash_table = NULL;
-
 //------------------- Private Function Prototypes ---------------------
 static void _handle_sigchld(int sig);
 static void _register_child_handler();
@@ -110,79 +106,6 @@ void my_cannotopen(char *file)
 }
 
 
-// Widget lookup support for GTK3 apps.  Overrides GTK2's auto generated function
-// "lookup_widget()" function.
-//
-GtkWidget   *my_lookup_widget(gchar *name)
-{
-    return( g_hash_table_lookup(hash_table, name) );
-}
-
-
-void my_add_widget(gpointer widget, gpointer user_data)
-{
-    GType       my_type;
-
-    static GType nb1, nb2;
-
-    if ( !hash_table )   // Need to initialize
-    {
-        hash_table = g_hash_table_new(g_str_hash,g_str_equal);
-
-        // This is a brute-force method for determining if an object is a "buildable"
-        // Additional values may need to be added if the glade file for a specific
-        // application defines other "non-buildable" objects.
-        nb1 = g_type_from_name("GtkAccelGroup");
-        nb2 = g_type_from_name("GtkTreeSelection");
-
-    }
-
-    my_type = G_OBJECT_TYPE(widget);
-
-    if ( my_type == nb1 || my_type == nb2 )     // Brute force Non-Buildable check
-    {
-        /* my_type is a Non-Buildable type : Do nothing */
-    }
-    else
-    {
-        /* Add the widget to to the reference database */
-        g_hash_table_insert(hash_table, strdup(gtk_buildable_get_name(GTK_BUILDABLE(widget))), widget); 
-
-        #if 0   // for debugging
-        {
-            static count = 0;
-
-            printf("ID-NAME[%d] = %x %s\n", count++, widget, gtk_buildable_get_name(GTK_BUILDABLE(widget)) ); 
-        }
-        #endif
-    }
-
-}
-
-#if 0   // Might be useful in the future for creating transient instances of toplevel widgets.
-//------------------- GTK3-only support functions -----------------------------------
-
-GtkWidget *create_widget(gchar *widget_name)
-{
-    GtkWidget   *widget;
-    GtkBuilder  *builder;
-    gchar       *toplevel[2];
-
-    toplevel[0] = widget_name;
-    toplevel[1] = NULL;
-
-    builder = gtk_builder_new();
-    gtk_builder_add_objects_from_file(builder, "../gscope3.glade", toplevel, NULL);
-    widget = GTK_WIDGET(gtk_builder_get_object(builder, widget_name));
-    gtk_builder_connect_signals(builder, NULL);
-    g_object_unref(G_OBJECT(builder));
-
-    return(widget);
-}
-
-#endif
-
-
 void my_space_codec(gboolean encode, gchar *my_string)
 {
     gchar *work_ptr;
@@ -338,6 +261,42 @@ void my_asprintf(gchar **str_ptr, const char *fmt, ...)
 }
 
 
+// Append a variable length integer (7 bits per byte, low bits first) to a byte array.
+//===========================================================================
+void my_put_varint(GByteArray *array, guint32 value)
+{
+    guint8  byte;
+
+    while (value >= 0x80)
+    {
+        byte = (value & 0x7f) | 0x80;
+        g_byte_array_append(array, &byte, 1);
+        value >>= 7;
+    }
+    byte = value;
+    g_byte_array_append(array, &byte, 1);
+}
+
+
+// Read a my_put_varint() integer and advance past it.
+//===========================================================================
+guint32 my_get_varint(const guint8 **read_ptr)
+{
+    const guint8    *ptr = *read_ptr;
+    guint32         value = 0;
+    guint           shift = 0;
+
+    do
+    {
+        value |= (guint32) (*ptr & 0x7f) << shift;
+        shift += 7;
+    } while (*ptr++ & 0x80);
+
+    *read_ptr = ptr;
+    return(value);
+}
+
+
 #ifndef HAVE_ASPRINTF   // A glimmer of hope for those without asprintf() and friends.
 
 //=====================================================
@@ -27,10 +27,10 @@
 char       *my_basename(const char *path);
 char       *my_dirname(char *path);
 void        my_cannotopen(char *file);
-GtkWidget  *my_lookup_widget(gchar *name);
-void        my_add_widget(gpointer data, gpointer user_data);
 pid_t       my_system(gchar *application);
 void        my_space_codec(gboolean encode, gchar *my_string);
 void        my_chdir(gchar *path);
 void        my_asprintf(gchar **str_ptr, const char *fmt, ...);
+void        my_put_varint(GByteArray *array, guint32 value);
+guint32     my_get_varint(const guint8 **read_ptr);
 
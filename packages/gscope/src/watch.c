@@ -0,0 +1,363 @@
+/*
+ *  gscope live cross-reference updates (inotify)
+ *
+ *  One inotify watch per source directory.  Change events for source files are collected
+ *  in a set; each event restarts a WATCH_DELAY_MS timer, and when the timer expires the set
+ *  is handed to BUILD_start_background(), which re-parses only those files on the build
+ *  thread and installs the result between lookups.  Events arrive through the GLib main
+ *  loop.  If the kernel event queue overflows, the changed-file set is unknown and a normal
+ *  incremental build is run instead.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#endif
+
+#include "app_config.h"
+#include "build.h"
+#include "dir.h"
+#include "core.h"
+#include "utils.h"
+#include "watch.h"
+
+
+//===============================================================
+//      Defines
+//===============================================================
+
+#define WATCH_EVENTS    (IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE)
+#define EVENT_BUF_SIZE  (64 * 1024)
+
+
+//===============================================================
+//      Private Function Prototypes
+//===============================================================
+
+#ifdef HAVE_SYS_INOTIFY_H
+static gboolean on_inotify      (GIOChannel *source, GIOCondition condition, gpointer data);
+static gboolean on_quiet_period (gpointer data);
+static void     on_update_done  (gpointer data);
+static void     add_directory   (const gchar *prefix, GHashTable *current);
+static void     stop_watching   (const gchar *reason);
+#endif
+
+
+
+//===============================================================
+//      Private Globals
+//===============================================================
+
+static gboolean     watch_requested = FALSE;
+static gboolean     watch_active = FALSE;
+
+#ifdef HAVE_SYS_INOTIFY_H
+static int          inotify_fd = -1;
+static guint        io_source = 0;
+static guint        timer_source = 0;
+static GHashTable   *dir_watches = NULL;    /* Directory prefix ("" or "dir/") -> watch descriptor */
+static GHashTable   *watch_dirs = NULL;     /* Watch descriptor -> directory prefix */
+static GHashTable   *changed = NULL;        /* Changed source files (key == value) */
+static gboolean     overflowed = FALSE;
+#endif
+
+
+GOptionEntry WATCH_options[] = {
+    {
+        "watch", 0, 0, G_OPTION_ARG_NONE, &watch_requested,
+        "Watch the source directories and update the cross-reference as files change.", NULL
+    },
+    { NULL }
+};
+
+
+
+//===============================================================
+//      Private Functions
+//===============================================================
+
+#ifdef HAVE_SYS_INOTIFY_H
+
+static gboolean on_inotify(GIOChannel *source, GIOCondition condition, gpointer data)
+{
+    char        buf[EVENT_BUF_SIZE] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    const struct inotify_event *event;
+    const gchar *prefix;
+    gchar       *path;
+    ssize_t     len;
+    char        *ptr;
+
+    while ( (len = read(inotify_fd, buf, sizeof(buf))) > 0 )
+    {
+        for (ptr = buf; ptr < buf + len; ptr += sizeof(struct inotify_event) + event->len)
+        {
+            event = (const struct inotify_event *) ptr;
+
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                overflowed = TRUE;
+                continue;
+            }
+
+            if ( (event->mask & IN_ISDIR) || event->len == 0 || !DIR_is_src_file(event->name) )
+                continue;
+
+            if ( (prefix = g_hash_table_lookup(watch_dirs, GINT_TO_POINTER(event->wd))) == NULL )
+                continue;
+
+            path = g_strconcat(prefix, event->name, NULL);
+            if ( g_hash_table_lookup(changed, path) )
+                g_free(path);
+            else
+                g_hash_table_insert(changed, path, path);
+        }
+    }
+
+    if ( g_hash_table_size(changed) > 0 || overflowed )
+    {
+        /* Restart the quiet period */
+        if (timer_source)
+            g_source_remove(timer_source);
+        timer_source = g_timeout_add(WATCH_DELAY_MS, on_quiet_period, NULL);
+    }
+
+    return(TRUE);
+}
+
+
+
+static gboolean on_quiet_period(gpointer data)
+{
+    GHashTable  *files;
+    guint       nfiles;
+
+    if ( BUILD_in_progress() )
+        return(TRUE);           /* Try again after the current build */
+
+    timer_source = 0;
+
+    files   = changed;
+    changed = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+    if (overflowed)
+    {
+        /* The changed-file set is incomplete: run a normal incremental build instead */
+        overflowed = FALSE;
+        settings.noBuild = FALSE;
+        g_hash_table_destroy(files);
+        BUILD_start_background(NULL, on_update_done, NULL);
+    }
+    else
+    {
+        nfiles = g_hash_table_size(files);
+        BUILD_start_background(files, on_update_done, GUINT_TO_POINTER(nfiles));
+    }
+
+    return(FALSE);
+}
+
+
+
+/* The updated cross-reference has been installed.  'data': number of changed files, or 0 after an overflow */
+static void on_update_done(gpointer data)
+{
+    guint       nfiles = GPOINTER_TO_UINT(data);
+    gchar       *msg;
+
+    if (nfiles == 0)
+        CORE_status("Cross Reference updated (full incremental check: too many changes)");
+    else
+    {
+        my_asprintf(&msg, "Cross Reference updated (%d changed file%s)", nfiles, nfiles == 1 ? "" : "s");
+        CORE_status(msg);
+        g_free(msg);
+    }
+}
+
+
+
+static void add_directory(const gchar *prefix, GHashTable *current)
+{
+    gchar       *key;
+    gchar       *path;
+    gpointer    value;
+    int         wd;
+
+    if ( g_hash_table_lookup_extended(current, prefix, NULL, NULL) )
+        return;
+
+    key = g_strdup(prefix);
+
+    if ( g_hash_table_lookup_extended(dir_watches, prefix, NULL, &value) )
+    {
+        /* Keep the watch from the previous source list */
+        wd = GPOINTER_TO_INT(value);
+        g_hash_table_insert(watch_dirs, value, key);
+        g_hash_table_remove(dir_watches, prefix);
+    }
+    else
+    {
+        /* Source file names are relative to the source directory */
+        if (prefix[0] != '/' && strcmp(settings.srcDir, "") != 0)
+            path = g_strconcat(settings.srcDir, "/", prefix[0] ? prefix : ".", NULL);
+        else
+            path = g_strdup(prefix[0] ? prefix : ".");
+
+        wd = inotify_add_watch(inotify_fd, path, WATCH_EVENTS);
+        g_free(path);
+
+        if (wd >= 0)
+            g_hash_table_insert(watch_dirs, GINT_TO_POINTER(wd), key);
+        else if (errno == ENOSPC)
+        {
+            g_free(key);
+            stop_watching("The inotify watch limit is too low for this source tree (see fs.inotify.max_user_watches).");
+            return;
+        }
+    }
+
+    g_hash_table_insert(current, key, GINT_TO_POINTER(wd));
+}
+
+
+
+static void stop_watching(const gchar *reason)
+{
+    gchar   *msg;
+
+    my_asprintf(&msg, "<span weight=\"bold\">Live cross-reference updates are disabled</span>\n%s", reason);
+    CORE_msg(CORE_MSG_WARNING, msg);
+    g_free(msg);
+
+    if (io_source)
+        g_source_remove(io_source);
+    if (timer_source)
+        g_source_remove(timer_source);
+    io_source = timer_source = 0;
+
+    close(inotify_fd);
+    inotify_fd = -1;
+
+    watch_active = FALSE;
+}
+
+#endif  /* HAVE_SYS_INOTIFY_H */
+
+
+
+//===============================================================
+//      Public Interface Functions
+//===============================================================
+
+gboolean WATCH_requested()
+{
+    return(watch_requested);
+}
+
+
+
+/* Start watching (front-end main loop required).  Call after the first build. */
+void WATCH_start()
+{
+    #ifdef HAVE_SYS_INOTIFY_H
+    GIOChannel  *channel;
+
+    if (watch_active)
+        return;
+
+    if ( (inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) < 0 )
+    {
+        fprintf(stderr, "Warning: Unable to start watching source files: %s\n", strerror(errno));
+        return;
+    }
+
+    dir_watches = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    watch_dirs  = g_hash_table_new(g_direct_hash, g_direct_equal);
+    changed     = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+    channel   = g_io_channel_unix_new(inotify_fd);
+    io_source = g_io_add_watch(channel, G_IO_IN, on_inotify, NULL);
+    g_io_channel_unref(channel);
+
+    watch_active = TRUE;
+    WATCH_sync();
+    #else
+    fprintf(stderr, "Warning: --watch is not supported on this platform\n");
+    #endif
+}
+
+
+
+/* Watch the directory of every source file (and stop watching directories that no longer hold one) */
+void WATCH_sync()
+{
+    #ifdef HAVE_SYS_INOTIFY_H
+    GHashTable      *current;
+    GHashTableIter  iter;
+    gpointer        wd;
+    DIR_src_iter_t  src_iter;
+    const char      *file;
+    const char      *slash;
+    gchar           *prefix;
+    gsize           prefix_len = 0;
+
+    if ( !watch_active )
+        return;
+
+    current = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    prefix  = g_strdup("");
+
+    /* Files of one directory are mostly adjacent in the list: only hash a prefix when it changes */
+    DIR_src_iter_init(&src_iter, 0);
+    while ( watch_active && (file = DIR_src_iter_next(&src_iter)) != NULL )
+    {
+        slash = strrchr(file, '/');
+        if ( (gsize) (slash ? slash - file + 1 : 0) == prefix_len && strncmp(file, prefix, prefix_len) == 0 )
+            continue;
+
+        g_free(prefix);
+        prefix_len = slash ? slash - file + 1 : 0;
+        prefix = g_strndup(file, prefix_len);
+
+        add_directory(prefix, current);
+    }
+    g_free(prefix);
+
+    if ( !watch_active )        /* Watch limit reached */
+    {
+        g_hash_table_destroy(current);
+        g_hash_table_destroy(dir_watches);
+        g_hash_table_destroy(watch_dirs);
+        g_hash_table_destroy(changed);
+        dir_watches = watch_dirs = changed = NULL;
+        return;
+    }
+
+    /* Directories without source files any more */
+    g_hash_table_iter_init(&iter, dir_watches);
+    while ( g_hash_table_iter_next(&iter, NULL, &wd) )
+    {
+        inotify_rm_watch(inotify_fd, GPOINTER_TO_INT(wd));
+        g_hash_table_remove(watch_dirs, wd);
+    }
+
+    g_hash_table_destroy(dir_watches);
+    dir_watches = current;
+    #endif
+}
+
+
+
+gboolean WATCH_active()
+{
+    return(watch_active);
+}
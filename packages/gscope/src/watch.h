@@ -0,0 +1,27 @@
+
+/* Live cross-reference updates:
+ *
+ *   gscope --watch ...
+ *
+ * Watches every directory that holds a source file (Linux inotify).  When source files are
+ * written, renamed or deleted, the changed files are collected until WATCH_DELAY_MS pass
+ * without another change, then only those files are re-parsed and spliced into the
+ * cross-reference (see BUILD_start_background).  While watching, the periodic "stat every
+ * source file" staleness check is skipped.
+ *
+ * New directories are not watched until the next full rebuild.
+ */
+
+#define WATCH_DELAY_MS      1500        /* Quiet period before an update */
+
+extern GOptionEntry WATCH_options[];    /* Command line options: --watch */
+
+
+//===============================================================
+//      Public Interface Functions
+//===============================================================
+
+gboolean    WATCH_requested (void);
+void        WATCH_start     (void);
+void        WATCH_sync      (void);
+gboolean    WATCH_active    (void);
@@ -0,0 +1 @@
+../../gscope/src/app_config_gui.c
\ No newline at end of file
@@ -0,0 +1 @@
+../../gscope/src/app_config_gui.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../gscope/src/blocks.c
\ No newline at end of file
@@ -0,0 +1 @@
+../../gscope/src/blocks.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../gscope/src/cmdline.c
\ No newline at end of file
@@ -0,0 +1 @@
+../../gscope/src/cmdline.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../gscope/src/core.c
\ No newline at end of file
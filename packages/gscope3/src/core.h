@@ -0,0 +1 @@
+../../gscope/src/core.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../gscope/src/federate.c
\ No newline at end of file
@@ -0,0 +1 @@
+../../gscope/src/federate.h
\ No newline at end of file
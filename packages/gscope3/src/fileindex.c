@@ -0,0 +1 @@
+../../gscope/src/fileindex.c
\ No newline at end of file
@@ -0,0 +1 @@
+../../gscope/src/fileindex.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../gscope/src/gscope_cli.c
\ No newline at end of file
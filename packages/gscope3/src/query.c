@@ -0,0 +1 @@
+../../gscope/src/query.c
\ No newline at end of file
@@ -0,0 +1 @@
+../../gscope/src/report.c
\ No newline at end of file
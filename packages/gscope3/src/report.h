@@ -0,0 +1 @@
+../../gscope/src/report.h
\ No newline at end of file
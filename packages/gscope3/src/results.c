@@ -0,0 +1 @@
+../../gscope/src/results.c
\ No newline at end of file
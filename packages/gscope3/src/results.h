@@ -0,0 +1 @@
+../../gscope/src/results.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../gscope/src/sectcache.c
\ No newline at end of file
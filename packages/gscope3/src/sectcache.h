@@ -0,0 +1 @@
+../../gscope/src/sectcache.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../gscope/src/serve.c
\ No newline at end of file
@@ -0,0 +1 @@
+../../gscope/src/serve.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../gscope/src/shard.c
\ No newline at end of file
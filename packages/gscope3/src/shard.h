@@ -0,0 +1 @@
+../../gscope/src/shard.h
\ No newline at end of file
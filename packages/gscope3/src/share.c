@@ -0,0 +1 @@
+../../gscope/src/share.c
\ No newline at end of file
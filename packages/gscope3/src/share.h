@@ -0,0 +1 @@
+../../gscope/src/share.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../gscope/src/stale.c
\ No newline at end of file
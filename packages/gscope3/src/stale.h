@@ -0,0 +1 @@
+../../gscope/src/stale.h
\ No newline at end of file
@@ -120,3 +120,83 @@ create_pixbuf                          (const gchar     *filename)
   g_free (pathname);
   return pixbuf;
 }
+
+
+
+/*
+ * GTK3 widget lookup support (GtkBuilder objects are registered by name at startup).
+ */
+
+static GHashTable   *hash_table = NULL;
+
+// Widget lookup support for GTK3 apps.  Overrides GTK2's auto generated function
+// "lookup_widget()" function.
+//
+GtkWidget   *my_lookup_widget(gchar *name)
+{
+    return( g_hash_table_lookup(hash_table, name) );
+}
+
+
+void my_add_widget(gpointer widget, gpointer user_data)
+{
+    GType       my_type;
+
+    static GType nb1, nb2;
+
+    if ( !hash_table )   // Need to initialize
+    {
+        hash_table = g_hash_table_new(g_str_hash,g_str_equal);
+
+        // This is a brute-force method for determining if an object is a "buildable"
+        // Additional values may need to be added if the glade file for a specific
+        // application defines other "non-buildable" objects.
+        nb1 = g_type_from_name("GtkAccelGroup");
+        nb2 = g_type_from_name("GtkTreeSelection");
+
+    }
+
+    my_type = G_OBJECT_TYPE(widget);
+
+    if ( my_type == nb1 || my_type == nb2 )     // Brute force Non-Buildable check
+    {
+        /* my_type is a Non-Buildable type : Do nothing */
+    }
+    else
+    {
+        /* Add the widget to to the reference database */
+        g_hash_table_insert(hash_table, strdup(gtk_buildable_get_name(GTK_BUILDABLE(widget))), widget); 
+
+        #if 0   // for debugging
+        {
+            static count = 0;
+
+            printf("ID-NAME[%d] = %x %s\n", count++, widget, gtk_buildable_get_name(GTK_BUILDABLE(widget)) ); 
+        }
+        #endif
+    }
+
+}
+
+#if 0   // Might be useful in the future for creating transient instances of toplevel widgets.
+//------------------- GTK3-only support functions -----------------------------------
+
+GtkWidget *create_widget(gchar *widget_name)
+{
+    GtkWidget   *widget;
+    GtkBuilder  *builder;
+    gchar       *toplevel[2];
+
+    toplevel[0] = widget_name;
+    toplevel[1] = NULL;
+
+    builder = gtk_builder_new();
+    gtk_builder_add_objects_from_file(builder, "../gscope3.glade", toplevel, NULL);
+    widget = GTK_WIDGET(gtk_builder_get_object(builder, widget_name));
+    gtk_builder_connect_signals(builder, NULL);
+    g_object_unref(G_OBJECT(builder));
+
+    return(widget);
+}
+
+#endif
@@ -0,0 +1 @@
+../../gscope/src/symdict.c
\ No newline at end of file
@@ -0,0 +1 @@
+../../gscope/src/symdict.h
\ No newline at end of file
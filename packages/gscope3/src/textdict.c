@@ -0,0 +1 @@
+../../gscope/src/textdict.c
\ No newline at end of file
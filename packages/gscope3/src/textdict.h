@@ -0,0 +1 @@
+../../gscope/src/textdict.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../gscope/src/trace.c
\ No newline at end of file
@@ -0,0 +1 @@
+../../gscope/src/trace.h
\ No newline at end of file
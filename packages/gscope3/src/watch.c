@@ -0,0 +1 @@
+../../gscope/src/watch.c
\ No newline at end of file
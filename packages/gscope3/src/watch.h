@@ -0,0 +1 @@
+../../gscope/src/watch.h
\ No newline at end of file